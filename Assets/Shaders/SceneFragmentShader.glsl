@@ -0,0 +1,15 @@
+#version 330 core
+
+in vec3 Position;
+
+uniform vec4 tint;
+
+out vec4 outColour;
+
+void main()
+{
+    // Scene meshes only promise positions, so faces are lit by the normal of the triangle they're on
+    vec3 normal = normalize(cross(dFdx(Position), dFdy(Position)));
+    float light = 0.35 + 0.65 * abs(dot(normal, normalize(vec3(0.4, 0.8, 0.45))));
+    outColour = vec4(tint.rgb * light, tint.a);
+}
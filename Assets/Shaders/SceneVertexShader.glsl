@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec3 position;
+
+uniform mat4 transform;
+
+out vec3 Position;
+
+void main()
+{
+    Position = position;
+    gl_Position = transform * vec4(position, 1.0);
+}
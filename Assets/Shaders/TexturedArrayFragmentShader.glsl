@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 TexCoord;
+flat in float Layer;
+out vec4 outColour;
+
+// Same size textures packed as layers of one array texture
+uniform sampler2DArray images;
+
+void main()
+{
+    outColour = texture(images, vec3(TexCoord, Layer));
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 330 core
+
+in vec2 TexCoord;
+out vec4 outColour;
+
+uniform sampler2D image;
+
+void main()
+{
+    outColour = texture(image, TexCoord);
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 330 core
+
+in vec2 position;
+// Per quad (instanced): centre and size in clip space, then the array layer (0 for a 2D texture)
+in vec4 placement;
+// Where the texture sits in its page: uv * xy + zw, (1, 1, 0, 0) for a texture of its own
+in vec4 uvTransform;
+
+out vec2 TexCoord;
+flat out float Layer;
+
+void main()
+{
+    // The quad spans -0.5..0.5, images are stored top row first
+    TexCoord = vec2(position.x + 0.5, 0.5 - position.y) * uvTransform.xy + uvTransform.zw;
+    Layer = placement.w;
+    gl_Position = vec4(position * placement.z + placement.xy, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,16 @@
+#version 330 core
+
+in vec2 position;
+
+uniform mat4 transform;
+// Where the texture sits in its atlas: uv * xy + zw, (1, 1, 0, 0) for a texture of its own
+uniform vec4 uvTransform;
+
+out vec2 TexCoord;
+
+void main()
+{
+    // The quad spans -0.5..0.5, images are stored top row first
+    TexCoord = vec2(position.x + 0.5, 0.5 - position.y) * uvTransform.xy + uvTransform.zw;
+    gl_Position = transform * vec4(position, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#version 330 core
+
+in vec2 TexCoord;
+out vec4 outColour;
+
+// The page this pixel would like, for VirtualTexture to read back: x and y's low 8 bits in red and green,
+// their next 4 in blue, the level in alpha (255, the clear value, is nothing)
+uniform vec2 virtualSize;
+uniform float pageSize;
+uniform float maxLevel;
+uniform float lodBias;
+
+vec2 levelSize(float level)
+{
+    return max(floor(virtualSize / exp2(level)), vec2(1.0));
+}
+
+void main()
+{
+    vec2 uv = clamp(TexCoord, 0.0, 1.0);
+    vec2 texel = uv * virtualSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias, 0.0, maxLevel);
+    float level = floor(lod);
+
+    vec2 pages = ceil(levelSize(level) / pageSize);
+    ivec2 page = ivec2(min(floor(uv * levelSize(level) / pageSize), pages - 1.0));
+    outColour = vec4(float(page.x & 255), float(page.y & 255), float((page.x >> 8) | ((page.y >> 8) << 4)),
+                     level) / 255.0;
+}
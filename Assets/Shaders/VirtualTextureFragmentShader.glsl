@@ -0,0 +1,38 @@
+#version 330 core
+
+in vec2 TexCoord;
+out vec4 outColour;
+
+// See src/VirtualTexture.h
+uniform sampler2D pageCache;   // tiles of pageSize + 2 * pageBorder texels
+uniform sampler2D indirection; // per level, per page: (cache slot x, slot y, level of the page there)
+uniform vec2 virtualSize;      // level 0 texels
+uniform float pageSize;
+uniform float pageBorder;
+uniform float cacheSize;       // texels per side
+uniform float maxLevel;
+uniform float lodBias;
+
+vec2 levelSize(float level)
+{
+    return max(floor(virtualSize / exp2(level)), vec2(1.0));
+}
+
+void main()
+{
+    vec2 uv = clamp(TexCoord, 0.0, 1.0);
+    vec2 texel = uv * virtualSize;
+    vec2 dx = dFdx(texel), dy = dFdy(texel);
+    float lod = clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + lodBias, 0.0, maxLevel);
+    float level = floor(lod);
+
+    vec2 pages = ceil(levelSize(level) / pageSize);
+    ivec2 page = ivec2(min(floor(uv * levelSize(level) / pageSize), pages - 1.0));
+    vec3 entry = floor(texelFetch(indirection, page, int(level)).xyz * 255.0 + 0.5);
+    // The page that's there may be an ancestor, entry.z levels down the chain
+    ivec2 resident = page >> ivec2(int(entry.z - level));
+    vec2 inPage = uv * levelSize(entry.z) / pageSize - vec2(resident);
+    inPage = clamp(inPage, -pageBorder / pageSize, 1.0 + pageBorder / pageSize);
+    vec2 slotTexel = entry.xy * (pageSize + 2.0 * pageBorder) + pageBorder + inPage * pageSize;
+    outColour = texture(pageCache, slotTexel / cacheSize);
+}
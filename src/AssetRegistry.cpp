@@ -0,0 +1,196 @@
+#include "AssetRegistry.h"
+#include <iostream>
+#include "ContentHash.h"
+
+namespace {
+
+// Slot + 1 in the low bits, so 0 is never an id, and the slot's generation above
+const int ASSET_SLOT_BITS = 20;
+const uint32_t ASSET_SLOT_MASK = (1u << ASSET_SLOT_BITS) - 1;
+const uint32_t ASSET_GENERATION_MASK = (1u << (32 - ASSET_SLOT_BITS)) - 1;
+
+AssetId makeId(uint32_t slot, uint32_t generation) {
+    return ((generation & ASSET_GENERATION_MASK) << ASSET_SLOT_BITS) | (slot + 1);
+}
+
+} // namespace
+
+AssetRegistry::~AssetRegistry() {
+    for (Entry &entry : entries)
+        if (entry.references > 0 && entry.free)
+            entry.free();
+}
+
+AssetRegistry::Entry *AssetRegistry::find(AssetId id) {
+    return const_cast<Entry *>(static_cast<const AssetRegistry *>(this)->find(id));
+}
+
+const AssetRegistry::Entry *AssetRegistry::find(AssetId id) const {
+    const uint32_t slot = (id & ASSET_SLOT_MASK) - 1;
+    if (id == 0 || slot >= entries.size())
+        return nullptr;
+    const Entry &entry = entries[slot];
+    if (entry.references == 0 || id != makeId(slot, entry.generation))
+        return nullptr;
+    return &entry;
+}
+
+AssetId AssetRegistry::acquire(AssetKind kind, uint64_t hash, size_t bytes, bool *added) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Key key = { hash, bytes, kind };
+    auto found = slots.find(key);
+    if (found != slots.end()) {
+        Entry &entry = entries[found->second];
+        entry.references++;
+        counters.references++;
+        counters.hits++;
+        counters.referencedBytes += bytes;
+        counters.residentReferencedBytes += entry.residentBytes;
+        if (added)
+            *added = false;
+        return makeId(found->second, entry.generation);
+    }
+
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else if (entries.size() < ASSET_SLOT_MASK) {
+        slot = (uint32_t) entries.size();
+        entries.emplace_back();
+    } else {
+        std::cerr << "ERROR::ASSETREGISTRY::FULL" << std::endl;
+        return 0;
+    }
+    Entry &entry = entries[slot];
+    entry.key = key;
+    entry.references = 1;
+    entry.failed = false;
+    slots[key] = slot;
+    counters.assets++;
+    counters.references++;
+    counters.uniqueBytes += bytes;
+    counters.referencedBytes += bytes;
+    if (added)
+        *added = true;
+    return makeId(slot, entry.generation);
+}
+
+AssetId AssetRegistry::acquire(AssetKind kind, const unsigned char *data, size_t size, bool *added) {
+    return acquire(kind, contentHash(data, size), size, added);
+}
+
+void AssetRegistry::retain(AssetId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(id);
+    if (!entry) {
+        std::cerr << "ERROR::ASSETREGISTRY::STALE_ID " << id << std::endl;
+        return;
+    }
+    entry->references++;
+    counters.references++;
+    counters.referencedBytes += entry->key.bytes;
+    counters.residentReferencedBytes += entry->residentBytes;
+}
+
+void AssetRegistry::release(AssetId id) {
+    std::function<void()> free;
+    std::shared_ptr<void> instance;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry *entry = find(id);
+        if (!entry) {
+            std::cerr << "ERROR::ASSETREGISTRY::STALE_ID " << id << std::endl;
+            return;
+        }
+        counters.references--;
+        counters.referencedBytes -= entry->key.bytes;
+        counters.residentReferencedBytes -= entry->residentBytes;
+        if (--entry->references > 0)
+            return;
+        counters.assets--;
+        counters.uniqueBytes -= entry->key.bytes;
+        counters.residentBytes -= entry->residentBytes;
+        const uint32_t slot = (id & ASSET_SLOT_MASK) - 1;
+        auto mapped = slots.find(entry->key);
+        if (mapped != slots.end() && mapped->second == slot) // a failed asset's content may be loading again
+            slots.erase(mapped);
+        free.swap(entry->free);
+        instance.swap(entry->instance);
+        entry->object = 0;
+        entry->residentBytes = 0;
+        entry->generation++;
+        freeSlots.push_back(slot);
+    }
+    // Outside the lock, in case freeing wants the registry
+    if (free)
+        free();
+    instance.reset();
+}
+
+void AssetRegistry::publish(AssetId id, uint32_t object, size_t residentBytes, std::function<void()> free) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(id);
+    if (!entry) {
+        std::cerr << "ERROR::ASSETREGISTRY::STALE_ID " << id << std::endl;
+        return;
+    }
+    counters.residentBytes += residentBytes - entry->residentBytes;
+    counters.residentReferencedBytes += (residentBytes - entry->residentBytes) * entry->references;
+    entry->object = object;
+    entry->residentBytes = residentBytes;
+    entry->free = std::move(free);
+}
+
+void AssetRegistry::publish(AssetId id, std::shared_ptr<void> instance, size_t residentBytes) {
+    std::shared_ptr<void> previous;
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(id);
+    if (!entry) {
+        std::cerr << "ERROR::ASSETREGISTRY::STALE_ID " << id << std::endl;
+        return;
+    }
+    counters.residentBytes += residentBytes - entry->residentBytes;
+    counters.residentReferencedBytes += (residentBytes - entry->residentBytes) * entry->references;
+    previous.swap(entry->instance);
+    entry->instance = std::move(instance);
+    entry->residentBytes = residentBytes;
+}
+
+void AssetRegistry::fail(AssetId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry *entry = find(id);
+    if (!entry) {
+        std::cerr << "ERROR::ASSETREGISTRY::STALE_ID " << id << std::endl;
+        return;
+    }
+    if (entry->failed)
+        return;
+    entry->failed = true;
+    auto mapped = slots.find(entry->key);
+    if (mapped != slots.end() && mapped->second == (id & ASSET_SLOT_MASK) - 1)
+        slots.erase(mapped);
+}
+
+bool AssetRegistry::failed(AssetId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry *entry = find(id);
+    return !entry || entry->failed;
+}
+
+uint32_t AssetRegistry::object(AssetId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry *entry = find(id);
+    return entry ? entry->object : 0;
+}
+
+std::shared_ptr<void> AssetRegistry::instance(AssetId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry *entry = find(id);
+    return entry ? entry->instance : nullptr;
+}
+
+AssetRegistryStats AssetRegistry::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
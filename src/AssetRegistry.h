@@ -0,0 +1,112 @@
+#ifndef OPENGLPLAYGROUND_ASSETREGISTRY_H
+#define OPENGLPLAYGROUND_ASSETREGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Content addressed assets: whatever is imported is hashed (contentHash, so XXH64) and looked up here
+// before it's decoded, so two paths to the same bytes load, store and upload them once. The first to
+// acquire some content is told it added it and loads it, then publishes what it made (a GL name, or an
+// object like a GLMesh); everyone else gets the same id and shares that. References are counted, and when
+// the last one goes the free callback given to publish() runs, or the published object is dropped. If the
+// load fails, fail() tells everyone sharing it so, and the next acquire of that content loads it afresh.
+// Ids are 32 bits: a slot and a generation, so an id kept after its asset went is caught rather than
+// resolving to whatever took the slot. Every call is thread safe; free callbacks (and the registry's hold on
+// published objects) run on the thread whose release() let go of the last reference, so anything holding GL
+// objects should release from the GL thread.
+
+typedef uint32_t AssetId; // 0 is never a valid id
+
+enum class AssetKind : uint8_t {
+    Blob,
+    Texture,
+    Mesh
+};
+
+struct AssetRegistryStats {
+    size_t assets = 0;                  // distinct contents held
+    size_t references = 0;              // held on them
+    size_t hits = 0;                    // acquires that found their content already there, ever
+    size_t uniqueBytes = 0;             // content, each asset once
+    size_t referencedBytes = 0;         // content once per reference: what loading every reference would take
+    size_t residentBytes = 0;           // published (GPU) bytes, each asset once
+    size_t residentReferencedBytes = 0; // and once per reference
+
+    size_t dedupedBytes() const { return referencedBytes - uniqueBytes; }
+    size_t dedupedResidentBytes() const { return residentReferencedBytes - residentBytes; }
+};
+
+class AssetRegistry {
+public:
+    AssetRegistry() = default;
+    // Frees whatever is still held, on the destroying thread
+    ~AssetRegistry();
+    AssetRegistry(const AssetRegistry &) = delete;
+    AssetRegistry &operator=(const AssetRegistry &) = delete;
+
+    // A reference to the asset with this content, adding it if it's new: then *added is set and the caller
+    // is the one to load it and publish(). Content is the same if kind, hash and size are: hash should cover
+    // anything that changes what gets loaded from the bytes (settings as well as the bytes themselves).
+    AssetId acquire(AssetKind kind, uint64_t hash, size_t bytes, bool *added = nullptr);
+    // The same, hashing the bytes
+    AssetId acquire(AssetKind kind, const unsigned char *data, size_t size, bool *added = nullptr);
+    void retain(AssetId id);
+    void release(AssetId id);
+
+    // What was loaded for the asset: object is handed out by object(), residentBytes counts in the stats
+    // and free runs when the last reference goes
+    void publish(AssetId id, uint32_t object, size_t residentBytes, std::function<void()> free);
+    // For assets loaded into an object rather than a GL name: the registry holds on to it until the last
+    // reference goes, and instance() hands it to everyone sharing the asset
+    void publish(AssetId id, std::shared_ptr<void> instance, size_t residentBytes);
+    // The one that added id couldn't load it: whoever shares it should give up (and release), and the content
+    // is forgotten, so acquiring it again adds a new asset to load rather than sharing this one
+    void fail(AssetId id);
+    // Whether fail() was called for id (or id is stale)
+    bool failed(AssetId id) const;
+    // 0 until published, or if id is stale
+    uint32_t object(AssetId id) const;
+    // Null until published with an instance, or if id is stale
+    std::shared_ptr<void> instance(AssetId id) const;
+    AssetRegistryStats stats() const;
+
+private:
+    struct Key {
+        uint64_t hash;
+        size_t bytes;
+        AssetKind kind;
+        bool operator==(const Key &other) const {
+            return hash == other.hash && bytes == other.bytes && kind == other.kind;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &key) const { return (size_t) (key.hash ^ ((uint64_t) key.kind << 61)); }
+    };
+    struct Entry {
+        Key key;
+        uint32_t generation = 1; // bumped when the slot is freed
+        uint32_t references = 0;
+        uint32_t object = 0;
+        bool failed = false;
+        size_t residentBytes = 0;
+        std::function<void()> free;
+        std::shared_ptr<void> instance;
+    };
+
+    mutable std::mutex mutex;
+    std::vector<Entry> entries; // slot
+    std::vector<uint32_t> freeSlots;
+    std::unordered_map<Key, uint32_t, KeyHash> slots;
+    AssetRegistryStats counters; // kept up to date as references come and go
+
+    // The entry for id, or null (after an error) if it's stale. Mutex held.
+    Entry *find(AssetId id);
+    const Entry *find(AssetId id) const;
+};
+
+#endif //OPENGLPLAYGROUND_ASSETREGISTRY_H
@@ -0,0 +1,337 @@
+#include "AssetScheduler.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include "Parallel.h"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool isFinal(AssetState state) {
+    return state == AssetState::Ready || state == AssetState::Failed || state == AssetState::Cancelled;
+}
+
+} // namespace
+
+bool readAssetFile(const char *path, std::vector<unsigned char> &bytes) {
+    std::ifstream in(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!in.is_open()) {
+        std::cerr << "ERROR::ASSETSCHEDULER::CANNOT_OPEN " << path << std::endl;
+        return false;
+    }
+    bytes.resize((size_t) in.tellg());
+    in.seekg(0);
+    if (!in.read(reinterpret_cast<char *>(bytes.data()), (std::streamsize) bytes.size())) {
+        std::cerr << "ERROR::ASSETSCHEDULER::CANNOT_READ " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void touchAssetBytes(const void *data, size_t size) {
+    const auto *bytes = static_cast<const volatile unsigned char *>(data);
+    unsigned char sum = 0;
+    for (size_t offset = 0; offset < size; offset += 4096)
+        sum ^= bytes[offset];
+    (void) sum;
+}
+
+AssetScheduler::AssetScheduler(int ioThreads, int decodeThreads, int maxInFlight)
+        : maxInFlight(std::max(maxInFlight, 1)) {
+    if (decodeThreads <= 0)
+        decodeThreads = std::max(parallelThreadCount() - std::max(ioThreads, 1) - 1, 1);
+    for (int t = 0; t < std::max(ioThreads, 1); t++)
+        threads.emplace_back([this]() { readLoop(); });
+    for (int t = 0; t < decodeThreads; t++)
+        threads.emplace_back([this]() { decodeLoop(); });
+}
+
+AssetScheduler::~AssetScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeReaders.notify_all();
+    wakeDecoders.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+    // Whatever got as far as reading and never finished (or finished since the last update) still owes a
+    // discard
+    for (const std::unique_ptr<Asset> &asset : assets)
+        if (asset->started && asset->state != AssetState::Ready && asset->request.discard)
+            asset->request.discard();
+}
+
+AssetHandle AssetScheduler::request(AssetRequest &&request) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<Asset> created(new Asset());
+    created->request = std::move(request);
+    created->priority = created->request.priority;
+    assets.push_back(std::move(created));
+    const AssetHandle handle = (AssetHandle) assets.size();
+    counters.requested++;
+    unfinished++;
+
+    Asset &added = *assets.back();
+    AssetState inherited = AssetState::Ready;
+    for (AssetHandle dependency : added.request.dependencies) {
+        if (dependency == 0 || dependency >= handle) {
+            std::cerr << "ERROR::ASSETSCHEDULER::BAD_DEPENDENCY " << added.request.name << std::endl;
+            inherited = AssetState::Failed;
+            continue;
+        }
+        Asset &other = asset(dependency);
+        if (other.state == AssetState::Ready)
+            continue;
+        if (isFinal(other.state)) {
+            inherited = other.state;
+            continue;
+        }
+        added.waitingFor++;
+        other.dependents.push_back(handle);
+        lendPriority(dependency, added.priority);
+    }
+    if (inherited != AssetState::Ready)
+        finish(handle, inherited);
+    else if (added.waitingFor == 0)
+        enqueue(handle);
+    return handle;
+}
+
+void AssetScheduler::setPriority(AssetHandle handle, float priority) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Asset &changed = asset(handle);
+    changed.request.priority = priority;
+    changed.priority = priority;
+    for (AssetHandle dependency : changed.request.dependencies)
+        lendPriority(dependency, priority);
+}
+
+void AssetScheduler::lendPriority(AssetHandle handle, float priority) {
+    Asset &lender = asset(handle);
+    if (isFinal(lender.state) || lender.priority >= priority)
+        return;
+    lender.priority = priority;
+    for (AssetHandle dependency : lender.request.dependencies)
+        lendPriority(dependency, priority);
+}
+
+void AssetScheduler::cancel(AssetHandle handle) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Asset &cancelled = asset(handle);
+    auto unqueue = [handle](std::vector<AssetHandle> &queue) {
+        auto found = std::find(queue.begin(), queue.end(), handle);
+        if (found == queue.end())
+            return false;
+        queue.erase(found);
+        return true;
+    };
+    switch (cancelled.state) {
+    case AssetState::Waiting:
+        finish(handle, AssetState::Cancelled);
+        break;
+    case AssetState::Queued:
+        unqueue(readQueue);
+        finish(handle, AssetState::Cancelled);
+        break;
+    case AssetState::Decoding:
+        if (unqueue(decodeQueue))
+            finish(handle, AssetState::Cancelled);
+        else
+            cancelled.cancelling = true; // a thread has it, it finishes the job when it's done
+        break;
+    case AssetState::Reading:
+        cancelled.cancelling = true;
+        break;
+    case AssetState::Uploading:
+        unqueue(uploadQueue);
+        finish(handle, AssetState::Cancelled);
+        break;
+    default:
+        break;
+    }
+}
+
+AssetState AssetScheduler::state(AssetHandle handle) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return handle == 0 || handle > assets.size() ? AssetState::Failed : asset(handle).state;
+}
+
+bool AssetScheduler::busy() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return unfinished > 0;
+}
+
+AssetStreamStats AssetScheduler::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+AssetHandle AssetScheduler::takeBest(std::vector<AssetHandle> &queue) const {
+    if (queue.empty())
+        return 0;
+    size_t best = 0;
+    for (size_t i = 1; i < queue.size(); i++)
+        if (asset(queue[i]).priority > asset(queue[best]).priority)
+            best = i;
+    const AssetHandle handle = queue[best];
+    queue[best] = queue.back();
+    queue.pop_back();
+    return handle;
+}
+
+void AssetScheduler::enqueue(AssetHandle handle) {
+    asset(handle).state = AssetState::Queued;
+    readQueue.push_back(handle);
+    wakeReaders.notify_one();
+}
+
+void AssetScheduler::finish(AssetHandle handle, AssetState state) {
+    Asset &ended = asset(handle);
+    ended.state = state;
+    finished.push_back(handle);
+    unfinished--;
+    if (state == AssetState::Ready)
+        counters.ready++;
+    else if (state == AssetState::Failed)
+        counters.failed++;
+    else
+        counters.cancelled++;
+    if (ended.started) {
+        inFlight--;
+        wakeReaders.notify_all();
+        if (state != AssetState::Ready && ended.request.discard)
+            discards.push_back(handle);
+    }
+    for (AssetHandle dependent : ended.dependents) {
+        Asset &waiting = asset(dependent);
+        if (waiting.state != AssetState::Waiting)
+            continue; // cancelled already
+        if (state != AssetState::Ready)
+            finish(dependent, state);
+        else if (--waiting.waitingFor == 0)
+            enqueue(dependent);
+    }
+}
+
+void AssetScheduler::readLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeReaders.wait(lock, [this]() { return stopping || (!readQueue.empty() && inFlight < maxInFlight); });
+        if (stopping)
+            return;
+        const AssetHandle handle = takeBest(readQueue);
+        Asset &reading = asset(handle);
+        reading.state = AssetState::Reading;
+        reading.started = true;
+        inFlight++;
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        const bool ok = !reading.request.read || reading.request.read();
+        const double seconds = secondsSince(start);
+        lock.lock();
+        counters.readSeconds += seconds;
+        if (reading.cancelling) {
+            finish(handle, AssetState::Cancelled);
+        } else if (!ok) {
+            std::cerr << "ERROR::ASSETSCHEDULER::READ_FAILED " << reading.request.name << std::endl;
+            finish(handle, AssetState::Failed);
+        } else {
+            reading.state = AssetState::Decoding;
+            decodeQueue.push_back(handle);
+            wakeDecoders.notify_one();
+        }
+    }
+}
+
+void AssetScheduler::decodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wakeDecoders.wait(lock, [this]() { return stopping || !decodeQueue.empty(); });
+        if (stopping)
+            return;
+        const AssetHandle handle = takeBest(decodeQueue);
+        Asset &decoding = asset(handle);
+        lock.unlock();
+        auto start = std::chrono::steady_clock::now();
+        const bool ok = !decoding.request.decode || decoding.request.decode();
+        const double seconds = secondsSince(start);
+        lock.lock();
+        counters.decodeSeconds += seconds;
+        if (decoding.cancelling) {
+            finish(handle, AssetState::Cancelled);
+        } else if (!ok) {
+            std::cerr << "ERROR::ASSETSCHEDULER::DECODE_FAILED " << decoding.request.name << std::endl;
+            finish(handle, AssetState::Failed);
+        } else if (decoding.request.upload) {
+            decoding.state = AssetState::Uploading;
+            uploadQueue.push_back(handle);
+        } else {
+            finish(handle, AssetState::Ready);
+        }
+    }
+}
+
+void AssetScheduler::update(double budgetMilliseconds) {
+    auto start = std::chrono::steady_clock::now();
+    // Discards first, then let go of the callbacks (and whatever they hold) of everything finished, here on
+    // the render thread
+    std::vector<AssetHandle> owed, done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        owed.swap(discards);
+        done.swap(finished);
+    }
+    for (AssetHandle handle : owed)
+        asset(handle).request.discard();
+    for (AssetHandle handle : done)
+        asset(handle).request = AssetRequest();
+
+    // Another call only if the average one still fits in what's left of the budget
+    bool uploaded = false;
+    for (;;) {
+        AssetHandle handle;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (uploaded) {
+                const double average = counters.uploadSeconds / (double) counters.uploadCalls;
+                if ((secondsSince(start) + average) * 1000.0 > budgetMilliseconds)
+                    break;
+            }
+            handle = takeBest(uploadQueue);
+        }
+        if (!handle)
+            break;
+        Asset &uploading = asset(handle);
+        auto callStart = std::chrono::steady_clock::now();
+        const AssetUpload result = uploading.request.upload();
+        const double seconds = secondsSince(callStart);
+        uploaded = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.uploadSeconds += seconds;
+            counters.uploadCalls++;
+            if (result == AssetUpload::More) {
+                uploadQueue.push_back(handle);
+            } else if (result == AssetUpload::Done) {
+                finish(handle, AssetState::Ready);
+            } else {
+                std::cerr << "ERROR::ASSETSCHEDULER::UPLOAD_FAILED " << uploading.request.name << std::endl;
+                finish(handle, AssetState::Failed);
+            }
+        }
+    }
+
+    if (uploaded) {
+        const double milliseconds = secondsSince(start) * 1000.0;
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.updates++;
+        counters.longestUpdate = std::max(counters.longestUpdate, milliseconds);
+        if (milliseconds > budgetMilliseconds)
+            counters.overBudget++;
+    }
+}
@@ -0,0 +1,137 @@
+#ifndef OPENGLPLAYGROUND_ASSETSCHEDULER_H
+#define OPENGLPLAYGROUND_ASSETSCHEDULER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams assets in the background while the render loop keeps going. Each request goes through three
+// stages, any of which may be left out:
+// - read, on an I/O thread: get the bytes off disk (a read, or mapping and touching a file)
+// - decode, on a decode worker: turn them into something ready for GL
+// - upload, on the render thread inside update(), which stops calling uploads once its time budget for
+//   the frame is used up. An upload can return More to be called again later, so one big asset doesn't
+//   take a whole frame.
+// Every queue hands out the highest priority request first. A request can depend on others: it doesn't
+// start until they're all ready, and lends them its priority meanwhile so they don't hold it up. Failing
+// or cancelling a request does the same to everything depending on it.
+// At most maxInFlight requests are between read and done at once, which bounds the memory decoded assets
+// can take while they wait for upload.
+
+typedef uint32_t AssetHandle; // 0 is never a valid handle
+
+enum class AssetState {
+    Waiting,   // for dependencies
+    Queued,    // for an I/O thread
+    Reading,
+    Decoding,  // queued for or on a decode worker
+    Uploading, // queued for or between calls on the render thread
+    Ready,
+    Failed,
+    Cancelled
+};
+
+enum class AssetUpload {
+    Done,
+    More,  // call again, budget permitting
+    Failed
+};
+
+struct AssetRequest {
+    std::string name;                      // for errors
+    float priority = 0.0f;                 // higher first, see assetPriority()
+    std::vector<AssetHandle> dependencies; // have to be Ready before this starts
+    std::function<bool()> read;            // I/O thread
+    std::function<bool()> decode;          // decode worker
+    std::function<AssetUpload()> upload;   // render thread
+    // Render thread, when a request that had started reading is cancelled or fails: free anything half made
+    std::function<void()> discard;
+};
+
+// Anything visible beats anything that isn't, then nearer beats further
+inline float assetPriority(float distance, bool visible) {
+    return (visible ? 1.0f : 0.0f) + 1.0f / (2.0f + (distance > 0.0f ? distance : 0.0f));
+}
+
+struct AssetStreamStats {
+    size_t requested = 0, ready = 0, failed = 0, cancelled = 0;
+    double readSeconds = 0.0, decodeSeconds = 0.0; // summed over the threads
+    double uploadSeconds = 0.0;  // render thread, in upload calls
+    size_t uploadCalls = 0;
+    size_t updates = 0;          // update() calls that had something to upload
+    double longestUpdate = 0.0;  // milliseconds, of those
+    size_t overBudget = 0;       // updates that went over their budget (a single upload call can't be split)
+};
+
+// Reads a whole file, for read stages. False (after an error) if it can't.
+bool readAssetFile(const char *path, std::vector<unsigned char> &bytes);
+// Reads a byte of every page, so a memory mapped file is off the disk before the render thread touches it
+void touchAssetBytes(const void *data, size_t size);
+
+class AssetScheduler {
+public:
+    // 0 decode threads = one per core, less the I/O and render threads
+    explicit AssetScheduler(int ioThreads = 2, int decodeThreads = 0, int maxInFlight = 16);
+    ~AssetScheduler();
+    AssetScheduler(const AssetScheduler &) = delete;
+    AssetScheduler &operator=(const AssetScheduler &) = delete;
+
+    // Render thread only, like cancel() and update(), and none of them from inside a callback. Destroying
+    // the scheduler drops whatever hasn't finished (discarding what had started).
+    AssetHandle request(AssetRequest &&request);
+    // Priorities only ever grow through dependencies: lowering a request's doesn't lower what it lent
+    void setPriority(AssetHandle handle, float priority);
+    // Stops the request as soon as whatever stage it's in returns. Ready ones stay ready.
+    void cancel(AssetHandle handle);
+    AssetState state(AssetHandle handle) const;
+    bool ready(AssetHandle handle) const { return state(handle) == AssetState::Ready; }
+
+    // Once a frame: discards what was cancelled, then uploads by priority until budgetMilliseconds is used
+    // (at least one upload call, so there's always progress)
+    void update(double budgetMilliseconds);
+    // Something still isn't Ready, Failed or Cancelled
+    bool busy() const;
+    AssetStreamStats stats() const;
+
+private:
+    struct Asset {
+        AssetRequest request;
+        AssetState state = AssetState::Waiting;
+        float priority = 0.0f;               // with what dependents lent it
+        size_t waitingFor = 0;               // dependencies not ready yet
+        std::vector<AssetHandle> dependents;
+        bool started = false;                // read has begun, so discard is owed if it doesn't finish
+        bool cancelling = false;             // cancelled while a thread had it
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable wakeReaders, wakeDecoders;
+    std::vector<std::unique_ptr<Asset>> assets; // handle - 1
+    std::vector<AssetHandle> readQueue, decodeQueue, uploadQueue;
+    std::vector<AssetHandle> discards;          // for the render thread
+    std::vector<AssetHandle> finished;          // callbacks to let go of, on the render thread
+    int maxInFlight;
+    int inFlight = 0;
+    size_t unfinished = 0;
+    bool stopping = false;
+    AssetStreamStats counters;
+    std::vector<std::thread> threads;
+
+    Asset &asset(AssetHandle handle) const { return *assets[handle - 1]; }
+    // Takes the highest priority handle out of queue, 0 if it's empty
+    AssetHandle takeBest(std::vector<AssetHandle> &queue) const;
+    void lendPriority(AssetHandle handle, float priority);
+    void enqueue(AssetHandle handle);
+    // Final states, with the mutex held. They pass the result on to dependents.
+    void finish(AssetHandle handle, AssetState state);
+    void readLoop();
+    void decodeLoop();
+};
+
+#endif //OPENGLPLAYGROUND_ASSETSCHEDULER_H
@@ -0,0 +1,340 @@
+#include "Benchmarks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "ImageDecoder.h"
+#include "LODSelector.h"
+#include "Meshlets.h"
+#include "MeshOptimizer.h"
+#include "MipBuilder.h"
+#include "OBJLoader.h"
+#include "Playground.h"
+#include "Reports.h"
+#include "SceneFile.h"
+#include "SWMultisample.h"
+#include "SWProgramRegistry.h"
+#include "SWRasterizer.h"
+#include "TextureCompression.h"
+
+// The same quad the window shows, so the two can be compared
+int renderOnCPU(const char *outputPath, bool visibility, int msaaSamples) {
+    // The kernels are generated from the same .glsl files by ShaderTranslator
+    const SWProgram *program = swFindProgram(shaderProgramName(vertexShaderPath, fragmentShaderPath));
+    if (!program)
+        return -1;
+    SWUniformBlock uniforms(*program);
+    uniforms.setMat4("transform", glm::mat4(1.0f));
+
+    SWAttributeStreams attributes;
+    attributes.fromInterleaved(quadVertices, 4, 5, 5);
+
+    SWFramebuffer framebuffer(800, 600);
+    framebuffer.clear(0.1f, 0.1f, 0.1f, 1.0f);
+    framebuffer.clearDepth();
+
+    SWRasterizer rasterizer(framebuffer);
+    rasterizer.visibilityMode = visibility;
+    std::unique_ptr<SWMultisampleFramebuffer> msaa;
+    if (msaaSamples > 1) {
+        msaa.reset(new SWMultisampleFramebuffer(framebuffer.width, framebuffer.height, msaaSamples));
+        msaa->clear(0.1f, 0.1f, 0.1f, 1.0f);
+        msaa->clearDepth();
+        rasterizer.multisampleTarget = msaa.get();
+    }
+    const uint32_t cpuElements[6] = { quadElements[0], quadElements[1], quadElements[2], quadElements[3], quadElements[4],
+                                      quadElements[5] };
+    rasterizer.drawElements(*program, attributes, cpuElements, 6, uniforms.data());
+    if (msaa) {
+        // Compare against what the non-AA path would spend: its frame memory, and a plain copy of its colours
+        std::vector<uint32_t> copy(framebuffer.colour.size());
+        auto start = std::chrono::steady_clock::now();
+        msaa->resolve(framebuffer);
+        auto resolved = std::chrono::steady_clock::now();
+        std::copy(framebuffer.colour.begin(), framebuffer.colour.end(), copy.begin());
+        auto copied = std::chrono::steady_clock::now();
+        const size_t plainBytes = (framebuffer.colour.size() + framebuffer.depth.size()) * 4;
+        std::cout << "CPU MSAA " << msaa->samples << "x: " << msaa->memoryBytes() / 1024 << " KiB vs "
+                  << plainBytes / 1024 << " KiB without AA (" << msaa->expandedPixels() << " expanded pixels), resolve "
+                  << std::chrono::duration<double, std::milli>(resolved - start).count() << " ms vs copy "
+                  << std::chrono::duration<double, std::milli>(copied - resolved).count() << " ms" << std::endl;
+    }
+    if (visibility) {
+        rasterizer.resolveVisibility();
+        const SWVisibilityStats &stats = rasterizer.visibilityStats;
+        std::cout << "CPU (visibility buffer): " << stats.trianglesVisible << "/" << stats.trianglesRecorded
+                  << " triangles visible, " << stats.pixelsShaded << " pixels shaded, overdraw avoided "
+                  << stats.overdraw() << "x" << std::endl;
+    } else {
+        std::cout << "CPU: " << rasterizer.trianglesRasterized << " triangles, "
+                  << rasterizer.fragmentsShaded << " fragments" << std::endl;
+    }
+    return framebuffer.writePPM(outputPath) ? 0 : -1;
+}
+
+int loadOBJAndReport(const char *path) {
+    MeshData mesh;
+    OBJLoadStats stats;
+    if (!loadOBJ(path, mesh, &stats))
+        return -1;
+    std::cout << path << ": " << stats.bytes / (1024 * 1024) << " MiB in " << stats.seconds * 1000.0 << " ms on "
+              << stats.threads << " threads (" << stats.megabytesPerSecond() << " MB/s), " << stats.positions
+              << " positions, " << stats.corners / 3 << " triangles, " << stats.vertices << " unique vertices, "
+              << mesh.submeshes.size() << " submeshes" << std::endl;
+    return 0;
+}
+
+int loadCachedAndReport(const char *path, const MeshImportOptions &options) {
+    auto start = std::chrono::steady_clock::now();
+    CachedMesh mesh;
+    if (!mesh.load(path, options))
+        return -1;
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << path << ": " << (mesh.fromCache ? (mesh.compressed ? "compressed cache" : "cache") : "source, cache rebuilt")
+              << ", " << mesh.fileBytes / 1024 << " KiB read in " << ms << " ms, " << mesh.vertexCount << " vertices, "
+              << (mesh.lods.empty() ? mesh.indexCount : mesh.lods[0].indexCount) / 3 << " triangles, "
+              << mesh.submeshes.size() << " submeshes, " << mesh.lods.size() << " LODs" << std::endl;
+    const MeshOptimizeStats &optimized = mesh.importReport.optimize;
+    if (!mesh.fromCache && options.optimize)
+        std::cout << "  optimised in " << optimized.seconds * 1000.0 << " ms: ACMR " << optimized.acmrBefore << " -> "
+                  << optimized.acmrAfter << ", ATVR " << optimized.atvrBefore << " -> " << optimized.atvrAfter << ", "
+                  << optimized.clusters << " overdraw clusters" << std::endl;
+    const IndexPackStats &packed = mesh.importReport.indices;
+    if (!mesh.fromCache)
+        std::cout << "  indices: " << (packed.type == ComponentType::UnsignedShort ? "16" : "32") << " bit "
+                  << (packed.strips ? "strips" : "list") << " in " << packed.batches << " batches, "
+                  << packed.packedBytes / 1024 << " KiB vs " << packed.listBytes / 1024 << " KiB as a 32 bit list ("
+                  << packed.savedBytes() / 1024 << " KiB saved)" << std::endl;
+    else
+        std::cout << "  indices: " << componentSize(mesh.indexType) * 8 << " bit "
+                  << (mesh.mode == GL_TRIANGLE_STRIP ? "strips" : "list") << " in " << mesh.indexBatches.size()
+                  << " batches, " << mesh.indexBytes() / 1024 << " KiB" << std::endl;
+    return 0;
+}
+
+int benchmarkMesh(const char *path) {
+    const SWProgram *program = swFindProgram(shaderProgramName(vertexShaderPath, fragmentShaderPath));
+    if (!program)
+        return -1;
+    for (int optimize = 0; optimize < 2; optimize++) {
+        MeshImportOptions options;
+        options.optimize = options.meshlets = optimize != 0;
+        options.lods = false; // only level 0 is drawn here
+        MeshData mesh;
+        if (!importMesh(path, mesh, options))
+            return -1;
+        const VertexAttribute *position = mesh.layout.find("position");
+        const VertexAttribute *normal = mesh.layout.find("normal");
+        if (!position || position->type != ComponentType::Float) {
+            std::cerr << "ERROR::BENCHMARK::NEEDS_FLOAT_POSITIONS " << path << std::endl;
+            return -1;
+        }
+        // Our shader wants vec2 position + vec3 colour: use x/y, and the normal (if any) as the colour.
+        // The optimised run also gets meshlets, culled like the GL path does.
+        std::vector<float> vertices(mesh.vertexCount * 5, 1.0f);
+        for (size_t v = 0; v < mesh.vertexCount; v++) {
+            const float *src = reinterpret_cast<const float *>(&mesh.vertexData[v * mesh.layout.stride + position->offset]);
+            vertices[v * 5] = src[0];
+            vertices[v * 5 + 1] = src[1];
+            if (normal && normal->type == ComponentType::Float) {
+                const float *n = reinterpret_cast<const float *>(&mesh.vertexData[v * mesh.layout.stride + normal->offset]);
+                for (int c = 0; c < 3; c++)
+                    vertices[v * 5 + 2 + c] = n[c] * 0.5f + 0.5f;
+            }
+        }
+        SWAttributeStreams attributes;
+        attributes.fromInterleaved(vertices.data(), (int) mesh.vertexCount, 5, 5);
+        const glm::vec3 extent = mesh.boundsMax - mesh.boundsMin;
+        const float scale = 1.5f / std::max(std::max(extent.x, extent.y), 1e-6f);
+        SWUniformBlock uniforms(*program);
+        const glm::mat4 transform = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(scale)),
+                                                   -(mesh.boundsMin + mesh.boundsMax) * 0.5f);
+        uniforms.setMat4("transform", transform);
+
+        SWFramebuffer framebuffer(800, 600);
+        SWRasterizer rasterizer(framebuffer);
+        MeshletCuller culler;
+        std::vector<uint32_t> visibleIndices;
+        const int frames = 10;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            framebuffer.clear(0.1f, 0.1f, 0.1f, 1.0f);
+            framebuffer.clearDepth();
+            if (mesh.meshlets.empty()) {
+                rasterizer.drawElements(*program, attributes, mesh.indices.data(), (int) mesh.indices.size(), uniforms.data());
+                continue;
+            }
+            // The CPU backend transforms every vertex per draw call, so the surviving ranges go in one call
+            culler.cull(mesh.meshlets.data(), mesh.meshlets.size(), transform,
+                        glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+            visibleIndices.clear();
+            for (size_t r = 0; r < culler.firstIndex.size(); r++)
+                visibleIndices.insert(visibleIndices.end(), mesh.indices.begin() + culler.firstIndex[r],
+                                      mesh.indices.begin() + culler.firstIndex[r] + culler.indexCount[r]);
+            rasterizer.drawElements(*program, attributes, visibleIndices.data(), (int) visibleIndices.size(), uniforms.data());
+        }
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << (optimize ? "optimised: " : "as imported: ") << "ACMR "
+                  << computeACMR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount) << ", ATVR "
+                  << computeATVR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount) << ", CPU "
+                  << ms / frames << " ms/frame, " << rasterizer.fragmentsShaded << " fragments";
+        if (!mesh.meshlets.empty())
+            std::cout << ", " << mesh.meshlets.size() << " meshlets, " << culler.stats.cullRate() * 100.0
+                      << "% culled, " << culler.stats.ranges << " ranges";
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+int benchmarkLODs(const char *path, size_t instanceCount) {
+    CachedMesh mesh;
+    if (!mesh.load(path))
+        return -1;
+    if (!mesh.fromCache)
+        std::cout << path << ": LOD chain built in " << mesh.importReport.lodSeconds * 1000.0 << " ms" << std::endl;
+    for (size_t l = 0; l < mesh.lods.size(); l++)
+        std::cout << "  LOD " << l << ": " << mesh.lods[l].indexCount / 3 << " triangles, error "
+                  << mesh.lods[l].error << std::endl;
+    if (mesh.lods.empty())
+        return -1;
+
+    // The mesh's origin is whatever the file says, bound it around that
+    const float radius = std::max(glm::length(mesh.boundsMin), glm::length(mesh.boundsMax));
+    const float field = radius * 20.0f * std::sqrt((float) instanceCount);
+    LODInstances instances;
+    instances.resize(instanceCount);
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> across(-field * 0.5f, field * 0.5f), scales(0.5f, 2.0f);
+    for (size_t i = 0; i < instanceCount; i++)
+        instances.set(i, glm::vec3(across(random), 0.0f, across(random)), scales(random));
+
+    // 1080p, 60 degree vertical field of view
+    const float projectionScale = 1080.0f / (2.0f * std::tan(glm::radians(30.0f)));
+    for (float hysteresis : { 0.0f, 0.25f }) {
+        LODSelector selector;
+        selector.hysteresis = hysteresis;
+        std::fill(instances.lod.begin(), instances.lod.end(), 0);
+        const int frames = 240;
+        double milliseconds = 0.0, triangles = 0.0, fullTriangles = 0.0;
+        size_t switches = 0, flickers = 0;
+        // Levels of the two frames before, to count instances that went straight back (visible popping)
+        std::vector<uint8_t> before(instances.lod), twoBefore(instances.lod);
+        for (int frame = 0; frame < frames; frame++) {
+            // Walk across the field at a height of a few meshes, swaying a little from side to side like a
+            // hand held camera, which is what makes instances near a threshold flicker without hysteresis
+            const float t = (float) frame / (float) (frames - 1);
+            const glm::vec3 eye(radius * 1000.0f * (t - 0.5f), radius * 4.0f, radius * 2.0f * std::sin((float) frame * 0.7f));
+            selector.select(mesh.lods.data(), mesh.lods.size(), radius, instances, eye, projectionScale);
+            milliseconds += selector.stats.milliseconds;
+            triangles += (double) selector.stats.triangles;
+            fullTriangles += (double) selector.stats.fullDetailTriangles;
+            if (frame > 0) // the first frame is everything settling from level 0
+                switches += selector.stats.switches;
+            for (size_t i = 0; i < instanceCount; i++)
+                flickers += frame > 1 && instances.lod[i] == twoBefore[i] && instances.lod[i] != before[i];
+            twoBefore.swap(before);
+            before = instances.lod;
+        }
+        std::cout << instanceCount << " instances, hysteresis " << hysteresis << ": " << milliseconds / frames
+                  << " ms/frame selecting, " << triangles / frames / 1e6 << "M triangles/frame vs "
+                  << fullTriangles / frames / 1e6 << "M at full detail, " << (double) switches / (frames - 1)
+                  << " LOD switches/frame (" << (double) flickers / (frames - 2)
+                  << " straight back), last frame per level:";
+        for (size_t count : selector.stats.perLevel)
+            std::cout << " " << count;
+        std::cout << std::endl;
+    }
+    return 0;
+}
+
+// Opens a .scene and runs the transform pass over it: the first pass pages the locals in, later ones are
+// what a frame would pay
+int benchmarkScene(const char *path, JobSystem &jobs) {
+    auto start = std::chrono::steady_clock::now();
+    SceneFile scene;
+    if (!scene.open(path))
+        return -1;
+    auto opened = std::chrono::steady_clock::now();
+    TransformHierarchy hierarchy;
+    hierarchy.attach(scene.transforms());
+    auto attached = std::chrono::steady_clock::now();
+    hierarchy.update();
+    auto updated = std::chrono::steady_clock::now();
+    const int passes = 10;
+    jobs.resetStats();
+    for (int pass = 0; pass < passes; pass++)
+        hierarchy.update();
+    const double passMilliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - updated).count() / passes;
+
+    size_t meshNodes = 0;
+    for (size_t i = 0; i < scene.nodeCount(); i++)
+        meshNodes += scene.meshes()[i] != SCENE_NONE ? 1 : 0;
+    std::cout << path << ": " << scene.nodeCount() << " nodes (" << meshNodes << " with meshes), "
+              << scene.meshCount() << " meshes, " << scene.materialCount() << " materials. Open "
+              << std::chrono::duration<double, std::milli>(opened - start).count() << " ms, attach "
+              << std::chrono::duration<double, std::milli>(attached - opened).count() << " ms, first transform pass "
+              << std::chrono::duration<double, std::milli>(updated - attached).count() << " ms, then "
+              << passMilliseconds << " ms a pass" << std::endl;
+    reportJobs(jobs);
+    return 0;
+}
+
+int benchmarkMips(const char *path) {
+    Image image;
+    if (!loadImage(path, image))
+        return -1;
+    std::cout << path << ": " << image.width << "x" << image.height << std::endl;
+    for (MipFilter filter : { MipFilter::Box, MipFilter::Kaiser }) {
+        for (int threads : { 1, 0 }) {
+            MipOptions options;
+            options.filter = filter;
+            options.threadCount = threads;
+            std::vector<Image> mips;
+            Image copy = image;
+            const auto start = std::chrono::steady_clock::now();
+            buildMipChain(std::move(copy), mips, options);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "  " << (filter == MipFilter::Box ? "box" : "kaiser") << ", "
+                      << (threads == 1 ? "1 thread" : "all threads") << ": " << mips.size() << " levels in " << ms
+                      << " ms, " << (double) image.width * image.height / ms / 1000.0 << " MPix/s" << std::endl;
+        }
+    }
+    return 0;
+}
+
+int benchmarkBlockCompression(const char *path) {
+    Image image;
+    if (!loadImage(path, image))
+        return -1;
+    std::cout << path << ": " << image.width << "x" << image.height << std::endl;
+    for (BCFormat format : { BCFormat::BC1, BCFormat::BC3, BCFormat::BC5, BCFormat::BC7 }) {
+        // BC1 drops colour where it punches alpha out and BC5 only keeps two channels, so only compare those
+        const int channels = format == BCFormat::BC5 ? 2 : format == BCFormat::BC1 ? 3 : 4;
+        for (BCQuality quality : { BCQuality::Fast, BCQuality::Normal, BCQuality::Best }) {
+            CompressedImage compressed;
+            const auto start = std::chrono::steady_clock::now();
+            compressImage(image, format, quality, compressed);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            Image decoded;
+            decompressImage(compressed, decoded);
+            double squaredError = 0.0;
+            for (size_t i = 0; i < image.pixels.size(); i += 4)
+                for (int c = 0; c < channels; c++) {
+                    const double difference = (double) image.pixels[i + c] - decoded.pixels[i + c];
+                    squaredError += difference * difference;
+                }
+            const double mse = squaredError / ((double) image.width * image.height * channels);
+            std::cout << "  " << bcFormatName(format) << " "
+                      << (quality == BCQuality::Fast ? "fast" : quality == BCQuality::Normal ? "normal" : "best")
+                      << ": " << ms << " ms, " << (double) image.width * image.height / ms / 1000.0 << " MPix/s, "
+                      << compressed.bytes() / 1024 << " KiB, PSNR "
+                      << (mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 99.0) << " dB" << std::endl;
+        }
+    }
+    return 0;
+}
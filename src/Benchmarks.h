@@ -0,0 +1,28 @@
+#ifndef OPENGLPLAYGROUND_BENCHMARKS_H
+#define OPENGLPLAYGROUND_BENCHMARKS_H
+
+#include <cstddef>
+#include "JobSystem.h"
+#include "MeshCache.h"
+
+// The command line modes that don't open a window (see CommandLine.h): each loads or renders something,
+// prints what it took and returns what main() should.
+
+// Renders the quad with the software rasterizer into a PPM
+int renderOnCPU(const char *outputPath, bool visibility, int msaaSamples);
+// Loads an OBJ and reports how fast it went
+int loadOBJAndReport(const char *path);
+// Loads a mesh through its .mesh cache (rebuilding it if stale) and reports where it came from
+int loadCachedAndReport(const char *path, const MeshImportOptions &options);
+// Renders a mesh with the CPU backend as imported and as optimised, to see what the optimizer buys
+int benchmarkMesh(const char *path);
+// Scatters instances of a mesh over a field, flies a camera through it and reports what LOD selection saves
+int benchmarkLODs(const char *path, size_t instanceCount);
+// Opens a .scene and times its transform passes
+int benchmarkScene(const char *path, JobSystem &jobs);
+// Builds the mip chain of an image with each filter, on one thread and on all of them
+int benchmarkMips(const char *path);
+// Compresses an image in every format and quality, reporting speed and error against the original
+int benchmarkBlockCompression(const char *path);
+
+#endif //OPENGLPLAYGROUND_BENCHMARKS_H
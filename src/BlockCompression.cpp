@@ -0,0 +1,207 @@
+#include "BlockCompression.h"
+#include <cstring>
+#include <iostream>
+#include "Parallel.h"
+
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5 // the format requires the last 5 bytes to be literals...
+#define LZ4_MATCH_LIMIT 12  // ...and the last match to start at least 12 bytes before the end
+#define LZ4_HASH_BITS 14
+#define LZ4_MAX_OFFSET 65535
+#define BLOCK_STORED_RAW 0x80000000u
+
+static inline uint32_t read32(const unsigned char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4);
+    return value;
+}
+
+static inline uint32_t hash4(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+// 15 fits in the token nibble, the rest goes out as a run of 255s and a final byte
+static inline unsigned char *writeLength(unsigned char *op, size_t length) {
+    for (; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = (unsigned char) length;
+    return op;
+}
+
+static unsigned char *writeSequence(unsigned char *op, const unsigned char *literals, size_t literalLength,
+                                    size_t offset, size_t matchLength) {
+    unsigned char *token = op++;
+    *token = (unsigned char) ((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15)
+        op = writeLength(op, literalLength - 15);
+    std::memcpy(op, literals, literalLength);
+    op += literalLength;
+    if (matchLength == 0)
+        return op; // last sequence, literals only
+    *op++ = (unsigned char) (offset & 0xFF);
+    *op++ = (unsigned char) (offset >> 8);
+    matchLength -= LZ4_MIN_MATCH;
+    *token |= (unsigned char) (matchLength >= 15 ? 15 : matchLength);
+    if (matchLength >= 15)
+        op = writeLength(op, matchLength - 15);
+    return op;
+}
+
+size_t lz4Compress(const unsigned char *src, size_t length, unsigned char *dst, size_t capacity) {
+    if (capacity < lz4CompressBound(length))
+        return 0; // keeps the loop free of capacity checks
+    unsigned char *op = dst;
+    size_t anchor = 0;
+    if (length > LZ4_MATCH_LIMIT) {
+        std::vector<uint32_t> table((size_t) 1 << LZ4_HASH_BITS, 0xFFFFFFFFu);
+        const size_t limit = length - LZ4_MATCH_LIMIT, matchEnd = length - LZ4_LAST_LITERALS;
+        size_t ip = 0;
+        unsigned misses = 0;
+        while (ip < limit) {
+            const uint32_t sequence = read32(src + ip);
+            const uint32_t h = hash4(sequence);
+            const uint32_t candidate = table[h];
+            table[h] = (uint32_t) ip;
+            if (candidate == 0xFFFFFFFFu || ip - candidate > LZ4_MAX_OFFSET || read32(src + candidate) != sequence) {
+                // Incompressible data: skip ahead faster the longer we go without a match
+                ip += 1 + (misses++ >> 6);
+                continue;
+            }
+            misses = 0;
+            size_t match = candidate, start = ip;
+            // Extend backwards into the pending literals, then forwards
+            while (start > anchor && match > 0 && src[start - 1] == src[match - 1]) {
+                start--;
+                match--;
+            }
+            size_t end = ip + LZ4_MIN_MATCH;
+            while (end < matchEnd && src[end] == src[match + (end - start)])
+                end++;
+            op = writeSequence(op, src + anchor, start - anchor, start - match, end - start);
+            anchor = ip = end;
+            if (ip < limit) // so the next match can refer back to just before here
+                table[hash4(read32(src + ip - 2))] = (uint32_t) (ip - 2);
+        }
+    }
+    op = writeSequence(op, src + anchor, length - anchor, 0, 0);
+    return (size_t) (op - dst);
+}
+
+bool lz4Decompress(const unsigned char *src, size_t srcLength, unsigned char *dst, size_t dstLength) {
+    size_t ip = 0, op = 0;
+    while (ip < srcLength) {
+        const unsigned token = src[ip++];
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            unsigned char byte;
+            do {
+                if (ip >= srcLength)
+                    return false;
+                byte = src[ip++];
+                literals += byte;
+            } while (byte == 255);
+        }
+        if (literals > srcLength - ip || literals > dstLength - op)
+            return false;
+        std::memcpy(dst + op, src + ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip == srcLength)
+            break; // the last sequence has no match
+        if (srcLength - ip < 2)
+            return false;
+        const size_t offset = (size_t) src[ip] | ((size_t) src[ip + 1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > op)
+            return false;
+        size_t matchLength = token & 15;
+        if (matchLength == 15) {
+            unsigned char byte;
+            do {
+                if (ip >= srcLength)
+                    return false;
+                byte = src[ip++];
+                matchLength += byte;
+            } while (byte == 255);
+        }
+        matchLength += LZ4_MIN_MATCH;
+        if (matchLength > dstLength - op)
+            return false;
+        if (offset >= matchLength) {
+            std::memcpy(dst + op, dst + op - offset, matchLength);
+        } else {
+            for (size_t i = 0; i < matchLength; i++) // overlapping copy repeats the pattern
+                dst[op + i] = dst[op + i - offset];
+        }
+        op += matchLength;
+    }
+    return op == dstLength;
+}
+
+void compressBlocks(const unsigned char *src, size_t length, std::vector<unsigned char> &out, int threadCount) {
+    const size_t blockCount = (length + COMPRESSION_BLOCK_BYTES - 1) / COMPRESSION_BLOCK_BYTES;
+    std::vector<std::vector<unsigned char>> blocks(blockCount);
+    std::vector<uint32_t> sizes(blockCount);
+    parallelBlocks(blockCount, [&](size_t b) {
+        const size_t begin = b * COMPRESSION_BLOCK_BYTES;
+        const size_t size = std::min<size_t>(COMPRESSION_BLOCK_BYTES, length - begin);
+        std::vector<unsigned char> &block = blocks[b];
+        block.resize(lz4CompressBound(size));
+        size_t compressed = lz4Compress(src + begin, size, block.data(), block.size());
+        if (compressed == 0 || compressed >= size) { // didn't help, store it as is
+            block.assign(src + begin, src + begin + size);
+            sizes[b] = (uint32_t) size | BLOCK_STORED_RAW;
+        } else {
+            block.resize(compressed);
+            sizes[b] = (uint32_t) compressed;
+        }
+    }, threadCount);
+
+    out.clear();
+    const uint32_t count = (uint32_t) blockCount;
+    out.insert(out.end(), reinterpret_cast<const unsigned char *>(&count), reinterpret_cast<const unsigned char *>(&count) + 4);
+    out.insert(out.end(), reinterpret_cast<const unsigned char *>(sizes.data()),
+               reinterpret_cast<const unsigned char *>(sizes.data() + blockCount));
+    for (const std::vector<unsigned char> &block : blocks)
+        out.insert(out.end(), block.begin(), block.end());
+}
+
+bool decompressBlocks(const unsigned char *src, size_t srcLength, unsigned char *dst, size_t dstLength,
+                      int threadCount) {
+    if (srcLength < 4) {
+        std::cerr << "ERROR::BLOCKCOMPRESSION::TRUNCATED" << std::endl;
+        return false;
+    }
+    const size_t blockCount = read32(src);
+    if (blockCount != (dstLength + COMPRESSION_BLOCK_BYTES - 1) / COMPRESSION_BLOCK_BYTES ||
+        4 + blockCount * 4 > srcLength) {
+        std::cerr << "ERROR::BLOCKCOMPRESSION::BAD_BLOCK_TABLE" << std::endl;
+        return false;
+    }
+    // Where every block starts, from the size table
+    std::vector<size_t> offsets(blockCount + 1);
+    offsets[0] = 4 + blockCount * 4;
+    for (size_t b = 0; b < blockCount; b++)
+        offsets[b + 1] = offsets[b] + (read32(src + 4 + b * 4) & ~BLOCK_STORED_RAW);
+    if (offsets[blockCount] > srcLength) {
+        std::cerr << "ERROR::BLOCKCOMPRESSION::TRUNCATED" << std::endl;
+        return false;
+    }
+    std::atomic<bool> ok(true);
+    parallelBlocks(blockCount, [&](size_t b) {
+        const size_t begin = b * COMPRESSION_BLOCK_BYTES;
+        const size_t size = std::min<size_t>(COMPRESSION_BLOCK_BYTES, dstLength - begin);
+        const size_t stored = offsets[b + 1] - offsets[b];
+        if (read32(src + 4 + b * 4) & BLOCK_STORED_RAW) {
+            if (stored != size)
+                ok = false;
+            else
+                std::memcpy(dst + begin, src + offsets[b], size);
+        } else if (!lz4Decompress(src + offsets[b], stored, dst + begin, size)) {
+            ok = false;
+        }
+    }, threadCount);
+    if (!ok)
+        std::cerr << "ERROR::BLOCKCOMPRESSION::CORRUPT_BLOCK" << std::endl;
+    return ok;
+}
@@ -0,0 +1,34 @@
+#ifndef OPENGLPLAYGROUND_BLOCKCOMPRESSION_H
+#define OPENGLPLAYGROUND_BLOCKCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// LZ4 block format codec (compatible with the reference lz4 library's LZ4_compress_default /
+// LZ4_decompress_safe), written here because we can't vendor dependencies. Fast greedy matcher,
+// nowhere near lz4hc ratios, but decompression is what matters for load times.
+
+// Worst case compressed size of n bytes
+inline size_t lz4CompressBound(size_t n) {
+    return n + n / 255 + 16;
+}
+// Most n compressed bytes can come to: past the first few, every byte of a match length is 255 more bytes
+inline uint64_t lz4DecompressBound(uint64_t n) {
+    return n * 255 + 16;
+}
+// Returns the compressed size, or 0 if it doesn't fit in capacity
+size_t lz4Compress(const unsigned char *src, size_t length, unsigned char *dst, size_t capacity);
+// Returns false if src is corrupt or doesn't decompress to exactly dstLength bytes
+bool lz4Decompress(const unsigned char *src, size_t srcLength, unsigned char *dst, size_t dstLength);
+
+// Blob of independently compressed blocks, so both directions parallelise:
+// uint32 block count, uint32 stored size per block (top bit set = stored uncompressed), then the blocks
+#define COMPRESSION_BLOCK_BYTES (256u * 1024u)
+
+void compressBlocks(const unsigned char *src, size_t length, std::vector<unsigned char> &out, int threadCount = 0);
+// dstLength is the original size, which the caller has to have stored somewhere
+bool decompressBlocks(const unsigned char *src, size_t srcLength, unsigned char *dst, size_t dstLength,
+                      int threadCount = 0);
+
+#endif //OPENGLPLAYGROUND_BLOCKCOMPRESSION_H
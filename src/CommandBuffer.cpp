@@ -0,0 +1,71 @@
+#include "CommandBuffer.h"
+
+namespace {
+
+float asFloat(uint32_t word) {
+    float value;
+    std::memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+} // namespace
+
+void CommandBuffer::replay() const {
+    const uint32_t *word = words.data();
+    const uint32_t *end = word + words.size();
+    while (word < end) {
+        const uint32_t header = *word++;
+        const GLint operand = (GLint) (header >> 8);
+        switch ((RenderCommand) (header & 0xFF)) {
+        case RenderCommand::UseProgram:
+            glUseProgram(word[0]);
+            word += 1;
+            break;
+        case RenderCommand::BindVertexArray:
+            glBindVertexArray(word[0]);
+            word += 1;
+            break;
+        case RenderCommand::BindTexture:
+            glActiveTexture(GL_TEXTURE0 + (GLenum) operand);
+            glBindTexture(word[0], word[1]);
+            word += 2;
+            break;
+        case RenderCommand::PrimitiveRestart:
+            if (word[0]) {
+                glEnable(GL_PRIMITIVE_RESTART);
+                glPrimitiveRestartIndex(word[0]);
+            } else {
+                glDisable(GL_PRIMITIVE_RESTART);
+            }
+            word += 1;
+            break;
+        case RenderCommand::UniformInt:
+            glUniform1i(operand, (GLint) word[0]);
+            word += 1;
+            break;
+        case RenderCommand::UniformFloat:
+            glUniform1f(operand, asFloat(word[0]));
+            word += 1;
+            break;
+        case RenderCommand::UniformVec4:
+            // The words are the floats' bits, written with memcpy, so they can go to GL as they are
+            glUniform4fv(operand, 1, reinterpret_cast<const GLfloat *>(word));
+            word += 4;
+            break;
+        case RenderCommand::UniformMat4:
+            glUniformMatrix4fv(operand, 1, GL_FALSE, reinterpret_cast<const GLfloat *>(word));
+            word += 16;
+            break;
+        case RenderCommand::DrawElements: {
+            const size_t offset = (size_t) ((uint64_t) word[3] | (uint64_t) word[4] << 32);
+            glDrawElementsBaseVertex(word[0], (GLsizei) word[1], word[2], (const void *) offset, (GLint) word[5]);
+            word += 6;
+            break;
+        }
+        case RenderCommand::DrawArrays:
+            glDrawArrays(word[0], (GLint) word[1], (GLsizei) word[2]);
+            word += 3;
+            break;
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#ifndef OPENGLPLAYGROUND_COMMANDBUFFER_H
+#define OPENGLPLAYGROUND_COMMANDBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+// GL calls written down to be made later. Only the thread with the context can call GL, but working out
+// what to draw (culling, picking state, computing uniforms) can happen anywhere: workers record into buffers
+// of their own, so recording takes no locks at all, and the GL thread replays the buffers in order in one
+// tight loop with nothing left to decide.
+// A command is a 32 bit word, the opcode in the low byte and a small operand (uniform location, texture
+// unit) in the rest, followed by its arguments as words. Leaving out binds that change nothing is up to
+// whoever records, as it would be calling GL.
+// DirectCommands takes the same calls and makes them straight away, so code written against either (a
+// template parameter) can be timed both ways.
+
+enum class RenderCommand : uint8_t {
+    UseProgram,        // program
+    BindVertexArray,   // vertex array
+    BindTexture,       // operand: unit. target, texture
+    PrimitiveRestart,  // restart index, 0 = off
+    UniformInt,        // operand: location. value
+    UniformFloat,      // operand: location. value
+    UniformVec4,       // operand: location. 4 floats
+    UniformMat4,       // operand: location. 16 floats, column major
+    DrawElements,      // mode, count, index type, offset (low, high), base vertex
+    DrawArrays,        // mode, first, count
+};
+
+// Largest operand that fits next to the opcode
+#define RENDER_COMMAND_MAX_OPERAND 0xFFFFFFu
+
+class CommandBuffer {
+public:
+    // Empties the buffer, keeping its memory
+    void clear() {
+        words.clear();
+        commands = 0;
+    }
+
+    void useProgram(GLuint id) { add(RenderCommand::UseProgram, 0, &id, 1); }
+    void bindVertexArray(GLuint id) { add(RenderCommand::BindVertexArray, 0, &id, 1); }
+    void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+        const uint32_t arguments[2] = { target, texture };
+        add(RenderCommand::BindTexture, unit, arguments, 2);
+    }
+    void primitiveRestart(GLuint index) { add(RenderCommand::PrimitiveRestart, 0, &index, 1); }
+
+    // Locations come from the program beforehand (glGetUniformLocation is a GL call too). -1, like GL, is
+    // ignored.
+    void uniform(GLint location, int value) { addUniform(RenderCommand::UniformInt, location, &value, 1); }
+    void uniform(GLint location, float value) { addUniform(RenderCommand::UniformFloat, location, &value, 1); }
+    void uniform(GLint location, const glm::vec4 &value) {
+        addUniform(RenderCommand::UniformVec4, location, glm::value_ptr(value), 4);
+    }
+    void uniform(GLint location, const glm::mat4 &value) {
+        addUniform(RenderCommand::UniformMat4, location, glm::value_ptr(value), 16);
+    }
+
+    void drawElements(GLenum mode, GLsizei count, GLenum indexType, size_t offset, GLint baseVertex = 0) {
+        const uint32_t arguments[6] = { mode, (uint32_t) count, indexType, (uint32_t) offset,
+                                        (uint32_t) ((uint64_t) offset >> 32), (uint32_t) baseVertex };
+        add(RenderCommand::DrawElements, 0, arguments, 6);
+    }
+    void drawArrays(GLenum mode, GLint first, GLsizei count) {
+        const uint32_t arguments[3] = { mode, (uint32_t) first, (uint32_t) count };
+        add(RenderCommand::DrawArrays, 0, arguments, 3);
+    }
+
+    // Makes every call, in order. GL thread only.
+    void replay() const;
+
+    size_t commandCount() const { return commands; }
+    size_t bytes() const { return words.size() * sizeof(uint32_t); }
+    bool empty() const { return commands == 0; }
+
+private:
+    std::vector<uint32_t> words;
+    size_t commands = 0;
+
+    void add(RenderCommand command, uint32_t operand, const void *arguments, size_t count) {
+        const size_t at = words.size();
+        words.resize(at + 1 + count);
+        words[at] = (uint32_t) command | (operand & RENDER_COMMAND_MAX_OPERAND) << 8;
+        std::memcpy(&words[at + 1], arguments, count * sizeof(uint32_t));
+        commands++;
+    }
+    void addUniform(RenderCommand command, GLint location, const void *values, size_t count) {
+        if (location >= 0 && (uint32_t) location <= RENDER_COMMAND_MAX_OPERAND)
+            add(command, (uint32_t) location, values, count);
+    }
+};
+
+// The same calls as CommandBuffer, made there and then (so on the GL thread only)
+class DirectCommands {
+public:
+    size_t commands = 0; // calls made
+
+    void useProgram(GLuint id) { glUseProgram(id); commands++; }
+    void bindVertexArray(GLuint id) { glBindVertexArray(id); commands++; }
+    void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        commands++;
+    }
+    void primitiveRestart(GLuint index) {
+        if (index) {
+            glEnable(GL_PRIMITIVE_RESTART);
+            glPrimitiveRestartIndex(index);
+        } else {
+            glDisable(GL_PRIMITIVE_RESTART);
+        }
+        commands++;
+    }
+    void uniform(GLint location, int value) { glUniform1i(location, value); commands++; }
+    void uniform(GLint location, float value) { glUniform1f(location, value); commands++; }
+    void uniform(GLint location, const glm::vec4 &value) { glUniform4fv(location, 1, glm::value_ptr(value)); commands++; }
+    void uniform(GLint location, const glm::mat4 &value) {
+        glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        commands++;
+    }
+    void drawElements(GLenum mode, GLsizei count, GLenum indexType, size_t offset, GLint baseVertex = 0) {
+        glDrawElementsBaseVertex(mode, count, indexType, (void *) offset, baseVertex);
+        commands++;
+    }
+    void drawArrays(GLenum mode, GLint first, GLsizei count) { glDrawArrays(mode, first, count); commands++; }
+};
+
+#endif //OPENGLPLAYGROUND_COMMANDBUFFER_H
@@ -0,0 +1,140 @@
+#include "CommandLine.h"
+#include <cstdlib>
+#include <cstring>
+#include "Benchmarks.h"
+
+bool runCommandLine(int argc, char **argv, JobSystem &jobs, ViewerOptions &options, int &result) {
+    // Options for the window's frames go anywhere, and are taken out before the rest is looked at:
+    // --no-render-thread draws on the main thread between input and simulation, rather than on a thread of
+    // its own (see RenderThread.h). --no-vsync, --adaptive-vsync, --fps <rate> and --low-latency are how
+    // frames are paced (see FramePacer.h). --sim-rate <hz> is how often a scene's simulation steps and
+    // --no-interpolation draws its steps as they are (see SceneSimulation.h).
+    std::vector<char *> arguments;
+    for (int i = 0; i < argc; i++) {
+        const std::string argument(argv[i]);
+        if (argument == "--no-render-thread")
+            options.renderThreadDepth = 0;
+        else if (argument == "--no-vsync")
+            options.pacing.swap = SwapMode::Immediate;
+        else if (argument == "--adaptive-vsync")
+            options.pacing.swap = SwapMode::AdaptiveVsync;
+        else if (argument == "--fps" && i + 1 < argc)
+            options.pacing.targetRate = std::atof(argv[++i]);
+        else if (argument == "--low-latency")
+            options.pacing.lowLatency = true;
+        else if (argument == "--sim-rate" && i + 1 < argc)
+            options.simulationRate = std::atof(argv[++i]);
+        else if (argument == "--no-interpolation")
+            options.interpolateSimulation = false;
+        else
+            arguments.push_back(argv[i]);
+    }
+    argc = (int) arguments.size();
+    argv = arguments.data();
+    result = 0;
+    // ./OpenGLPlayground --cpu out.ppm [--visibility] [--msaa 4|8] renders with the software backend instead
+    if (argc > 2 && std::string(argv[1]) == "--cpu") {
+        bool visibility = false;
+        int msaaSamples = 1;
+        for (int i = 3; i < argc; i++) {
+            if (std::string(argv[i]) == "--visibility")
+                visibility = true;
+            else if (std::string(argv[i]) == "--msaa" && i + 1 < argc)
+                msaaSamples = std::atoi(argv[++i]);
+        }
+        result = renderOnCPU(argv[2], visibility, msaaSamples);
+        return true;
+    }
+    // ./OpenGLPlayground --obj mesh.obj just loads the mesh and prints the load stats
+    if (argc > 2 && std::string(argv[1]) == "--obj") {
+        result = loadOBJAndReport(argv[2]);
+        return true;
+    }
+    // ./OpenGLPlayground --mesh mesh.obj [--compress] [--no-optimize] [--no-lods] [--strips] does the same through the .mesh cache
+    if (argc > 2 && std::string(argv[1]) == "--mesh") {
+        MeshImportOptions importOptions;
+        for (int i = 3; i < argc; i++) {
+            if (std::string(argv[i]) == "--compress")
+                importOptions.compress = true;
+            else if (std::string(argv[i]) == "--no-optimize")
+                importOptions.optimize = false;
+            else if (std::string(argv[i]) == "--no-lods")
+                importOptions.lods = false;
+            else if (std::string(argv[i]) == "--strips")
+                importOptions.strips = true;
+        }
+        result = loadCachedAndReport(argv[2], importOptions);
+        return true;
+    }
+    // ./OpenGLPlayground --bench mesh.obj compares the CPU backend on the mesh before and after optimisation
+    if (argc > 2 && std::string(argv[1]) == "--bench") {
+        result = benchmarkMesh(argv[2]);
+        return true;
+    }
+    // ./OpenGLPlayground --lod mesh.obj [instances] runs LOD selection over a field of instances of the mesh
+    if (argc > 2 && std::string(argv[1]) == "--lod") {
+        result = benchmarkLODs(argv[2], argc > 3 ? (size_t) std::atol(argv[3]) : 100000);
+        return true;
+    }
+    // ./OpenGLPlayground --scene file.scene times loading the scene and updating its transforms
+    if (argc > 2 && std::string(argv[1]) == "--scene") {
+        result = benchmarkScene(argv[2], jobs);
+        return true;
+    }
+    // ./OpenGLPlayground --mips image.png times building its mip chain
+    if (argc > 2 && std::string(argv[1]) == "--mips") {
+        result = benchmarkMips(argv[2]);
+        return true;
+    }
+    // ./OpenGLPlayground --bc image.png compares the block compression formats on it
+    if (argc > 2 && std::string(argv[1]) == "--bc") {
+        result = benchmarkBlockCompression(argv[2]);
+        return true;
+    }
+    // ./OpenGLPlayground model.glb|model.obj draws that instead of the quad. A .scene (see SceneBuilder) is
+    // drawn from its nodes, alternating every report between command buffers recorded on the jobs and
+    // calls made straight from the GL thread, to compare the two.
+    options.modelPath = argc > 1 && argv[1][0] != '-' ? argv[1] : nullptr;
+    const std::string modelName = options.modelPath ? options.modelPath : "";
+    if (modelName.size() > 6 && modelName.compare(modelName.size() - 6, 6, ".scene") == 0) {
+        options.scenePath = options.modelPath;
+        options.modelPath = nullptr;
+    }
+    // ./OpenGLPlayground --texture [--bc1|--bc3|--bc5|--bc7] [--fast|--best] image.png [image.jpg ...] streams
+    // the images in, each on its own quad, block compressed (through a texture cache in the working directory)
+    // if a format is given
+    if (argc > 2 && std::string(argv[1]) == "--texture") {
+        for (int i = 2; i < argc; i++) {
+            const std::string argument(argv[i]);
+            if (argument.size() == 5 && argument.compare(0, 4, "--bc") == 0 && std::strchr("1357", argument[4])) {
+                options.compressTextures = true;
+                options.textureCompression.format = (BCFormat) (argument[4] - '0');
+            } else if (argument == "--fast") {
+                options.textureCompression.quality = BCQuality::Fast;
+            } else if (argument == "--best") {
+                options.textureCompression.quality = BCQuality::Best;
+            } else {
+                options.texturePaths.push_back(argument);
+            }
+        }
+    }
+    // ./OpenGLPlayground --atlas [--no-arrays] image.png [image.jpg ...] draws the same grid from textures packed
+    // into atlases and arrays
+    if (argc > 2 && std::string(argv[1]) == "--atlas") {
+        for (int i = 2; i < argc; i++) {
+            if (std::string(argv[i]) == "--no-arrays")
+                options.packOptions.arrays = false;
+            else
+                options.atlasPaths.push_back(argv[i]);
+        }
+    }
+    // ./OpenGLPlayground --virtual texture.vtex [--cache slots] draws a virtual texture (made with
+    // VirtualTextureBuilder) on a quad you can zoom into
+    if (argc > 2 && std::string(argv[1]) == "--virtual") {
+        options.virtualTexturePath = argv[2];
+        for (int i = 3; i < argc; i++)
+            if (std::string(argv[i]) == "--cache" && i + 1 < argc)
+                options.virtualTextureOptions.cacheSlots = std::atoi(argv[++i]);
+    }
+    return false;
+}
@@ -0,0 +1,34 @@
+#ifndef OPENGLPLAYGROUND_COMMANDLINE_H
+#define OPENGLPLAYGROUND_COMMANDLINE_H
+
+#include <string>
+#include <vector>
+#include "FramePacer.h"
+#include "JobSystem.h"
+#include "TextureCache.h"
+#include "TexturePacker.h"
+#include "VirtualTexture.h"
+
+// What the window is to show and how its frames go, from the command line
+struct ViewerOptions {
+    int renderThreadDepth = 2;
+    FramePacingOptions pacing;
+    double simulationRate = 30.0;
+    bool interpolateSimulation = true;
+
+    const char *modelPath = nullptr; // .glb or anything the .mesh cache imports
+    const char *scenePath = nullptr;
+    std::vector<std::string> texturePaths;
+    bool compressTextures = false;
+    TextureCacheOptions textureCompression;
+    std::vector<std::string> atlasPaths;
+    TexturePackOptions packOptions;
+    const char *virtualTexturePath = nullptr;
+    VirtualTextureOptions virtualTextureOptions;
+};
+
+// Fills options from the command line. The modes that don't need a window (see Benchmarks.h) are run there
+// and then instead: returns true when one was, with what main() should return in result.
+bool runCommandLine(int argc, char **argv, JobSystem &jobs, ViewerOptions &options, int &result);
+
+#endif //OPENGLPLAYGROUND_COMMANDLINE_H
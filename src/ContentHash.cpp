@@ -0,0 +1,80 @@
+#include "ContentHash.h"
+#include <cstring>
+
+namespace {
+
+const uint64_t PRIME1 = 0x9E3779B185EBCA87ull;
+const uint64_t PRIME2 = 0xC2B2AE3D27D4EB4Full;
+const uint64_t PRIME3 = 0x165667B19E3779F9ull;
+const uint64_t PRIME4 = 0x85EBCA77C2B2AE63ull;
+const uint64_t PRIME5 = 0x27D4EB2F165667C5ull;
+
+inline uint64_t rotl(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t read64(const unsigned char *p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8); // little endian hosts only, like the cache formats
+    return v;
+}
+
+inline uint32_t read32(const unsigned char *p) {
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+inline uint64_t accumulate(uint64_t accumulator, uint64_t input) {
+    return rotl(accumulator + input * PRIME2, 31) * PRIME1;
+}
+
+inline uint64_t merge(uint64_t hash, uint64_t lane) {
+    return (hash ^ accumulate(0, lane)) * PRIME1 + PRIME4;
+}
+
+} // namespace
+
+uint64_t contentHash(const unsigned char *data, size_t size, uint64_t seed) {
+    const unsigned char *p = data, *end = data + size;
+    uint64_t hash;
+    if (size >= 32) {
+        // Four independent lanes over 32 byte stripes
+        uint64_t v1 = seed + PRIME1 + PRIME2, v2 = seed + PRIME2, v3 = seed, v4 = seed - PRIME1;
+        for (; p + 32 <= end; p += 32) {
+            v1 = accumulate(v1, read64(p));
+            v2 = accumulate(v2, read64(p + 8));
+            v3 = accumulate(v3, read64(p + 16));
+            v4 = accumulate(v4, read64(p + 24));
+        }
+        hash = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+        hash = merge(merge(merge(merge(hash, v1), v2), v3), v4);
+    } else {
+        hash = seed + PRIME5;
+    }
+    hash += (uint64_t) size;
+
+    for (; p + 8 <= end; p += 8)
+        hash = rotl(hash ^ accumulate(0, read64(p)), 27) * PRIME1 + PRIME4;
+    if (p + 4 <= end) {
+        hash = rotl(hash ^ (uint64_t) read32(p) * PRIME1, 23) * PRIME2 + PRIME3;
+        p += 4;
+    }
+    for (; p < end; p++)
+        hash = rotl(hash ^ *p * PRIME5, 11) * PRIME1;
+
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    hash *= PRIME3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+std::string contentHashString(uint64_t hash) {
+    static const char digits[] = "0123456789abcdef";
+    std::string text(16, '0');
+    for (int i = 15; i >= 0; i--, hash >>= 4)
+        text[i] = digits[hash & 15];
+    return text;
+}
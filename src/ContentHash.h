@@ -0,0 +1,17 @@
+#ifndef OPENGLPLAYGROUND_CONTENTHASH_H
+#define OPENGLPLAYGROUND_CONTENTHASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 64 bit hash of file contents, for caches that should be keyed on what an asset is rather than where
+// it lives or when it was touched. XXH64 (same output as the reference xxHash), several GB/s, which next to
+// decoding or compressing the asset is free.
+
+uint64_t contentHash(const unsigned char *data, size_t size, uint64_t seed = 0);
+
+// 16 lowercase hex digits, for file names
+std::string contentHashString(uint64_t hash);
+
+#endif //OPENGLPLAYGROUND_CONTENTHASH_H
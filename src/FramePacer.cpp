@@ -0,0 +1,166 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+namespace {
+
+// Sleeps are only good to a millisecond or so (worse on some systems), so the last of it is spent yielding
+const double FRAME_PACER_SPIN = 0.0015;
+
+// p in [0, 1] of sorted values, the last one for 1
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    return sorted[std::min(sorted.size() - 1, (size_t) (p * (double) sorted.size()))];
+}
+
+void percentiles(std::vector<double> &values, double *out) {
+    std::sort(values.begin(), values.end());
+    out[0] = percentile(values, 0.5);
+    out[1] = percentile(values, 0.95);
+    out[2] = percentile(values, 0.99);
+    out[3] = percentile(values, 1.0);
+}
+
+} // namespace
+
+FramePacer::FramePacer(const FramePacingOptions &options, double refreshRate)
+        : options(options), swap(options.swap), refreshPeriod(1.0 / (refreshRate > 0.0 ? refreshRate : 60.0)),
+          epoch(std::chrono::steady_clock::now()) {}
+
+FramePacer::~FramePacer() {
+    for (const Fence &fence : fences)
+        glDeleteSync(fence.sync);
+}
+
+double FramePacer::now() const {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void FramePacer::applySwapMode() {
+    if (swap == SwapMode::AdaptiveVsync && !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+        !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+        std::cout << "Adaptive vsync isn't supported here, using vsync" << std::endl;
+        swap = SwapMode::Vsync;
+    }
+    glfwSwapInterval(swap == SwapMode::Immediate ? 0 : swap == SwapMode::Vsync ? 1 : -1);
+}
+
+uint64_t FramePacer::beginFrame() {
+    double start = now(), wake = start;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        const double budget = workEstimate + options.lowLatencyMargin;
+        if (options.targetRate > 0.0) {
+            const double period = 1.0 / options.targetRate;
+            // More than a frame behind (a hitch, a breakpoint): start the cadence again from here rather
+            // than rush frames out to catch up
+            if (nextStart < start - period)
+                nextStart = start;
+            wake = std::max(wake, nextStart);
+            nextStart += period;
+            // The frame has its slot on the cadence to be done in: start as late in it as still makes that
+            if (options.lowLatency)
+                wake = std::max(wake, nextStart - budget);
+        } else if (options.lowLatency && swap != SwapMode::Immediate && lastSwapped >= 0.0) {
+            // Swaps land on refreshes: the first refresh there's time to make, and the latest start that
+            // still makes it
+            const double deadline = lastSwapped + std::ceil((wake + budget - lastSwapped) / refreshPeriod) * refreshPeriod;
+            wake = std::max(wake, deadline - budget);
+        }
+    }
+    if (wake - start > FRAME_PACER_SPIN)
+        std::this_thread::sleep_for(std::chrono::duration<double>(wake - start - FRAME_PACER_SPIN));
+    while (now() < wake)
+        std::this_thread::yield();
+
+    FrameTimeline timeline;
+    timeline.inputSampled = now();
+    std::lock_guard<std::mutex> lock(mutex);
+    slept += timeline.inputSampled - start;
+    timeline.frame = nextFrame++;
+    timelines.push_back(timeline);
+    if (timelines.size() > FRAME_PACER_HISTORY)
+        timelines.pop_front();
+    return timeline.frame;
+}
+
+FrameTimeline *FramePacer::find(uint64_t frame) {
+    if (timelines.empty() || frame < timelines.front().frame || frame - timelines.front().frame >= timelines.size())
+        return nullptr;
+    return &timelines[(size_t) (frame - timelines.front().frame)];
+}
+
+void FramePacer::submitted(uint64_t frame) {
+    const double time = now();
+    std::lock_guard<std::mutex> lock(mutex);
+    FrameTimeline *timeline = find(frame);
+    if (!timeline)
+        return;
+    timeline->submitted = time;
+    const double work = time - timeline->inputSampled;
+    workEstimate = workEstimate > 0.0 ? workEstimate * 0.9 + work * 0.1 : work;
+}
+
+void FramePacer::swapped(uint64_t frame) {
+    const double time = now();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        lastSwapped = time;
+        if (FrameTimeline *timeline = find(frame))
+            timeline->swapped = time;
+    }
+    fences.push_back({ frame, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) });
+    pollGPU();
+}
+
+void FramePacer::pollGPU() {
+    while (!fences.empty()) {
+        const GLenum result = glClientWaitSync(fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (result == GL_TIMEOUT_EXPIRED)
+            return;
+        if (result != GL_WAIT_FAILED) {
+            const double time = now();
+            std::lock_guard<std::mutex> lock(mutex);
+            if (FrameTimeline *timeline = find(fences.front().frame))
+                timeline->gpuDone = time;
+        }
+        glDeleteSync(fences.front().sync);
+        fences.pop_front();
+    }
+}
+
+FramePacingStats FramePacer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    FramePacingStats result;
+    std::vector<double> frameTimes, latencies;
+    const FrameTimeline *previous = nullptr;
+    size_t begun = 0;
+    for (const FrameTimeline &timeline : timelines) {
+        if (timeline.frame < statsFrom)
+            continue;
+        begun++;
+        if (timeline.gpuDone > 0.0) {
+            latencies.push_back((timeline.gpuDone - timeline.inputSampled) * 1e3);
+            if (previous && previous->frame + 1 == timeline.frame)
+                frameTimes.push_back((timeline.swapped - previous->swapped) * 1e3);
+            previous = &timeline;
+        }
+    }
+    result.frames = latencies.size();
+    result.sleptMilliseconds = begun ? slept * 1e3 / (double) begun : 0.0;
+    percentiles(frameTimes, result.frameTime);
+    percentiles(latencies, result.inputToGPUDone);
+    const double scanout = swap == SwapMode::Immediate ? 0.5 : 1.0;
+    result.estimatedLatency = result.inputToGPUDone[0] + scanout * refreshPeriod * 1e3;
+    return result;
+}
+
+void FramePacer::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    statsFrom = nextFrame;
+    slept = 0.0;
+}
@@ -0,0 +1,107 @@
+#ifndef OPENGLPLAYGROUND_FRAMEPACER_H
+#define OPENGLPLAYGROUND_FRAMEPACER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+
+// When frames start, and where their time goes.
+// - Swap modes: vsync, adaptive vsync (tears instead of waiting a whole refresh for a frame that's only just
+//   late, where the driver can) or none.
+// - A target rate caps the frame rate by sleeping at the start of a frame, on a fixed cadence so the odd slow
+//   frame doesn't push every later one back.
+// - Low latency mode sleeps before input is sampled too, but as long as it can: until just enough time is
+//   left to get the frame done by the next deadline (refresh or target rate), by how long frames have been
+//   taking lately. Sampling input late means less of the frame's age shows.
+// Every frame's timeline is kept: input sampled, draw calls submitted, swap returned, GPU done. The GPU's
+// part is a fence after the swap that the GL thread checks on without waiting, so it's only as exact as how
+// often that happens (twice a frame).
+
+#define FRAME_PACER_HISTORY 1024 // frame timelines kept for the stats
+
+enum class SwapMode {
+    Immediate,     // no vsync
+    Vsync,
+    AdaptiveVsync, // vsync, except late frames go straight out. Plain vsync where it isn't supported.
+};
+
+struct FramePacingOptions {
+    SwapMode swap = SwapMode::Vsync;
+    double targetRate = 0.0;          // frames a second, 0 = as fast as the swap allows
+    bool lowLatency = false;
+    double lowLatencyMargin = 0.002;  // seconds kept in hand beyond what frames have been taking
+};
+
+// Seconds, since the pacer started
+struct FrameTimeline {
+    uint64_t frame = 0;
+    double inputSampled = 0.0;
+    double submitted = 0.0; // the last draw call made
+    double swapped = 0.0;   // glfwSwapBuffers returned
+    double gpuDone = 0.0;   // the fence after the swap had signalled, 0 until then
+};
+
+struct FramePacingStats {
+    size_t frames = 0;
+    double frameTime[4] = {};       // ms between swaps: 50th, 95th, 99th percentile and worst
+    double inputToGPUDone[4] = {};  // ms, likewise
+    double sleptMilliseconds = 0.0; // per frame, by the pacer
+    // Input to the middle of the screen lighting up: to GPU done, then on average half a refresh for the
+    // scanout to get halfway down, plus with vsync another half waiting for the next refresh to start
+    double estimatedLatency = 0.0;  // ms, from the median
+};
+
+class FramePacer {
+public:
+    // refreshRate: of the monitor (0 if unknown, 60 is assumed)
+    FramePacer(const FramePacingOptions &options, double refreshRate);
+    ~FramePacer();
+
+    // With the context current. Sets the swap interval for the swap mode, falling back to vsync when
+    // adaptive isn't there.
+    void applySwapMode();
+    SwapMode swapMode() const { return swap; }
+
+    // Main thread, before input is read: sleeps for the target rate or low latency, then notes input is
+    // being sampled. Returns the frame's number, for the calls below.
+    uint64_t beginFrame();
+    // GL thread, after the frame's last draw call
+    void submitted(uint64_t frame);
+    // GL thread, once the swap returns: fences the frame and checks earlier fences
+    void swapped(uint64_t frame);
+    // GL thread, whenever: notes frames the GPU is done with, without waiting
+    void pollGPU();
+
+    // Frames whose timeline is complete since the last resetStats()
+    FramePacingStats stats() const;
+    void resetStats();
+
+private:
+    struct Fence {
+        uint64_t frame;
+        GLsync sync;
+    };
+
+    const FramePacingOptions options;
+    SwapMode swap;
+    double refreshPeriod;
+    std::chrono::steady_clock::time_point epoch;
+    uint64_t nextFrame = 0;
+    uint64_t statsFrom = 0;    // first frame the stats look at
+    double nextStart = 0.0;    // target rate cadence
+    double lastSwapped = -1.0; // where the refreshes fall, for low latency
+    double workEstimate = 0.0; // input sampled to submitted, a moving average
+    double slept = 0.0;        // since resetStats()
+    mutable std::mutex mutex; // timelines and the estimates above
+    std::deque<FrameTimeline> timelines; // oldest first, the last FRAME_PACER_HISTORY
+    std::deque<Fence> fences;            // GL thread only
+
+    double now() const;
+    FrameTimeline *find(uint64_t frame);
+};
+
+#endif //OPENGLPLAYGROUND_FRAMEPACER_H
@@ -0,0 +1,288 @@
+#include "GLBLoader.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#define GLB_MAGIC 0x46546C67u      // "glTF"
+#define GLB_CHUNK_JSON 0x4E4F534Au // "JSON"
+#define GLB_CHUNK_BIN 0x004E4942u  // "BIN\0"
+
+namespace {
+
+uint32_t readU32(const unsigned char *p) {
+    uint32_t value;
+    std::memcpy(&value, p, 4); // GLB is little endian, like everything we run on
+    return value;
+}
+
+int componentsOf(const std::string &type) {
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0; // matrices aren't vertex attributes we can point glVertexAttribPointer at
+}
+
+bool validComponentType(long long type) {
+    return type == 0x1400 || type == 0x1401 || type == 0x1402 || type == 0x1403 || type == 0x1405 || type == 0x1406;
+}
+
+// glTF semantic -> the name our shaders use for that input
+std::string attributeName(const std::string &semantic) {
+    if (semantic == "POSITION") return "position";
+    if (semantic == "NORMAL") return "normal";
+    if (semantic == "TANGENT") return "tangent";
+    if (semantic == "TEXCOORD_0") return "texCoord";
+    if (semantic == "COLOR_0") return "colour";
+    // TEXCOORD_1 -> texcoord1, JOINTS_0 -> joints0 ...
+    std::string name;
+    for (char c : semantic)
+        if (c != '_')
+            name += (char) (c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+    return name;
+}
+
+// Where an accessor's elements live in the binary chunk
+struct AccessorRange {
+    ComponentType type;
+    int components;
+    bool normalized;
+    size_t count;
+    size_t offset; // first element, bytes into the binary chunk
+    size_t stride; // bytes between elements
+};
+
+bool resolveAccessor(const JsonValue &json, long long index, size_t binaryLength, AccessorRange &range) {
+    const JsonValue &accessor = json["accessors"][(size_t) index];
+    if (accessor.isNull() || index < 0) {
+        std::cerr << "ERROR::GLBLOADER::BAD_ACCESSOR " << index << std::endl;
+        return false;
+    }
+    if (!accessor.has("bufferView") || accessor.has("sparse")) {
+        std::cerr << "ERROR::GLBLOADER::UNSUPPORTED_ACCESSOR " << index << " (sparse or without a buffer view)" << std::endl;
+        return false;
+    }
+    const long long componentType = accessor["componentType"].asInt();
+    range.components = componentsOf(accessor["type"].asString());
+    if (!validComponentType(componentType) || range.components == 0) {
+        std::cerr << "ERROR::GLBLOADER::UNSUPPORTED_ACCESSOR_TYPE " << index << std::endl;
+        return false;
+    }
+    range.type = (ComponentType) componentType;
+    range.normalized = accessor["normalized"].asBool();
+    const long long count = accessor["count"].asInt();
+    if (count < 0) {
+        std::cerr << "ERROR::GLBLOADER::BAD_ACCESSOR_COUNT " << index << std::endl;
+        return false;
+    }
+    range.count = (size_t) count;
+
+    const JsonValue &view = json["bufferViews"][(size_t) accessor["bufferView"].asInt(-1)];
+    const long long buffer = view["buffer"].asInt(-1);
+    if (view.isNull() || buffer != 0 || json["buffers"][0].has("uri")) {
+        std::cerr << "ERROR::GLBLOADER::EXTERNAL_BUFFER accessor " << index << std::endl;
+        return false;
+    }
+    const size_t elementSize = (size_t) range.components * componentSize(range.type);
+    const size_t viewOffset = (size_t) view["byteOffset"].asInt(), viewLength = (size_t) view["byteLength"].asInt();
+    const size_t accessorOffset = (size_t) accessor["byteOffset"].asInt();
+    range.stride = view.has("byteStride") ? (size_t) view["byteStride"].asInt() : elementSize;
+    range.offset = viewOffset + accessorOffset;
+    // Written as subtractions so huge offsets, lengths or counts can't wrap around and pass
+    bool inBounds = viewOffset <= binaryLength && viewLength <= binaryLength - viewOffset &&
+                    accessorOffset <= viewLength && range.stride >= elementSize;
+    if (inBounds && range.count) {
+        const size_t room = viewLength - accessorOffset;
+        inBounds = room >= elementSize && range.count - 1 <= (room - elementSize) / range.stride;
+    }
+    if (!inBounds) {
+        std::cerr << "ERROR::GLBLOADER::ACCESSOR_OUT_OF_BOUNDS " << index << std::endl;
+        return false;
+    }
+    // GL wants every component aligned to its own size
+    if (range.offset % componentSize(range.type) || range.stride % componentSize(range.type)) {
+        std::cerr << "ERROR::GLBLOADER::MISALIGNED_ACCESSOR " << index << std::endl;
+        return false;
+    }
+    return true;
+}
+
+glm::vec3 readVec3(const JsonValue &array, float fallback) {
+    return glm::vec3((float) array[0].asNumber(fallback), (float) array[1].asNumber(fallback),
+                     (float) array[2].asNumber(fallback));
+}
+
+} // namespace
+
+bool GLBFile::open(const char *path) {
+    primitives.clear();
+    binaryData = nullptr;
+    binaryLength = 0;
+    if (!file.open(path))
+        return false;
+
+    // 12 byte header, then a JSON chunk and optionally a BIN chunk, each with an 8 byte header
+    const unsigned char *data = file.data();
+    const size_t size = file.size();
+    if (size < 20 || readU32(data) != GLB_MAGIC || readU32(data + 4) != 2 || readU32(data + 8) > size) {
+        std::cerr << "ERROR::GLBLOADER::NOT_A_GLB_2_FILE " << path << std::endl;
+        return false;
+    }
+    const size_t totalLength = readU32(data + 8);
+    const unsigned char *jsonText = nullptr;
+    size_t jsonLength = 0;
+    for (size_t offset = 12; offset + 8 <= totalLength;) {
+        const size_t chunkLength = readU32(data + offset);
+        const uint32_t chunkType = readU32(data + offset + 4);
+        if (offset + 8 + chunkLength > totalLength) {
+            std::cerr << "ERROR::GLBLOADER::TRUNCATED_CHUNK " << path << std::endl;
+            return false;
+        }
+        if (chunkType == GLB_CHUNK_JSON && !jsonText) {
+            jsonText = data + offset + 8;
+            jsonLength = chunkLength;
+        } else if (chunkType == GLB_CHUNK_BIN && !binaryData) {
+            binaryData = data + offset + 8;
+            binaryLength = chunkLength;
+        }
+        offset += 8 + ((chunkLength + 3) & ~(size_t) 3);
+    }
+    if (!jsonText || !parseJson(reinterpret_cast<const char *>(jsonText), jsonLength, json)) {
+        std::cerr << "ERROR::GLBLOADER::BAD_JSON_CHUNK " << path << std::endl;
+        return false;
+    }
+
+    // Every primitive of every mesh (node transforms aren't applied, the meshes are drawn as stored)
+    bool first = true;
+    const JsonValue &meshes = json["meshes"];
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const JsonValue &meshPrimitives = meshes[m]["primitives"];
+        for (size_t p = 0; p < meshPrimitives.size(); p++) {
+            const JsonValue &source = meshPrimitives[p];
+            GLBPrimitive primitive;
+            primitive.name = meshes[m]["name"].asString() + "#" + std::to_string(p);
+            primitive.mode = (uint32_t) source["mode"].asInt(4); // GL_TRIANGLES
+            primitive.material = (int) source["material"].asInt(-1);
+            primitive.vertexCount = 0;
+
+            const JsonValue &attributes = source["attributes"];
+            size_t shortestAttribute = SIZE_MAX;
+            for (const auto &attribute : attributes.members) {
+                AccessorRange range;
+                if (!resolveAccessor(json, attribute.second.asInt(-1), binaryLength, range))
+                    return false;
+                shortestAttribute = std::min(shortestAttribute, range.count);
+                primitive.layout.attributes.push_back({ attributeName(attribute.first), range.components, range.type,
+                                                        range.normalized, range.offset, range.stride });
+                if (attribute.first == "POSITION") {
+                    primitive.vertexCount = range.count;
+                    const JsonValue &accessor = json["accessors"][(size_t) attribute.second.asInt()];
+                    primitive.boundsMin = readVec3(accessor["min"], 0.0f);
+                    primitive.boundsMax = readVec3(accessor["max"], 0.0f);
+                }
+            }
+            if (!primitive.layout.find("position")) {
+                std::cerr << "ERROR::GLBLOADER::PRIMITIVE_WITHOUT_POSITION " << primitive.name << std::endl;
+                return false;
+            }
+            // Every vertex reads every attribute, so none may run out before the positions do
+            if (shortestAttribute < primitive.vertexCount) {
+                std::cerr << "ERROR::GLBLOADER::ATTRIBUTE_TOO_SHORT " << primitive.name << std::endl;
+                return false;
+            }
+
+            primitive.indexed = source.has("indices");
+            primitive.indexType = ComponentType::UnsignedInt;
+            primitive.indexOffset = primitive.indexCount = 0;
+            if (primitive.indexed) {
+                AccessorRange range;
+                if (!resolveAccessor(json, source["indices"].asInt(-1), binaryLength, range))
+                    return false;
+                if (range.components != 1 || range.stride != componentSize(range.type) ||
+                    (range.type != ComponentType::UnsignedByte && range.type != ComponentType::UnsignedShort &&
+                     range.type != ComponentType::UnsignedInt)) {
+                    std::cerr << "ERROR::GLBLOADER::BAD_INDEX_ACCESSOR " << primitive.name << std::endl;
+                    return false;
+                }
+                primitive.indexType = range.type;
+                primitive.indexOffset = range.offset;
+                primitive.indexCount = range.count;
+            }
+
+            boundsMin = first ? primitive.boundsMin : glm::min(boundsMin, primitive.boundsMin);
+            boundsMax = first ? primitive.boundsMax : glm::max(boundsMax, primitive.boundsMax);
+            first = false;
+            primitives.push_back(primitive);
+        }
+    }
+    return true;
+}
+
+bool GLBFile::toMeshData(MeshData &mesh) const {
+    // Union of all the primitives' attributes, every one starting 4 byte aligned like GL prefers
+    mesh = MeshData();
+    for (const GLBPrimitive &primitive : primitives) {
+        if (primitive.mode != 4) { // GL_TRIANGLES
+            std::cerr << "ERROR::GLBLOADER::NOT_TRIANGLES " << primitive.name << std::endl;
+            return false;
+        }
+        for (const VertexAttribute &attribute : primitive.layout.attributes) {
+            // Each slot is laid out for the first primitive that has it, later ones are copied in as is
+            if (const VertexAttribute *target = mesh.layout.find(attribute.name)) {
+                if (target->components != attribute.components || target->type != attribute.type ||
+                    target->normalized != attribute.normalized) {
+                    std::cerr << "ERROR::GLBLOADER::MISMATCHED_ATTRIBUTE " << attribute.name << " in "
+                              << primitive.name << std::endl;
+                    return false;
+                }
+                continue;
+            }
+            mesh.layout.add(attribute.name, attribute.components, attribute.type, attribute.normalized);
+            mesh.layout.stride = (mesh.layout.stride + 3) & ~(size_t) 3;
+        }
+        mesh.vertexCount += primitive.vertexCount;
+    }
+    mesh.vertexData.assign(mesh.vertexCount * mesh.layout.stride, 0);
+
+    size_t baseVertex = 0;
+    for (const GLBPrimitive &primitive : primitives) {
+        for (const VertexAttribute &attribute : primitive.layout.attributes) {
+            const VertexAttribute &target = *mesh.layout.find(attribute.name);
+            const size_t size = (size_t) attribute.components * componentSize(attribute.type);
+            const unsigned char *src = binaryData + attribute.offset;
+            unsigned char *dst = mesh.vertexData.data() + baseVertex * mesh.layout.stride + target.offset;
+            for (size_t v = 0; v < primitive.vertexCount; v++)
+                std::memcpy(dst + v * mesh.layout.stride, src + v * primitive.layout.strideOf(attribute), size);
+        }
+        const uint32_t firstIndex = (uint32_t) mesh.indices.size();
+        if (primitive.indexed) {
+            const unsigned char *src = binaryData + primitive.indexOffset;
+            for (size_t i = 0; i < primitive.indexCount; i++) {
+                uint32_t index;
+                if (primitive.indexType == ComponentType::UnsignedByte) {
+                    index = src[i];
+                } else if (primitive.indexType == ComponentType::UnsignedShort) {
+                    uint16_t value;
+                    std::memcpy(&value, src + i * 2, 2);
+                    index = value;
+                } else {
+                    std::memcpy(&index, src + i * 4, 4);
+                }
+                if (index >= primitive.vertexCount) {
+                    std::cerr << "ERROR::GLBLOADER::INDEX_OUT_OF_RANGE " << primitive.name << std::endl;
+                    return false;
+                }
+                mesh.indices.push_back((uint32_t) baseVertex + index);
+            }
+        } else {
+            for (size_t v = 0; v < primitive.vertexCount; v++)
+                mesh.indices.push_back((uint32_t) (baseVertex + v));
+        }
+        mesh.submeshes.push_back({ firstIndex, (uint32_t) mesh.indices.size() - firstIndex, primitive.name });
+        baseVertex += primitive.vertexCount;
+    }
+    mesh.boundsMin = boundsMin;
+    mesh.boundsMax = boundsMax;
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef OPENGLPLAYGROUND_GLBLOADER_H
+#define OPENGLPLAYGROUND_GLBLOADER_H
+
+#include <string>
+#include <vector>
+#include "Json.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+
+// One glTF mesh primitive, with every byte range pointing into the GLB's binary chunk.
+// Vertex attribute offsets are relative to the start of that chunk, so after uploading the chunk as one
+// buffer the layout can go straight to glVertexAttribPointer.
+struct GLBPrimitive {
+    std::string name;    // "<mesh name>#<primitive index>"
+    uint32_t mode;       // GL_TRIANGLES etc. (glTF uses the GL values)
+    VertexLayout layout; // separate streams: POSITION -> "position", NORMAL -> "normal", TEXCOORD_0 -> "texCoord", COLOR_0 -> "colour"
+    size_t vertexCount;
+    bool indexed;
+    ComponentType indexType; // UnsignedByte/UnsignedShort/UnsignedInt
+    size_t indexOffset;      // bytes into the binary chunk
+    size_t indexCount;
+    int material;            // -1 if none
+    glm::vec3 boundsMin, boundsMax; // from the POSITION accessor's min/max
+};
+
+// A binary glTF 2.0 file. The file stays memory mapped for as long as this object lives, and nothing in the
+// binary chunk is copied: binary() points into the mapping.
+class GLBFile {
+public:
+    JsonValue json;
+    std::vector<GLBPrimitive> primitives;
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+
+    // Returns false (after printing why) for anything that isn't a valid, self contained GLB
+    // (external .bin buffers and data URIs aren't supported)
+    bool open(const char *path);
+
+    // Copies every triangle primitive into one interleaved, uint32 indexed mesh with a submesh per primitive
+    // (attributes a primitive doesn't have are zero). For tools: the GPU path is GLMesh::upload.
+    bool toMeshData(MeshData &mesh) const;
+
+    const unsigned char *binary() const { return binaryData; }
+    size_t binarySize() const { return binaryLength; }
+
+private:
+    MappedFile file;
+    const unsigned char *binaryData = nullptr;
+    size_t binaryLength = 0;
+};
+
+#endif //OPENGLPLAYGROUND_GLBLOADER_H
@@ -0,0 +1,232 @@
+#include "GLMesh.h"
+#include <algorithm>
+#include <iostream>
+#include "ContentHash.h"
+#include "GLBLoader.h"
+#include "MeshCache.h"
+
+namespace {
+
+template<typename T>
+uint64_t hashArray(const T *values, size_t count, uint64_t seed) {
+    return contentHash(reinterpret_cast<const unsigned char *>(values), count * sizeof(T), seed);
+}
+
+uint64_t hashLayout(const VertexLayout &layout, uint64_t seed) {
+    for (const VertexAttribute &attribute : layout.attributes) {
+        seed = hashArray(attribute.name.data(), attribute.name.size(), seed);
+        const uint64_t fields[] = { (uint64_t) attribute.components, (uint64_t) attribute.type,
+                                    attribute.normalized ? 1u : 0u, attribute.offset, layout.strideOf(attribute) };
+        seed = hashArray(fields, 5, seed);
+    }
+    return seed;
+}
+
+} // namespace
+
+int applyVertexLayout(const VertexLayout &layout, GLuint program) {
+    int bound = 0;
+    for (const VertexAttribute &attribute : layout.attributes) {
+        GLint location = glGetAttribLocation(program, attribute.name.c_str()); // search by string
+        if (location < 0)
+            continue; // the shader doesn't use it (or the compiler optimised it out)
+        glVertexAttribPointer((GLuint) location, attribute.components, (GLenum) attribute.type,
+                              attribute.normalized ? GL_TRUE : GL_FALSE, (GLsizei) layout.strideOf(attribute),
+                              (void *) attribute.offset);
+        glEnableVertexAttribArray((GLuint) location);
+        bound++;
+    }
+    return bound;
+}
+
+uint64_t meshContentHash(const GLBFile &glb, GLuint program) {
+    uint64_t hash = contentHash(glb.binary(), glb.binarySize(), program);
+    for (const GLBPrimitive &primitive : glb.primitives) {
+        const uint64_t fields[] = { primitive.mode, primitive.vertexCount, primitive.indexed ? 1u : 0u,
+                                    (uint64_t) primitive.indexType, primitive.indexOffset, primitive.indexCount };
+        hash = hashLayout(primitive.layout, hashArray(fields, 6, hash));
+    }
+    return hash;
+}
+
+uint64_t meshContentHash(const CachedMesh &mesh, GLuint program) {
+    uint64_t hash = contentHash(mesh.vertexData(), mesh.vertexBytes(), program);
+    hash = contentHash(static_cast<const unsigned char *>(mesh.indexData()), mesh.indexBytes(), hash);
+    const uint64_t fields[] = { mesh.mode, (uint64_t) mesh.indexType, mesh.layout.stride };
+    hash = hashLayout(mesh.layout, hashArray(fields, 3, hash));
+    std::vector<uint32_t> submeshes;
+    for (const SubMesh &submesh : mesh.submeshes) {
+        submeshes.push_back(submesh.firstIndex);
+        submeshes.push_back(submesh.indexCount);
+    }
+    hash = hashArray(submeshes.data(), submeshes.size(), hash);
+    hash = hashArray(mesh.indexBatches.data(), mesh.indexBatches.size(), hash);
+    hash = hashArray(mesh.lods.data(), mesh.lods.size(), hash);
+    return hashArray(mesh.lodRanges.data(), mesh.lodRanges.size(), hash);
+}
+
+GLMesh::~GLMesh() {
+    if (!vertexArrays.empty())
+        glDeleteVertexArrays((GLsizei) vertexArrays.size(), vertexArrays.data());
+    if (buffer)
+        glDeleteBuffers(1, &buffer);
+    if (indexBuffer)
+        glDeleteBuffers(1, &indexBuffer);
+}
+
+bool GLMesh::upload(const GLBFile &glb, GLuint program) {
+    if (!glb.binary() || glb.binarySize() == 0) {
+        std::cerr << "ERROR::GLMESH::NO_BINARY_CHUNK" << std::endl;
+        return false;
+    }
+    // Straight from the file mapping to the driver: the pages are read in by glBufferData itself,
+    // and there's no intermediate copy on our side
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) glb.binarySize(), glb.binary(), GL_STATIC_DRAW);
+    uploadedBytes = glb.binarySize();
+
+    for (const GLBPrimitive &primitive : glb.primitives) {
+        Draw draw;
+        glGenVertexArrays(1, &draw.VAO);
+        vertexArrays.push_back(draw.VAO);
+        glBindVertexArray(draw.VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer); // This binds to the VAO
+        applyVertexLayout(primitive.layout, program);
+        draw.mode = primitive.mode;
+        draw.indexed = primitive.indexed;
+        draw.indexType = (GLenum) primitive.indexType;
+        draw.indexOffset = primitive.indexOffset;
+        draw.count = (GLsizei) (primitive.indexed ? primitive.indexCount : primitive.vertexCount);
+        draw.baseVertex = 0;
+        draws.push_back(draw);
+    }
+    glBindVertexArray(0);
+    return true;
+}
+
+bool GLMesh::upload(const CachedMesh &mesh, GLuint program) {
+    if (!mesh.vertexData() || !mesh.indexData()) {
+        std::cerr << "ERROR::GLMESH::EMPTY_MESH" << std::endl;
+        return false;
+    }
+    GLuint VAO;
+    glGenVertexArrays(1, &VAO);
+    vertexArrays.push_back(VAO);
+    glBindVertexArray(VAO);
+    // From a .mesh file these pointers are the file mapping itself
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) mesh.vertexBytes(), mesh.vertexData(), GL_STATIC_DRAW);
+    glGenBuffers(1, &indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) mesh.indexBytes(), mesh.indexData(), GL_STATIC_DRAW);
+    uploadedBytes = mesh.vertexBytes() + mesh.indexBytes();
+    applyVertexLayout(mesh.layout, program);
+    indexBatches = mesh.indexBatches;
+    const bool strips = mesh.mode == GL_TRIANGLE_STRIP;
+    const GLenum indexType = (GLenum) mesh.indexType;
+    const size_t indexSize = componentSize(mesh.indexType);
+    restartIndex = strips ? (indexType == GL_UNSIGNED_SHORT ? 0xFFFFu : 0xFFFFFFFFu) : 0;
+    // A draw per submesh, or per piece of one where it crosses into another index batch, and the same again
+    // for every LOD level past 0 from its ranges
+    const size_t submeshCount = mesh.submeshes.size();
+    const size_t levels = submeshCount && mesh.lodRanges.size() == mesh.lods.size() * submeshCount ? mesh.lods.size() : 0;
+    for (size_t l = 0; l < std::max<size_t>(levels, 1); l++) {
+        rangeOffsets.clear();
+        rangeCounts.clear();
+        rangeBaseVertices.clear();
+        for (size_t s = 0; s < submeshCount; s++) {
+            if (l == 0)
+                addRange(mesh.submeshes[s].firstIndex, mesh.submeshes[s].indexCount, indexSize);
+            else
+                addRange(mesh.lodRanges[l * submeshCount + s].firstIndex,
+                         mesh.lodRanges[l * submeshCount + s].indexCount, indexSize);
+        }
+        if (l > 0)
+            lodDraws.emplace_back();
+        std::vector<Draw> &level = l == 0 ? draws : lodDraws.back();
+        for (size_t r = 0; r < rangeCounts.size(); r++)
+            level.push_back({ VAO, (GLenum) mesh.mode, true, indexType, (size_t) rangeOffsets[r], rangeCounts[r],
+                              rangeBaseVertices[r] });
+    }
+    if (levels)
+        lods = mesh.lods;
+    radius = std::max(glm::length(mesh.boundsMin), glm::length(mesh.boundsMax));
+    glBindVertexArray(0);
+    return true;
+}
+
+void GLMesh::addRange(uint32_t firstIndex, uint32_t count, size_t indexSize) const {
+    if (indexBatches.empty()) {
+        rangeOffsets.push_back((const void *) ((size_t) firstIndex * indexSize));
+        rangeCounts.push_back((GLsizei) count);
+        rangeBaseVertices.push_back(0);
+        return;
+    }
+    // Batches are sorted and cover the whole buffer, so start from the last one beginning at or before firstIndex
+    const uint32_t end = firstIndex + count;
+    auto batch = std::upper_bound(indexBatches.begin(), indexBatches.end(), firstIndex,
+                                  [](uint32_t index, const IndexBatch &b) { return index < b.firstIndex; });
+    if (batch != indexBatches.begin())
+        --batch;
+    for (uint32_t first = firstIndex; first < end && batch != indexBatches.end(); ++batch) {
+        const uint32_t last = std::min(end, batch->firstIndex + batch->indexCount);
+        if (last <= first)
+            continue;
+        rangeOffsets.push_back((const void *) ((size_t) first * indexSize));
+        rangeCounts.push_back((GLsizei) (last - first));
+        rangeBaseVertices.push_back((GLint) batch->baseVertex);
+        first = last;
+    }
+}
+
+void GLMesh::enableRestart() const {
+    if (restartIndex) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(restartIndex);
+    } else {
+        glDisable(GL_PRIMITIVE_RESTART);
+    }
+}
+
+void GLMesh::draw() const {
+    drawLevel(0);
+}
+
+void GLMesh::drawLevel(size_t level) const {
+    enableRestart();
+    for (const Draw &draw : levelDraws(level)) {
+        glBindVertexArray(draw.VAO);
+        if (draw.indexed)
+            glDrawElementsBaseVertex(draw.mode, draw.count, draw.indexType, (void *) draw.indexOffset, draw.baseVertex);
+        else
+            glDrawArrays(draw.mode, 0, draw.count);
+    }
+}
+
+size_t GLMesh::levelTriangles(size_t level) const {
+    if (level < lods.size())
+        return lods[level].indexCount / 3; // near enough for strips too
+    size_t indices = 0;
+    for (const Draw &draw : levelDraws(level))
+        indices += (size_t) draw.count;
+    return indices / 3;
+}
+
+void GLMesh::drawRanges(const std::vector<uint32_t> &firstIndex, const std::vector<uint32_t> &indexCount) const {
+    if (draws.empty() || firstIndex.empty())
+        return;
+    const Draw &draw = draws.front();
+    const size_t indexSize = draw.indexType == GL_UNSIGNED_SHORT ? 2 : draw.indexType == GL_UNSIGNED_BYTE ? 1 : 4;
+    rangeOffsets.clear();
+    rangeCounts.clear();
+    rangeBaseVertices.clear();
+    for (size_t r = 0; r < firstIndex.size(); r++)
+        addRange(firstIndex[r], indexCount[r], indexSize);
+    enableRestart();
+    glBindVertexArray(draw.VAO);
+    glMultiDrawElementsBaseVertex(draw.mode, rangeCounts.data(), draw.indexType, rangeOffsets.data(),
+                                  (GLsizei) rangeCounts.size(), rangeBaseVertices.data());
+}
@@ -0,0 +1,78 @@
+#ifndef OPENGLPLAYGROUND_GLMESH_H
+#define OPENGLPLAYGROUND_GLMESH_H
+
+#include <vector>
+#include <glad/glad.h>
+#include "Mesh.h"
+
+class CachedMesh;
+class GLBFile;
+
+// Points every attribute in layout that `program` actually uses at the buffer currently bound to
+// GL_ARRAY_BUFFER (and enables it). Returns how many attributes were bound.
+int applyVertexLayout(const VertexLayout &layout, GLuint program);
+
+// What AssetKind::Mesh registry entries are keyed on: the bytes a GLMesh is made from, the tables saying
+// what's where in them, and the program, whose attribute locations its vertex arrays are set up for
+uint64_t meshContentHash(const GLBFile &glb, GLuint program);
+uint64_t meshContentHash(const CachedMesh &mesh, GLuint program);
+
+// A mesh on the GPU. A GLB's whole binary chunk becomes one buffer, used both for vertices and indices,
+// with a VAO per primitive describing where in it each one's data is. A CachedMesh gets a VBO + EBO and
+// one VAO shared by its submeshes; its indices are drawn with whatever width, base vertices and primitive
+// restart it was packed with, so callers only ever deal in index ranges. Its LOD levels get draws of their own.
+class GLMesh {
+public:
+    struct Draw {
+        GLuint VAO;
+        GLenum mode;
+        bool indexed;
+        GLenum indexType;
+        size_t indexOffset;
+        GLsizei count; // indices, or vertices when not indexed
+        GLint baseVertex;
+    };
+
+    GLuint buffer = 0;
+    GLuint indexBuffer = 0; // 0 when the indices live in `buffer`
+    std::vector<GLuint> vertexArrays;
+    std::vector<Draw> draws;                 // level 0
+    std::vector<MeshLOD> lods;               // CachedMesh only, level 0 first
+    std::vector<std::vector<Draw>> lodDraws; // levels 1 and up, lodDraws[level - 1]
+    float radius = 0.0f;                     // CachedMesh only: bounds the mesh around its origin
+    std::vector<IndexBatch> indexBatches; // CachedMesh only: how index ranges map to base vertices
+    GLuint restartIndex = 0;              // 0 = no primitive restart
+    size_t uploadedBytes = 0;
+
+    GLMesh() = default;
+    GLMesh(const GLMesh &) = delete;
+    GLMesh &operator=(const GLMesh &) = delete;
+    ~GLMesh();
+
+    // Must be called with `program` current, so the attribute locations can be looked up
+    bool upload(const GLBFile &glb, GLuint program);
+    bool upload(const CachedMesh &mesh, GLuint program);
+    void draw() const;
+    // Draws one LOD level (level 0 when the mesh has no such level)
+    void drawLevel(size_t level) const;
+    const std::vector<Draw> &levelDraws(size_t level) const {
+        return level == 0 || level > lodDraws.size() ? draws : lodDraws[level - 1];
+    }
+    size_t levelCount() const { return lodDraws.size() + 1; }
+    // What drawing a level costs, for the stats
+    size_t levelTriangles(size_t level) const;
+    // Draws index ranges of the first draw's buffers (meshlet culling output, LOD levels) in one
+    // glMultiDrawElementsBaseVertex, cutting them where the index batches change base vertex
+    void drawRanges(const std::vector<uint32_t> &firstIndex, const std::vector<uint32_t> &indexCount) const;
+
+private:
+    mutable std::vector<const void *> rangeOffsets; // scratch for drawRanges
+    mutable std::vector<GLsizei> rangeCounts;
+    mutable std::vector<GLint> rangeBaseVertices;
+
+    // Appends [firstIndex, firstIndex + count) to the scratch arrays, one entry per batch it touches
+    void addRange(uint32_t firstIndex, uint32_t count, size_t indexSize) const;
+    void enableRestart() const;
+};
+
+#endif //OPENGLPLAYGROUND_GLMESH_H
@@ -1,4 +1,5 @@
 #include "GLShader.h"
+#include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <fstream>
 
@@ -24,7 +25,7 @@ char* readFile(const char *filePath) {
 }
 
 // We want to set up the whole shader program here
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : name(shaderProgramName(vertexPath, fragmentPath)) {
     // Vertex Shader
     char* vertexShaderSource = readFile(vertexPath);
     GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -89,6 +90,18 @@ void Shader::setFloat(const std::string &name, float value) const
 {
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) const
+{
+    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+void Shader::setVec4(const std::string &name, const glm::vec4 &value) const
+{
+    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, glm::value_ptr(value));
+}
+void Shader::setMat4(const std::string &name, const glm::mat4 &value) const
+{
+    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(value));
+}
 
 Shader::~Shader() {
     glDeleteProgram(ID);
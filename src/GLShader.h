@@ -3,6 +3,8 @@
 
 #include <glad/glad.h>
 #include <string>
+#include <glm/glm.hpp>
+#include "ShaderProgramName.h"
 
 // Function courtesy of: https://badvertex.com/2012/11/20/how-to-load-a-glsl-shader-in-opengl-using-c.html
 char* readFile(const char *filePath);
@@ -10,6 +12,7 @@ char* readFile(const char *filePath);
 class Shader {
 public:
     GLuint ID;
+    std::string name; // see shaderProgramName(), also the name of the matching CPU program
 
     // Constructor
     Shader(const char* vertexPath, const char* fragmentPath);
@@ -17,6 +20,9 @@ public:
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
+    void setVec2(const std::string &name, const glm::vec2 &value) const;
+    void setVec4(const std::string &name, const glm::vec4 &value) const;
+    void setMat4(const std::string &name, const glm::mat4 &value) const;
 
     // Auto delete program
     ~Shader();
@@ -1,11 +1,177 @@
 #ifndef OPENGLPLAYGROUND_GLTRANSFORM_H
 #define OPENGLPLAYGROUND_GLTRANSFORM_H
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include "Parallel.h"
+#include "SWSimd.h"
 
+// Node transforms of a hierarchy. Locals are kept as a structure of arrays (translations, rotations and
+// scales each in an array of their own, plus parent indices) and worlds are worked out from them in one
+// pass: parents always come before their children, so a node's parent is done by the time it's reached.
+// The pass goes a depth at a time, each level split across threads (jobs, with a JobSystem running), as
+// nothing on one level depends on anything else on it.
+// The arrays are only viewed, not owned, so a loaded scene can hand over pointers into its file mapping.
 
+#define TRANSFORM_NO_PARENT 0xFFFFFFFFu
+// Nodes per parallelFor block
+#define TRANSFORM_BLOCK_SIZE 4096
 
+struct TransformArrays {
+    size_t count = 0;
+    const uint32_t *parents = nullptr;       // TRANSFORM_NO_PARENT for roots, otherwise below the node's index
+    const glm::vec3 *translations = nullptr;
+    const glm::vec4 *rotations = nullptr;    // unit quaternions, x y z w
+    const glm::vec3 *scales = nullptr;
+};
 
-#endif OPENGLPLAYGROUND_GLTRANSFORM_H
+static_assert(sizeof(glm::vec3) == 3 * sizeof(float) && sizeof(glm::vec4) == 4 * sizeof(float),
+              "the transform arrays are read as plain floats");
+
+// Locals that change, owned rather than viewed (parents don't change, so they stay wherever they were)
+struct TransformState {
+    std::vector<glm::vec3> translations;
+    std::vector<glm::vec4> rotations;
+    std::vector<glm::vec3> scales;
+
+    void assign(const TransformArrays &arrays) {
+        translations.assign(arrays.translations, arrays.translations + arrays.count);
+        rotations.assign(arrays.rotations, arrays.rotations + arrays.count);
+        scales.assign(arrays.scales, arrays.scales + arrays.count);
+    }
+    TransformArrays view(const uint32_t *parents) const {
+        TransformArrays arrays;
+        arrays.count = translations.size();
+        arrays.parents = parents;
+        arrays.translations = translations.data();
+        arrays.rotations = rotations.data();
+        arrays.scales = scales.data();
+        return arrays;
+    }
+};
+
+// out = a + (b - a) * t over count floats, eight at a time
+inline void lerpFloats(const float *a, const float *b, float t, float *out, size_t count) {
+    const Float8 weight = f8Set1(t);
+    size_t i = 0;
+    for (; i + SW_LANES <= count; i += SW_LANES) {
+        const Float8 from = f8Load(a + i);
+        f8Store(out + i, from + (f8Load(b + i) - from) * weight);
+    }
+    for (; i < count; i++)
+        out[i] = a[i] + (b[i] - a[i]) * t;
+}
+
+// Normalised lerp of quaternions, the short way round, two to a Float8 (one per half). Close enough to a
+// slerp for the small steps between simulation states, and a lot cheaper.
+inline void nlerpQuaternions(const glm::vec4 *a, const glm::vec4 *b, float t, glm::vec4 *out, size_t count) {
+    const Float8 weight = f8Set1(t);
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const Float8 from = f8Load(&a[i].x);
+        Float8 to = f8Load(&b[i].x);
+        to = f8Select(f8Less(f8HalfSums(from * to), f8Zero()), -to, to);
+        const Float8 q = from + (to - from) * weight;
+        f8Store(&out[i].x, q / f8Sqrt(f8HalfSums(q * q)));
+    }
+    for (; i < count; i++) {
+        const glm::vec4 to = glm::dot(a[i], b[i]) < 0.0f ? -b[i] : b[i];
+        out[i] = glm::normalize(a[i] + (to - a[i]) * t);
+    }
+}
+
+// Locals in between two states, for nodes [begin, end): t = 0 is all a, 1 all b
+inline void interpolateTransforms(const TransformArrays &a, const TransformArrays &b, float t, TransformState &out,
+                                  size_t begin, size_t end) {
+    if (begin >= end)
+        return;
+    lerpFloats(&a.translations[begin].x, &b.translations[begin].x, t, &out.translations[begin].x, (end - begin) * 3);
+    nlerpQuaternions(a.rotations + begin, b.rotations + begin, t, &out.rotations[begin], end - begin);
+    lerpFloats(&a.scales[begin].x, &b.scales[begin].x, t, &out.scales[begin].x, (end - begin) * 3);
+}
+
+// translate * rotate * scale, without going through glm's quaternion and matrix products
+inline glm::mat4 composeTransform(const glm::vec3 &translation, const glm::vec4 &rotation, const glm::vec3 &scale) {
+    const float x = rotation.x, y = rotation.y, z = rotation.z, w = rotation.w;
+    glm::mat4 m;
+    m[0] = glm::vec4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w), 2.0f * (x * z - y * w), 0.0f) * scale.x;
+    m[1] = glm::vec4(2.0f * (x * y - z * w), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w), 0.0f) * scale.y;
+    m[2] = glm::vec4(2.0f * (x * z + y * w), 2.0f * (y * z - x * w), 1.0f - 2.0f * (x * x + y * y), 0.0f) * scale.z;
+    m[3] = glm::vec4(translation, 1.0f);
+    return m;
+}
+
+// The box around a transformed box (Arvo's method: the centre moves, the half extent goes through |m|)
+inline void transformBounds(const glm::mat4 &m, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax,
+                            glm::vec3 &outMin, glm::vec3 &outMax) {
+    const glm::vec3 centre = glm::vec3(m * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    const glm::vec3 half = (boundsMax - boundsMin) * 0.5f;
+    const glm::vec3 extent = glm::abs(glm::vec3(m[0])) * half.x + glm::abs(glm::vec3(m[1])) * half.y +
+                             glm::abs(glm::vec3(m[2])) * half.z;
+    outMin = centre - extent;
+    outMax = centre + extent;
+}
+
+class TransformHierarchy {
+public:
+    // Points at new local arrays, which have to stay put until the next attach(). Sorts the nodes into
+    // levels by depth, which a breadth first file already is.
+    void attach(const TransformArrays &arrays) {
+        nodes = arrays;
+        worlds.resize(arrays.count);
+        std::vector<uint32_t> depths(arrays.count);
+        uint32_t deepest = 0;
+        bool sorted = true;
+        for (size_t i = 0; i < arrays.count; i++) {
+            const uint32_t parent = arrays.parents[i];
+            depths[i] = parent == TRANSFORM_NO_PARENT ? 0 : depths[parent] + 1;
+            deepest = std::max(deepest, depths[i]);
+            sorted = sorted && (i == 0 || depths[i] >= depths[i - 1]);
+        }
+        levels.assign(arrays.count ? deepest + 2 : 1, 0);
+        for (size_t i = 0; i < arrays.count; i++)
+            levels[depths[i] + 1]++;
+        for (size_t l = 1; l < levels.size(); l++)
+            levels[l] += levels[l - 1];
+        order.clear();
+        if (!sorted) {
+            order.resize(arrays.count);
+            std::vector<size_t> next(levels.begin(), levels.end() - 1);
+            for (size_t i = 0; i < arrays.count; i++)
+                order[next[depths[i]]++] = (uint32_t) i;
+        }
+    }
+    // Every world transform from the locals as they are now
+    void update() {
+        for (size_t l = 0; l + 1 < levels.size(); l++) {
+            const size_t first = levels[l];
+            parallelFor(levels[l + 1] - first, TRANSFORM_BLOCK_SIZE, [&](size_t begin, size_t end) {
+                for (size_t k = first + begin; k < first + end; k++)
+                    updateNode(order.empty() ? k : order[k]);
+            });
+        }
+    }
+
+    size_t size() const { return nodes.count; }
+    const glm::mat4 &world(size_t node) const { return worlds[node]; }
+    const std::vector<glm::mat4> &world() const { return worlds; }
+
+private:
+    TransformArrays nodes;
+    std::vector<glm::mat4> worlds;
+    std::vector<size_t> levels;   // where each depth starts in order, and where the last one ends
+    std::vector<uint32_t> order;  // nodes by depth, empty when they're in that order already
+
+    void updateNode(size_t i) {
+        const glm::mat4 local = composeTransform(nodes.translations[i], nodes.rotations[i], nodes.scales[i]);
+        const uint32_t parent = nodes.parents[i];
+        worlds[i] = parent == TRANSFORM_NO_PARENT ? local : worlds[parent] * local;
+    }
+};
+
+#endif //OPENGLPLAYGROUND_GLTRANSFORM_H
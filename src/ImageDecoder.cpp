@@ -0,0 +1,458 @@
+#include "ImageDecoder.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "MappedFile.h"
+
+namespace {
+
+// ---- Inflate ----
+
+// LSB first bit reader, reads zeros past the end (which the caller notices through `overrun`)
+struct InflateBits {
+    const unsigned char *data;
+    size_t size, position = 0;
+    uint64_t buffer = 0;
+    int count = 0;
+
+    InflateBits(const unsigned char *data, size_t size) : data(data), size(size) {}
+    void refill() {
+        for (; count <= 56; count += 8, position++)
+            buffer |= (uint64_t) (position < size ? data[position] : 0) << count;
+    }
+    uint32_t peek(int bits) {
+        if (count < bits)
+            refill();
+        return (uint32_t) (buffer & ((1ull << bits) - 1));
+    }
+    void consume(int bits) {
+        buffer >>= bits;
+        count -= bits;
+    }
+    uint32_t get(int bits) {
+        const uint32_t value = peek(bits);
+        consume(bits);
+        return value;
+    }
+    // Byte that the next read starts at, once the reader is on a byte boundary
+    size_t bytePosition() const { return position - count / 8; }
+    void seek(size_t byte) {
+        position = byte;
+        buffer = 0;
+        count = 0;
+    }
+    bool overrun() const { return bytePosition() > size; }
+};
+
+#define INFLATE_FAST_BITS 10
+
+// Canonical Huffman code: a table for codes up to INFLATE_FAST_BITS long, counts/symbols for the rest
+struct InflateTable {
+    uint16_t fast[1 << INFLATE_FAST_BITS]; // symbol | length << 9, 0 if the code is longer
+    uint16_t counts[16];
+    uint16_t symbols[320];
+
+    bool build(const uint8_t *lengths, int n) {
+        std::memset(counts, 0, sizeof(counts));
+        std::memset(fast, 0, sizeof(fast));
+        for (int s = 0; s < n; s++)
+            counts[lengths[s]]++;
+        counts[0] = 0;
+        uint16_t offsets[16] = {};
+        int left = 1;
+        for (int l = 1; l < 16; l++) {
+            left = (left << 1) - counts[l];
+            if (left < 0)
+                return false; // over subscribed
+            offsets[l] = l > 1 ? offsets[l - 1] + counts[l - 1] : 0;
+        }
+        uint16_t next[16];
+        std::memcpy(next, offsets, sizeof(next));
+        for (int s = 0; s < n; s++)
+            if (lengths[s])
+                symbols[next[lengths[s]]++] = (uint16_t) s;
+        // Codes are assigned in symbol order within a length, and arrive bit reversed
+        uint32_t code = 0;
+        int index = 0;
+        for (int l = 1; l <= INFLATE_FAST_BITS; l++, code <<= 1) {
+            for (int i = 0; i < counts[l]; i++, code++, index++) {
+                uint32_t reversed = 0;
+                for (int b = 0; b < l; b++)
+                    reversed |= ((code >> b) & 1u) << (l - 1 - b);
+                for (uint32_t r = reversed; r < (1u << INFLATE_FAST_BITS); r += 1u << l)
+                    fast[r] = (uint16_t) (symbols[index] | l << 9);
+            }
+        }
+        return true;
+    }
+
+    // Returns the symbol, or -1 for a code that isn't in the table
+    int decode(InflateBits &bits) const {
+        const uint16_t entry = fast[bits.peek(INFLATE_FAST_BITS)];
+        if (entry) {
+            bits.consume(entry >> 9);
+            return entry & 0x1FF;
+        }
+        // Long code: walk it a bit at a time (this is the puff.c loop)
+        int code = 0, first = 0, index = 0;
+        for (int l = 1; l < 16; l++) {
+            code |= (int) bits.get(1);
+            const int count = counts[l];
+            if (code - first < count)
+                return symbols[index + code - first];
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99,
+                                  115, 131, 163, 195, 227, 258 };
+const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025,
+                                    1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12,
+                                    12, 13, 13 };
+
+bool inflateBlock(InflateBits &bits, const InflateTable &literals, const InflateTable &distances,
+                  std::vector<unsigned char> &out, size_t start) {
+    for (;;) {
+        const int symbol = literals.decode(bits);
+        if (symbol < 0 || bits.overrun())
+            return false;
+        if (symbol < 256) {
+            out.push_back((unsigned char) symbol);
+            continue;
+        }
+        if (symbol == 256)
+            return true;
+        if (symbol > 285)
+            return false;
+        const size_t length = lengthBase[symbol - 257] + bits.get(lengthExtra[symbol - 257]);
+        const int code = distances.decode(bits);
+        if (code < 0 || code > 29)
+            return false;
+        const size_t distance = distanceBase[code] + bits.get(distanceExtra[code]);
+        if (distance > out.size() - start)
+            return false;
+        // Byte at a time: the match may overlap what it's copying
+        size_t from = out.size() - distance;
+        for (size_t i = 0; i < length; i++)
+            out.push_back(out[from + i]);
+    }
+}
+
+// ---- PNG ----
+
+uint32_t readBE32(const unsigned char *p) {
+    return (uint32_t) p[0] << 24 | (uint32_t) p[1] << 16 | (uint32_t) p[2] << 8 | p[3];
+}
+
+struct PNGHeader {
+    uint32_t width, height;
+    int depth, colourType, channels;
+    int bitsPerPixel;
+    unsigned char palette[256][4];
+    int paletteSize = 0;
+    bool colourKey = false;
+    uint16_t key[3] = {}; // tRNS for grey/RGB: this colour (at the file's bit depth) is transparent
+};
+
+// Turns one unfiltered row into RGBA, writing every `step`th pixel of out
+void convertRow(const PNGHeader &png, const unsigned char *row, uint32_t width, unsigned char *out, size_t step) {
+    const int depth = png.depth;
+    const uint32_t maximum = (1u << depth) - 1;
+    auto sample = [&](uint32_t index) -> uint32_t { // index-th sample of the row at the file's depth
+        if (depth == 8)
+            return row[index];
+        if (depth == 16)
+            return (uint32_t) row[index * 2] << 8 | row[index * 2 + 1];
+        const uint32_t bit = index * depth;
+        return (row[bit / 8] >> (8 - depth - bit % 8)) & maximum;
+    };
+    auto to8 = [&](uint32_t value) -> unsigned char {
+        return (unsigned char) (depth == 16 ? value >> 8 : depth == 8 ? value : value * 255 / maximum);
+    };
+    for (uint32_t x = 0; x < width; x++, out += step * 4) {
+        switch (png.colourType) {
+        case 0: { // grey
+            const uint32_t g = sample(x);
+            out[0] = out[1] = out[2] = to8(g);
+            out[3] = png.colourKey && g == png.key[0] ? 0 : 255;
+            break;
+        }
+        case 2: { // RGB
+            const uint32_t r = sample(x * 3), g = sample(x * 3 + 1), b = sample(x * 3 + 2);
+            out[0] = to8(r);
+            out[1] = to8(g);
+            out[2] = to8(b);
+            out[3] = png.colourKey && r == png.key[0] && g == png.key[1] && b == png.key[2] ? 0 : 255;
+            break;
+        }
+        case 3: { // palette, out of range indices come out black
+            const uint32_t index = sample(x);
+            static const unsigned char black[4] = { 0, 0, 0, 255 };
+            std::memcpy(out, (int) index < png.paletteSize ? png.palette[index] : black, 4);
+            break;
+        }
+        case 4: // grey + alpha
+            out[0] = out[1] = out[2] = to8(sample(x * 2));
+            out[3] = to8(sample(x * 2 + 1));
+            break;
+        default: // RGBA
+            for (int c = 0; c < 4; c++)
+                out[c] = to8(sample(x * 4 + c));
+            break;
+        }
+    }
+}
+
+unsigned char paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+    return (unsigned char) (pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Undoes the filter of each row in place, in rows of 1 + rowBytes (filter type first)
+bool unfilter(unsigned char *rows, uint32_t height, size_t rowBytes, int pixelBytes) {
+    const unsigned char *previous = nullptr;
+    for (uint32_t y = 0; y < height; y++) {
+        unsigned char *row = rows + y * (rowBytes + 1) + 1;
+        const int filter = row[-1];
+        for (size_t i = 0; i < rowBytes; i++) {
+            const int a = i >= (size_t) pixelBytes ? row[i - pixelBytes] : 0;
+            const int b = previous ? previous[i] : 0;
+            const int c = previous && i >= (size_t) pixelBytes ? previous[i - pixelBytes] : 0;
+            switch (filter) {
+            case 0: break;
+            case 1: row[i] = (unsigned char) (row[i] + a); break;
+            case 2: row[i] = (unsigned char) (row[i] + b); break;
+            case 3: row[i] = (unsigned char) (row[i] + ((a + b) >> 1)); break;
+            case 4: row[i] = (unsigned char) (row[i] + paeth(a, b, c)); break;
+            default: return false;
+            }
+        }
+        previous = row;
+    }
+    return true;
+}
+
+} // namespace
+
+bool zlibInflate(const unsigned char *data, size_t size, std::vector<unsigned char> &out) {
+    // CMF/FLG: deflate, no preset dictionary, header checksum
+    if (size < 2 || (data[0] & 0x0F) != 8 || (data[0] * 256 + data[1]) % 31 != 0 || (data[1] & 0x20))
+        return false;
+    InflateBits bits(data + 2, size - 2);
+    const size_t start = out.size();
+    InflateTable literals, distances;
+    for (bool last = false; !last;) {
+        last = bits.get(1) != 0;
+        const uint32_t type = bits.get(2);
+        if (type == 0) { // stored
+            bits.consume(bits.count % 8);
+            const size_t at = bits.bytePosition();
+            if (at + 4 > bits.size)
+                return false;
+            const uint32_t length = bits.data[at] | (uint32_t) bits.data[at + 1] << 8;
+            const uint32_t check = bits.data[at + 2] | (uint32_t) bits.data[at + 3] << 8;
+            if ((length ^ 0xFFFFu) != check || at + 4 + length > bits.size)
+                return false;
+            out.insert(out.end(), bits.data + at + 4, bits.data + at + 4 + length);
+            bits.seek(at + 4 + length);
+            continue;
+        }
+        uint8_t lengths[320];
+        if (type == 1) { // fixed codes
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            std::memset(lengths + 288, 5, 30);
+            literals.build(lengths, 288);
+            distances.build(lengths + 288, 30);
+        } else if (type == 2) { // dynamic codes, themselves Huffman coded with a code length code
+            const int literalCount = (int) bits.get(5) + 257, distanceCount = (int) bits.get(5) + 1;
+            const int codeCount = (int) bits.get(4) + 4;
+            static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+            uint8_t codeLengths[19] = {};
+            for (int i = 0; i < codeCount; i++)
+                codeLengths[order[i]] = (uint8_t) bits.get(3);
+            InflateTable lengthCode;
+            if (literalCount > 286 || !lengthCode.build(codeLengths, 19))
+                return false;
+            for (int i = 0; i < literalCount + distanceCount;) {
+                const int symbol = lengthCode.decode(bits);
+                if (symbol < 0)
+                    return false;
+                if (symbol < 16) {
+                    lengths[i++] = (uint8_t) symbol;
+                    continue;
+                }
+                int repeat;
+                uint8_t value = 0;
+                if (symbol == 16) {
+                    if (i == 0)
+                        return false;
+                    value = lengths[i - 1];
+                    repeat = 3 + (int) bits.get(2);
+                } else {
+                    repeat = symbol == 17 ? 3 + (int) bits.get(3) : 11 + (int) bits.get(7);
+                }
+                if (i + repeat > literalCount + distanceCount)
+                    return false;
+                std::memset(lengths + i, value, (size_t) repeat);
+                i += repeat;
+            }
+            if (!literals.build(lengths, literalCount) || !distances.build(lengths + literalCount, distanceCount))
+                return false;
+        } else {
+            return false;
+        }
+        if (!inflateBlock(bits, literals, distances, out, start))
+            return false;
+    }
+    // The Adler-32 trailer isn't checked: PNG has its own CRCs, and a corrupt stream rarely inflates cleanly
+    return !bits.overrun();
+}
+
+bool decodePNG(const unsigned char *data, size_t size, Image &image) {
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    if (size < 8 || std::memcmp(data, signature, 8) != 0) {
+        std::cerr << "ERROR::IMAGEDECODER::NOT_A_PNG" << std::endl;
+        return false;
+    }
+    PNGHeader png = {};
+    bool haveHeader = false, interlaced = false;
+    std::vector<unsigned char> compressed;
+    for (size_t at = 8;;) {
+        if (at + 12 > size) {
+            std::cerr << "ERROR::IMAGEDECODER::PNG_TRUNCATED" << std::endl;
+            return false;
+        }
+        const uint32_t length = readBE32(data + at);
+        const unsigned char *type = data + at + 4, *chunk = data + at + 8;
+        if (length > size - at - 12) {
+            std::cerr << "ERROR::IMAGEDECODER::PNG_TRUNCATED" << std::endl;
+            return false;
+        }
+        at += 12 + (size_t) length;
+        if (std::memcmp(type, "IHDR", 4) == 0 && length >= 13) {
+            png.width = readBE32(chunk);
+            png.height = readBE32(chunk + 4);
+            png.depth = chunk[8];
+            png.colourType = chunk[9];
+            interlaced = chunk[12] == 1;
+            static const int channels[7] = { 1, 0, 3, 1, 2, 0, 4 };
+            png.channels = png.colourType <= 6 ? channels[png.colourType] : 0;
+            const int depth = png.depth;
+            const bool depthOk = png.colourType == 0 ? depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16
+                               : png.colourType == 3 ? depth == 1 || depth == 2 || depth == 4 || depth == 8
+                               : depth == 8 || depth == 16;
+            if (!png.channels || !depthOk || chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1) {
+                std::cerr << "ERROR::IMAGEDECODER::PNG_BAD_HEADER" << std::endl;
+                return false;
+            }
+            if (png.width == 0 || png.height == 0 || png.width > IMAGE_MAX_SIDE || png.height > IMAGE_MAX_SIDE) {
+                std::cerr << "ERROR::IMAGEDECODER::PNG_BAD_SIZE " << png.width << "x" << png.height << std::endl;
+                return false;
+            }
+            png.bitsPerPixel = png.channels * depth;
+            haveHeader = true;
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            png.paletteSize = (int) std::min<uint32_t>(length / 3, 256);
+            for (int i = 0; i < png.paletteSize; i++) {
+                std::memcpy(png.palette[i], chunk + i * 3, 3);
+                png.palette[i][3] = 255;
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (png.colourType == 3) {
+                for (int i = 0; i < (int) length && i < png.paletteSize; i++)
+                    png.palette[i][3] = chunk[i];
+            } else if ((png.colourType == 0 && length >= 2) || (png.colourType == 2 && length >= 6)) {
+                png.colourKey = true;
+                for (int c = 0; c < (png.colourType == 0 ? 1 : 3); c++)
+                    png.key[c] = (uint16_t) (chunk[c * 2] << 8 | chunk[c * 2 + 1]);
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        } else if (!(type[0] & 0x20)) { // uppercase first letter: critical, we can't skip it
+            std::cerr << "ERROR::IMAGEDECODER::PNG_UNKNOWN_CRITICAL_CHUNK " << std::string((const char *) type, 4)
+                      << std::endl;
+            return false;
+        }
+    }
+    if (!haveHeader || compressed.empty() || (png.colourType == 3 && png.paletteSize == 0)) {
+        std::cerr << "ERROR::IMAGEDECODER::PNG_MISSING_CHUNK" << std::endl;
+        return false;
+    }
+
+    // Adam7 passes, or one pass covering everything
+    static const uint32_t passX[7] = { 0, 4, 0, 2, 0, 1, 0 }, passY[7] = { 0, 0, 4, 0, 2, 0, 1 };
+    static const uint32_t stepX[7] = { 8, 8, 4, 4, 2, 2, 1 }, stepY[7] = { 8, 8, 8, 4, 4, 2, 2 };
+    const int passes = interlaced ? 7 : 1;
+    size_t expected = 0;
+    for (int p = 0; p < passes; p++) {
+        const uint32_t w = interlaced ? (png.width - passX[p] + stepX[p] - 1) / stepX[p] : png.width;
+        const uint32_t h = interlaced ? (png.height - passY[p] + stepY[p] - 1) / stepY[p] : png.height;
+        if (w && h)
+            expected += h * (1 + ((size_t) w * png.bitsPerPixel + 7) / 8);
+    }
+    std::vector<unsigned char> raw;
+    raw.reserve(expected);
+    if (!zlibInflate(compressed.data(), compressed.size(), raw) || raw.size() < expected) {
+        std::cerr << "ERROR::IMAGEDECODER::PNG_CORRUPT_DATA" << std::endl;
+        return false;
+    }
+
+    image.width = (int) png.width;
+    image.height = (int) png.height;
+    image.pixels.resize((size_t) png.width * png.height * 4);
+    const int pixelBytes = std::max(1, png.bitsPerPixel / 8);
+    unsigned char *rows = raw.data();
+    for (int p = 0; p < passes; p++) {
+        const uint32_t w = interlaced ? (png.width - passX[p] + stepX[p] - 1) / stepX[p] : png.width;
+        const uint32_t h = interlaced ? (png.height - passY[p] + stepY[p] - 1) / stepY[p] : png.height;
+        if (!w || !h)
+            continue;
+        const size_t rowBytes = ((size_t) w * png.bitsPerPixel + 7) / 8;
+        if (!unfilter(rows, h, rowBytes, pixelBytes)) {
+            std::cerr << "ERROR::IMAGEDECODER::PNG_BAD_FILTER" << std::endl;
+            return false;
+        }
+        for (uint32_t y = 0; y < h; y++) {
+            const uint32_t outY = interlaced ? passY[p] + y * stepY[p] : y;
+            const uint32_t outX = interlaced ? passX[p] : 0;
+            convertRow(png, rows + y * (rowBytes + 1) + 1, w,
+                       &image.pixels[((size_t) outY * png.width + outX) * 4], interlaced ? stepX[p] : 1);
+        }
+        rows += h * (rowBytes + 1);
+    }
+    return true;
+}
+
+bool decodeImage(const unsigned char *data, size_t size, Image &image) {
+    if (size >= 8 && data[0] == 0x89 && data[1] == 'P' && data[2] == 'N' && data[3] == 'G')
+        return decodePNG(data, size, image);
+    if (size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF)
+        return decodeJPEG(data, size, image);
+    std::cerr << "ERROR::IMAGEDECODER::UNKNOWN_FORMAT" << std::endl;
+    return false;
+}
+
+bool loadImage(const char *path, Image &image) {
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    if (!decodeImage(file.data(), file.size(), image)) {
+        std::cerr << "ERROR::IMAGEDECODER::FAILED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef OPENGLPLAYGROUND_IMAGEDECODER_H
+#define OPENGLPLAYGROUND_IMAGEDECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// PNG and baseline JPEG decoders, written here for the same reason as BlockCompression.h: no vendored
+// dependencies. Everything decodes to 8 bit RGBA, which is what the texture path uploads.
+// PNG: every colour type and bit depth (16 bit is cut to 8), palettes with tRNS, Adam7 interlacing.
+// JPEG: baseline and extended sequential Huffman, greyscale or YCbCr with any sampling factors up to 4x4,
+// restart markers. No progressive or arithmetic coded JPEGs.
+
+// Textures bigger than this on a side are almost certainly a corrupt header, so the decoders reject them
+// rather than allocate for them
+#define IMAGE_MAX_SIDE 32768
+
+struct Image {
+    int width = 0, height = 0;
+    std::vector<unsigned char> pixels; // width * height RGBA, rows top to bottom
+
+    size_t bytes() const { return pixels.size(); }
+};
+
+// Each returns false (after printing why) if the data is corrupt or uses something unsupported
+bool decodePNG(const unsigned char *data, size_t size, Image &image);
+bool decodeJPEG(const unsigned char *data, size_t size, Image &image);
+// Picks the decoder from the file signature
+bool decodeImage(const unsigned char *data, size_t size, Image &image);
+// Maps the file and decodes it
+bool loadImage(const char *path, Image &image);
+
+// zlib stream (RFC 1950/1951) -> out, appended. Returns false if the stream is corrupt.
+bool zlibInflate(const unsigned char *data, size_t size, std::vector<unsigned char> &out);
+
+#endif //OPENGLPLAYGROUND_IMAGEDECODER_H
@@ -0,0 +1,353 @@
+#include "IndexPacking.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Greedy stripifier: start a strip at the first unused triangle in the given order, then keep walking to
+// the unused neighbour across the strip's open edge. GL flips the winding of every other strip triangle,
+// so the edge to continue over is q->p after an even triangle and p->q after an odd one.
+void stripify(const uint32_t *indices, size_t indexCount, std::vector<uint32_t> &strips) {
+    const size_t triangleCount = indexCount / 3;
+    // Directed edge (from << 32 | to) -> triangle, sorted for lookups
+    std::vector<std::pair<uint64_t, uint32_t>> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int e = 0; e < 3; e++)
+            edges.push_back({ (uint64_t) indices[t * 3 + e] << 32 | indices[t * 3 + (e + 1) % 3], (uint32_t) t });
+    std::sort(edges.begin(), edges.end());
+    std::vector<bool> used(triangleCount, false);
+
+    // The unused triangle with directed edge from->to, or -1
+    auto across = [&](uint32_t from, uint32_t to) -> int64_t {
+        const uint64_t key = (uint64_t) from << 32 | to;
+        auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, 0u));
+        for (; it != edges.end() && it->first == key; ++it)
+            if (!used[it->second])
+                return it->second;
+        return -1;
+    };
+    auto third = [&](int64_t t, uint32_t a, uint32_t b) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = indices[t * 3 + k];
+            if (v != a && v != b)
+                return v;
+        }
+        return indices[t * 3];
+    };
+
+    for (size_t start = 0; start < triangleCount; start++) {
+        if (used[start])
+            continue;
+        used[start] = true;
+        // Rotate the first triangle so the strip can continue, if any rotation allows it
+        const uint32_t *tri = indices + start * 3;
+        int rotation = 0;
+        for (int r = 0; r < 3; r++) {
+            if (across(tri[(r + 2) % 3], tri[(r + 1) % 3]) >= 0) {
+                rotation = r;
+                break;
+            }
+        }
+        for (int k = 0; k < 3; k++)
+            strips.push_back(tri[(rotation + k) % 3]);
+        uint32_t p = tri[(rotation + 1) % 3], q = tri[(rotation + 2) % 3];
+        for (size_t n = 1;; n++) {
+            const int64_t next = n & 1 ? across(q, p) : across(p, q);
+            if (next < 0)
+                break;
+            used[next] = true;
+            const uint32_t d = third(next, p, q);
+            strips.push_back(d);
+            p = q;
+            q = d;
+        }
+        strips.push_back(MESH_INDEX_RESTART);
+    }
+}
+
+// Cuts mesh.indices into batches of whole triangles (lists) or whole strips including their restart, each
+// reaching at most INDEX_PACK_MAX_SPAN vertices past its base. A triangle/strip whose own vertices are further
+// apart than that (usually one the vertex cache optimizer left for last) is split off the mesh: it gets
+// copies of its vertices at the end of the vertex buffer, which puts it in a batch of its own.
+// Without `split` the copies only happen on paper, to find out whether 16 bits would be worth it.
+// `fits` is false if some strip is too long to fit a batch at all.
+std::vector<IndexBatch> cutBatches(MeshData &mesh, bool split, size_t &triangles, size_t &splitVertices, bool &fits) {
+    std::vector<uint32_t> &indices = mesh.indices;
+    const bool strips = mesh.mode == 0x0005;
+    const size_t stride = mesh.layout.stride;
+    std::vector<IndexBatch> batches;
+    std::vector<std::pair<uint32_t, uint32_t>> copies; // old -> new vertex within one unit
+    size_t nextVertex = mesh.vertexCount;
+    uint32_t lo = 0, hi = 0;
+    triangles = splitVertices = 0;
+    fits = true;
+    for (size_t i = 0; i < indices.size();) {
+        size_t end = i + 3;
+        if (strips)
+            for (end = i; end < indices.size() && indices[end++] != MESH_INDEX_RESTART;) {}
+        end = std::min(end, indices.size());
+        uint32_t unitLo = 0xFFFFFFFFu, unitHi = 0;
+        size_t corners = 0;
+        for (size_t k = i; k < end; k++) {
+            if (indices[k] == MESH_INDEX_RESTART)
+                continue;
+            unitLo = std::min(unitLo, indices[k]);
+            unitHi = std::max(unitHi, indices[k]);
+            corners++;
+        }
+        triangles += strips ? (corners > 2 ? corners - 2 : 0) : corners / 3;
+        if (corners > INDEX_PACK_MAX_SPAN)
+            fits = false;
+        if (corners > 0 && unitHi - unitLo > INDEX_PACK_MAX_SPAN && fits) {
+            copies.clear();
+            for (size_t k = i; k < end; k++) {
+                if (indices[k] == MESH_INDEX_RESTART)
+                    continue;
+                auto copy = std::find_if(copies.begin(), copies.end(),
+                                         [&](const std::pair<uint32_t, uint32_t> &c) { return c.first == indices[k]; });
+                if (copy == copies.end()) {
+                    copies.push_back({ indices[k], (uint32_t) nextVertex++ });
+                    copy = copies.end() - 1;
+                    if (split) {
+                        mesh.vertexData.resize(nextVertex * stride);
+                        std::memcpy(&mesh.vertexData[copy->second * stride], &mesh.vertexData[(size_t) copy->first * stride],
+                                    stride);
+                    }
+                }
+                if (split)
+                    indices[k] = copy->second;
+            }
+            unitLo = copies.front().second;
+            unitHi = copies.back().second;
+            splitVertices += copies.size();
+        }
+        if (corners > 0 && unitHi - unitLo <= INDEX_PACK_MAX_SPAN) {
+            if (batches.empty() || std::max(hi, unitHi) - std::min(lo, unitLo) > INDEX_PACK_MAX_SPAN) {
+                batches.push_back({ (uint32_t) i, 0, 0 });
+                lo = unitLo;
+                hi = unitHi;
+            } else {
+                lo = std::min(lo, unitLo);
+                hi = std::max(hi, unitHi);
+            }
+        }
+        // Lone restarts just tag along
+        if (!batches.empty()) {
+            batches.back().indexCount = (uint32_t) (end - batches.back().firstIndex);
+            batches.back().baseVertex = lo;
+        }
+        i = end;
+    }
+    if (split)
+        mesh.vertexCount = nextVertex;
+    // Leading restarts before the first vertex go in the first batch
+    if (!batches.empty()) {
+        batches.front().indexCount += batches.front().firstIndex;
+        batches.front().firstIndex = 0;
+    }
+    return batches;
+}
+
+} // namespace
+
+size_t splitForShortIndices(MeshData &mesh) {
+    if (mesh.vertexCount <= INDEX_PACK_MAX_SPAN || mesh.mode != 0x0004)
+        return 0;
+    if (mesh.submeshes.empty())
+        mesh.submeshes.push_back({ 0, (uint32_t) mesh.indices.size(), "" });
+
+    std::vector<SubMesh> pieces;
+    std::vector<uint32_t> offsets(mesh.vertexCount + 1), adjacency, queue, queuedIn, output;
+    std::vector<uint32_t> seenIn(mesh.vertexCount, 0xFFFFFFFFu); // which piece last counted each vertex
+    std::vector<bool> placed;
+    uint32_t piece = 0;
+    for (const SubMesh &submesh : mesh.submeshes) {
+        const size_t triangleCount = submesh.indexCount / 3;
+        uint32_t *indices = mesh.indices.data() + submesh.firstIndex;
+        // Cheap check first: small submeshes stay as they are
+        size_t distinct = 0;
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            if (seenIn[indices[i]] != piece) {
+                seenIn[indices[i]] = piece;
+                distinct++;
+            }
+        piece++;
+        if (distinct <= INDEX_PACK_SPLIT_VERTICES) {
+            pieces.push_back(submesh);
+            continue;
+        }
+
+        // Vertex -> triangles of this submesh (CSR)
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            offsets[indices[i] + 1]++;
+        for (size_t v = 0; v < mesh.vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(triangleCount * 3);
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangleCount * 3; i++)
+                adjacency[fill[indices[i]]++] = (uint32_t) (i / 3);
+        }
+
+        // Grow each piece breadth first over shared vertices, so pieces are compact patches of the surface.
+        // The next piece starts on the previous one's frontier, so consecutive pieces stay next to each other.
+        placed.assign(triangleCount, false);
+        queuedIn.assign(triangleCount, 0xFFFFFFFFu);
+        queue.clear();
+        output.clear();
+        size_t cursor = 0, frontier = 0;
+        SubMesh current = { submesh.firstIndex, 0, submesh.name };
+        while (output.size() < triangleCount * 3) {
+            uint32_t seed = 0xFFFFFFFFu;
+            for (; frontier < queue.size() && seed == 0xFFFFFFFFu; frontier++)
+                if (!placed[queue[frontier]])
+                    seed = queue[frontier];
+            for (; seed == 0xFFFFFFFFu; cursor++)
+                if (!placed[cursor])
+                    seed = (uint32_t) cursor;
+            queue.assign(1, seed);
+            queuedIn[seed] = piece;
+            distinct = 0;
+            size_t head = 0;
+            for (; head < queue.size(); head++) {
+                const uint32_t t = queue[head];
+                const uint32_t *tri = indices + (size_t) t * 3;
+                size_t added = 0;
+                for (int k = 0; k < 3; k++)
+                    added += seenIn[tri[k]] != piece && (k < 1 || tri[k] != tri[0]) && (k < 2 || tri[k] != tri[1]);
+                if (distinct + added > INDEX_PACK_SPLIT_VERTICES)
+                    break;
+                distinct += added;
+                placed[t] = true;
+                output.insert(output.end(), tri, tri + 3);
+                current.indexCount += 3;
+                for (int k = 0; k < 3; k++) {
+                    seenIn[tri[k]] = piece;
+                    for (uint32_t a = offsets[tri[k]]; a < offsets[tri[k] + 1]; a++) {
+                        const uint32_t u = adjacency[a];
+                        if (!placed[u] && queuedIn[u] != piece) {
+                            queuedIn[u] = piece;
+                            queue.push_back(u);
+                        }
+                    }
+                }
+            }
+            frontier = head;
+            pieces.push_back(current);
+            current = { current.firstIndex + current.indexCount, 0, submesh.name };
+            piece++;
+        }
+        std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+    }
+
+    // Pieces share vertices along their borders. Give every piece but the first its own copies, so once the
+    // optimizer has ordered vertices by first use each piece's vertices are one contiguous run
+    std::vector<uint32_t> owner(mesh.vertexCount, 0xFFFFFFFFu), copyOf(mesh.vertexCount);
+    std::vector<uint32_t> copies;
+    const size_t stride = mesh.layout.stride;
+    for (uint32_t p = 0; p < pieces.size(); p++) {
+        uint32_t *indices = mesh.indices.data() + pieces[p].firstIndex;
+        for (size_t i = 0; i < pieces[p].indexCount; i++) {
+            const uint32_t v = indices[i];
+            if (owner[v] == 0xFFFFFFFFu)
+                owner[v] = p;
+            if (owner[v] == p)
+                continue;
+            if (seenIn[v] != p + piece) { // seenIn is free now, reuse it as "copied for this piece"
+                seenIn[v] = p + piece;
+                copyOf[v] = (uint32_t) (mesh.vertexCount + copies.size());
+                copies.push_back(v);
+            }
+            indices[i] = copyOf[v];
+        }
+    }
+    mesh.vertexData.resize((mesh.vertexCount + copies.size()) * stride);
+    for (size_t c = 0; c < copies.size(); c++)
+        std::memcpy(&mesh.vertexData[(mesh.vertexCount + c) * stride], &mesh.vertexData[(size_t) copies[c] * stride],
+                    stride);
+    mesh.vertexCount += copies.size();
+
+    const size_t added = pieces.size() - mesh.submeshes.size();
+    mesh.submeshes.swap(pieces);
+    return added;
+}
+
+size_t stripifyMesh(MeshData &mesh) {
+    if (mesh.mode != 0x0004) // already strips
+        return mesh.indices.size();
+    if (mesh.submeshes.empty())
+        mesh.submeshes.push_back({ 0, (uint32_t) mesh.indices.size(), "" });
+    // The submeshes make up level 0, then every other LOD level has a range per submesh
+    std::vector<uint32_t> strips;
+    strips.reserve(mesh.indices.size());
+    for (SubMesh &submesh : mesh.submeshes) {
+        const uint32_t first = (uint32_t) strips.size();
+        stripify(mesh.indices.data() + submesh.firstIndex, submesh.indexCount, strips);
+        submesh.firstIndex = first;
+        submesh.indexCount = (uint32_t) strips.size() - first;
+    }
+    const size_t submeshCount = mesh.submeshes.size();
+    for (size_t l = 0; l < mesh.lods.size(); l++) {
+        MeshLOD &lod = mesh.lods[l];
+        lod.firstIndex = l == 0 ? 0 : (uint32_t) strips.size();
+        for (size_t s = 0; s < submeshCount; s++) {
+            LODRange &range = mesh.lodRanges[l * submeshCount + s];
+            if (l == 0) {
+                range = { mesh.submeshes[s].firstIndex, mesh.submeshes[s].indexCount };
+                continue;
+            }
+            const uint32_t first = (uint32_t) strips.size();
+            stripify(mesh.indices.data() + range.firstIndex, range.indexCount, strips);
+            range = { first, (uint32_t) strips.size() - first };
+        }
+        lod.indexCount = (uint32_t) (l == 0 ? mesh.submeshes.back().firstIndex + mesh.submeshes.back().indexCount
+                                            : strips.size() - lod.firstIndex);
+    }
+    mesh.indices.swap(strips);
+    mesh.mode = 0x0005; // GL_TRIANGLE_STRIP
+    mesh.meshlets.clear();
+    return mesh.indices.size();
+}
+
+void packIndices(MeshData &mesh, IndexPackStats *stats) {
+    const std::vector<uint32_t> &indices = mesh.indices;
+    IndexPackStats result;
+    result.strips = mesh.mode == 0x0005;
+
+    size_t triangles, splitVertices;
+    bool fits;
+    std::vector<IndexBatch> batches = cutBatches(mesh, false, triangles, splitVertices, fits);
+
+    // Worth it if the batches aren't too small and the copied vertices eat at most half of the bytes saved
+    const bool narrow = fits && !batches.empty() &&
+                        (batches.size() == 1 || indices.size() / batches.size() >= INDEX_PACK_MIN_BATCH_INDICES) &&
+                        splitVertices * mesh.layout.stride * 2 <= indices.size() * (sizeof(uint32_t) - sizeof(uint16_t));
+
+    mesh.indexBatches.clear();
+    if (narrow) {
+        batches = cutBatches(mesh, true, triangles, splitVertices, fits);
+        result.splitVertices = splitVertices;
+        mesh.indexType = ComponentType::UnsignedShort;
+        mesh.packedIndices.resize(indices.size() * sizeof(uint16_t));
+        uint16_t *packed = reinterpret_cast<uint16_t *>(mesh.packedIndices.data());
+        for (const IndexBatch &batch : batches)
+            for (size_t k = batch.firstIndex; k < (size_t) batch.firstIndex + batch.indexCount; k++)
+                packed[k] = indices[k] == MESH_INDEX_RESTART ? (uint16_t) 0xFFFF : (uint16_t) (indices[k] - batch.baseVertex);
+        mesh.indexBatches = batches;
+    } else {
+        mesh.indexType = ComponentType::UnsignedInt;
+        mesh.packedIndices.resize(indices.size() * sizeof(uint32_t));
+        std::memcpy(mesh.packedIndices.data(), indices.data(), mesh.packedIndices.size());
+        if (!indices.empty())
+            mesh.indexBatches.push_back({ 0, (uint32_t) indices.size(), 0 });
+    }
+
+    result.type = mesh.indexType;
+    result.batches = mesh.indexBatches.size();
+    result.listBytes = triangles * 3 * sizeof(uint32_t);
+    result.packedBytes = mesh.packedIndices.size();
+    if (stats)
+        *stats = result;
+}
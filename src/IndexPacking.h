@@ -0,0 +1,49 @@
+#ifndef OPENGLPLAYGROUND_INDEXPACKING_H
+#define OPENGLPLAYGROUND_INDEXPACKING_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+
+// Making index buffers smaller: 16 bit indices wherever they can address the vertices, and optionally
+// triangle strips with primitive restart instead of lists.
+
+// A batch of 16 bit indices has to reach all its vertices from its base vertex, with 0xFFFF kept for restart
+#define INDEX_PACK_MAX_SPAN 0xFFFEu
+// splitForShortIndices cuts submeshes into pieces of at most this many vertices, all a batch reaches
+#define INDEX_PACK_SPLIT_VERTICES (INDEX_PACK_MAX_SPAN + 1)
+// Fewer indices than this per batch on average and the extra draws cost more than the bandwidth saved
+#define INDEX_PACK_MIN_BATCH_INDICES 3072
+
+struct IndexPackStats {
+    size_t listBytes = 0;   // the mesh as a 32 bit triangle list
+    size_t packedBytes = 0; // what the GPU gets
+    size_t batches = 0;
+    size_t splitVertices = 0; // vertices copied so far apart triangles fit a 16 bit batch
+    ComponentType type = ComponentType::UnsignedInt;
+    bool strips = false;
+
+    size_t savedBytes() const { return listBytes > packedBytes ? listBytes - packedBytes : 0; }
+};
+
+// For meshes with more vertices than 16 bit indices reach: splits every big submesh into compact patches
+// (consecutive submeshes with the same name) of at most INDEX_PACK_SPLIT_VERTICES vertices, and copies the
+// vertices pieces share so each has its own. Run it before optimizeMesh, which orders vertices by first use,
+// so each piece's vertices end up together and packIndices can give it a 16 bit batch. Returns the number
+// of pieces added.
+size_t splitForShortIndices(MeshData &mesh);
+
+// Rewrites the submeshes and LOD levels of a triangle list mesh as triangle strips (each one followed by
+// MESH_INDEX_RESTART) and sets mesh.mode to GL_TRIANGLE_STRIP. Strips follow the existing triangle order,
+// so a vertex cache optimised mesh stays mostly cache friendly. Meshlets are dropped: culling them draws
+// ranges of a triangle list. Returns the new index count.
+size_t stripifyMesh(MeshData &mesh);
+
+// Fills mesh.packedIndices/indexType/indexBatches from mesh.indices: 16 bit unless that takes too many
+// batches, 32 bit otherwise. Batches only split between triangles or strips, so any range of the index
+// buffer can be drawn by cutting it at batch boundaries. The odd triangle whose vertices are more than
+// INDEX_PACK_MAX_SPAN apart gets copies of them appended to the vertex buffer (mesh.indices is rewritten
+// to match), so it can go in a batch of its own.
+void packIndices(MeshData &mesh, IndexPackStats *stats = nullptr);
+
+#endif //OPENGLPLAYGROUND_INDEXPACKING_H
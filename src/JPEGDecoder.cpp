@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "ImageDecoder.h"
+
+// Baseline JPEG (ITU T.81): Huffman decode, dequantise, AAN float IDCT straight into one plane per component,
+// then upsample (nearest) and convert YCbCr -> RGB.
+
+namespace {
+
+const uint8_t zigzag[64] = { 0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34,
+                             27, 20, 13, 6, 7, 14, 21, 28, 35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44,
+                             51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63 };
+
+#define JPEG_FAST_BITS 9
+
+// MSB first reader over entropy coded data: skips the 0x00 stuffed after every 0xFF, and stops at a marker
+// (feeding zeros from then on)
+struct JPEGBits {
+    const unsigned char *data;
+    size_t size, position;
+    uint32_t buffer = 0;
+    int count = 0;
+    bool marker = false;
+
+    void refill() {
+        for (; count <= 24; count += 8) {
+            uint32_t byte = 0;
+            if (!marker && position < size) {
+                byte = data[position];
+                if (byte == 0xFF) {
+                    const unsigned char next = position + 1 < size ? data[position + 1] : 0xD9;
+                    if (next == 0x00)
+                        position += 2;
+                    else {
+                        marker = true;
+                        byte = 0;
+                    }
+                } else {
+                    position++;
+                }
+            }
+            buffer |= byte << (24 - count);
+        }
+    }
+    uint32_t peek16() {
+        if (count < 16)
+            refill();
+        return buffer >> 16;
+    }
+    void consume(int bits) {
+        buffer <<= bits;
+        count -= bits;
+    }
+    uint32_t get(int bits) {
+        if (bits == 0)
+            return 0;
+        if (count < bits)
+            refill();
+        const uint32_t value = buffer >> (32 - bits);
+        consume(bits);
+        return value;
+    }
+    // After a restart interval: drop the partial byte and step over the RSTn marker
+    bool restart() {
+        buffer = 0;
+        count = 0;
+        marker = false;
+        if (position + 1 < size && data[position] == 0xFF && data[position + 1] >= 0xD0 && data[position + 1] <= 0xD7) {
+            position += 2;
+            return true;
+        }
+        return false;
+    }
+};
+
+struct JPEGHuffman {
+    uint16_t fast[1 << JPEG_FAST_BITS]; // symbol | length << 8, 0 if the code is longer
+    int32_t maxCode[18];                // largest code of each length, -1 if none
+    int32_t offset[17];                 // symbol index of a code = code + offset[length]
+    uint8_t symbols[256];
+    bool defined = false;
+
+    bool build(const uint8_t *counts, const uint8_t *values, int total) {
+        std::memcpy(symbols, values, (size_t) total);
+        std::memset(fast, 0, sizeof(fast));
+        int32_t code = 0;
+        int index = 0;
+        for (int l = 1; l <= 16; l++) {
+            // More codes than the length has room for: check before they're written into `fast`
+            if (code + counts[l - 1] > (1 << l))
+                return false;
+            offset[l] = index - code;
+            for (int i = 0; i < counts[l - 1]; i++, index++, code++)
+                if (l <= JPEG_FAST_BITS)
+                    for (int r = 0; r < 1 << (JPEG_FAST_BITS - l); r++)
+                        fast[(code << (JPEG_FAST_BITS - l)) | r] = (uint16_t) (symbols[index] | l << 8);
+            maxCode[l] = counts[l - 1] ? code - 1 : -1;
+            code <<= 1;
+        }
+        maxCode[17] = 0x7FFFFFFF; // sentinel
+        defined = true;
+        return true;
+    }
+
+    // Returns the symbol, or -1 for a code that isn't in the table
+    int decode(JPEGBits &bits) const {
+        const uint32_t peek = bits.peek16();
+        const uint16_t entry = fast[peek >> (16 - JPEG_FAST_BITS)];
+        if (entry) {
+            bits.consume(entry >> 8);
+            return entry & 0xFF;
+        }
+        for (int l = JPEG_FAST_BITS + 1; l <= 16; l++) {
+            const int32_t code = (int32_t) (peek >> (16 - l));
+            if (code <= maxCode[l]) {
+                bits.consume(l);
+                return symbols[code + offset[l]];
+            }
+        }
+        return -1;
+    }
+};
+
+// The s bit value that follows a Huffman symbol: the top half of the range is positive, the bottom half
+// stands for negatives
+int extend(uint32_t value, int s) {
+    return s == 0 ? 0 : value < (1u << (s - 1)) ? (int) value - (1 << s) + 1 : (int) value;
+}
+
+struct JPEGComponent {
+    int id, h, v, quantTable;
+    int dcTable = 0, acTable = 0;
+    int prediction = 0;
+    int planeWidth = 0, planeHeight = 0; // whole MCUs worth of samples
+    std::vector<unsigned char> plane;
+};
+
+// AAN scale factors: cos(k pi / 16) * sqrt(2) for k > 0. The fast IDCT below leaves these multiplies out,
+// so they're folded into the dequantisation table instead (along with the 1/8 of the 2D transform).
+const float aanScale[8] = { 1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+                            1.0f, 0.785694958f, 0.541196100f, 0.275899379f };
+
+// One 8 point AAN inverse DCT (as in libjpeg's jidctflt.c), in[i * step] -> out[i * step]
+inline void idct8(const float *in, float *out, int step) {
+    // Even part
+    float t0 = in[0], t1 = in[2 * step], t2 = in[4 * step], t3 = in[6 * step];
+    float t10 = t0 + t2, t11 = t0 - t2;
+    float t13 = t1 + t3, t12 = (t1 - t3) * 1.414213562f - t13;
+    t0 = t10 + t13;
+    t3 = t10 - t13;
+    t1 = t11 + t12;
+    t2 = t11 - t12;
+    // Odd part
+    const float t4 = in[step], t5 = in[3 * step], t6 = in[5 * step], t7 = in[7 * step];
+    const float z13 = t6 + t5, z10 = t6 - t5, z11 = t4 + t7, z12 = t4 - t7;
+    const float o7 = z11 + z13;
+    const float o11 = (z11 - z13) * 1.414213562f;
+    const float z5 = (z10 + z12) * 1.847759065f;
+    const float o10 = 1.082392200f * z12 - z5;
+    const float o12 = -2.613125930f * z10 + z5;
+    const float o6 = o12 - o7, o5 = o11 - o6, o4 = o10 + o5;
+    out[0] = t0 + o7;
+    out[7 * step] = t0 - o7;
+    out[step] = t1 + o6;
+    out[6 * step] = t1 - o6;
+    out[2 * step] = t2 + o5;
+    out[5 * step] = t2 - o5;
+    out[4 * step] = t3 + o4;
+    out[3 * step] = t3 - o4;
+}
+
+// 8x8 inverse DCT of dequantised coefficients (natural order), level shifted into out
+void inverseDCT(const float *coefficients, unsigned char *out, int stride) {
+    float columns[64], rows[8];
+    for (int x = 0; x < 8; x++) {
+        const float *in = coefficients + x;
+        // Most columns of a typical block are empty past the DC term
+        if (in[8] == 0.0f && in[16] == 0.0f && in[24] == 0.0f && in[32] == 0.0f && in[40] == 0.0f && in[48] == 0.0f &&
+            in[56] == 0.0f) {
+            for (int y = 0; y < 8; y++)
+                columns[y * 8 + x] = in[0];
+            continue;
+        }
+        idct8(in, columns + x, 8);
+    }
+    for (int y = 0; y < 8; y++) {
+        idct8(columns + y * 8, rows, 1);
+        for (int x = 0; x < 8; x++)
+            out[y * stride + x] = (unsigned char) std::min(std::max(rows[x] + 128.5f, 0.0f), 255.0f);
+    }
+}
+
+class JPEGDecoder {
+public:
+    bool decode(const unsigned char *data, size_t size, Image &image);
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    float dequant[4][64] = {}; // zigzag order, with the IDCT's scale factors folded in
+    JPEGHuffman dc[4], ac[4];
+    std::vector<JPEGComponent> components;
+    int width = 0, height = 0, maxH = 1, maxV = 1, mcusX = 0, mcusY = 0;
+    int restartInterval = 0;
+    bool adobeRGB = false; // Adobe APP14 transform 0: the three components are RGB, not YCbCr
+
+    bool frame(const unsigned char *segment, size_t length);
+    bool huffmanTables(const unsigned char *segment, size_t length);
+    bool quantTables(const unsigned char *segment, size_t length);
+    bool scan(const unsigned char *segment, size_t length, size_t &position);
+    bool block(JPEGBits &bits, JPEGComponent &component, int blockX, int blockY);
+    void output(Image &image) const;
+};
+
+bool JPEGDecoder::frame(const unsigned char *segment, size_t length) {
+    if (length < 6 || segment[0] != 8) {
+        std::cerr << "ERROR::IMAGEDECODER::JPEG_UNSUPPORTED_PRECISION" << std::endl;
+        return false;
+    }
+    height = segment[1] << 8 | segment[2];
+    width = segment[3] << 8 | segment[4];
+    const int count = segment[5];
+    if (width == 0 || height == 0 || width > IMAGE_MAX_SIDE || height > IMAGE_MAX_SIDE || (count != 1 && count != 3) ||
+        length < 6 + (size_t) count * 3) {
+        std::cerr << "ERROR::IMAGEDECODER::JPEG_UNSUPPORTED_FRAME " << width << "x" << height << ", " << count
+                  << " components" << std::endl;
+        return false;
+    }
+    components.resize((size_t) count);
+    for (int c = 0; c < count; c++) {
+        const unsigned char *p = segment + 6 + c * 3;
+        components[c] = JPEGComponent();
+        components[c].id = p[0];
+        components[c].h = p[1] >> 4;
+        components[c].v = p[1] & 15;
+        components[c].quantTable = p[2] & 3;
+        if (components[c].h < 1 || components[c].h > 4 || components[c].v < 1 || components[c].v > 4) {
+            std::cerr << "ERROR::IMAGEDECODER::JPEG_BAD_SAMPLING" << std::endl;
+            return false;
+        }
+        maxH = std::max(maxH, components[c].h);
+        maxV = std::max(maxV, components[c].v);
+    }
+    // A single component is coded as 8x8 blocks whatever its sampling factors say
+    if (count == 1)
+        components[0].h = components[0].v = maxH = maxV = 1;
+    mcusX = (width + maxH * 8 - 1) / (maxH * 8);
+    mcusY = (height + maxV * 8 - 1) / (maxV * 8);
+    for (JPEGComponent &component : components) {
+        component.planeWidth = mcusX * component.h * 8;
+        component.planeHeight = mcusY * component.v * 8;
+        component.plane.assign((size_t) component.planeWidth * component.planeHeight, 0);
+    }
+    return true;
+}
+
+bool JPEGDecoder::huffmanTables(const unsigned char *segment, size_t length) {
+    for (size_t at = 0; at < length;) {
+        if (at + 17 > length)
+            return false;
+        const int tableClass = segment[at] >> 4, id = segment[at] & 15;
+        const uint8_t *counts = segment + at + 1;
+        int total = 0;
+        for (int l = 0; l < 16; l++)
+            total += counts[l];
+        if (tableClass > 1 || id > 3 || total > 256 || at + 17 + total > length)
+            return false;
+        if (!(tableClass ? ac : dc)[id].build(counts, segment + at + 17, total))
+            return false;
+        at += 17 + (size_t) total;
+    }
+    return true;
+}
+
+bool JPEGDecoder::quantTables(const unsigned char *segment, size_t length) {
+    for (size_t at = 0; at < length;) {
+        const int precision = segment[at] >> 4, id = segment[at] & 15;
+        if (id > 3 || precision > 1 || at + 1 + 64 * (precision + 1) > length)
+            return false;
+        for (int k = 0; k < 64; k++) {
+            const int value = precision ? segment[at + 1 + k * 2] << 8 | segment[at + 2 + k * 2] : segment[at + 1 + k];
+            dequant[id][k] = (float) value * aanScale[zigzag[k] / 8] * aanScale[zigzag[k] % 8] / 8.0f;
+        }
+        at += 1 + 64 * (size_t) (precision + 1);
+    }
+    return true;
+}
+
+bool JPEGDecoder::block(JPEGBits &bits, JPEGComponent &component, int blockX, int blockY) {
+    const JPEGHuffman &dcTable = dc[component.dcTable], &acTable = ac[component.acTable];
+    const float *q = dequant[component.quantTable];
+    float coefficients[64] = {};
+    const int s = dcTable.decode(bits);
+    if (s < 0 || s > 11)
+        return false;
+    component.prediction += extend(bits.get(s), s);
+    coefficients[0] = (float) component.prediction * q[0];
+    for (int k = 1; k < 64;) {
+        const int rs = acTable.decode(bits);
+        if (rs < 0)
+            return false;
+        const int run = rs >> 4, bitsInValue = rs & 15;
+        if (bitsInValue == 0) {
+            if (run != 15)
+                break; // end of block
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63)
+            return false;
+        coefficients[zigzag[k]] = (float) extend(bits.get(bitsInValue), bitsInValue) * q[k];
+        k++;
+    }
+    inverseDCT(coefficients, &component.plane[(size_t) blockY * 8 * component.planeWidth + blockX * 8],
+               component.planeWidth);
+    return true;
+}
+
+bool JPEGDecoder::scan(const unsigned char *segment, size_t length, size_t &position) {
+    const int count = length > 0 ? segment[0] : 0;
+    if (count < 1 || count > 4 || length < 4 + (size_t) count * 2 || components.empty()) {
+        std::cerr << "ERROR::IMAGEDECODER::JPEG_BAD_SCAN" << std::endl;
+        return false;
+    }
+    std::vector<JPEGComponent *> members;
+    for (int i = 0; i < count; i++) {
+        const unsigned char *p = segment + 1 + i * 2;
+        auto found = std::find_if(components.begin(), components.end(),
+                                  [&](const JPEGComponent &c) { return c.id == p[0]; });
+        if (found == components.end() || !dc[p[1] >> 4 & 3].defined || !ac[p[1] & 3].defined) {
+            std::cerr << "ERROR::IMAGEDECODER::JPEG_BAD_SCAN" << std::endl;
+            return false;
+        }
+        found->dcTable = p[1] >> 4 & 3;
+        found->acTable = p[1] & 3;
+        found->prediction = 0;
+        members.push_back(&*found);
+    }
+
+    JPEGBits bits = { data, size, position };
+    // Interleaved scans go MCU by MCU, each with h x v blocks of every component. A scan of one component
+    // covers just that component's blocks in raster order.
+    const bool interleaved = count > 1;
+    const int unitsX = interleaved ? mcusX : ((width * members[0]->h + maxH - 1) / maxH + 7) / 8;
+    const int unitsY = interleaved ? mcusY : ((height * members[0]->v + maxV - 1) / maxV + 7) / 8;
+    int untilRestart = restartInterval;
+    for (int y = 0; y < unitsY; y++) {
+        for (int x = 0; x < unitsX; x++) {
+            if (restartInterval && untilRestart-- == 0) {
+                if (!bits.restart()) {
+                    std::cerr << "ERROR::IMAGEDECODER::JPEG_MISSING_RESTART" << std::endl;
+                    return false;
+                }
+                for (JPEGComponent *component : members)
+                    component->prediction = 0;
+                untilRestart = restartInterval - 1;
+            }
+            bool ok = true;
+            if (interleaved) {
+                for (JPEGComponent *component : members)
+                    for (int by = 0; by < component->v && ok; by++)
+                        for (int bx = 0; bx < component->h && ok; bx++)
+                            ok = block(bits, *component, x * component->h + bx, y * component->v + by);
+            } else {
+                ok = block(bits, *members[0], x, y);
+            }
+            if (!ok) {
+                std::cerr << "ERROR::IMAGEDECODER::JPEG_CORRUPT_DATA" << std::endl;
+                return false;
+            }
+        }
+    }
+    position = bits.position;
+    return true;
+}
+
+void JPEGDecoder::output(Image &image) const {
+    image.width = width;
+    image.height = height;
+    image.pixels.resize((size_t) width * height * 4);
+    // Columns each output x reads in every plane, so the inner loop is just loads
+    std::vector<int> columns((size_t) width * components.size());
+    for (size_t c = 0; c < components.size(); c++)
+        for (int x = 0; x < width; x++)
+            columns[c * width + x] = x * components[c].h / maxH;
+    for (int y = 0; y < height; y++) {
+        unsigned char *out = &image.pixels[(size_t) y * width * 4];
+        if (components.size() == 1) {
+            const unsigned char *grey = &components[0].plane[(size_t) y * components[0].planeWidth];
+            for (int x = 0; x < width; x++, out += 4) {
+                out[0] = out[1] = out[2] = grey[x];
+                out[3] = 255;
+            }
+            continue;
+        }
+        const unsigned char *rows[3];
+        for (int c = 0; c < 3; c++)
+            rows[c] = &components[c].plane[(size_t) (y * components[c].v / maxV) * components[c].planeWidth];
+        for (int x = 0; x < width; x++, out += 4) {
+            const int a = rows[0][columns[x]], b = rows[1][columns[width + x]], c = rows[2][columns[2 * width + x]];
+            if (adobeRGB) {
+                out[0] = (unsigned char) a;
+                out[1] = (unsigned char) b;
+                out[2] = (unsigned char) c;
+            } else {
+                // JFIF YCbCr, 16.16 fixed point
+                const int cb = b - 128, cr = c - 128;
+                const int r = a + ((91881 * cr + 32768) >> 16);
+                const int g = a - ((22554 * cb + 46802 * cr - 32768) >> 16);
+                const int bl = a + ((116130 * cb + 32768) >> 16);
+                out[0] = (unsigned char) std::min(std::max(r, 0), 255);
+                out[1] = (unsigned char) std::min(std::max(g, 0), 255);
+                out[2] = (unsigned char) std::min(std::max(bl, 0), 255);
+            }
+            out[3] = 255;
+        }
+    }
+}
+
+bool JPEGDecoder::decode(const unsigned char *bytes, size_t length, Image &image) {
+    data = bytes;
+    size = length;
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        std::cerr << "ERROR::IMAGEDECODER::NOT_A_JPEG" << std::endl;
+        return false;
+    }
+    bool haveScan = false;
+    for (size_t at = 2;;) {
+        // Markers can be padded with any number of 0xFF
+        while (at < size && data[at] != 0xFF)
+            at++;
+        while (at < size && data[at] == 0xFF)
+            at++;
+        if (at >= size) {
+            std::cerr << "ERROR::IMAGEDECODER::JPEG_TRUNCATED" << std::endl;
+            return false;
+        }
+        const unsigned char marker = data[at++];
+        if (marker == 0xD9) // EOI
+            break;
+        // No length: stuffed 0xFF00 in scan data we skipped, TEM, RSTn
+        if (marker == 0x00 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+            continue;
+        if (at + 2 > size) {
+            std::cerr << "ERROR::IMAGEDECODER::JPEG_TRUNCATED" << std::endl;
+            return false;
+        }
+        const size_t segmentLength = (size_t) (data[at] << 8 | data[at + 1]);
+        if (segmentLength < 2 || at + segmentLength > size) {
+            std::cerr << "ERROR::IMAGEDECODER::JPEG_TRUNCATED" << std::endl;
+            return false;
+        }
+        const unsigned char *segment = data + at + 2;
+        const size_t bodyLength = segmentLength - 2;
+        at += segmentLength;
+        bool ok = true;
+        switch (marker) {
+        case 0xC0: // baseline
+        case 0xC1: // extended sequential, Huffman
+            ok = frame(segment, bodyLength);
+            break;
+        case 0xC4:
+            ok = huffmanTables(segment, bodyLength);
+            break;
+        case 0xDB:
+            ok = quantTables(segment, bodyLength);
+            break;
+        case 0xDD:
+            ok = bodyLength >= 2;
+            if (ok)
+                restartInterval = segment[0] << 8 | segment[1];
+            break;
+        case 0xDA:
+            ok = scan(segment, bodyLength, at);
+            haveScan = haveScan || ok;
+            break;
+        case 0xEE: // Adobe
+            if (bodyLength >= 12 && std::memcmp(segment, "Adobe", 5) == 0)
+                adobeRGB = segment[11] == 0;
+            break;
+        default:
+            if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC8) {
+                std::cerr << "ERROR::IMAGEDECODER::JPEG_UNSUPPORTED_CODING (progressive, lossless or arithmetic)"
+                          << std::endl;
+                return false;
+            }
+            break; // APPn, COM, etc.
+        }
+        if (!ok) {
+            if (marker == 0xC4 || marker == 0xDB || marker == 0xDD)
+                std::cerr << "ERROR::IMAGEDECODER::JPEG_BAD_TABLE" << std::endl;
+            return false;
+        }
+    }
+    if (!haveScan) {
+        std::cerr << "ERROR::IMAGEDECODER::JPEG_NO_IMAGE" << std::endl;
+        return false;
+    }
+    output(image);
+    return true;
+}
+
+} // namespace
+
+bool decodeJPEG(const unsigned char *data, size_t size, Image &image) {
+    JPEGDecoder decoder;
+    return decoder.decode(data, size, image);
+}
@@ -0,0 +1,204 @@
+#include "JobSystem.h"
+
+namespace {
+
+// Which system and worker the calling thread is
+thread_local const JobSystem *currentSystem = nullptr;
+thread_local size_t currentIndex = 0;
+
+// Tries before an idle worker goes to sleep
+const int JOB_IDLE_SPINS = 64;
+
+} // namespace
+
+JobSystem::JobSystem(int threadCount) : statsSince(std::chrono::steady_clock::now()) {
+    if (threadCount <= 0)
+        threadCount = parallelThreadCount();
+    for (int t = 0; t < threadCount; t++) {
+        workers.emplace_back(new Worker());
+        workers.back()->pool.reset(new Job[JOB_POOL_SIZE]);
+        workers.back()->random = 0x9E3779B9u * (uint32_t) (t + 1);
+    }
+    currentSystem = this;
+    currentIndex = 0;
+    parallelBackend() = this;
+    for (int t = 1; t < threadCount; t++)
+        threads.emplace_back([this, t]() { workerLoop((size_t) t); });
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping.store(true);
+    }
+    wake.notify_all();
+    for (std::thread &thread : threads)
+        thread.join();
+    if (currentSystem == this) {
+        currentSystem = nullptr;
+        parallelBackend() = nullptr;
+    }
+}
+
+JobSystem::Worker *JobSystem::current() const {
+    return currentSystem == this ? workers[currentIndex].get() : nullptr;
+}
+
+Job *JobSystem::allocate(Worker &worker) {
+    // Thousands of jobs later the next slot is nearly always done. When it isn't, it can belong to a job
+    // suspended further up this very stack (in a wait()), so waiting for it could spin forever: move on
+    for (size_t tries = 0; tries < JOB_POOL_SIZE; tries++) {
+        Job *job = &worker.pool[worker.allocated++ & (JOB_POOL_SIZE - 1)];
+        if (!job->done.load(std::memory_order_acquire))
+            continue;
+        job->done.store(false, std::memory_order_relaxed);
+        job->next = nullptr;
+        return job;
+    }
+    return nullptr; // every slot's in flight
+}
+
+void JobSystem::push(Worker &worker, Job *job) {
+    if (!worker.queue.push(job)) {
+        execute(worker, job, false);
+        return;
+    }
+    // Pairs with the sleeper bumping `sleeping` before it looks at `queued`: one of us sees the other
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst) > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wake.notify_one();
+    }
+}
+
+void JobSystem::schedule(Worker &worker, Job *job, JobCounter *after) {
+    if (after) {
+        after->acquire();
+        if (after->count.load(std::memory_order_acquire) > 0) {
+            job->next = after->waiting;
+            after->waiting = job;
+            after->releaseLock();
+            return;
+        }
+        after->releaseLock();
+    }
+    push(worker, job);
+}
+
+void JobSystem::execute(Worker &worker, Job *job, bool stolen) {
+    // Only the outermost job is timed, or whatever runs inside another's wait() would count twice
+    const bool outermost = worker.depth++ == 0;
+    const auto start = outermost ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    JobCounter *counter = job->counter;
+    job->run(*job);
+    job->done.store(true, std::memory_order_release);
+    worker.jobs.fetch_add(1, std::memory_order_relaxed);
+    if (stolen)
+        worker.steals.fetch_add(1, std::memory_order_relaxed);
+    if (outermost)
+        worker.busyNanoseconds.fetch_add((uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+    worker.depth--;
+    if (counter)
+        finish(worker, counter);
+}
+
+void JobSystem::finish(Worker &worker, JobCounter *counter) {
+    // Under the lock, so nothing can be added to `waiting` after we've taken it, and wait() (which takes the
+    // lock on its way out) can't let the counter go while we still have hold of it
+    Job *ready = nullptr;
+    counter->acquire();
+    if (counter->count.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        ready = counter->waiting;
+        counter->waiting = nullptr;
+    }
+    counter->releaseLock();
+    while (ready) {
+        Job *next = ready->next;
+        push(worker, ready);
+        ready = next;
+    }
+}
+
+void JobSystem::wait(JobCounter &counter) {
+    Worker *worker = current();
+    while (counter.count.load(std::memory_order_acquire) > 0)
+        if (!worker || !runOne(*worker))
+            std::this_thread::yield();
+    counter.acquire();
+    counter.releaseLock();
+}
+
+bool JobSystem::runOne(Worker &worker) {
+    Job *job = worker.queue.pop();
+    bool stolen = false;
+    if (!job && workers.size() > 1) {
+        // Start somewhere different each time so thieves don't all queue up on the same victim
+        worker.random ^= worker.random << 13;
+        worker.random ^= worker.random >> 17;
+        worker.random ^= worker.random << 5;
+        const size_t first = worker.random % workers.size();
+        for (size_t i = 0; i < workers.size() && !job; i++) {
+            Worker &victim = *workers[(first + i) % workers.size()];
+            if (&victim != &worker)
+                job = victim.queue.steal();
+        }
+        stolen = job != nullptr;
+    }
+    if (!job)
+        return false;
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    execute(worker, job, stolen);
+    return true;
+}
+
+void JobSystem::workerLoop(size_t index) {
+    currentSystem = this;
+    currentIndex = index;
+    parallelBackend() = this;
+    Worker &worker = *workers[index];
+    int idle = 0;
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (runOne(worker)) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < JOB_IDLE_SPINS) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        wake.wait(lock, [this]() { return stopping.load() || queued.load(std::memory_order_seq_cst) > 0; });
+        sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        idle = 0;
+    }
+}
+
+void JobSystem::runBlocks(size_t blockCount, void (*run)(void *context, size_t block), void *context) {
+    parallelFor(blockCount, 1, [run, context](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; block++)
+            run(context, block);
+    });
+}
+
+std::vector<JobWorkerStats> JobSystem::stats() const {
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - statsSince).count();
+    std::vector<JobWorkerStats> result(workers.size());
+    for (size_t w = 0; w < workers.size(); w++) {
+        result[w].jobs = (size_t) workers[w]->jobs.load(std::memory_order_relaxed);
+        result[w].steals = (size_t) workers[w]->steals.load(std::memory_order_relaxed);
+        result[w].busySeconds = (double) workers[w]->busyNanoseconds.load(std::memory_order_relaxed) * 1e-9;
+        result[w].utilisation = elapsed > 0.0 ? result[w].busySeconds / elapsed : 0.0;
+    }
+    return result;
+}
+
+void JobSystem::resetStats() {
+    for (const std::unique_ptr<Worker> &worker : workers) {
+        worker->jobs.store(0, std::memory_order_relaxed);
+        worker->steals.store(0, std::memory_order_relaxed);
+        worker->busyNanoseconds.store(0, std::memory_order_relaxed);
+    }
+    statsSince = std::chrono::steady_clock::now();
+}
@@ -0,0 +1,242 @@
+#ifndef OPENGLPLAYGROUND_JOBSYSTEM_H
+#define OPENGLPLAYGROUND_JOBSYSTEM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Parallel.h"
+
+// Work stealing jobs for the frame: culling, transforms, anything cut into pieces that have to be done
+// before the frame goes on.
+// - Every worker (the thread that made the system is worker 0, plus a thread per other core) has a
+//   Chase-Lev deque: it pushes and pops its own jobs at the bottom, newest first while they're warm in
+//   cache, and idle workers steal the oldest (usually the biggest pieces) from the top of someone else's.
+// - Jobs come out of a ring per worker and carry their callable inline, so running one allocates nothing.
+//   A slot is only reused once the job that had it is done: busy ones are skipped, and with none free
+//   the job runs there and then.
+// - JobCounters count jobs in flight: wait() runs jobs until a counter is down to zero rather than block,
+//   and a job can be held back until a counter is down to zero, which is how dependencies are expressed.
+// While a system exists, parallelBlocks/parallelFor on its threads run as its jobs, so everything already
+// written against Parallel.h stops starting threads of its own on every call.
+// One system at a time; jobs have to be started from its workers (from anywhere else they run inline).
+
+#define JOB_QUEUE_SIZE 4096 // per worker, a power of two. Pushing onto a full deque runs the job there and then.
+#define JOB_POOL_SIZE 4096  // jobs per worker
+#define JOB_DATA_BYTES 96   // biggest callable a job carries
+
+class JobSystem;
+struct Job;
+
+class JobCounter {
+public:
+    JobCounter() = default;
+    JobCounter(const JobCounter &) = delete;
+    JobCounter &operator=(const JobCounter &) = delete;
+
+    bool done() const { return count.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobSystem;
+    std::atomic<int> count{ 0 };
+    std::atomic_flag lock = ATOMIC_FLAG_INIT; // guards `waiting` and the step down to zero
+    Job *waiting = nullptr;                   // held back until count is zero
+
+    void acquire() {
+        while (lock.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    void releaseLock() { lock.clear(std::memory_order_release); }
+};
+
+struct Job {
+    void (*run)(Job &job) = nullptr; // calls and destroys the callable in data
+    JobCounter *counter = nullptr;   // counted down when the job is done
+    Job *next = nullptr;             // in a counter's waiting list
+    std::atomic<bool> done{ true };  // the slot can be reused
+    alignas(16) unsigned char data[JOB_DATA_BYTES];
+};
+
+struct JobWorkerStats {
+    size_t jobs = 0;          // run by this worker
+    size_t steals = 0;        // of those, taken from another worker
+    double busySeconds = 0.0; // running jobs (not counting ones run while waiting inside another)
+    double utilisation = 0.0; // busySeconds over the time since resetStats()
+};
+
+// Chase-Lev work stealing deque of fixed size (Lê et al., "Correct and Efficient Work-Stealing for Weak
+// Memory Models"), with sequentially consistent operations where the paper has fences
+class JobDeque {
+public:
+    // Owner only. False if it's full.
+    bool push(Job *job) {
+        const int64_t b = bottom.load(std::memory_order_relaxed);
+        const int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= JOB_QUEUE_SIZE)
+            return false;
+        buffer[b & (JOB_QUEUE_SIZE - 1)].store(job, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_release);
+        return true;
+    }
+    // Owner only, newest first
+    Job *pop() {
+        const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Job *job = buffer[b & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // The last one: a thief may be after it too
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                job = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return job;
+    }
+    // Anyone, oldest first. Null if it's empty or another thief got there first.
+    Job *steal() {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        const int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b)
+            return nullptr;
+        Job *job = buffer[t & (JOB_QUEUE_SIZE - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return job;
+    }
+
+private:
+    // Padded apart, so thieves hammering top don't keep taking the owner's bottom away from it (padding
+    // rather than alignas, which plain new doesn't honour before C++17)
+    std::atomic<int64_t> top{ 0 };
+    char topPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<int64_t> bottom{ 0 };
+    char bottomPadding[64 - sizeof(std::atomic<int64_t>)];
+    std::atomic<Job *> buffer[JOB_QUEUE_SIZE] = {};
+};
+
+class JobSystem : public ParallelBackend {
+public:
+    // 0 threads = one per core, the calling thread included. It becomes worker 0, and has to be the one
+    // to destroy the system too.
+    explicit JobSystem(int threadCount = 0);
+    // Jobs that haven't run by now are dropped: wait for what you start
+    ~JobSystem() override;
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Queues work() on the calling worker, counted on counter (if any). With `after`, it's held back until
+    // that counter is down to zero.
+    template<typename F>
+    void run(F &&work, JobCounter *counter = nullptr, JobCounter *after = nullptr);
+    // Runs jobs until counter is down to zero
+    void wait(JobCounter &counter);
+
+    // work(begin, end) over [0, count), split in halves down to grain sized ranges that idle workers steal
+    template<typename F>
+    void parallelFor(size_t count, size_t grain, const F &work);
+
+    int threadCount() const override { return (int) workers.size(); }
+    // Per worker, since the last resetStats() (from worker 0, like the construction)
+    std::vector<JobWorkerStats> stats() const;
+    void resetStats();
+
+    // What parallelBlocks goes through on our threads
+    void runBlocks(size_t blockCount, void (*run)(void *context, size_t block), void *context) override;
+
+private:
+    struct Worker {
+        JobDeque queue;
+        std::unique_ptr<Job[]> pool;
+        size_t allocated = 0;
+        int depth = 0;            // jobs running on this worker, nested through wait()
+        uint32_t random = 1;      // for picking who to steal from
+        std::atomic<uint64_t> jobs{ 0 }, steals{ 0 }, busyNanoseconds{ 0 };
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<int> queued{ 0 };   // jobs in deques
+    std::atomic<int> sleeping{ 0 };
+    std::atomic<bool> stopping{ false };
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::chrono::steady_clock::time_point statsSince;
+
+    // The calling thread's worker, null if it isn't one of ours
+    Worker *current() const;
+    // A free job slot of the worker's, null if all of them are in flight
+    Job *allocate(Worker &worker);
+    // Onto the calling worker's deque (run on the spot if it's full)
+    void push(Worker &worker, Job *job);
+    void schedule(Worker &worker, Job *job, JobCounter *after);
+    void execute(Worker &worker, Job *job, bool stolen);
+    void finish(Worker &worker, JobCounter *counter);
+    // Runs one job, its own or stolen. False if there were none.
+    bool runOne(Worker &worker);
+    void workerLoop(size_t index);
+};
+
+template<typename F>
+void JobSystem::run(F &&work, JobCounter *counter, JobCounter *after) {
+    typedef typename std::decay<F>::type Callable;
+    static_assert(sizeof(Callable) <= JOB_DATA_BYTES, "job callable is too big");
+    static_assert(alignof(Callable) <= 16, "job callable is over aligned");
+    Worker *worker = current();
+    Job *job = worker ? allocate(*worker) : nullptr;
+    if (!job) {
+        // Not one of our threads (no deque to put it on), or every one of its jobs is in flight
+        if (after)
+            wait(*after);
+        work();
+        return;
+    }
+    new (job->data) Callable(std::forward<F>(work));
+    job->run = [](Job &self) {
+        Callable &callable = *reinterpret_cast<Callable *>(self.data);
+        callable();
+        callable.~Callable();
+    };
+    job->counter = counter;
+    if (counter)
+        counter->count.fetch_add(1, std::memory_order_relaxed);
+    schedule(*worker, job, after);
+}
+
+template<typename F>
+void JobSystem::parallelFor(size_t count, size_t grain, const F &work) {
+    if (count == 0)
+        return;
+    struct Range {
+        JobSystem *system;
+        const F *work;
+        JobCounter *counter;
+        size_t begin, end, grain;
+        void operator()() const {
+            size_t last = end;
+            // Hand the far half to whoever steals it, keep splitting the near one
+            while (last - begin > grain) {
+                const size_t middle = begin + (last - begin) / 2;
+                system->run(Range{ system, work, counter, middle, last, grain }, counter);
+                last = middle;
+            }
+            (*work)(begin, last);
+        }
+    };
+    JobCounter counter;
+    Range{ this, &work, &counter, 0, count, std::max<size_t>(grain, 1) }();
+    wait(counter);
+}
+
+#endif //OPENGLPLAYGROUND_JOBSYSTEM_H
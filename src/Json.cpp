@@ -0,0 +1,239 @@
+#include "Json.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const JsonValue nullValue;
+static const std::string emptyString;
+
+const JsonValue &JsonValue::operator[](const char *key) const {
+    if (type == Object)
+        for (const auto &member : members)
+            if (member.first == key)
+                return member.second;
+    return nullValue;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const {
+    return type == Array && index < elements.size() ? elements[index] : nullValue;
+}
+
+const std::string &JsonValue::asString() const {
+    return type == String ? string : emptyString;
+}
+
+namespace {
+
+// Recursive descent over [p, end), `depth` guards against stack overflows on hostile files
+struct JsonParser {
+    const char *begin, *p, *end;
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+            p++;
+    }
+
+    bool fail(const char *what) {
+        std::cerr << "ERROR::JSON::" << what << " at byte " << (p - begin) << std::endl;
+        return false;
+    }
+
+    bool literal(const char *word) {
+        const size_t length = std::strlen(word);
+        if ((size_t) (end - p) < length || std::strncmp(p, word, length) != 0)
+            return fail("UNEXPECTED_TOKEN");
+        p += length;
+        return true;
+    }
+
+    static void appendUTF8(std::string &out, unsigned codepoint) {
+        if (codepoint < 0x80) {
+            out += (char) codepoint;
+        } else if (codepoint < 0x800) {
+            out += (char) (0xC0 | (codepoint >> 6));
+            out += (char) (0x80 | (codepoint & 0x3F));
+        } else if (codepoint < 0x10000) {
+            out += (char) (0xE0 | (codepoint >> 12));
+            out += (char) (0x80 | ((codepoint >> 6) & 0x3F));
+            out += (char) (0x80 | (codepoint & 0x3F));
+        } else {
+            out += (char) (0xF0 | (codepoint >> 18));
+            out += (char) (0x80 | ((codepoint >> 12) & 0x3F));
+            out += (char) (0x80 | ((codepoint >> 6) & 0x3F));
+            out += (char) (0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    bool hex4(unsigned &value) {
+        if (end - p < 4)
+            return fail("BAD_ESCAPE");
+        value = 0;
+        for (int i = 0; i < 4; i++, p++) {
+            const char c = *p;
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= (unsigned) (c - '0');
+            else if (c >= 'a' && c <= 'f') value |= (unsigned) (c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') value |= (unsigned) (c - 'A' + 10);
+            else return fail("BAD_ESCAPE");
+        }
+        return true;
+    }
+
+    bool parseString(std::string &out) {
+        p++; // opening quote
+        out.clear();
+        while (p < end && *p != '"') {
+            if (*p != '\\') {
+                out += *p++;
+                continue;
+            }
+            if (++p >= end)
+                break;
+            const char escape = *p++;
+            switch (escape) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned codepoint;
+                    if (!hex4(codepoint))
+                        return false;
+                    // Surrogate pair
+                    if (codepoint >= 0xD800 && codepoint < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+                        p += 2;
+                        unsigned low;
+                        if (!hex4(low))
+                            return false;
+                        codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUTF8(out, codepoint);
+                    break;
+                }
+                default:
+                    return fail("BAD_ESCAPE");
+            }
+        }
+        if (p >= end)
+            return fail("UNTERMINATED_STRING");
+        p++; // closing quote
+        return true;
+    }
+
+    bool parseValue(JsonValue &out, int depth) {
+        if (depth > 128)
+            return fail("TOO_DEEP");
+        skipSpace();
+        if (p >= end)
+            return fail("UNEXPECTED_END");
+        switch (*p) {
+            case 'n':
+                out.type = JsonValue::Null;
+                return literal("null");
+            case 't':
+                out.type = JsonValue::Bool;
+                out.boolean = true;
+                return literal("true");
+            case 'f':
+                out.type = JsonValue::Bool;
+                out.boolean = false;
+                return literal("false");
+            case '"':
+                out.type = JsonValue::String;
+                return parseString(out.string);
+            case '[': {
+                out.type = JsonValue::Array;
+                p++;
+                skipSpace();
+                if (p < end && *p == ']') {
+                    p++;
+                    return true;
+                }
+                for (;;) {
+                    out.elements.emplace_back();
+                    if (!parseValue(out.elements.back(), depth + 1))
+                        return false;
+                    skipSpace();
+                    if (p < end && *p == ',') {
+                        p++;
+                    } else if (p < end && *p == ']') {
+                        p++;
+                        return true;
+                    } else {
+                        return fail("EXPECTED_COMMA_OR_BRACKET");
+                    }
+                }
+            }
+            case '{': {
+                out.type = JsonValue::Object;
+                p++;
+                skipSpace();
+                if (p < end && *p == '}') {
+                    p++;
+                    return true;
+                }
+                for (;;) {
+                    skipSpace();
+                    if (p >= end || *p != '"')
+                        return fail("EXPECTED_KEY");
+                    out.members.emplace_back();
+                    if (!parseString(out.members.back().first))
+                        return false;
+                    skipSpace();
+                    if (p >= end || *p != ':')
+                        return fail("EXPECTED_COLON");
+                    p++;
+                    if (!parseValue(out.members.back().second, depth + 1))
+                        return false;
+                    skipSpace();
+                    if (p < end && *p == ',') {
+                        p++;
+                    } else if (p < end && *p == '}') {
+                        p++;
+                        return true;
+                    } else {
+                        return fail("EXPECTED_COMMA_OR_BRACE");
+                    }
+                }
+            }
+            default: {
+                // strtod needs a terminated string, numbers are short so copy them out
+                char buffer[64];
+                size_t length = 0;
+                while (p + length < end && length < sizeof(buffer) - 1 && std::strchr("+-0123456789.eE", p[length]))
+                    length++;
+                if (length == 0)
+                    return fail("UNEXPECTED_TOKEN");
+                std::memcpy(buffer, p, length);
+                buffer[length] = 0;
+                char *parsedEnd;
+                out.type = JsonValue::Number;
+                out.number = std::strtod(buffer, &parsedEnd);
+                if (parsedEnd != buffer + length)
+                    return fail("BAD_NUMBER");
+                p += length;
+                return true;
+            }
+        }
+    }
+};
+
+} // namespace
+
+bool parseJson(const char *text, size_t length, JsonValue &out) {
+    JsonParser parser{ text, text, text + length };
+    out = JsonValue();
+    if (!parser.parseValue(out, 0))
+        return false;
+    parser.skipSpace();
+    // GLB pads the JSON chunk with spaces, and some exporters with zeros
+    while (parser.p < parser.end && *parser.p == 0)
+        parser.p++;
+    if (parser.p != parser.end)
+        return parser.fail("TRAILING_CHARACTERS");
+    return true;
+}
@@ -0,0 +1,39 @@
+#ifndef OPENGLPLAYGROUND_JSON_H
+#define OPENGLPLAYGROUND_JSON_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for asset headers (glTF): parses into a small DOM, and lookups of missing
+// members/elements return a shared null value so chains like json["a"][0]["b"] never need checks.
+class JsonValue {
+public:
+    enum Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Null;
+    bool boolean = false;
+    double number = 0.0;
+    std::string string;
+    std::vector<JsonValue> elements;                         // Array
+    std::vector<std::pair<std::string, JsonValue>> members;  // Object, in file order
+
+    bool isNull() const { return type == Null; }
+    bool has(const char *key) const { return !(*this)[key].isNull(); }
+    size_t size() const { return type == Array ? elements.size() : type == Object ? members.size() : 0; }
+
+    const JsonValue &operator[](const char *key) const;
+    const JsonValue &operator[](size_t index) const;
+    const JsonValue &operator[](int index) const { return (*this)[(size_t) index]; } // so [0] isn't ambiguous
+
+    double asNumber(double fallback = 0.0) const { return type == Number ? number : fallback; }
+    long long asInt(long long fallback = 0) const { return type == Number ? (long long) number : fallback; }
+    bool asBool(bool fallback = false) const { return type == Bool ? boolean : fallback; }
+    const std::string &asString() const;
+};
+
+// Returns false (after printing where it went wrong) if text isn't valid JSON
+bool parseJson(const char *text, size_t length, JsonValue &out);
+
+#endif //OPENGLPLAYGROUND_JSON_H
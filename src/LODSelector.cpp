@@ -0,0 +1,71 @@
+#include "LODSelector.h"
+#include <algorithm>
+#include <chrono>
+#include "SWSimd.h"
+
+void LODInstances::resize(size_t n) {
+    count = n;
+    const size_t padded = (n + SW_LANES - 1) / SW_LANES * SW_LANES;
+    x.resize(padded, 0.0f);
+    y.resize(padded, 0.0f);
+    z.resize(padded, 0.0f);
+    scale.resize(padded, 0.0f);
+    lod.resize(padded, 0);
+}
+
+void LODSelector::select(const MeshLOD *lods, size_t lodCount, float radius, LODInstances &instances,
+                         const glm::vec3 &eye, float projectionScale) {
+    auto start = std::chrono::steady_clock::now();
+    stats.instances = instances.count;
+    stats.triangles = stats.fullDetailTriangles = stats.switches = 0;
+    stats.perLevel.assign(lodCount, 0);
+    if (lodCount == 0 || instances.count == 0)
+        return;
+    lodCount = std::min<size_t>(lodCount, 255);
+
+    // Level l is fine at distance d when error[l] * scale * projectionScale / d <= pixelError, i.e. when
+    // d >= error[l] * scale * reach: one multiply and compare per level, no division per instance
+    const float reach = projectionScale / std::max(pixelError, 1e-6f);
+    const float coarser = 1.0f - std::min(std::max(hysteresis, 0.0f), 0.99f);
+    std::vector<float> levelReach(lodCount);
+    for (size_t l = 0; l < lodCount; l++)
+        levelReach[l] = lods[l].error * reach;
+
+    const Float8 one = f8Set1(1.0f), tiny = f8Set1(1e-6f), radius8 = f8Set1(radius);
+    const Float8 eyeX = f8Set1(eye.x), eyeY = f8Set1(eye.y), eyeZ = f8Set1(eye.z), coarser8 = f8Set1(coarser);
+    float current[SW_LANES], selected[SW_LANES];
+    for (size_t i = 0; i < instances.count; i += SW_LANES) {
+        const Float8 dx = f8Load(&instances.x[i]) - eyeX;
+        const Float8 dy = f8Load(&instances.y[i]) - eyeY;
+        const Float8 dz = f8Load(&instances.z[i]) - eyeZ;
+        const Float8 scale = f8Load(&instances.scale[i]);
+        // Distance to the bounding sphere, so a big object next to the camera stays detailed
+        const Float8 distance = f8Max(f8Sqrt(dx * dx + dy * dy + dz * dz) - radius8 * scale, tiny);
+        const Float8 shrunk = distance * coarser8;
+
+        // Errors increase with the level, so the coarsest acceptable level is the number of levels past 0
+        // that are acceptable
+        Float8 fine = f8Zero(), coarse = f8Zero();
+        for (size_t l = 1; l < lodCount; l++) {
+            const Float8 needed = f8Set1(levelReach[l]) * scale;
+            fine = fine + f8And(f8LessEqual(needed, distance), one);
+            coarse = coarse + f8And(f8LessEqual(needed, shrunk), one);
+        }
+        for (int k = 0; k < SW_LANES; k++)
+            current[k] = (float) std::min<size_t>(instances.lod[i + k], lodCount - 1);
+        // Too coarse now: go to the level that fits. Coarse enough: only get coarser past the hysteresis band.
+        const Float8 level = f8Load(current);
+        f8Store(selected, f8Select(f8Less(fine, level), fine, f8Select(f8Greater(coarse, level), coarse, level)));
+
+        const int lanes = (int) std::min<size_t>(SW_LANES, instances.count - i);
+        for (int k = 0; k < lanes; k++) {
+            const uint8_t l = (uint8_t) selected[k];
+            stats.switches += l != instances.lod[i + k];
+            instances.lod[i + k] = l;
+            stats.perLevel[l]++;
+            stats.triangles += lods[l].indexCount / 3;
+        }
+    }
+    stats.fullDetailTriangles = (size_t) (lods[0].indexCount / 3) * instances.count;
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,55 @@
+#ifndef OPENGLPLAYGROUND_LODSELECTOR_H
+#define OPENGLPLAYGROUND_LODSELECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+
+// Runtime half of the LOD chain (MeshSimplifier.h): every frame, each instance of a mesh picks the coarsest
+// level whose error projects to less than a pixel budget on screen.
+
+// Instances of one mesh, as separate arrays so 8 of them are selected at a time.
+// Arrays are padded to a multiple of 8, the padding is never read back.
+struct LODInstances {
+    std::vector<float> x, y, z; // world space position of the mesh's origin
+    std::vector<float> scale;   // uniform world scale
+    std::vector<uint8_t> lod;   // level each instance drew last frame, updated by LODSelector::select
+    size_t count = 0;
+
+    void resize(size_t n);
+    void set(size_t i, const glm::vec3 &position, float instanceScale) {
+        x[i] = position.x;
+        y[i] = position.y;
+        z[i] = position.z;
+        scale[i] = instanceScale;
+    }
+};
+
+struct LODSelectStats {
+    size_t instances = 0;
+    size_t triangles = 0;           // drawn with the selected levels
+    size_t fullDetailTriangles = 0; // what level 0 everywhere would have been
+    size_t switches = 0;            // instances that changed level this frame
+    std::vector<size_t> perLevel;
+    double milliseconds = 0.0;
+};
+
+class LODSelector {
+public:
+    float pixelError = 1.0f; // largest error allowed on screen, in pixels
+    // Hysteresis: an instance only moves to a coarser level once that level's error is under
+    // (1 - hysteresis) * pixelError, but goes back to a finer one as soon as it's over pixelError,
+    // so an instance sitting on a threshold doesn't flip between two levels every frame
+    float hysteresis = 0.25f;
+    LODSelectStats stats;
+
+    // lods/lodCount as built by buildLODChain, with errors increasing. radius bounds the mesh around its origin
+    // (object space), distances are to that sphere. projectionScale is pixels per world unit at distance 1,
+    // viewport height / (2 tan(fovy / 2)) for a perspective projection.
+    void select(const MeshLOD *lods, size_t lodCount, float radius, LODInstances &instances, const glm::vec3 &eye,
+                float projectionScale);
+};
+
+#endif //OPENGLPLAYGROUND_LODSELECTOR_H
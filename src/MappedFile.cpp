@@ -0,0 +1,78 @@
+#include "MappedFile.h"
+#include <fstream>
+#include <iostream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define MAPPEDFILE_MMAP 1
+#else
+#define MAPPEDFILE_MMAP 0
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const char *path) {
+    close();
+#if MAPPEDFILE_MMAP
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not read file " << path << ". File does not exist." << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Could not stat file " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    length = (size_t) info.st_size;
+    opened = true;
+    if (length > 0) {
+        void *mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Could not map file " << path << std::endl;
+            ::close(fd);
+            length = 0;
+            opened = false;
+            return false;
+        }
+        // Loaders mostly stream front to back, tell the OS to read ahead aggressively
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const unsigned char *>(mapping);
+    }
+    ::close(fd); // the mapping keeps the file alive
+    return true;
+#else
+    std::ifstream file(path, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        std::cerr << "Could not read file " << path << ". File does not exist." << std::endl;
+        return false;
+    }
+    length = (size_t) file.tellg();
+    file.seekg(0);
+    char *buffer = new char[length ? length : 1];
+    file.read(buffer, (std::streamsize) length);
+    bytes = reinterpret_cast<const unsigned char *>(buffer);
+    fallback = opened = true;
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+    if (bytes) {
+#if MAPPEDFILE_MMAP
+        if (!fallback)
+            munmap(const_cast<unsigned char *>(bytes), length);
+#endif
+        if (fallback)
+            delete[] reinterpret_cast<const char *>(bytes);
+    }
+    bytes = nullptr;
+    length = 0;
+    opened = fallback = false;
+}
@@ -0,0 +1,32 @@
+#ifndef OPENGLPLAYGROUND_MAPPEDFILE_H
+#define OPENGLPLAYGROUND_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Read-only memory mapped file. The OS pages the file in as we touch it, so a multi-gigabyte asset
+// costs no upfront read and no copy into our own buffers.
+// (Where mmap isn't available the whole file is read into memory instead, same interface.)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Prints an error and returns false if the file can't be opened
+    bool open(const char *path);
+    void close();
+
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length; }
+    bool isOpen() const { return bytes != nullptr || opened; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+    bool opened = false;  // an empty file is open but has no mapping
+    bool fallback = false; // bytes came from new[] rather than mmap
+};
+
+#endif //OPENGLPLAYGROUND_MAPPEDFILE_H
@@ -0,0 +1,128 @@
+#ifndef OPENGLPLAYGROUND_MESH_H
+#define OPENGLPLAYGROUND_MESH_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Component types use the GL enum values (which glTF also uses), so they can be handed straight to
+// glVertexAttribPointer without this header needing GL
+enum class ComponentType : uint32_t {
+    Byte = 0x1400,
+    UnsignedByte = 0x1401,
+    Short = 0x1402,
+    UnsignedShort = 0x1403,
+    UnsignedInt = 0x1405,
+    Float = 0x1406
+};
+
+inline size_t componentSize(ComponentType type) {
+    switch (type) {
+        case ComponentType::Byte:
+        case ComponentType::UnsignedByte:
+            return 1;
+        case ComponentType::Short:
+        case ComponentType::UnsignedShort:
+            return 2;
+        default:
+            return 4;
+    }
+}
+
+// One vertex attribute, named after the shader input it feeds
+struct VertexAttribute {
+    std::string name;
+    int components;
+    ComponentType type;
+    bool normalized;
+    size_t offset; // bytes from the start of the vertex (interleaved) or of the buffer (separate streams)
+    size_t stride; // 0 = the layout's stride, i.e. interleaved with the other attributes
+};
+
+// Describes how vertex bytes map to shader inputs, the data behind glVertexAttribPointer.
+// Either one interleaved vertex (stride set, attributes with stride 0) or, as glTF often does,
+// each attribute in its own stream at its own offset and stride.
+struct VertexLayout {
+    size_t stride = 0;
+    std::vector<VertexAttribute> attributes;
+
+    // Appends an attribute after the ones already there
+    void add(const std::string &name, int components, ComponentType type = ComponentType::Float,
+             bool normalized = false) {
+        attributes.push_back({ name, components, type, normalized, stride, 0 });
+        stride += (size_t) components * componentSize(type);
+    }
+    size_t strideOf(const VertexAttribute &attribute) const { return attribute.stride ? attribute.stride : stride; }
+    const VertexAttribute *find(const std::string &name) const {
+        for (const VertexAttribute &attribute : attributes)
+            if (attribute.name == name)
+                return &attribute;
+        return nullptr;
+    }
+};
+
+// A range of the index buffer drawn with one material (OBJ usemtl/o/g, glTF primitive)
+struct SubMesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    std::string name;
+};
+
+// A small cluster of a submesh's triangles (a consecutive index range) with bounds for culling.
+// See Meshlets.h.
+struct Meshlet {
+    uint32_t firstIndex;    // into the mesh's index buffer
+    uint32_t triangleCount; // <= MESHLET_MAX_TRIANGLES
+    uint32_t vertexCount;   // distinct vertices, <= MESHLET_MAX_VERTICES
+    uint32_t submesh;
+    glm::vec3 center;       // bounding sphere
+    float radius;
+    glm::vec3 coneAxis;     // average facing of the triangles
+    float coneCutoff;       // sine of the widest angle between a triangle normal and coneAxis, 1 = never backface culled
+};
+
+// One level of detail: an index range drawing the whole mesh (every submesh, in order) with fewer triangles.
+// See MeshSimplifier.h.
+struct MeshLOD {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // how far, in the mesh's units, this level may be from level 0
+};
+
+// Where one submesh's triangles are in one level of detail, so a level can still be drawn a submesh at a time
+struct LODRange {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+// Between two strips in a GL_TRIANGLE_STRIP index buffer (glPrimitiveRestartIndex)
+#define MESH_INDEX_RESTART 0xFFFFFFFFu
+
+// A run of the packed index buffer whose indices are relative to baseVertex (glDrawElementsBaseVertex),
+// which is how 16 bit indices address meshes with more than 65536 vertices. See IndexPacking.h.
+struct IndexBatch {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t baseVertex;
+};
+
+// Triangle mesh in CPU memory, ready to be copied into a VBO + EBO
+struct MeshData {
+    VertexLayout layout;
+    std::vector<unsigned char> vertexData; // vertexCount * layout.stride bytes
+    size_t vertexCount = 0;
+    std::vector<uint32_t> indices;
+    uint32_t mode = 0x0004; // GL_TRIANGLES, or GL_TRIANGLE_STRIP (0x0005) with MESH_INDEX_RESTART after each strip
+    std::vector<SubMesh> submeshes;
+    std::vector<Meshlet> meshlets; // empty unless the import built them
+    std::vector<MeshLOD> lods;     // same, level 0 first
+    std::vector<LODRange> lodRanges; // with lods: level l's submesh s is [l * submeshes.size() + s]
+    // `indices` narrowed for the GPU by packIndices, empty until then
+    ComponentType indexType = ComponentType::UnsignedInt;
+    std::vector<unsigned char> packedIndices;
+    std::vector<IndexBatch> indexBatches;
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+};
+
+#endif //OPENGLPLAYGROUND_MESH_H
@@ -0,0 +1,420 @@
+#include "MeshCache.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "BlockCompression.h"
+#include "GLBLoader.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "OBJLoader.h"
+
+namespace {
+
+// On disk layout. Everything is little endian and naturally aligned, so the header and tables can be
+// read in place from the mapping.
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceSize;
+    int64_t sourceModified;
+    uint32_t flags;
+    uint32_t stride;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint32_t indexType; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t attributeCount;
+    uint32_t submeshCount;
+    uint32_t importFlags; // MeshImportOptions::flags()
+    uint32_t mode;        // GL_TRIANGLES or GL_TRIANGLE_STRIP
+    uint32_t batchCount;
+    float boundsMin[3], boundsMax[3];
+    uint64_t attributeOffset, submeshOffset;
+    uint64_t meshletOffset, meshletCount; // Meshlet records as they are in memory
+    uint64_t lodOffset, lodCount;         // MeshLOD records, same
+    uint64_t lodRangeOffset;              // LODRange records, lodCount * submeshCount of them
+    uint64_t batchOffset;                 // IndexBatch records
+    uint64_t vertexOffset, vertexStoredBytes; // stored = compressed size if MESH_CACHE_COMPRESSED
+    uint64_t indexOffset, indexStoredBytes;
+};
+
+struct MeshCacheAttribute {
+    char name[MESH_CACHE_NAME_LENGTH];
+    uint32_t components;
+    uint32_t type;
+    uint32_t normalized;
+    uint32_t offset;
+};
+
+struct MeshCacheSubMesh {
+    char name[MESH_CACHE_NAME_LENGTH];
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+size_t alignUp(size_t value) {
+    return (value + MESH_CACHE_ALIGNMENT - 1) & ~(size_t) (MESH_CACHE_ALIGNMENT - 1);
+}
+
+bool endsWith(const std::string &text, const char *suffix) {
+    const size_t length = std::strlen(suffix);
+    if (text.size() < length)
+        return false;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[text.size() - length + i];
+        if (c >= 'A' && c <= 'Z')
+            c = (char) (c - 'A' + 'a');
+        if (c != suffix[i])
+            return false;
+    }
+    return true;
+}
+
+// Copies a name into a fixed size, zero terminated field (longer names get cut)
+void copyName(char (&dst)[MESH_CACHE_NAME_LENGTH], const std::string &name) {
+    std::memset(dst, 0, sizeof(dst));
+    std::memcpy(dst, name.data(), std::min(name.size(), sizeof(dst) - 1));
+}
+
+} // namespace
+
+bool meshSourceStamp(const char *path, MeshSourceStamp &stamp) {
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false;
+    stamp.size = (uint64_t) info.st_size;
+    stamp.modified = (int64_t) info.st_mtime;
+    return true;
+}
+
+bool loadMeshSource(const char *path, MeshData &mesh) {
+    if (endsWith(path, ".obj"))
+        return loadOBJ(path, mesh);
+    if (endsWith(path, ".glb")) {
+        GLBFile glb;
+        return glb.open(path) && glb.toMeshData(mesh);
+    }
+    std::cerr << "ERROR::MESHCACHE::UNKNOWN_SOURCE_FORMAT " << path << std::endl;
+    return false;
+}
+
+bool importMesh(const char *path, MeshData &mesh, const MeshImportOptions &options, MeshImportReport *report) {
+    auto start = std::chrono::steady_clock::now();
+    if (!loadMeshSource(path, mesh))
+        return false;
+    MeshImportReport result;
+    result.parseSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (options.optimize) {
+        splitForShortIndices(mesh); // so the optimizer's vertex order leaves room for 16 bit indices
+        optimizeMesh(mesh, &result.optimize);
+    }
+    if (options.meshlets)
+        buildMeshlets(mesh);
+    if (options.lods) {
+        // After the meshlets, which only cover level 0
+        auto lodStart = std::chrono::steady_clock::now();
+        buildLODChain(mesh);
+        result.lodSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lodStart).count();
+    }
+    if (options.strips)
+        stripifyMesh(mesh);
+    packIndices(mesh, &result.indices);
+    if (report)
+        *report = result;
+    return true;
+}
+
+bool writeMeshCache(const char *path, const MeshData &mesh, const MeshSourceStamp &source,
+                    const MeshImportOptions &options) {
+    const bool compress = options.compress;
+    if (mesh.packedIndices.size() != mesh.indices.size() * componentSize(mesh.indexType)) {
+        std::cerr << "ERROR::MESHCACHE::INDICES_NOT_PACKED " << path << std::endl;
+        return false;
+    }
+    if (mesh.lodRanges.size() != mesh.lods.size() * mesh.submeshes.size()) {
+        std::cerr << "ERROR::MESHCACHE::LOD_RANGES_MISSING " << path << std::endl;
+        return false;
+    }
+    MeshCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.sourceSize = source.size;
+    header.sourceModified = source.modified;
+    header.flags = compress ? MESH_CACHE_COMPRESSED : 0;
+    header.stride = (uint32_t) mesh.layout.stride;
+    header.vertexCount = mesh.vertexCount;
+    header.indexCount = mesh.indices.size();
+    header.indexType = (uint32_t) mesh.indexType;
+    header.mode = mesh.mode;
+    header.batchCount = (uint32_t) mesh.indexBatches.size();
+    header.attributeCount = (uint32_t) mesh.layout.attributes.size();
+    header.submeshCount = (uint32_t) mesh.submeshes.size();
+    header.importFlags = options.flags();
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = mesh.boundsMin[i];
+        header.boundsMax[i] = mesh.boundsMax[i];
+    }
+
+    std::vector<MeshCacheAttribute> attributes(header.attributeCount);
+    for (size_t a = 0; a < attributes.size(); a++) {
+        const VertexAttribute &attribute = mesh.layout.attributes[a];
+        copyName(attributes[a].name, attribute.name);
+        attributes[a].components = (uint32_t) attribute.components;
+        attributes[a].type = (uint32_t) attribute.type;
+        attributes[a].normalized = attribute.normalized ? 1 : 0;
+        attributes[a].offset = (uint32_t) attribute.offset;
+    }
+    std::vector<MeshCacheSubMesh> submeshes(header.submeshCount);
+    for (size_t s = 0; s < submeshes.size(); s++) {
+        copyName(submeshes[s].name, mesh.submeshes[s].name);
+        submeshes[s].firstIndex = mesh.submeshes[s].firstIndex;
+        submeshes[s].indexCount = mesh.submeshes[s].indexCount;
+    }
+
+    const unsigned char *vertexBlob = mesh.vertexData.data();
+    const unsigned char *indexBlob = mesh.packedIndices.data();
+    header.vertexStoredBytes = mesh.vertexData.size();
+    header.indexStoredBytes = mesh.packedIndices.size();
+    std::vector<unsigned char> compressedVertices, compressedIndices;
+    if (compress) {
+        compressBlocks(vertexBlob, (size_t) header.vertexStoredBytes, compressedVertices);
+        compressBlocks(indexBlob, (size_t) header.indexStoredBytes, compressedIndices);
+        vertexBlob = compressedVertices.data();
+        indexBlob = compressedIndices.data();
+        header.vertexStoredBytes = compressedVertices.size();
+        header.indexStoredBytes = compressedIndices.size();
+    }
+
+    header.attributeOffset = sizeof(header);
+    header.submeshOffset = header.attributeOffset + attributes.size() * sizeof(MeshCacheAttribute);
+    header.meshletOffset = header.submeshOffset + submeshes.size() * sizeof(MeshCacheSubMesh);
+    header.meshletCount = mesh.meshlets.size();
+    header.lodOffset = header.meshletOffset + mesh.meshlets.size() * sizeof(Meshlet);
+    header.lodCount = mesh.lods.size();
+    header.lodRangeOffset = header.lodOffset + mesh.lods.size() * sizeof(MeshLOD);
+    header.batchOffset = header.lodRangeOffset + mesh.lodRanges.size() * sizeof(LODRange);
+    const size_t tablesEnd = (size_t) (header.batchOffset + mesh.indexBatches.size() * sizeof(IndexBatch));
+    header.vertexOffset = alignUp(tablesEnd);
+    header.indexOffset = alignUp((size_t) (header.vertexOffset + header.vertexStoredBytes));
+
+    // Written to a temporary name and renamed, so a crash never leaves a half written cache that looks valid
+    const std::string temporary = std::string(path) + ".tmp";
+    std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR::MESHCACHE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    const char padding[MESH_CACHE_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(attributes.data()), (std::streamsize) (attributes.size() * sizeof(MeshCacheAttribute)));
+    out.write(reinterpret_cast<const char *>(submeshes.data()), (std::streamsize) (submeshes.size() * sizeof(MeshCacheSubMesh)));
+    out.write(reinterpret_cast<const char *>(mesh.meshlets.data()), (std::streamsize) (mesh.meshlets.size() * sizeof(Meshlet)));
+    out.write(reinterpret_cast<const char *>(mesh.lods.data()), (std::streamsize) (mesh.lods.size() * sizeof(MeshLOD)));
+    out.write(reinterpret_cast<const char *>(mesh.lodRanges.data()), (std::streamsize) (mesh.lodRanges.size() * sizeof(LODRange)));
+    out.write(reinterpret_cast<const char *>(mesh.indexBatches.data()), (std::streamsize) (mesh.indexBatches.size() * sizeof(IndexBatch)));
+    out.write(padding, (std::streamsize) (header.vertexOffset - tablesEnd));
+    out.write(reinterpret_cast<const char *>(vertexBlob), (std::streamsize) header.vertexStoredBytes);
+    out.write(padding, (std::streamsize) (header.indexOffset - (header.vertexOffset + header.vertexStoredBytes)));
+    out.write(reinterpret_cast<const char *>(indexBlob), (std::streamsize) header.indexStoredBytes);
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path) != 0) {
+        std::cerr << "ERROR::MESHCACHE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void CachedMesh::reset() {
+    file.close();
+    owned = MeshData();
+    layout = VertexLayout();
+    submeshes.clear();
+    meshlets.clear();
+    lods.clear();
+    lodRanges.clear();
+    indexBatches.clear();
+    mode = 0x0004;
+    indexType = ComponentType::UnsignedInt;
+    vertices = nullptr;
+    indices = nullptr;
+    vertexCount = indexCount = fileBytes = 0;
+    fromCache = compressed = false;
+    importReport = MeshImportReport();
+}
+
+bool CachedMesh::openCache(const char *cachePath, const MeshSourceStamp *expected, const MeshImportOptions *options) {
+    reset();
+    if (!file.open(cachePath))
+        return false;
+    const unsigned char *data = file.data();
+    const size_t size = file.size();
+    MeshCacheHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "ERROR::MESHCACHE::TRUNCATED " << cachePath << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION) {
+        if (!expected) // when we have the source, an old cache is just stale
+            std::cerr << "ERROR::MESHCACHE::WRONG_VERSION " << cachePath << std::endl;
+        return false;
+    }
+    if ((expected && (header.sourceSize != expected->size || header.sourceModified != expected->modified)) ||
+        (options && header.importFlags != options->flags()))
+        return false; // stale, not an error
+    const bool wideIndices = header.indexType == 0x1405; // GL_UNSIGNED_INT
+    const uint64_t vertexBytes = header.vertexCount * header.stride, indexBytes = header.indexCount * (wideIndices ? 4 : 2);
+    const bool isCompressed = (header.flags & MESH_CACHE_COMPRESSED) != 0;
+    // The sizes decide what gets allocated for decompressing, so they have to be believable before anything
+    // is: no bigger than the cap (which also keeps the products above from having wrapped round), and no
+    // bigger than what the stored bytes could decompress to
+    if (header.stride == 0 || header.vertexCount > MESH_CACHE_MAX_BLOB_BYTES / header.stride ||
+        header.indexCount > MESH_CACHE_MAX_BLOB_BYTES / 4 ||
+        (isCompressed && (vertexBytes > lz4DecompressBound(header.vertexStoredBytes) ||
+                          indexBytes > lz4DecompressBound(header.indexStoredBytes)))) {
+        std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+        return false;
+    }
+    if (header.attributeOffset + (uint64_t) header.attributeCount * sizeof(MeshCacheAttribute) > size ||
+        header.submeshOffset + (uint64_t) header.submeshCount * sizeof(MeshCacheSubMesh) > size ||
+        header.meshletOffset + header.meshletCount * sizeof(Meshlet) > size ||
+        header.lodOffset + header.lodCount * sizeof(MeshLOD) > size ||
+        header.lodCount > size || header.lodRangeOffset + header.lodCount * header.submeshCount * sizeof(LODRange) > size ||
+        header.batchOffset + (uint64_t) header.batchCount * sizeof(IndexBatch) > size ||
+        header.vertexOffset + header.vertexStoredBytes > size || header.indexOffset + header.indexStoredBytes > size ||
+        (!isCompressed && (header.vertexStoredBytes != vertexBytes || header.indexStoredBytes != indexBytes)) ||
+        header.vertexOffset % MESH_CACHE_ALIGNMENT || header.indexOffset % MESH_CACHE_ALIGNMENT ||
+        (!wideIndices && header.indexType != 0x1403) || (header.mode != 0x0004 && header.mode != 0x0005)) {
+        std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+        return false;
+    }
+
+    layout.stride = header.stride;
+    for (uint32_t a = 0; a < header.attributeCount; a++) {
+        MeshCacheAttribute attribute;
+        std::memcpy(&attribute, data + header.attributeOffset + a * sizeof(attribute), sizeof(attribute));
+        attribute.name[MESH_CACHE_NAME_LENGTH - 1] = 0;
+        layout.attributes.push_back({ attribute.name, (int) attribute.components, (ComponentType) attribute.type,
+                                      attribute.normalized != 0, attribute.offset, 0 });
+    }
+    for (uint32_t s = 0; s < header.submeshCount; s++) {
+        MeshCacheSubMesh submesh;
+        std::memcpy(&submesh, data + header.submeshOffset + s * sizeof(submesh), sizeof(submesh));
+        submesh.name[MESH_CACHE_NAME_LENGTH - 1] = 0;
+        if ((uint64_t) submesh.firstIndex + submesh.indexCount > header.indexCount) {
+            std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+            return false;
+        }
+        submeshes.push_back({ submesh.firstIndex, submesh.indexCount, submesh.name });
+    }
+    meshlets.resize((size_t) header.meshletCount);
+    if (!meshlets.empty())
+        std::memcpy(meshlets.data(), data + header.meshletOffset, meshlets.size() * sizeof(Meshlet));
+    for (const Meshlet &meshlet : meshlets) {
+        if ((uint64_t) meshlet.firstIndex + meshlet.triangleCount * 3ull > header.indexCount) {
+            std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+            return false;
+        }
+    }
+    lods.resize((size_t) header.lodCount);
+    if (!lods.empty())
+        std::memcpy(lods.data(), data + header.lodOffset, lods.size() * sizeof(MeshLOD));
+    for (const MeshLOD &lod : lods) {
+        if ((uint64_t) lod.firstIndex + lod.indexCount > header.indexCount) {
+            std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+            return false;
+        }
+    }
+    lodRanges.resize((size_t) (header.lodCount * header.submeshCount));
+    if (!lodRanges.empty())
+        std::memcpy(lodRanges.data(), data + header.lodRangeOffset, lodRanges.size() * sizeof(LODRange));
+    for (const LODRange &range : lodRanges) {
+        if ((uint64_t) range.firstIndex + range.indexCount > header.indexCount) {
+            std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+            return false;
+        }
+    }
+    indexBatches.resize(header.batchCount);
+    if (!indexBatches.empty())
+        std::memcpy(indexBatches.data(), data + header.batchOffset, indexBatches.size() * sizeof(IndexBatch));
+    for (const IndexBatch &batch : indexBatches) {
+        if ((uint64_t) batch.firstIndex + batch.indexCount > header.indexCount) {
+            std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+            return false;
+        }
+    }
+    vertexCount = (size_t) header.vertexCount;
+    indexCount = (size_t) header.indexCount;
+    mode = header.mode;
+    indexType = (ComponentType) header.indexType;
+    boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    fileBytes = size;
+    fromCache = true;
+    compressed = isCompressed;
+
+    if (!compressed) {
+        // The whole point: nothing to do, the blobs are already in their final form
+        vertices = data + header.vertexOffset;
+        indices = data + header.indexOffset;
+        return true;
+    }
+    owned.vertexData.resize((size_t) vertexBytes);
+    owned.packedIndices.resize((size_t) indexBytes);
+    if (!decompressBlocks(data + header.vertexOffset, (size_t) header.vertexStoredBytes, owned.vertexData.data(),
+                          (size_t) vertexBytes) ||
+        !decompressBlocks(data + header.indexOffset, (size_t) header.indexStoredBytes,
+                          owned.packedIndices.data(), (size_t) indexBytes)) {
+        std::cerr << "ERROR::MESHCACHE::CORRUPT " << cachePath << std::endl;
+        return false;
+    }
+    vertices = owned.vertexData.data();
+    indices = owned.packedIndices.data();
+    file.close(); // everything we need has been copied out
+    return true;
+}
+
+bool CachedMesh::load(const char *sourcePath, const MeshImportOptions &options, const char *cachePath,
+                      bool writeCache) {
+    const std::string defaultCachePath = std::string(sourcePath) + ".mesh";
+    if (!cachePath)
+        cachePath = defaultCachePath.c_str();
+    MeshSourceStamp stamp;
+    if (!meshSourceStamp(sourcePath, stamp)) {
+        // Shipping builds may only have the cache, so use it whatever it was built from
+        if (openCache(cachePath))
+            return true;
+        std::cerr << "ERROR::MESHCACHE::NO_SOURCE_OR_CACHE " << sourcePath << std::endl;
+        return false;
+    }
+    MeshSourceStamp cached;
+    if (meshSourceStamp(cachePath, cached) && openCache(cachePath, &stamp, &options))
+        return true;
+
+    // Missing or stale: import the source
+    reset();
+    if (!importMesh(sourcePath, owned, options, &importReport))
+        return false;
+    if (writeCache && !writeMeshCache(cachePath, owned, stamp, options))
+        std::cerr << "ERROR::MESHCACHE::CACHE_NOT_UPDATED " << cachePath << std::endl; // still usable this run
+    layout = owned.layout;
+    vertexCount = owned.vertexCount;
+    indexCount = owned.indices.size();
+    mode = owned.mode;
+    indexType = owned.indexType;
+    indexBatches = owned.indexBatches;
+    submeshes = owned.submeshes;
+    meshlets = owned.meshlets;
+    lods = owned.lods;
+    lodRanges = owned.lodRanges;
+    boundsMin = owned.boundsMin;
+    boundsMax = owned.boundsMax;
+    vertices = owned.vertexData.data();
+    indices = owned.packedIndices.data();
+    std::vector<uint32_t>().swap(owned.indices); // only the packed ones are needed from here on
+    fileBytes = (size_t) stamp.size;
+    return true;
+}
@@ -0,0 +1,110 @@
+#ifndef OPENGLPLAYGROUND_MESHCACHE_H
+#define OPENGLPLAYGROUND_MESHCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "IndexPacking.h"
+#include "MappedFile.h"
+#include "Mesh.h"
+#include "MeshOptimizer.h"
+
+// Preprocessed mesh files (.mesh): a fixed header, attribute + submesh tables, then the vertex and index
+// blobs exactly as they go into the VBO/EBO, each 64 byte aligned. Loading is an mmap and a header check.
+// Blobs can optionally be LZ4 block compressed (see BlockCompression.h), which trades a parallel
+// decompress for a smaller file.
+
+#define MESH_CACHE_MAGIC 0x4D50474Fu // "OGPM"
+#define MESH_CACHE_VERSION 6
+#define MESH_CACHE_ALIGNMENT 64
+#define MESH_CACHE_COMPRESSED 1u
+#define MESH_CACHE_NAME_LENGTH 48
+#define MESH_CACHE_MAX_BLOB_BYTES (4ull << 30) // vertex or index data, decompressed; beyond that it's corrupt
+
+// Identifies the source file a cache was built from, so a re-exported asset invalidates its cache
+struct MeshSourceStamp {
+    uint64_t size = 0;
+    int64_t modified = 0; // seconds since the epoch
+};
+
+// Returns false if the file doesn't exist
+bool meshSourceStamp(const char *path, MeshSourceStamp &stamp);
+
+// What the import pipeline does to a mesh between parsing and the cache
+struct MeshImportOptions {
+    bool optimize = true;  // vertex cache / overdraw / vertex fetch ordering, see MeshOptimizer.h
+    bool meshlets = true;  // clusters for culling, see Meshlets.h
+    bool lods = true;      // simplified levels of detail, see MeshSimplifier.h
+    bool strips = false;   // triangle strips with primitive restart instead of lists (drops the meshlets)
+    bool compress = false; // LZ4 the cache blobs (doesn't change the mesh, so a cache either way is fine)
+
+    // Stored in the cache, a cache built with different flags is stale
+    uint32_t flags() const { return (optimize ? 1u : 0u) | (meshlets ? 2u : 0u) | (lods ? 4u : 0u) | (strips ? 8u : 0u); }
+};
+
+struct MeshImportReport {
+    double parseSeconds = 0.0;
+    MeshOptimizeStats optimize; // all zero if not optimised
+    double lodSeconds = 0.0;
+    IndexPackStats indices;
+};
+
+// Loads an OBJ or GLB (by extension) into mesh
+bool loadMeshSource(const char *path, MeshData &mesh);
+// loadMeshSource + the processing passes in options, ending with packIndices
+bool importMesh(const char *path, MeshData &mesh, const MeshImportOptions &options, MeshImportReport *report = nullptr);
+
+// Writes the packed indices, so mesh has to have been through packIndices
+bool writeMeshCache(const char *path, const MeshData &mesh, const MeshSourceStamp &source,
+                    const MeshImportOptions &options);
+
+// A mesh ready for upload. When it came from an uncompressed cache, vertexData()/indexData() point straight
+// into the file mapping; otherwise (compressed cache, or a stale/missing cache and we fell back to the
+// source file) they point into memory owned by this object.
+class CachedMesh {
+public:
+    VertexLayout layout;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    uint32_t mode = 0x0004; // GL_TRIANGLES or GL_TRIANGLE_STRIP, see MeshData
+    ComponentType indexType = ComponentType::UnsignedInt;
+    std::vector<IndexBatch> indexBatches;
+    std::vector<SubMesh> submeshes;
+    std::vector<Meshlet> meshlets;
+    std::vector<MeshLOD> lods;
+    std::vector<LODRange> lodRanges; // see MeshData
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsMax = glm::vec3(0.0f);
+    bool fromCache = false;  // false if the source had to be parsed
+    bool compressed = false;
+    size_t fileBytes = 0;    // size of whatever was read
+
+    CachedMesh() = default;
+    CachedMesh(const CachedMesh &) = delete;
+    CachedMesh &operator=(const CachedMesh &) = delete;
+
+    MeshImportReport importReport; // when the source had to be imported
+
+    // Opens `cachePath` (default: sourcePath + ".mesh") if it was built from the current sourcePath with the
+    // same options, otherwise imports sourcePath and, if writeCache, rebuilds the cache for next time
+    bool load(const char *sourcePath, const MeshImportOptions &options = MeshImportOptions(),
+              const char *cachePath = nullptr, bool writeCache = true);
+    // Opens a cache file directly. With a stamp/options, fails if the cache was built from something else.
+    bool openCache(const char *cachePath, const MeshSourceStamp *expected = nullptr,
+                   const MeshImportOptions *options = nullptr);
+
+    const unsigned char *vertexData() const { return vertices; }
+    size_t vertexBytes() const { return vertexCount * layout.stride; }
+    // Packed indices: indexType wide, relative to their batch's base vertex
+    const void *indexData() const { return indices; }
+    size_t indexBytes() const { return indexCount * componentSize(indexType); }
+
+private:
+    MappedFile file;
+    MeshData owned; // source fallback, or decompressed blobs
+    const unsigned char *vertices = nullptr;
+    const unsigned char *indices = nullptr;
+
+    void reset();
+};
+
+#endif //OPENGLPLAYGROUND_MESHCACHE_H
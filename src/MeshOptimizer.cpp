@@ -0,0 +1,265 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// FIFO post-transform cache, simulated with timestamps: a vertex is still cached if fewer than cacheSize
+// misses happened since it was last loaded. Invalidating everything is just a jump of the clock.
+struct VertexCacheSimulator {
+    std::vector<uint32_t> loadedAt;
+    uint32_t time;
+    uint32_t size;
+
+    VertexCacheSimulator(size_t vertexCount, int cacheSize)
+            : loadedAt(vertexCount, 0), time((uint32_t) cacheSize + 1), size((uint32_t) cacheSize) {}
+
+    // Returns true if v had to be transformed
+    bool access(uint32_t v) {
+        if (time - loadedAt[v] <= size)
+            return false;
+        loadedAt[v] = time++;
+        return true;
+    }
+    void flush() {
+        time += size + 1;
+    }
+};
+
+glm::vec3 readPosition(const unsigned char *positions, size_t stride, uint32_t v) {
+    glm::vec3 p;
+    std::memcpy(&p, positions + (size_t) v * stride, sizeof(p));
+    return p;
+}
+
+} // namespace
+
+float computeACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+    if (indexCount < 3)
+        return 0.0f;
+    VertexCacheSimulator cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++)
+        misses += cache.access(indices[i]);
+    return (float) misses / (float) (indexCount / 3);
+}
+
+float computeATVR(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+    VertexCacheSimulator cache(vertexCount, cacheSize);
+    std::vector<bool> used(vertexCount, false);
+    size_t misses = 0, unique = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        misses += cache.access(indices[i]);
+        if (!used[indices[i]]) {
+            used[indices[i]] = true;
+            unique++;
+        }
+    }
+    return unique ? (float) misses / (float) unique : 0.0f;
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize,
+                         std::vector<uint32_t> *clusters) {
+    const size_t triangleCount = indexCount / 3;
+    if (clusters)
+        clusters->assign(triangleCount ? 1 : 0, 0);
+    if (triangleCount == 0)
+        return;
+
+    // Vertex -> triangles adjacency (CSR), and how many unemitted triangles each vertex still has
+    std::vector<uint32_t> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        live[indices[i]]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < triangleCount * 3; i++)
+            adjacency[fill[indices[i]]++] = (uint32_t) (i / 3);
+    }
+
+    std::vector<uint32_t> output(triangleCount * 3);
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<uint32_t> loadedAt(vertexCount, 0), deadEnds, candidates;
+    uint32_t time = (uint32_t) cacheSize + 1;
+    size_t written = 0, cursor = 0;
+
+    // Tipsify: fan out around one vertex at a time, emitting all its remaining triangles, then move on to
+    // the neighbour that will still be in the cache once its own triangles are emitted
+    int64_t fan = indices[0];
+    while (fan >= 0) {
+        candidates.clear();
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            const uint32_t t = adjacency[a];
+            if (emitted[t])
+                continue;
+            for (int c = 0; c < 3; c++) {
+                const uint32_t v = indices[t * 3 + c];
+                output[written++] = v;
+                deadEnds.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - loadedAt[v] > (uint32_t) cacheSize)
+                    loadedAt[v] = time++;
+            }
+            emitted[t] = true;
+        }
+
+        // Prefer the candidate that has been in the cache longest but will still be there after its
+        // fan (2 new vertices per triangle, worst case)
+        int64_t next = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0)
+                continue;
+            int64_t priority = 0;
+            if ((int64_t) (time - loadedAt[v]) + 2 * (int64_t) live[v] <= cacheSize)
+                priority = time - loadedAt[v];
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+        if (next < 0) {
+            // Dead end: back up through recently used vertices, then scan for anything left
+            while (!deadEnds.empty() && next < 0) {
+                const uint32_t v = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[v] > 0)
+                    next = v;
+            }
+            for (; next < 0 && cursor < vertexCount; cursor++)
+                if (live[cursor] > 0)
+                    next = (int64_t) cursor;
+            if (next >= 0 && clusters)
+                clusters->push_back((uint32_t) (written / 3));
+        }
+        fan = next;
+    }
+    std::memcpy(indices, output.data(), triangleCount * 3 * sizeof(uint32_t));
+}
+
+size_t optimizeOverdraw(uint32_t *indices, size_t indexCount, const unsigned char *positions, size_t positionStride,
+                        size_t vertexCount, const std::vector<uint32_t> &hardClusters, float threshold,
+                        int cacheSize) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return 0;
+
+    // 1. Split the hard clusters further wherever the part so far already has a good enough ACMR on its own.
+    // Each cluster is simulated with a cold cache, so reordering them can't make the ACMR much worse.
+    const float target = computeACMR(indices, triangleCount * 3, vertexCount, cacheSize) * threshold;
+    std::vector<uint32_t> starts;
+    VertexCacheSimulator cache(vertexCount, cacheSize);
+    for (size_t h = 0; h < hardClusters.size(); h++) {
+        const size_t end = h + 1 < hardClusters.size() ? hardClusters[h + 1] : triangleCount;
+        size_t start = hardClusters[h], misses = 0;
+        starts.push_back((uint32_t) start);
+        cache.flush();
+        for (size_t t = start; t < end; t++) {
+            for (int c = 0; c < 3; c++)
+                misses += cache.access(indices[t * 3 + c]);
+            if (t + 1 < end && (float) misses <= target * (float) (t + 1 - start)) {
+                starts.push_back((uint32_t) (t + 1));
+                start = t + 1;
+                misses = 0;
+                cache.flush();
+            }
+        }
+    }
+    const size_t clusterCount = starts.size();
+    starts.push_back((uint32_t) triangleCount);
+
+    // 2. Sort clusters by how much they face away from the centre of the mesh: outward facing clusters are
+    // the ones likely to be in front, and drawing them first lets the depth test reject what's behind
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t k = 0; k < clusterCount; k++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = starts[k]; t < starts[k + 1]; t++) {
+            const glm::vec3 a = readPosition(positions, positionStride, indices[t * 3]);
+            const glm::vec3 b = readPosition(positions, positionStride, indices[t * 3 + 1]);
+            const glm::vec3 c = readPosition(positions, positionStride, indices[t * 3 + 2]);
+            const glm::vec3 n = glm::cross(b - a, c - a); // length = 2 * area
+            const float triangleArea = glm::length(n) * 0.5f;
+            centroid += (a + b + c) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[k] = area > 0.0f ? centroid / area : centroid;
+        const float length = glm::length(normal);
+        normals[k] = length > 0.0f ? normal / length : normal;
+    }
+    if (meshArea > 0.0f)
+        meshCentroid /= meshArea;
+    std::vector<float> keys(clusterCount);
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t k = 0; k < clusterCount; k++) {
+        keys[k] = glm::dot(centroids[k] - meshCentroid, normals[k]);
+        order[k] = (uint32_t) k;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] > keys[b]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t k : order)
+        output.insert(output.end(), indices + (size_t) starts[k] * 3, indices + (size_t) starts[k + 1] * 3);
+    std::memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+    return clusterCount;
+}
+
+size_t optimizeVertexFetch(uint32_t *indices, size_t indexCount, unsigned char *vertices, size_t vertexCount,
+                           size_t stride) {
+    std::vector<uint32_t> remap(vertexCount, 0xFFFFFFFFu);
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t &target = remap[indices[i]];
+        if (target == 0xFFFFFFFFu)
+            target = next++;
+        indices[i] = target;
+    }
+    std::vector<unsigned char> reordered((size_t) next * stride);
+    for (size_t v = 0; v < vertexCount; v++)
+        if (remap[v] != 0xFFFFFFFFu)
+            std::memcpy(&reordered[(size_t) remap[v] * stride], vertices + v * stride, stride);
+    std::memcpy(vertices, reordered.data(), reordered.size());
+    return next;
+}
+
+void optimizeMesh(MeshData &mesh, MeshOptimizeStats *stats, float overdrawThreshold) {
+    auto start = std::chrono::steady_clock::now();
+    MeshOptimizeStats result;
+    result.acmrBefore = computeACMR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+    result.atvrBefore = computeATVR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+
+    // Overdraw sorting needs float positions (quantised GLB positions just skip it)
+    const VertexAttribute *position = mesh.layout.find("position");
+    const bool floatPositions = position && position->type == ComponentType::Float && position->components >= 3;
+    std::vector<SubMesh> ranges = mesh.submeshes;
+    if (ranges.empty())
+        ranges.push_back({ 0, (uint32_t) mesh.indices.size(), "" });
+    std::vector<uint32_t> clusters;
+    for (const SubMesh &range : ranges) {
+        uint32_t *indices = mesh.indices.data() + range.firstIndex;
+        optimizeVertexCache(indices, range.indexCount, mesh.vertexCount, MESH_OPTIMIZER_CACHE_SIZE, &clusters);
+        if (floatPositions)
+            result.clusters += optimizeOverdraw(indices, range.indexCount, mesh.vertexData.data() + position->offset,
+                                                mesh.layout.stride, mesh.vertexCount, clusters, overdrawThreshold);
+        else
+            result.clusters += clusters.size();
+    }
+    mesh.vertexCount = optimizeVertexFetch(mesh.indices.data(), mesh.indices.size(), mesh.vertexData.data(),
+                                           mesh.vertexCount, mesh.layout.stride);
+    mesh.vertexData.resize(mesh.vertexCount * mesh.layout.stride);
+
+    result.acmrAfter = computeACMR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+    result.atvrAfter = computeATVR(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (stats)
+        *stats = result;
+}
@@ -0,0 +1,50 @@
+#ifndef OPENGLPLAYGROUND_MESHOPTIMIZER_H
+#define OPENGLPLAYGROUND_MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Index/vertex reordering for the GPU, run at import time (Sander, Nehab, Barczak, "Fast Triangle Reordering
+// for Vertex Locality and Reduced Overdraw", 2007):
+//  1. Tipsify: triangle order that reuses the post-transform vertex cache
+//  2. Split that order into clusters and sort them outside-in, so front faces tend to be drawn first
+//  3. Renumber vertices in first use order, so vertex fetch walks the VBO roughly linearly
+
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+
+// Average cache miss ratio: vertex shader runs per triangle with a FIFO post-transform cache. 3 is the worst,
+// ~0.5 the best possible on a regular grid.
+float computeACMR(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+// Average transform to vertex ratio: vertex shader runs per referenced vertex, 1.0 is perfect
+float computeATVR(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+// Reorders the triangles of indices in place. If clusters is given it gets the first triangle of every
+// "hard" cluster (where Tipsify had to jump to an unconnected part of the mesh).
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount,
+                         int cacheSize = MESH_OPTIMIZER_CACHE_SIZE, std::vector<uint32_t> *clusters = nullptr);
+
+// Reorders clusters of a vertex cache optimised triangle list (from optimizeVertexCache) to reduce overdraw.
+// Clusters are split further wherever that costs less than `threshold` times the current ACMR.
+// positions are xyz floats, positionStride bytes apart. Returns the number of clusters.
+size_t optimizeOverdraw(uint32_t *indices, size_t indexCount, const unsigned char *positions, size_t positionStride,
+                        size_t vertexCount, const std::vector<uint32_t> &hardClusters, float threshold = 1.05f,
+                        int cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+// Renumbers vertices in the order indices first use them (dropping unused ones), rewriting both arrays.
+// Returns the new vertex count.
+size_t optimizeVertexFetch(uint32_t *indices, size_t indexCount, unsigned char *vertices, size_t vertexCount,
+                           size_t stride);
+
+struct MeshOptimizeStats {
+    float acmrBefore = 0.0f, acmrAfter = 0.0f;
+    float atvrBefore = 0.0f, atvrAfter = 0.0f;
+    size_t clusters = 0;
+    double seconds = 0.0;
+};
+
+// All three passes, the first two per submesh so submesh ranges stay intact
+void optimizeMesh(MeshData &mesh, MeshOptimizeStats *stats = nullptr, float overdrawThreshold = 1.05f);
+
+#endif //OPENGLPLAYGROUND_MESHOPTIMIZER_H
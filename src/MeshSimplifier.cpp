@@ -0,0 +1,285 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "MeshOptimizer.h"
+
+namespace {
+
+// Sum of squared distances to a set of planes, area weighted: error(p) = p'Ap + 2b'p + c, over the weight
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0, c = 0;
+    double weight = 0;
+
+    void addPlane(const glm::vec3 &n, float d, float w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a22 += w * n.z * n.z;
+        b0 += w * n.x * d; b1 += w * n.y * d; b2 += w * n.z * d;
+        c += w * d * d;
+        weight += w;
+    }
+    Quadric &operator+=(const Quadric &q) {
+        a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+        b0 += q.b0; b1 += q.b1; b2 += q.b2; c += q.c;
+        weight += q.weight;
+        return *this;
+    }
+    // Mean squared distance of p to the planes
+    double error(const glm::vec3 &p) const {
+        const double x = p.x, y = p.y, z = p.z;
+        const double e = x * x * a00 + y * y * a11 + z * z * a22 + 2.0 * (x * y * a01 + x * z * a02 + y * z * a12) +
+                         2.0 * (x * b0 + y * b1 + z * b2) + c;
+        return weight > 0.0 ? std::max(e, 0.0) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    uint32_t from, to;
+    float error;
+};
+
+glm::vec3 readPosition(const unsigned char *positions, size_t stride, uint32_t v) {
+    glm::vec3 p;
+    std::memcpy(&p, positions + (size_t) v * stride, sizeof(p));
+    return p;
+}
+
+// Vertices that mustn't move: ones sharing their position with another vertex (seams) and ones on an edge
+// that doesn't have exactly two triangles (open borders, non-manifold bits)
+std::vector<bool> findLockedVertices(const uint32_t *indices, size_t indexCount, const unsigned char *positions,
+                                     size_t stride, size_t vertexCount) {
+    // Weld by position: sort, then every run of equal positions maps to its first vertex
+    std::vector<uint32_t> order(vertexCount), welded(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        order[v] = (uint32_t) v;
+    auto less = [&](uint32_t a, uint32_t b) {
+        return std::memcmp(positions + (size_t) a * stride, positions + (size_t) b * stride, sizeof(glm::vec3)) < 0;
+    };
+    std::sort(order.begin(), order.end(), less);
+    std::vector<bool> locked(vertexCount, false);
+    for (size_t i = 0; i < vertexCount;) {
+        size_t j = i + 1;
+        while (j < vertexCount && !less(order[i], order[j]))
+            j++;
+        for (size_t k = i; k < j; k++) {
+            welded[order[k]] = order[i];
+            locked[order[k]] = j - i > 1;
+        }
+        i = j;
+    }
+
+    // Count the triangles on every (welded) edge
+    std::vector<uint64_t> edges;
+    edges.reserve(indexCount);
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        for (int e = 0; e < 3; e++) {
+            const uint64_t a = welded[indices[i + e]], b = welded[indices[i + (e + 1) % 3]];
+            edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+    std::vector<bool> lockedWeld(vertexCount, false);
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j] == edges[i])
+            j++;
+        if (j - i != 2) {
+            lockedWeld[(size_t) (edges[i] >> 32)] = true;
+            lockedWeld[(size_t) (edges[i] & 0xFFFFFFFFu)] = true;
+        }
+        i = j;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+        if (lockedWeld[welded[v]])
+            locked[v] = true;
+    return locked;
+}
+
+} // namespace
+
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount, const unsigned char *positions,
+                    size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError,
+                    float *resultError) {
+    std::vector<uint32_t> triangles;
+    triangles.reserve(indexCount / 3 * 3);
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+        if (indices[i] != indices[i + 1] && indices[i + 1] != indices[i + 2] && indices[i] != indices[i + 2])
+            triangles.insert(triangles.end(), indices + i, indices + i + 3);
+
+    const std::vector<bool> locked = findLockedVertices(triangles.data(), triangles.size(), positions, positionStride,
+                                                        vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < triangles.size(); i += 3) {
+        const glm::vec3 a = readPosition(positions, positionStride, triangles[i]);
+        const glm::vec3 b = readPosition(positions, positionStride, triangles[i + 1]);
+        const glm::vec3 c = readPosition(positions, positionStride, triangles[i + 2]);
+        glm::vec3 n = glm::cross(b - a, c - a);
+        const float length = glm::length(n);
+        if (length == 0.0f)
+            continue;
+        n /= length;
+        for (int k = 0; k < 3; k++)
+            quadrics[triangles[i + k]].addPlane(n, -glm::dot(n, a), length * 0.5f);
+    }
+
+    // Passes of independent collapses, cheapest first: within a pass no two collapses touch the same
+    // triangles, so each one can be checked against the mesh as it is
+    float maxError = 0.0f;
+    std::vector<uint32_t> offsets(vertexCount + 1), adjacency, remap(vertexCount);
+    std::vector<bool> touched(vertexCount);
+    std::vector<Collapse> candidates;
+    const float targetError2 = targetError * targetError;
+    while (triangles.size() > targetIndexCount) {
+        // Vertex -> triangles (CSR)
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t v : triangles)
+            offsets[v + 1]++;
+        for (size_t v = 0; v < vertexCount; v++)
+            offsets[v + 1] += offsets[v];
+        adjacency.resize(triangles.size());
+        {
+            std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < triangles.size(); i++)
+                adjacency[fill[triangles[i]]++] = (uint32_t) (i / 3);
+        }
+
+        // Every interior edge shows up once in each direction, only look at it from one side, and only the
+        // cheaper way round
+        candidates.clear();
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                const uint32_t a = triangles[i + e], b = triangles[i + (e + 1) % 3];
+                if (a > b || (locked[a] && locked[b]))
+                    continue;
+                Quadric merged = quadrics[a];
+                merged += quadrics[b];
+                const float toB = locked[a] ? INFINITY : (float) merged.error(readPosition(positions, positionStride, b));
+                const float toA = locked[b] ? INFINITY : (float) merged.error(readPosition(positions, positionStride, a));
+                candidates.push_back(toB <= toA ? Collapse{ a, b, toB } : Collapse{ b, a, toA });
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse &x, const Collapse &y) { return x.error < y.error; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        for (size_t v = 0; v < vertexCount; v++)
+            remap[v] = (uint32_t) v;
+        size_t trianglesLeft = triangles.size() / 3, collapsed = 0;
+        for (const Collapse &collapse : candidates) {
+            if (collapse.error > targetError2 || trianglesLeft * 3 <= targetIndexCount)
+                break;
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+            // Moving `from` onto `to` mustn't flip (or nearly flip) any triangle that survives
+            const glm::vec3 target = readPosition(positions, positionStride, collapse.to);
+            size_t removed = 0;
+            bool flips = false;
+            for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1] && !flips; a++) {
+                const uint32_t *t = &triangles[(size_t) adjacency[a] * 3];
+                if (t[0] == collapse.to || t[1] == collapse.to || t[2] == collapse.to) {
+                    removed++;
+                    continue;
+                }
+                glm::vec3 p[3];
+                for (int k = 0; k < 3; k++)
+                    p[k] = readPosition(positions, positionStride, t[k]);
+                const glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (int k = 0; k < 3; k++)
+                    if (t[k] == collapse.from)
+                        p[k] = target;
+                const glm::vec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                flips = glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after);
+            }
+            if (flips || removed == 0)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            for (uint32_t a = offsets[collapse.from]; a < offsets[collapse.from + 1]; a++)
+                for (int k = 0; k < 3; k++)
+                    touched[triangles[(size_t) adjacency[a] * 3 + k]] = true;
+            quadrics[collapse.to] += quadrics[collapse.from];
+            maxError = std::max(maxError, collapse.error);
+            trianglesLeft -= removed;
+            collapsed++;
+        }
+        if (collapsed == 0)
+            break;
+
+        size_t written = 0;
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            const uint32_t a = remap[triangles[i]], b = remap[triangles[i + 1]], c = remap[triangles[i + 2]];
+            if (a == b || b == c || a == c)
+                continue;
+            triangles[written++] = a;
+            triangles[written++] = b;
+            triangles[written++] = c;
+        }
+        triangles.resize(written);
+    }
+
+    std::memcpy(destination, triangles.data(), triangles.size() * sizeof(uint32_t));
+    if (resultError)
+        *resultError = std::sqrt(maxError);
+    return triangles.size();
+}
+
+size_t buildLODChain(MeshData &mesh, int maxLevels, float reduction) {
+    mesh.lods.clear();
+    mesh.lodRanges.clear();
+    if (mesh.submeshes.empty())
+        mesh.submeshes.push_back({ 0, (uint32_t) mesh.indices.size(), "" });
+    mesh.lods.push_back({ 0, (uint32_t) mesh.indices.size(), 0.0f });
+    for (const SubMesh &submesh : mesh.submeshes)
+        mesh.lodRanges.push_back({ submesh.firstIndex, submesh.indexCount });
+    const VertexAttribute *position = mesh.layout.find("position");
+    if (!position || position->type != ComponentType::Float || position->components < 3)
+        return mesh.lods.size();
+    const unsigned char *positions = mesh.vertexData.data() + position->offset;
+
+    // Each level simplifies the one before, so its error is bounded by the sum of the steps so far
+    std::vector<SubMesh> previous = mesh.submeshes;
+    std::vector<uint32_t> level, scratch, window;
+    for (int l = 1; l < maxLevels; l++) {
+        std::vector<SubMesh> current = previous;
+        level.clear();
+        float stepError = 0.0f;
+        for (SubMesh &range : current) {
+            const size_t target = (size_t) ((float) (range.indexCount / 3) * reduction) * 3;
+            // Work on the vertices this range uses only: the simplifier and optimizer cost per vertex they're
+            // given, and a mesh split into many submeshes would otherwise pay for the whole buffer every time
+            const uint32_t *source = mesh.indices.data() + range.firstIndex;
+            uint32_t first = 0xFFFFFFFFu, end = 0;
+            for (size_t i = 0; i < range.indexCount; i++) {
+                first = std::min(first, source[i]);
+                end = std::max(end, source[i] + 1);
+            }
+            if (range.indexCount == 0)
+                first = end = 0;
+            window.resize(range.indexCount);
+            for (size_t i = 0; i < range.indexCount; i++)
+                window[i] = source[i] - first;
+            scratch.resize(range.indexCount);
+            float error = 0.0f;
+            const size_t count = simplifyMesh(scratch.data(), window.data(), range.indexCount,
+                                              positions + (size_t) first * mesh.layout.stride, mesh.layout.stride,
+                                              end - first, target, INFINITY, &error);
+            optimizeVertexCache(scratch.data(), count, end - first, MESH_OPTIMIZER_CACHE_SIZE, nullptr);
+            for (size_t i = 0; i < count; i++)
+                scratch[i] += first;
+            range.firstIndex = (uint32_t) (mesh.indices.size() + level.size());
+            range.indexCount = (uint32_t) count;
+            level.insert(level.end(), scratch.begin(), scratch.begin() + count);
+            stepError = std::max(stepError, error);
+        }
+        const MeshLOD last = mesh.lods.back();
+        if (level.empty() || (float) level.size() > (float) last.indexCount * MESH_LOD_MIN_GAIN)
+            break; // everything left is locked (seams, borders) or flips when collapsed
+        mesh.lods.push_back({ (uint32_t) mesh.indices.size(), (uint32_t) level.size(), last.error + stepError });
+        mesh.indices.insert(mesh.indices.end(), level.begin(), level.end());
+        for (const SubMesh &range : current)
+            mesh.lodRanges.push_back({ range.firstIndex, range.indexCount });
+        previous = current;
+    }
+    return mesh.lods.size();
+}
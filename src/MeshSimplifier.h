@@ -0,0 +1,33 @@
+#ifndef OPENGLPLAYGROUND_MESHSIMPLIFIER_H
+#define OPENGLPLAYGROUND_MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "Mesh.h"
+
+// Offline simplification into a chain of LODs that all share the mesh's vertex buffer.
+// Each level is a triangle list appended to the index buffer, with the geometric error it was built
+// with, which is what the runtime needs to pick a level by screen-space error (see LODSelector.h).
+
+#define MESH_LOD_MAX_LEVELS 8
+#define MESH_LOD_REDUCTION 0.5f // triangles kept from one level to the next
+#define MESH_LOD_MIN_GAIN 0.85f // give up once a level keeps more than this of the previous one
+
+// Edge collapse simplification with quadric error metrics (Garland & Heckbert). Every collapse keeps one end
+// of the edge, so no vertex is moved or created and the result indexes the same vertex buffer.
+// Vertices on open borders and seams (several vertices at one position, i.e. split normals or UVs) are never
+// collapsed, which keeps the outline and the texture mapping intact.
+// Stops at targetIndexCount indices or when the next collapse would cost more than targetError (in the
+// mesh's units). destination needs room for indexCount indices. Returns the index count written, and the
+// largest error of any collapse in resultError.
+size_t simplifyMesh(uint32_t *destination, const uint32_t *indices, size_t indexCount, const unsigned char *positions,
+                    size_t positionStride, size_t vertexCount, size_t targetIndexCount, float targetError,
+                    float *resultError = nullptr);
+
+// Builds mesh.lods: level 0 is the index buffer as it is, every further level simplifies the previous one
+// (submesh by submesh) to `reduction` of its triangles and is appended to mesh.indices. The submeshes keep
+// describing level 0, and mesh.lodRanges where each one is in every level. Needs float xyz positions,
+// otherwise only level 0 is recorded. Returns the level count.
+size_t buildLODChain(MeshData &mesh, int maxLevels = MESH_LOD_MAX_LEVELS, float reduction = MESH_LOD_REDUCTION);
+
+#endif //OPENGLPLAYGROUND_MESHSIMPLIFIER_H
@@ -0,0 +1,167 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include "Parallel.h"
+
+// Meshlets per culling job: big enough that a job is worth handing to a thread
+#define MESHLET_CULL_BLOCK 256
+
+static glm::vec3 readPosition(const MeshData &mesh, size_t offset, uint32_t v) {
+    glm::vec3 p;
+    std::memcpy(&p, &mesh.vertexData[(size_t) v * mesh.layout.stride + offset], sizeof(p));
+    return p;
+}
+
+// Bounding sphere + normal cone of indices [first, first + 3 * triangles)
+static void computeMeshletBounds(const MeshData &mesh, size_t positionOffset, Meshlet &meshlet) {
+    const uint32_t *indices = &mesh.indices[meshlet.firstIndex];
+    glm::vec3 lo(1e30f), hi(-1e30f), normalSum(0.0f);
+    std::vector<glm::vec3> normals(meshlet.triangleCount);
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++) {
+        const glm::vec3 a = readPosition(mesh, positionOffset, indices[t * 3]);
+        const glm::vec3 b = readPosition(mesh, positionOffset, indices[t * 3 + 1]);
+        const glm::vec3 c = readPosition(mesh, positionOffset, indices[t * 3 + 2]);
+        lo = glm::min(lo, glm::min(a, glm::min(b, c)));
+        hi = glm::max(hi, glm::max(a, glm::max(b, c)));
+        const glm::vec3 n = glm::cross(b - a, c - a);
+        const float length = glm::length(n);
+        normals[t] = length > 0.0f ? n / length : glm::vec3(0.0f);
+        normalSum += normals[t];
+    }
+    // Centre of the box, radius to the furthest vertex: not the minimal sphere, but close and cheap
+    meshlet.center = (lo + hi) * 0.5f;
+    float radius2 = 0.0f;
+    for (uint32_t i = 0; i < meshlet.triangleCount * 3; i++) {
+        const glm::vec3 d = readPosition(mesh, positionOffset, indices[i]) - meshlet.center;
+        radius2 = std::max(radius2, glm::dot(d, d));
+    }
+    meshlet.radius = std::sqrt(radius2);
+
+    const float axisLength = glm::length(normalSum);
+    meshlet.coneAxis = axisLength > 0.0f ? normalSum / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+    float minDot = 1.0f;
+    for (const glm::vec3 &n : normals)
+        if (n != glm::vec3(0.0f)) // degenerate triangles face nowhere
+            minDot = std::min(minDot, glm::dot(n, meshlet.coneAxis));
+    // Half angle >= 90 degrees: some triangle always faces the camera
+    meshlet.coneCutoff = (axisLength == 0.0f || minDot <= 0.0f) ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+}
+
+size_t buildMeshlets(MeshData &mesh) {
+    mesh.meshlets.clear();
+    const VertexAttribute *position = mesh.layout.find("position");
+    if (!position || position->type != ComponentType::Float || position->components < 3)
+        return 0;
+
+    std::vector<SubMesh> ranges = mesh.submeshes;
+    if (ranges.empty())
+        ranges.push_back({ 0, (uint32_t) mesh.indices.size(), "" });
+    // Which meshlet each vertex was last counted in, to count distinct vertices without a set
+    std::vector<uint32_t> seenIn(mesh.vertexCount, 0xFFFFFFFFu);
+    for (uint32_t s = 0; s < (uint32_t) ranges.size(); s++) {
+        const uint32_t end = ranges[s].firstIndex + ranges[s].indexCount / 3 * 3;
+        for (uint32_t i = ranges[s].firstIndex; i < end;) {
+            Meshlet meshlet = {};
+            meshlet.firstIndex = i;
+            meshlet.submesh = s;
+            const uint32_t id = (uint32_t) mesh.meshlets.size();
+            // Greedily take triangles until the next one would break a limit
+            for (; i < end && meshlet.triangleCount < MESHLET_MAX_TRIANGLES; i += 3) {
+                uint32_t added = 0;
+                for (int c = 0; c < 3; c++) {
+                    const uint32_t v = mesh.indices[i + c];
+                    added += seenIn[v] != id && (c < 1 || v != mesh.indices[i]) && (c < 2 || v != mesh.indices[i + 1]);
+                }
+                if (meshlet.vertexCount + added > MESHLET_MAX_VERTICES)
+                    break;
+                for (int c = 0; c < 3; c++)
+                    seenIn[mesh.indices[i + c]] = id;
+                meshlet.vertexCount += added;
+                meshlet.triangleCount++;
+            }
+            computeMeshletBounds(mesh, position->offset, meshlet);
+            mesh.meshlets.push_back(meshlet);
+        }
+    }
+    return mesh.meshlets.size();
+}
+
+void MeshletCuller::cull(const Meshlet *meshlets, size_t count, const glm::mat4 &modelViewProjection,
+                         const glm::vec4 &camera) {
+    auto start = std::chrono::steady_clock::now();
+    // Frustum planes straight from the matrix (Gribb & Hartmann), normalised so distances are real distances
+    glm::vec4 planes[6];
+    const glm::mat4 m = glm::transpose(modelViewProjection);
+    for (int axis = 0; axis < 3; axis++) {
+        planes[axis * 2] = m[3] + m[axis];
+        planes[axis * 2 + 1] = m[3] - m[axis];
+    }
+    for (glm::vec4 &plane : planes)
+        plane /= std::max(glm::length(glm::vec3(plane)), 1e-20f);
+    const bool perspective = camera.w != 0.0f;
+    const glm::vec3 eye(camera);
+
+    const size_t blockCount = (count + MESHLET_CULL_BLOCK - 1) / MESHLET_CULL_BLOCK;
+    if (blocks.size() < blockCount)
+        blocks.resize(blockCount);
+    parallelBlocks(blockCount, [&](size_t b) {
+        Block &block = blocks[b];
+        block.firstIndex.clear();
+        block.indexCount.clear();
+        block.frustumCulled = block.backfaceCulled = 0;
+        for (size_t i = b * MESHLET_CULL_BLOCK, end = std::min(count, i + MESHLET_CULL_BLOCK); i < end; i++) {
+            const Meshlet &meshlet = meshlets[i];
+            bool outside = false;
+            for (const glm::vec4 &plane : planes)
+                outside = outside || glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius;
+            if (outside) {
+                block.frustumCulled++;
+                continue;
+            }
+            // Every triangle faces away if the whole cone (widened by the sphere for perspective) does
+            bool backfacing;
+            if (perspective) {
+                const glm::vec3 toCentre = meshlet.center - eye;
+                backfacing = glm::dot(toCentre, meshlet.coneAxis) >=
+                             meshlet.coneCutoff * glm::length(toCentre) + meshlet.radius;
+            } else {
+                backfacing = glm::dot(eye, meshlet.coneAxis) > meshlet.coneCutoff;
+            }
+            if (backfacing) {
+                block.backfaceCulled++;
+                continue;
+            }
+            const uint32_t indices = meshlet.triangleCount * 3;
+            if (!block.firstIndex.empty() && block.firstIndex.back() + block.indexCount.back() == meshlet.firstIndex) {
+                block.indexCount.back() += indices;
+            } else {
+                block.firstIndex.push_back(meshlet.firstIndex);
+                block.indexCount.push_back(indices);
+            }
+        }
+    }, threadCount);
+
+    // Stitch the blocks' ranges together, merging across block boundaries too
+    firstIndex.clear();
+    indexCount.clear();
+    stats = MeshletCullStats();
+    stats.meshlets = count;
+    for (size_t b = 0; b < blockCount; b++) {
+        const Block &block = blocks[b];
+        stats.frustumCulled += block.frustumCulled;
+        stats.backfaceCulled += block.backfaceCulled;
+        for (size_t r = 0; r < block.firstIndex.size(); r++) {
+            if (!firstIndex.empty() && firstIndex.back() + indexCount.back() == block.firstIndex[r]) {
+                indexCount.back() += block.indexCount[r];
+            } else {
+                firstIndex.push_back(block.firstIndex[r]);
+                indexCount.push_back(block.indexCount[r]);
+            }
+            stats.triangles += block.indexCount[r] / 3;
+        }
+    }
+    stats.ranges = firstIndex.size();
+    stats.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
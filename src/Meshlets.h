@@ -0,0 +1,51 @@
+#ifndef OPENGLPLAYGROUND_MESHLETS_H
+#define OPENGLPLAYGROUND_MESHLETS_H
+
+#include <cstdint>
+#include <vector>
+#include "Mesh.h"
+
+// Meshlets: clusters of up to 64 vertices / 124 triangles (what mesh shader hardware likes), small enough
+// that culling them individually throws away most of a big mesh that's off screen or facing away.
+// Each meshlet is a consecutive run of the index buffer, so drawing the survivors is a glMultiDrawElements
+// over the merged runs, no index rewriting needed.
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// Cuts every submesh of mesh into meshlets, in index order (so run the vertex cache optimizer first, its
+// order keeps neighbouring triangles together). Needs float xyz positions. Returns the meshlet count.
+size_t buildMeshlets(MeshData &mesh);
+
+struct MeshletCullStats {
+    size_t meshlets = 0;
+    size_t frustumCulled = 0;
+    size_t backfaceCulled = 0;
+    size_t ranges = 0;    // draw calls' worth of index ranges after merging neighbours
+    size_t triangles = 0; // left to draw
+    double milliseconds = 0.0;
+
+    double cullRate() const { return meshlets ? (double) (frustumCulled + backfaceCulled) / (double) meshlets : 0.0; }
+};
+
+// Culls meshlets on worker threads and collects the survivors as compact index ranges
+class MeshletCuller {
+public:
+    std::vector<uint32_t> firstIndex; // ranges to draw, neighbouring meshlets merged
+    std::vector<uint32_t> indexCount;
+    MeshletCullStats stats;
+    int threadCount = 0; // 0 = one per core
+
+    // modelViewProjection takes the mesh's object space to clip space. camera is in object space too:
+    // a position (w = 1) for perspective, or the direction the camera looks in (w = 0) for orthographic.
+    void cull(const Meshlet *meshlets, size_t count, const glm::mat4 &modelViewProjection, const glm::vec4 &camera);
+
+private:
+    struct Block {
+        std::vector<uint32_t> firstIndex, indexCount;
+        size_t frustumCulled, backfaceCulled;
+    };
+    std::vector<Block> blocks; // kept between frames so culling doesn't allocate
+};
+
+#endif //OPENGLPLAYGROUND_MESHLETS_H
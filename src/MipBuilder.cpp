@@ -0,0 +1,296 @@
+#include "MipBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/glm.hpp>
+#include <glm/gtc/color_space.hpp>
+#include <glm/gtc/constants.hpp>
+#include "Parallel.h"
+#include "SWSimd.h"
+
+// linear -> sRGB goes through sqrt(linear), which spreads the dark end (where sRGB codes are densest in
+// linear terms) over enough table entries that only values right on a code boundary can round the other way
+#define MIP_SRGB_TABLE_SIZE 4096
+#define MIP_ROWS_PER_BLOCK 16
+
+namespace {
+
+struct SRGBTables {
+    float toLinear[256];
+    unsigned char fromSqrtLinear[MIP_SRGB_TABLE_SIZE];
+    SRGBTables() {
+        for (int i = 0; i < 256; i++)
+            toLinear[i] = glm::convertSRGBToLinear(glm::vec3((float) i / 255.0f)).x;
+        for (int i = 0; i < MIP_SRGB_TABLE_SIZE; i++) {
+            const float root = (float) i / (MIP_SRGB_TABLE_SIZE - 1);
+            const float encoded = glm::convertLinearToSRGB(glm::vec3(root * root)).x;
+            fromSqrtLinear[i] = (unsigned char) std::lround(std::min(std::max(encoded, 0.0f), 1.0f) * 255.0f);
+        }
+    }
+};
+
+const SRGBTables &srgbTables() {
+    static const SRGBTables tables;
+    return tables;
+}
+
+// Which source texels each destination texel reads, and how much of each: `taps` weights per destination
+// texel, starting at source texel first[x]. Windows are all the same length (zero padded) so the inner
+// loops have a fixed trip count.
+struct FilterWeights {
+    int taps = 0;
+    std::vector<int> first;
+    std::vector<float> weights;
+};
+
+double bessel0(double x) {
+    // Power series, converges fast for the arguments a Kaiser window with alpha 4 produces
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+double kaiser(double x) {
+    const double width = 3.0, alpha = 4.0;
+    if (std::fabs(x) >= width)
+        return 0.0;
+    const double sinc = x == 0.0 ? 1.0 : std::sin(glm::pi<double>() * x) / (glm::pi<double>() * x);
+    const double t = x / width;
+    return sinc * bessel0(alpha * std::sqrt(1.0 - t * t)) / bessel0(alpha);
+}
+
+FilterWeights filterWeights(int sourceSize, int size, MipFilter filter) {
+    const double scale = (double) sourceSize / size; // source texels per destination texel
+    std::vector<std::vector<std::pair<int, double>>> taps((size_t) size);
+    for (int x = 0; x < size; x++) {
+        // Source texels the footprint touches, with the ones past an edge folded onto it
+        const double begin = filter == MipFilter::Box ? x * scale : (x + 0.5 - 3.0) * scale;
+        const double end = filter == MipFilter::Box ? (x + 1) * scale : (x + 0.5 + 3.0) * scale;
+        const int low = std::max(0, (int) std::floor(begin)), high = std::min(sourceSize - 1, (int) std::ceil(end));
+        std::vector<double> weights((size_t) (high - low + 1), 0.0);
+        for (int i = (int) std::floor(begin); i <= (int) std::ceil(end); i++) {
+            const int clamped = std::min(std::max(i, 0), sourceSize - 1) - low;
+            if (filter == MipFilter::Box)
+                weights[clamped] += std::max(0.0, std::min<double>(end, i + 1) - std::max<double>(begin, i));
+            else
+                weights[clamped] += kaiser((i + 0.5) / scale - (x + 0.5));
+        }
+        double total = 0.0;
+        for (int i = 0; i < (int) weights.size(); i++)
+            if (weights[i] != 0.0) {
+                taps[x].push_back({ low + i, weights[i] });
+                total += weights[i];
+            }
+        for (std::pair<int, double> &tap : taps[x])
+            tap.second /= total;
+    }
+
+    FilterWeights result;
+    for (const auto &list : taps)
+        result.taps = std::max(result.taps, list.back().first - list.front().first + 1);
+    result.first.resize((size_t) size);
+    result.weights.assign((size_t) size * result.taps, 0.0f);
+    for (int x = 0; x < size; x++) {
+        const int first = std::min(taps[x].front().first, sourceSize - result.taps);
+        result.first[x] = first;
+        for (const std::pair<int, double> &tap : taps[x])
+            result.weights[(size_t) x * result.taps + tap.first - first] = (float) tap.second;
+    }
+    return result;
+}
+
+// RGBA8 -> linear float RGBA, colour premultiplied by alpha if alphaWeighted
+void decodeRow(const unsigned char *in, int width, float *out, const MipOptions &options) {
+    const SRGBTables &tables = srgbTables();
+    for (int x = 0; x < width; x++, in += 4, out += 4) {
+        const float alpha = in[3] / 255.0f;
+        const float weight = options.alphaWeighted ? alpha : 1.0f;
+        for (int c = 0; c < 3; c++)
+            out[c] = (options.srgb ? tables.toLinear[in[c]] : in[c] / 255.0f) * weight;
+        out[3] = alpha;
+    }
+}
+
+// Where downsample() reads its source rows: a float level straight from memory, or level 0 decoded a row
+// at a time as it's needed. A 4096x4096 image would be 256 MiB as floats, and writing that out and
+// reading it back costs more than the filter itself.
+struct SourceRows {
+    const float *levels = nullptr;
+    const Image *image = nullptr;
+    const MipOptions *options = nullptr;
+};
+
+// Rows of level 0 one thread has decoded, in a ring that holds a destination row's window plus the next
+// row's step, so going down a block of rows decodes each source row once
+struct RowCache {
+    std::vector<float> rows;
+    std::vector<int> tags;
+
+    const float *row(const SourceRows &source, int width, int y) {
+        const size_t rowFloats = (size_t) width * 4;
+        if (source.levels)
+            return source.levels + y * rowFloats;
+        const size_t slot = (size_t) y % tags.size();
+        float *cached = &rows[slot * rowFloats];
+        if (tags[slot] != y) {
+            decodeRow(&source.image->pixels[y * rowFloats], width, cached, *source.options);
+            tags[slot] = y;
+        }
+        return cached;
+    }
+};
+
+// Separable resample: each destination row is first the weighted sum of source rows (straight 8 float
+// multiply-adds along the row), then each pair of destination texels sums its taps of that row
+void downsample(const SourceRows &source, int width, int height, std::vector<float> &out, int outWidth,
+                int outHeight, const MipOptions &options) {
+    const FilterWeights horizontal = filterWeights(width, outWidth, options.filter);
+    const FilterWeights vertical = filterWeights(height, outHeight, options.filter);
+    out.resize((size_t) outWidth * outHeight * 4);
+    const size_t rowFloats = (size_t) width * 4;
+    parallelFor((size_t) outHeight, MIP_ROWS_PER_BLOCK, [&](size_t begin, size_t end) {
+        std::vector<float> row(rowFloats);
+        std::vector<const float *> taps((size_t) vertical.taps);
+        RowCache cache;
+        if (!source.levels) {
+            const size_t slots = (size_t) vertical.taps + 2 * (size_t) std::ceil((double) height / outHeight);
+            cache.rows.resize(slots * rowFloats);
+            cache.tags.assign(slots, -1);
+        }
+        for (size_t y = begin; y < end; y++) {
+            const float *weights = &vertical.weights[y * vertical.taps];
+            for (int t = 0; t < vertical.taps; t++)
+                taps[t] = cache.row(source, width, vertical.first[y] + t);
+            size_t i = 0;
+            for (; i + SW_LANES <= rowFloats; i += SW_LANES) {
+                Float8 sum = f8Zero();
+                for (int t = 0; t < vertical.taps; t++)
+                    sum += f8Load(taps[t] + i) * weights[t];
+                f8Store(&row[i], sum);
+            }
+            for (; i < rowFloats; i++) { // odd width: one pixel left over
+                float sum = 0.0f;
+                for (int t = 0; t < vertical.taps; t++)
+                    sum += taps[t][i] * weights[t];
+                row[i] = sum;
+            }
+
+            float *destination = &out[y * outWidth * 4];
+            int x = 0;
+            for (; x + 1 < outWidth; x += 2) {
+                const float *a = &row[(size_t) horizontal.first[x] * 4], *b = &row[(size_t) horizontal.first[x + 1] * 4];
+                const float *wa = &horizontal.weights[(size_t) x * horizontal.taps], *wb = wa + horizontal.taps;
+                Float8 sum = f8Zero();
+                for (int t = 0; t < horizontal.taps; t++)
+                    sum += f8LoadHalves(a + t * 4, b + t * 4) * f8Set2(wa[t], wb[t]);
+                f8Store(destination + x * 4, sum);
+            }
+            if (x < outWidth) {
+                const float *a = &row[(size_t) horizontal.first[x] * 4];
+                const float *wa = &horizontal.weights[(size_t) x * horizontal.taps];
+                for (int c = 0; c < 4; c++) {
+                    float sum = 0.0f;
+                    for (int t = 0; t < horizontal.taps; t++)
+                        sum += a[t * 4 + c] * wa[t];
+                    destination[x * 4 + c] = sum;
+                }
+            }
+        }
+    }, options.threadCount);
+}
+
+// Share of texels whose alpha, scaled, passes the cutoff
+float coverage(const Image &image, float cutoff) {
+    size_t passing = 0;
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+        passing += image.pixels[i] / 255.0f >= cutoff;
+    return (float) passing / (float) (image.pixels.size() / 4);
+}
+
+float coverage(const std::vector<float> &level, float scale, float cutoff) {
+    size_t passing = 0;
+    for (size_t i = 3; i < level.size(); i += 4)
+        passing += level[i] * scale >= cutoff;
+    return (float) passing / (float) (level.size() / 4);
+}
+
+// Linear float RGBA -> RGBA8, two pixels per Float8
+void encodeLevel(const std::vector<float> &level, Image &image, float alphaScale, const MipOptions &options) {
+    const SRGBTables &tables = srgbTables();
+    const size_t pixels = (size_t) image.width * image.height;
+    image.pixels.resize(pixels * 4);
+    const Float8 alphaLanes = f8MaskFromBits(0x88), zero = f8Zero(), one = f8Set1(1.0f);
+    const Float8 colourScale = f8Set1(options.srgb ? MIP_SRGB_TABLE_SIZE - 1 : 255.0f);
+    const Float8 alphaScale8 = f8Set1(alphaScale * 255.0f);
+    parallelFor(pixels, 64 * 1024, [&](size_t begin, size_t end) {
+        float lanes[SW_LANES];
+        auto encode = [&](const float *in, unsigned char *out, int count) {
+            // Undo the alpha weighting, leaving alpha itself alone
+            Float8 value = count == 2 ? f8Load(in) : f8LoadHalves(in, in);
+            const float a0 = in[3], a1 = count == 2 ? in[7] : in[3];
+            if (options.alphaWeighted)
+                value = f8Select(alphaLanes, value,
+                                 value * f8Set2(a0 > 0.0f ? 1.0f / a0 : 0.0f, a1 > 0.0f ? 1.0f / a1 : 0.0f));
+            value = f8Min(f8Max(value, zero), one);
+            const Float8 colour = options.srgb ? f8Sqrt(value) * colourScale : value * colourScale;
+            f8Store(lanes, f8Select(alphaLanes, f8Min(value * alphaScale8, f8Set1(255.0f)), colour));
+            for (int i = 0; i < count * 4; i++) {
+                const int index = (int) (lanes[i] + 0.5f);
+                out[i] = (unsigned char) ((i & 3) != 3 && options.srgb ? tables.fromSqrtLinear[index] : index);
+            }
+        };
+        size_t p = begin;
+        for (; p + 1 < end; p += 2)
+            encode(&level[p * 4], &image.pixels[p * 4], 2);
+        if (p < end)
+            encode(&level[p * 4], &image.pixels[p * 4], 1);
+    }, options.threadCount);
+}
+
+} // namespace
+
+void buildMipChain(Image &&image, std::vector<Image> &mips, const MipOptions &options) {
+    mips.clear();
+    mips.push_back(std::move(image));
+    if (mips[0].width <= 0 || mips[0].height <= 0)
+        return;
+    const float targetCoverage = options.alphaCutoff > 0.0f ? coverage(mips[0], options.alphaCutoff) : 0.0f;
+    std::vector<float> level, next;
+    SourceRows source;
+    source.image = &mips[0];
+    source.options = &options;
+    int width = mips[0].width, height = mips[0].height;
+    while (width > 1 || height > 1) {
+        const int nextWidth = std::max(1, width / 2), nextHeight = std::max(1, height / 2);
+        downsample(source, width, height, next, nextWidth, nextHeight, options);
+        level.swap(next);
+        source.levels = level.data();
+        width = nextWidth;
+        height = nextHeight;
+
+        // Bisect for the alpha scale that brings coverage back to level 0's, keeping the closest seen (small
+        // levels only have a few coverage values to choose from). Only the encoded level gets scaled, the next
+        // level is filtered from the unscaled one.
+        float alphaScale = 1.0f;
+        if (options.alphaCutoff > 0.0f) {
+            float low = 0.0f, high = 4.0f;
+            float closest = std::fabs(coverage(level, 1.0f, options.alphaCutoff) - targetCoverage);
+            for (int i = 0; i < 12; i++) {
+                const float scale = (low + high) * 0.5f;
+                const float covered = coverage(level, scale, options.alphaCutoff);
+                if (std::fabs(covered - targetCoverage) < closest) {
+                    closest = std::fabs(covered - targetCoverage);
+                    alphaScale = scale;
+                }
+                (covered < targetCoverage ? low : high) = scale;
+            }
+        }
+        Image mip;
+        mip.width = width;
+        mip.height = height;
+        encodeLevel(level, mip, alphaScale, options);
+        mips.push_back(std::move(mip));
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef OPENGLPLAYGROUND_MIPBUILDER_H
+#define OPENGLPLAYGROUND_MIPBUILDER_H
+
+#include <vector>
+#include "ImageDecoder.h"
+
+// Mip chains built on the CPU instead of glGenerateMipmap, whose filtering depends on the driver (and on
+// llvmpipe takes CPU time from rendering anyway). Filtering happens in linear light on float RGBA with
+// colour weighted by alpha, 8 floats (two pixels) at a time, and each level is encoded back to RGBA8.
+// Sizes needn't be powers of two: every level is max(1, size / 2) and the filters weigh source texels by
+// how much of them a destination texel covers. Edges clamp.
+
+enum class MipFilter {
+    Box,   // area average, 2x2 for even sizes
+    Kaiser // Kaiser windowed sinc (3 lobes, alpha 4): sharper, about 6x the taps of Box
+};
+
+struct MipOptions {
+    bool srgb = true;          // colour channels are sRGB encoded, so convert to linear and back around the filter
+    MipFilter filter = MipFilter::Box;
+    bool alphaWeighted = true; // transparent texels don't bleed their (often garbage) colour into their neighbours
+    // > 0 for alpha tested textures: each level's alpha is scaled so the share of texels with alpha >= cutoff
+    // stays what it is in level 0, instead of foliage thinning out into nothing in the distance
+    float alphaCutoff = 0.0f;
+    int threadCount = 0;       // for the rows of each level, 0 = one per core (1 when images are already spread
+                               // over threads, like the texture streamer's workers)
+};
+
+// Levels 1.. down to 1x1, each filtered from the float version of the level above. mips[0] is image itself.
+void buildMipChain(Image &&image, std::vector<Image> &mips, const MipOptions &options = MipOptions());
+
+#endif //OPENGLPLAYGROUND_MIPBUILDER_H
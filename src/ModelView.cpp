@@ -0,0 +1,137 @@
+#include "ModelView.h"
+#include <algorithm>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+
+ModelView::ModelView(const char *path, Shader &program, AssetRegistry &registry)
+        : path(path), program(program), registry(registry) {
+    isGLB = this->path.size() > 4 && this->path.compare(this->path.size() - 4, 4, ".glb") == 0;
+}
+
+ModelView::~ModelView() {
+    if (content)
+        registry.release(content);
+}
+
+void ModelView::request(AssetScheduler &assets) {
+    AssetRequest request;
+    request.name = path;
+    request.priority = assetPriority(0.0f, true);
+    request.read = [this]() { return isGLB ? glb.open(path.c_str()) : cached.load(path.c_str()); };
+    // Hashing for the registry reads the whole mapping, which faults it in here rather than in the middle of
+    // a frame's glBufferData
+    request.decode = [this]() {
+        const uint64_t hash = isGLB ? meshContentHash(glb, program.ID) : meshContentHash(cached, program.ID);
+        const size_t bytes = isGLB ? glb.binarySize() : cached.vertexBytes() + cached.indexBytes();
+        content = registry.acquire(AssetKind::Mesh, hash, bytes, &owner);
+        return content != 0;
+    };
+    request.upload = [this]() {
+        if (!owner) {
+            // Someone else loaded this mesh: share theirs once they've uploaded it, or fail with them
+            model = std::static_pointer_cast<GLMesh>(registry.instance(content));
+            if (model)
+                return AssetUpload::Done;
+            return registry.failed(content) ? AssetUpload::Failed : AssetUpload::More;
+        }
+        model = std::make_shared<GLMesh>();
+        if (isGLB ? !model->upload(glb, program.ID) : !model->upload(cached, program.ID)) {
+            registry.fail(content);
+            return AssetUpload::Failed;
+        }
+        registry.publish(content, model, model->uploadedBytes);
+        return AssetUpload::Done;
+    };
+    request.discard = [this]() {
+        model.reset();
+        if (content)
+            registry.release(content);
+        content = 0;
+    };
+    asset = assets.request(std::move(request));
+}
+
+bool ModelView::update(AssetScheduler &assets) {
+    if (arrived || !asset)
+        return true;
+    const AssetState state = assets.state(asset);
+    if (state == AssetState::Ready)
+        arrive();
+    return state != AssetState::Failed;
+}
+
+void ModelView::arrive() {
+    const glm::vec3 boundsMin = isGLB ? glb.boundsMin : cached.boundsMin;
+    const glm::vec3 boundsMax = isGLB ? glb.boundsMax : cached.boundsMax;
+    const glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+    const glm::vec3 extent = boundsMax - boundsMin;
+    scale = 1.5f / std::max(std::max(extent.x, extent.y), 1e-6f);
+    transform = glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(scale)), -centre);
+    program.use();
+    program.setMat4("transform", transform);
+    // Meshlet culling drops back facing clusters, so GL has to drop back faces too or the result changes
+    if (!cached.meshlets.empty())
+        glEnable(GL_CULL_FACE);
+    // Models rarely have vertex colours, draw those white
+    GLint colAttrib = glGetAttribLocation(program.ID, "colour");
+    if (colAttrib >= 0)
+        glVertexAttrib3f((GLuint) colAttrib, 1.0f, 1.0f, 1.0f);
+    std::cout << path << ": " << model->draws.size() << " draws, " << model->uploadedBytes / 1024
+              << " KiB uploaded" << std::endl;
+    instance.resize(1);
+    instance.set(0, glm::vec3(transform[3]), scale);
+    arrived = true;
+}
+
+void ModelView::prepare(ModelFrame &frame, int height) {
+    frame.prepared = arrived;
+    if (!frame.prepared)
+        return;
+    frame.level = 0;
+    if (model->levelCount() > 1) {
+        // The view is orthographic, so an eye one unit in front of the bounding sphere and half the
+        // framebuffer's height in pixels per unit make LODSelector's projected error the one on screen
+        const glm::vec3 eye = glm::vec3(transform[3]) + glm::vec3(0.0f, 0.0f, model->radius * scale + 1.0f);
+        selector.select(model->lods.data(), model->lods.size(), model->radius, instance, eye, (float) height * 0.5f);
+        frame.level = instance.lod[0];
+    }
+    // Meshlets only cover level 0
+    frame.culled = !cached.meshlets.empty() && frame.level == 0;
+    if (!frame.culled) {
+        frame.triangles = model->levelTriangles(frame.level);
+        return;
+    }
+    // Our shader looks straight down -z, so that's the view direction in object space too
+    culler.cull(cached.meshlets.data(), cached.meshlets.size(), transform, glm::vec4(0.0f, 0.0f, -1.0f, 0.0f));
+    frame.firstIndex.swap(culler.firstIndex);
+    frame.indexCount.swap(culler.indexCount);
+    frame.triangles = culler.stats.triangles;
+    frame.cull = culler.stats;
+}
+
+void ModelView::draw(const ModelFrame &frame) {
+    if (!frame.prepared) {
+        model->draw();
+        return;
+    }
+    if (frame.culled)
+        model->drawRanges(frame.firstIndex, frame.indexCount);
+    else
+        model->drawLevel(frame.level);
+    drawnLevel = frame.level;
+    drawnTriangles = frame.triangles;
+    drawnCulled = frame.culled;
+    drawnCull = frame.cull;
+}
+
+void ModelView::report() const {
+    if (!arrived)
+        return;
+    std::cout << ", model: LOD " << drawnLevel << "/" << model->levelCount() << ", " << drawnTriangles
+              << " triangles drawn";
+    if (!drawnCulled)
+        return;
+    std::cout << ", meshlets: " << drawnCull.cullRate() * 100.0 << "% culled (" << drawnCull.frustumCulled
+              << " frustum, " << drawnCull.backfaceCulled << " backface), " << drawnCull.ranges
+              << " ranges, culling took " << drawnCull.milliseconds << " ms";
+}
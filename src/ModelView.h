@@ -0,0 +1,82 @@
+#ifndef OPENGLPLAYGROUND_MODELVIEW_H
+#define OPENGLPLAYGROUND_MODELVIEW_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "AssetRegistry.h"
+#include "AssetScheduler.h"
+#include "GLBLoader.h"
+#include "GLMesh.h"
+#include "GLShader.h"
+#include "LODSelector.h"
+#include "MeshCache.h"
+#include "Meshlets.h"
+
+// A model on the command line, drawn instead of the quad. Its layout comes from the file, and it is scaled
+// to fit the window. GLBs are uploaded straight from their binary chunk, anything else goes through the
+// .mesh cache, and either streams in through the scheduler while the loop runs (the quad stands in until
+// it's there). The upload is shared through the registry with anything else that loaded the same mesh. LODSelector picks the level its size in the window calls for, and at full detail its
+// meshlets, when the cache has them, are culled every frame. Both happen in prepare(), on the main thread
+// where parallelBlocks has the jobs, and draw() on the GL thread only makes the calls.
+
+// What prepare() hands draw()
+struct ModelFrame {
+    bool prepared = false; // false: the model arrived after this frame was prepared, so it's drawn whole
+    size_t level = 0;
+    bool culled = false;   // level 0 with meshlets: the ranges below are what's left to draw
+    std::vector<uint32_t> firstIndex, indexCount;
+    size_t triangles = 0;
+    MeshletCullStats cull;
+};
+
+class ModelView {
+public:
+    // program: the quad's, which takes the model's positions (and a colour, which is drawn white). The
+    // registry has to outlive the view.
+    ModelView(const char *path, Shader &program, AssetRegistry &registry);
+    // GL thread
+    ~ModelView();
+    ModelView(const ModelView &) = delete;
+    ModelView &operator=(const ModelView &) = delete;
+
+    // Has to outlive the scheduler, whose callbacks fill it in
+    void request(AssetScheduler &assets);
+    // GL thread, once a frame: takes the model in once it's uploaded. False if it couldn't be loaded.
+    bool update(AssetScheduler &assets);
+    bool ready() const { return arrived; }
+
+    // Main thread, once a frame for a framebuffer `height` pixels tall: picks the level and culls
+    void prepare(ModelFrame &frame, int height);
+    // GL thread
+    void draw(const ModelFrame &frame);
+    // GL thread. Appends the level, the triangles drawn and what culling did to the frame report's line.
+    void report() const;
+
+private:
+    std::string path;
+    bool isGLB;
+    Shader &program;
+    GLBFile glb;
+    CachedMesh cached;
+    AssetRegistry &registry;
+    AssetId content = 0;  // set by the decode worker
+    bool owner = false;   // whether it's ours to upload and publish
+    std::shared_ptr<GLMesh> model;
+    glm::mat4 transform = glm::mat4(1.0f);
+    AssetHandle asset = 0;
+    std::atomic<bool> arrived{false}; // set by the GL thread once everything above is filled in
+    float scale = 1.0f; // of the transform
+    MeshletCuller culler;  // main thread, like the two below
+    LODSelector selector;
+    LODInstances instance; // just the one
+    size_t drawnLevel = 0, drawnTriangles = 0; // GL thread, the last frame drawn
+    bool drawnCulled = false;
+    MeshletCullStats drawnCull;
+
+    void arrive();
+};
+
+#endif //OPENGLPLAYGROUND_MODELVIEW_H
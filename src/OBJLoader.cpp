@@ -0,0 +1,506 @@
+#include "OBJLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "MappedFile.h"
+#include "Parallel.h"
+
+// Chunks are cut at the first newline after every OBJ_CHUNK_BYTES, so threads never see half a line
+#define OBJ_CHUNK_BYTES (1u << 20)
+// Corners are spread over this many hash shards for deduplication, each one deduplicated by one thread
+#define OBJ_DEDUP_SHARD_BITS 6
+
+namespace {
+
+// One triangle corner as written in the file, 0 based, -1 when the face didn't give that index
+struct Corner {
+    int32_t v, vt, vn;
+};
+
+// A negative (relative) index, which can only be made absolute once we know how many
+// positions/texcoords/normals the chunks before this one had
+struct RelativeIndex {
+    uint32_t corner;
+    int slot;      // 0 = v, 1 = vt, 2 = vn
+    int64_t local; // index relative to the first element of this chunk (may be negative)
+};
+
+struct GroupStart {
+    uint32_t corner; // first corner of the group, counted from the start of the chunk
+    std::string name;
+};
+
+struct Chunk {
+    const char *begin, *end;
+    std::vector<float> positions, texCoords, normals;
+    std::vector<Corner> corners;
+    std::vector<RelativeIndex> relative;
+    std::vector<GroupStart> groups;
+    glm::vec3 boundsMin = glm::vec3(1e30f), boundsMax = glm::vec3(-1e30f);
+    size_t positionBase = 0, texCoordBase = 0, normalBase = 0, cornerBase = 0;
+    bool malformed = false;
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char *skipBlanks(const char *p, const char *end) {
+    while (p < end && isBlank(*p))
+        p++;
+    return p;
+}
+
+inline const char *skipLine(const char *p, const char *end) {
+    const void *newline = std::memchr(p, '\n', (size_t) (end - p));
+    return newline ? static_cast<const char *>(newline) + 1 : end;
+}
+
+// strtod without the locale lookups and the per call overhead. Up to 19 significant digits are
+// accumulated as an integer and scaled once, which is plenty for a float.
+const char *parseFloat(const char *p, const char *end, float &out) {
+    static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                     1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    uint64_t mantissa = 0;
+    int digits = 0, exponent = 0;
+    const char *start = p;
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+            if (mantissa)
+                digits++;
+        } else {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t) (*p - '0');
+                if (mantissa)
+                    digits++;
+                exponent--;
+            }
+        }
+    }
+    if (p == start) {
+        out = 0.0f;
+        return nullptr;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+'))
+            negativeExponent = *q++ == '-';
+        int value = 0;
+        const char *digitsStart = q;
+        for (; q < end && *q >= '0' && *q <= '9'; q++)
+            value = std::min(value * 10 + (*q - '0'), 10000);
+        if (q != digitsStart) {
+            exponent += negativeExponent ? -value : value;
+            p = q;
+        }
+    }
+    double result = (double) mantissa;
+    while (exponent > 22) {
+        result *= 1e22;
+        exponent -= 22;
+    }
+    while (exponent < -22) {
+        result /= 1e22;
+        exponent += 22;
+    }
+    result = exponent >= 0 ? result * powers[exponent] : result / powers[-exponent];
+    out = (float) (negative ? -result : result);
+    return p;
+}
+
+const char *parseInt(const char *p, const char *end, int64_t &out) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    const char *start = p;
+    int64_t value = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        value = value * 10 + (*p - '0');
+    if (p == start)
+        return nullptr;
+    out = negative ? -value : value;
+    return p;
+}
+
+// Reads up to `count` floats off the current line into dst, missing ones are left as 0
+const char *parseFloats(const char *p, const char *end, std::vector<float> &dst, int count) {
+    for (int i = 0; i < count; i++) {
+        p = skipBlanks(p, end);
+        float value = 0.0f;
+        const char *next = (p < end && *p != '\n') ? parseFloat(p, end, value) : nullptr;
+        if (next)
+            p = next;
+        dst.push_back(value);
+    }
+    return p;
+}
+
+// Stores a face index: positive ones are 1 based absolute, negative ones count back from the latest element
+void storeIndex(Chunk &chunk, int64_t index, int slot, size_t localCount, int32_t &dst) {
+    if (index > 0) {
+        dst = (int32_t) (index - 1);
+    } else if (index < 0) {
+        chunk.relative.push_back({ (uint32_t) chunk.corners.size(), slot, (int64_t) localCount + index });
+        dst = -1;
+    } else {
+        chunk.malformed = true;
+        dst = -1;
+    }
+}
+
+// One "v", "v/vt", "v//vn" or "v/vt/vn" face vertex
+const char *parseCorner(Chunk &chunk, const char *p, const char *end, Corner &corner,
+                        std::vector<RelativeIndex> &pending) {
+    corner = { -1, -1, -1 };
+    const size_t counts[3] = { chunk.positions.size() / 3, chunk.texCoords.size() / 2, chunk.normals.size() / 3 };
+    int32_t *slots[3] = { &corner.v, &corner.vt, &corner.vn };
+    const size_t relativeBefore = chunk.relative.size();
+    for (int slot = 0; slot < 3; slot++) {
+        int64_t index;
+        const char *next = parseInt(p, end, index);
+        if (next) {
+            storeIndex(chunk, index, slot, counts[slot], *slots[slot]);
+            p = next;
+        } else if (slot == 0) {
+            return nullptr;
+        }
+        if (p >= end || *p != '/')
+            break;
+        p++;
+    }
+    // Relative indices were recorded against the next corner slot, but a face vertex can be emitted several
+    // times by the fan, so hand them to the caller to attach to every copy
+    pending.assign(chunk.relative.begin() + (std::ptrdiff_t) relativeBefore, chunk.relative.end());
+    chunk.relative.resize(relativeBefore);
+    return p;
+}
+
+void emitCorner(Chunk &chunk, const Corner &corner, const std::vector<RelativeIndex> &pending) {
+    for (RelativeIndex relative : pending) {
+        relative.corner = (uint32_t) chunk.corners.size();
+        chunk.relative.push_back(relative);
+    }
+    chunk.corners.push_back(corner);
+}
+
+void parseFace(Chunk &chunk, const char *p, const char *end) {
+    Corner first, previous, current;
+    std::vector<RelativeIndex> firstPending, previousPending, currentPending;
+    int count = 0;
+    for (;;) {
+        p = skipBlanks(p, end);
+        if (p >= end || *p == '\n' || *p == '#')
+            break;
+        const char *next = parseCorner(chunk, p, end, current, currentPending);
+        if (!next) {
+            chunk.malformed = true;
+            break;
+        }
+        p = next;
+        // Fan triangulation: (0, 1, 2), (0, 2, 3)...
+        if (count == 0) {
+            first = current;
+            firstPending.swap(currentPending);
+        } else if (count >= 2) {
+            emitCorner(chunk, first, firstPending);
+            emitCorner(chunk, previous, previousPending);
+            emitCorner(chunk, current, currentPending);
+        }
+        if (count > 0) {
+            previous = current;
+            previousPending.swap(currentPending);
+        }
+        count++;
+    }
+}
+
+void parseChunk(Chunk &chunk) {
+    const char *p = chunk.begin, *end = chunk.end;
+    while (p < end) {
+        p = skipBlanks(p, end);
+        if (p >= end)
+            break;
+        const char *lineEnd = skipLine(p, end);
+        if (p[0] == 'v' && p + 1 < end) {
+            if (isBlank(p[1])) {
+                const size_t first = chunk.positions.size();
+                parseFloats(p + 2, lineEnd, chunk.positions, 3);
+                const glm::vec3 position(chunk.positions[first], chunk.positions[first + 1], chunk.positions[first + 2]);
+                chunk.boundsMin = glm::min(chunk.boundsMin, position);
+                chunk.boundsMax = glm::max(chunk.boundsMax, position);
+            } else if (p[1] == 't' && p + 2 < end && isBlank(p[2])) {
+                parseFloats(p + 3, lineEnd, chunk.texCoords, 2);
+            } else if (p[1] == 'n' && p + 2 < end && isBlank(p[2])) {
+                parseFloats(p + 3, lineEnd, chunk.normals, 3);
+            }
+        } else if (p[0] == 'f' && p + 1 < end && isBlank(p[1])) {
+            parseFace(chunk, p + 2, lineEnd);
+        } else if (((p[0] == 'o' || p[0] == 'g') && p + 1 < end && isBlank(p[1])) ||
+                   (lineEnd - p > 7 && std::strncmp(p, "usemtl", 6) == 0 && isBlank(p[6]))) {
+            // A new object, group or material starts a new submesh
+            const char *name = skipBlanks(p + (p[0] == 'u' ? 7 : 2), lineEnd);
+            const char *nameEnd = lineEnd;
+            while (nameEnd > name && (isBlank(nameEnd[-1]) || nameEnd[-1] == '\n'))
+                nameEnd--;
+            chunk.groups.push_back({ (uint32_t) chunk.corners.size(), std::string(name, nameEnd) });
+        }
+        p = lineEnd;
+    }
+}
+
+inline uint32_t hashCorner(const Corner &corner) {
+    uint64_t h = (uint64_t) (uint32_t) corner.v * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t) (uint32_t) corner.vt * 0xC2B2AE3D27D4EB4Full + (h >> 29);
+    h ^= (uint64_t) (uint32_t) corner.vn * 0x165667B19E3779F9ull + (h >> 32);
+    h ^= h >> 33;
+    return (uint32_t) h;
+}
+
+inline bool operator==(const Corner &a, const Corner &b) {
+    return a.v == b.v && a.vt == b.vt && a.vn == b.vn;
+}
+
+} // namespace
+
+bool loadOBJ(const char *path, MeshData &mesh, OBJLoadStats *stats, int threadCount) {
+    auto start = std::chrono::steady_clock::now();
+    if (threadCount <= 0)
+        threadCount = parallelThreadCount();
+
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    const char *text = reinterpret_cast<const char *>(file.data());
+    const char *textEnd = text + file.size();
+
+    // 1. Line aligned chunks
+    std::vector<Chunk> chunks;
+    for (const char *p = text; p < textEnd;) {
+        const char *end = p + std::min<size_t>(OBJ_CHUNK_BYTES, (size_t) (textEnd - p));
+        end = end < textEnd ? skipLine(end, textEnd) : textEnd;
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = end;
+        p = end;
+    }
+
+    // 2. Parse every chunk on its own
+    parallelBlocks(chunks.size(), [&](size_t c) { parseChunk(chunks[c]); }, threadCount);
+
+    // 3. Where each chunk's elements land in the whole file
+    size_t positionCount = 0, texCoordCount = 0, normalCount = 0, cornerCount = 0;
+    glm::vec3 boundsMin(1e30f), boundsMax(-1e30f);
+    for (Chunk &chunk : chunks) {
+        if (chunk.malformed) {
+            std::cerr << "ERROR::OBJLOADER::MALFORMED_FACE in " << path << std::endl;
+            return false;
+        }
+        chunk.positionBase = positionCount;
+        chunk.texCoordBase = texCoordCount;
+        chunk.normalBase = normalCount;
+        chunk.cornerBase = cornerCount;
+        positionCount += chunk.positions.size() / 3;
+        texCoordCount += chunk.texCoords.size() / 2;
+        normalCount += chunk.normals.size() / 3;
+        cornerCount += chunk.corners.size();
+        boundsMin = glm::min(boundsMin, chunk.boundsMin);
+        boundsMax = glm::max(boundsMax, chunk.boundsMax);
+    }
+    if (cornerCount > 0xFFFFFFFFu) {
+        std::cerr << "ERROR::OBJLOADER::TOO_MANY_INDICES in " << path << std::endl;
+        return false;
+    }
+
+    // 4. Gather positions/texcoords/normals/corners into flat arrays, making every index absolute and checked
+    std::vector<float> positions(positionCount * 3), texCoords(texCoordCount * 2), normals(normalCount * 3);
+    std::vector<Corner> corners(cornerCount);
+    std::atomic<bool> outOfRange(false);
+    parallelBlocks(chunks.size(), [&](size_t c) {
+        Chunk &chunk = chunks[c];
+        std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + chunk.positionBase * 3);
+        std::copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + chunk.texCoordBase * 2);
+        std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + chunk.normalBase * 3);
+        const size_t bases[3] = { chunk.positionBase, chunk.texCoordBase, chunk.normalBase };
+        const size_t counts[3] = { positionCount, texCoordCount, normalCount };
+        for (const RelativeIndex &relative : chunk.relative) {
+            const int64_t index = (int64_t) bases[relative.slot] + relative.local;
+            Corner &corner = chunk.corners[relative.corner];
+            int32_t *slots[3] = { &corner.v, &corner.vt, &corner.vn };
+            *slots[relative.slot] = index >= 0 ? (int32_t) index : (int32_t) counts[relative.slot];
+        }
+        for (const Corner &corner : chunk.corners) {
+            if (corner.v < 0 || (size_t) corner.v >= positionCount || (size_t) (corner.vt + 1) > texCoordCount ||
+                (size_t) (corner.vn + 1) > normalCount)
+                outOfRange = true;
+        }
+        std::copy(chunk.corners.begin(), chunk.corners.end(), corners.begin() + chunk.cornerBase);
+    }, threadCount);
+    if (outOfRange) {
+        std::cerr << "ERROR::OBJLOADER::INDEX_OUT_OF_RANGE in " << path << std::endl;
+        return false;
+    }
+
+    // 5. Submeshes start wherever an o/g/usemtl line was
+    mesh.submeshes.clear();
+    for (const Chunk &chunk : chunks) {
+        for (const GroupStart &group : chunk.groups) {
+            const uint32_t first = (uint32_t) (chunk.cornerBase + group.corner);
+            if (!mesh.submeshes.empty() && mesh.submeshes.back().firstIndex == first)
+                mesh.submeshes.back().name = group.name; // e.g. "o cube" followed by "usemtl red": keep the last
+            else
+                mesh.submeshes.push_back({ first, 0, group.name });
+        }
+    }
+    if (mesh.submeshes.empty() || mesh.submeshes.front().firstIndex != 0)
+        mesh.submeshes.insert(mesh.submeshes.begin(), SubMesh{ 0, 0, "" });
+    for (size_t s = 0; s < mesh.submeshes.size(); s++) {
+        const uint32_t next = s + 1 < mesh.submeshes.size() ? mesh.submeshes[s + 1].firstIndex : (uint32_t) cornerCount;
+        mesh.submeshes[s].indexCount = next - mesh.submeshes[s].firstIndex;
+    }
+    mesh.submeshes.erase(std::remove_if(mesh.submeshes.begin(), mesh.submeshes.end(),
+                                        [](const SubMesh &submesh) { return submesh.indexCount == 0; }),
+                         mesh.submeshes.end());
+    chunks.clear();
+    chunks.shrink_to_fit();
+
+    // 6. Deduplicate corners. Corners are bucketed by hash into shards (in corner order), every shard finds
+    // the first corner of each distinct v/vt/vn in its own table, and since a key only ever lives in one
+    // shard no locking is needed.
+    const size_t shardCount = (size_t) 1 << OBJ_DEDUP_SHARD_BITS;
+    const size_t blockSize = 1 << 16;
+    const size_t blockCount = (cornerCount + blockSize - 1) / blockSize;
+    std::vector<uint32_t> hashes(cornerCount);
+    std::vector<size_t> shardOffsets(blockCount * shardCount + 1, 0); // [block][shard] counts, then offsets
+    parallelBlocks(blockCount, [&](size_t block) {
+        size_t *counts = &shardOffsets[block * shardCount];
+        for (size_t c = block * blockSize, end = std::min(cornerCount, c + blockSize); c < end; c++) {
+            hashes[c] = hashCorner(corners[c]);
+            counts[hashes[c] >> (32 - OBJ_DEDUP_SHARD_BITS)]++;
+        }
+    }, threadCount);
+    // Shard major order, so every shard is one contiguous, corner ordered range
+    std::vector<size_t> shardBegin(shardCount + 1, 0);
+    {
+        size_t total = 0;
+        for (size_t shard = 0; shard < shardCount; shard++) {
+            shardBegin[shard] = total;
+            for (size_t block = 0; block < blockCount; block++) {
+                const size_t count = shardOffsets[block * shardCount + shard];
+                shardOffsets[block * shardCount + shard] = total;
+                total += count;
+            }
+        }
+        shardBegin[shardCount] = total;
+    }
+    std::vector<uint32_t> bucketed(cornerCount);
+    parallelBlocks(blockCount, [&](size_t block) {
+        size_t *offsets = &shardOffsets[block * shardCount];
+        for (size_t c = block * blockSize, end = std::min(cornerCount, c + blockSize); c < end; c++)
+            bucketed[offsets[hashes[c] >> (32 - OBJ_DEDUP_SHARD_BITS)]++] = (uint32_t) c;
+    }, threadCount);
+
+    std::vector<uint32_t> firstCorner(cornerCount);
+    parallelBlocks(shardCount, [&](size_t shard) {
+        const size_t begin = shardBegin[shard], end = shardBegin[shard + 1];
+        size_t tableSize = 16;
+        while (tableSize < (end - begin) * 2)
+            tableSize *= 2;
+        std::vector<uint32_t> table(tableSize, 0xFFFFFFFFu);
+        for (size_t i = begin; i < end; i++) {
+            const uint32_t c = bucketed[i];
+            // The top bits picked the shard, so probe with the low ones
+            size_t slot = hashes[c] & (tableSize - 1);
+            for (;; slot = (slot + 1) & (tableSize - 1)) {
+                if (table[slot] == 0xFFFFFFFFu) {
+                    table[slot] = c;
+                    firstCorner[c] = c;
+                    break;
+                }
+                if (corners[table[slot]] == corners[c]) {
+                    firstCorner[c] = table[slot];
+                    break;
+                }
+            }
+        }
+    }, threadCount);
+    hashes.clear();
+    hashes.shrink_to_fit();
+    bucketed.clear();
+    bucketed.shrink_to_fit();
+
+    // 7. Number the distinct vertices in first occurrence order (a blocked prefix sum over "is first" flags),
+    // which keeps the vertex order close to the file's and so the index buffer reasonably cache friendly
+    std::vector<uint32_t> vertexId(cornerCount);
+    std::vector<size_t> blockVertices(blockCount + 1, 0);
+    parallelBlocks(blockCount, [&](size_t block) {
+        size_t count = 0;
+        for (size_t c = block * blockSize, end = std::min(cornerCount, c + blockSize); c < end; c++)
+            count += firstCorner[c] == c;
+        blockVertices[block + 1] = count;
+    }, threadCount);
+    for (size_t block = 0; block < blockCount; block++)
+        blockVertices[block + 1] += blockVertices[block];
+    const size_t vertexCount = blockVertices[blockCount];
+    parallelBlocks(blockCount, [&](size_t block) {
+        uint32_t next = (uint32_t) blockVertices[block];
+        for (size_t c = block * blockSize, end = std::min(cornerCount, c + blockSize); c < end; c++)
+            if (firstCorner[c] == c)
+                vertexId[c] = next++;
+    }, threadCount);
+
+    // 8. Interleaved vertices + indices
+    const bool hasNormals = normalCount > 0, hasTexCoords = texCoordCount > 0;
+    mesh.layout = VertexLayout();
+    mesh.layout.add("position", 3);
+    if (hasNormals)
+        mesh.layout.add("normal", 3);
+    if (hasTexCoords)
+        mesh.layout.add("texCoord", 2);
+    const size_t floatsPerVertex = mesh.layout.stride / sizeof(float);
+    mesh.vertexCount = vertexCount;
+    mesh.vertexData.assign(vertexCount * mesh.layout.stride, 0);
+    mesh.indices.resize(cornerCount);
+    float *vertexData = reinterpret_cast<float *>(mesh.vertexData.data());
+    parallelBlocks(blockCount, [&](size_t block) {
+        for (size_t c = block * blockSize, end = std::min(cornerCount, c + blockSize); c < end; c++) {
+            const uint32_t id = vertexId[firstCorner[c]];
+            mesh.indices[c] = id;
+            if (firstCorner[c] != c)
+                continue;
+            const Corner &corner = corners[c];
+            float *out = vertexData + (size_t) id * floatsPerVertex;
+            std::memcpy(out, &positions[(size_t) corner.v * 3], 3 * sizeof(float));
+            out += 3;
+            if (hasNormals) {
+                if (corner.vn >= 0)
+                    std::memcpy(out, &normals[(size_t) corner.vn * 3], 3 * sizeof(float));
+                out += 3;
+            }
+            if (hasTexCoords && corner.vt >= 0)
+                std::memcpy(out, &texCoords[(size_t) corner.vt * 2], 2 * sizeof(float));
+        }
+    }, threadCount);
+    mesh.boundsMin = positionCount ? boundsMin : glm::vec3(0.0f);
+    mesh.boundsMax = positionCount ? boundsMax : glm::vec3(0.0f);
+
+    if (stats) {
+        stats->bytes = file.size();
+        stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats->threads = threadCount;
+        stats->positions = positionCount;
+        stats->corners = cornerCount;
+        stats->vertices = vertexCount;
+    }
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef OPENGLPLAYGROUND_OBJLOADER_H
+#define OPENGLPLAYGROUND_OBJLOADER_H
+
+#include <cstddef>
+#include "Mesh.h"
+
+struct OBJLoadStats {
+    size_t bytes = 0;
+    double seconds = 0.0;
+    int threads = 0;
+    size_t positions = 0;
+    size_t corners = 0; // triangle corners after fan triangulation, i.e. the index count
+    size_t vertices = 0; // unique v/vt/vn combinations
+
+    double megabytesPerSecond() const { return seconds > 0.0 ? (double) bytes / seconds / 1e6 : 0.0; }
+};
+
+// Loads a Wavefront OBJ as an indexed triangle list (position, then normal and texCoord if the file has them).
+// The file is memory mapped and cut into line aligned chunks that are parsed on `threadCount` threads
+// (0 = one per core), then identical v/vt/vn corners are merged into one vertex.
+// Returns false (after printing why) if the file can't be read or has out of range indices.
+bool loadOBJ(const char *path, MeshData &mesh, OBJLoadStats *stats = nullptr, int threadCount = 0);
+
+#endif //OPENGLPLAYGROUND_OBJLOADER_H
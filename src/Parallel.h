@@ -0,0 +1,142 @@
+#ifndef OPENGLPLAYGROUND_PARALLEL_H
+#define OPENGLPLAYGROUND_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Minimal fork/join helpers for the loaders and the CPU backend.
+// Work is cut into blocks that threads grab off a shared counter, so uneven blocks still balance out.
+// On a thread that belongs to a job system (see JobSystem.h) the blocks are its jobs instead, rather than
+// starting threads for every call.
+// WorkerThreads at the bottom is the odd one out: long lived threads for work that outlives a call.
+
+inline int parallelThreadCount() {
+    return std::max(1, (int) std::thread::hardware_concurrency());
+}
+
+// Somewhere other than fresh threads for parallelBlocks to run blocks on
+class ParallelBackend {
+public:
+    virtual ~ParallelBackend() = default;
+    virtual int threadCount() const = 0;
+    // run(context, block) for every block in [0, blockCount), done when it returns
+    virtual void runBlocks(size_t blockCount, void (*run)(void *context, size_t block), void *context) = 0;
+};
+
+// The calling thread's backend, null for none
+inline ParallelBackend *&parallelBackend() {
+    static thread_local ParallelBackend *backend = nullptr;
+    return backend;
+}
+
+// Runs work(block) for every block in [0, blockCount) on up to threadCount threads (0 = one per core, or
+// with a backend, all of its threads). The calling thread takes part, and everything is finished when this
+// returns. A backend takes any threadCount above 1 to mean all of its threads.
+template<typename F>
+void parallelBlocks(size_t blockCount, F work, int threadCount = 0) {
+    ParallelBackend *backend = parallelBackend();
+    if (threadCount <= 0)
+        threadCount = backend ? backend->threadCount() : parallelThreadCount();
+    threadCount = (int) std::min<size_t>((size_t) threadCount, blockCount);
+    if (threadCount <= 1) {
+        for (size_t block = 0; block < blockCount; block++)
+            work(block);
+        return;
+    }
+    if (backend) {
+        backend->runBlocks(blockCount, [](void *context, size_t block) { (*static_cast<F *>(context))(block); },
+                           &work);
+        return;
+    }
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t block = next++; block < blockCount; block = next++)
+            work(block);
+    };
+    std::vector<std::thread> threads;
+    for (int t = 1; t < threadCount; t++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+// Runs work(begin, end) over [0, count) in ranges of blockSize
+template<typename F>
+void parallelFor(size_t count, size_t blockSize, F work, int threadCount = 0) {
+    const size_t blocks = (count + blockSize - 1) / blockSize;
+    parallelBlocks(blocks, [&](size_t block) {
+        work(block * blockSize, std::min(count, (block + 1) * blockSize));
+    }, threadCount);
+}
+
+// Threads that run queued jobs in the order they were pushed, for background work like texture decoding
+// that the caller doesn't wait on. Jobs still queued when this is destroyed are dropped, running ones finish.
+class WorkerThreads {
+public:
+    explicit WorkerThreads(int threadCount = 0) {
+        if (threadCount <= 0)
+            threadCount = parallelThreadCount();
+        for (int t = 0; t < threadCount; t++)
+            threads.emplace_back([this]() { run(); });
+    }
+    ~WorkerThreads() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.clear();
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &thread : threads)
+            thread.join();
+    }
+    WorkerThreads(const WorkerThreads &) = delete;
+    WorkerThreads &operator=(const WorkerThreads &) = delete;
+
+    void push(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobs.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+    // Jobs queued or running
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return jobs.size() + running;
+    }
+    int threadCount() const { return (int) threads.size(); }
+
+private:
+    std::vector<std::thread> threads;
+    std::deque<std::function<void()>> jobs;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    size_t running = 0;
+    bool stopping = false;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping)
+                return;
+            std::function<void()> job = std::move(jobs.front());
+            jobs.pop_front();
+            running++;
+            lock.unlock();
+            job();
+            lock.lock();
+            running--;
+        }
+    }
+};
+
+#endif //OPENGLPLAYGROUND_PARALLEL_H
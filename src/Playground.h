@@ -0,0 +1,44 @@
+#ifndef OPENGLPLAYGROUND_PLAYGROUND_H
+#define OPENGLPLAYGROUND_PLAYGROUND_H
+
+#include <glad/glad.h>
+#include "Mesh.h"
+
+// What the window and the command line modes share: the quad that's drawn when there's nothing else, and
+// where the shaders are (the CPU backend finds its kernels by the same paths).
+
+// Vertices
+const float quadVertices[] = {
+        -0.5f,  0.5f, 1.0f, 0.0f, 0.0f, // Top-left
+        0.5f,  0.5f, 0.0f, 1.0f, 0.0f, // Top-right
+        0.5f, -0.5f, 0.0f, 0.0f, 1.0f, // Bottom-right
+        -0.5f, -0.5f, 1.0f, 1.0f, 1.0f  // Bottom-left
+
+};
+
+// Four vertices don't need 32 bit indices
+const GLushort quadElements[] = {
+        0, 1, 2,
+        2, 3, 0
+};
+
+// What the vertices above hold, for glVertexAttribPointer
+inline VertexLayout quadLayout() {
+    VertexLayout layout;
+    layout.add("position", 2);
+    layout.add("colour", 3);
+    return layout;
+}
+
+const char *const vertexShaderPath = "../Assets/Shaders/VertexShader.glsl";
+const char *const fragmentShaderPath = "../Assets/Shaders/FragmentShader.glsl";
+const char *const texturedVertexShaderPath = "../Assets/Shaders/TexturedVertexShader.glsl";
+const char *const texturedGridVertexShaderPath = "../Assets/Shaders/TexturedGridVertexShader.glsl";
+const char *const texturedFragmentShaderPath = "../Assets/Shaders/TexturedFragmentShader.glsl";
+const char *const texturedArrayFragmentShaderPath = "../Assets/Shaders/TexturedArrayFragmentShader.glsl";
+const char *const virtualTextureFragmentShaderPath = "../Assets/Shaders/VirtualTextureFragmentShader.glsl";
+const char *const virtualTextureFeedbackShaderPath = "../Assets/Shaders/VirtualTextureFeedbackShader.glsl";
+const char *const sceneVertexShaderPath = "../Assets/Shaders/SceneVertexShader.glsl";
+const char *const sceneFragmentShaderPath = "../Assets/Shaders/SceneFragmentShader.glsl";
+
+#endif //OPENGLPLAYGROUND_PLAYGROUND_H
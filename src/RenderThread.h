@@ -0,0 +1,191 @@
+#ifndef OPENGLPLAYGROUND_RENDERTHREAD_H
+#define OPENGLPLAYGROUND_RENDERTHREAD_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// A thread of its own for the GL context, so a swap that blocks (vsync, a driver with frames queued up)
+// holds up the next frame's drawing and nothing else. The main thread keeps polling events and simulating:
+// it fills frame N + 1 into a packet while the render thread draws frame N from another one and swaps.
+// Packets go round a ring of fixed size, so the main thread can't get more than that many frames ahead;
+// it waits in begin() for the render thread to be done with the oldest. With a depth of 2, that's the usual
+// double buffering: one packet filled, one drawn.
+// A depth of 0 runs everything on the calling thread instead, submit() drawing and swapping there and then,
+// which is the loop without a render thread, for comparison (and for anything that has to be on one thread).
+// The stats say how much of the time the two threads were actually both busy.
+
+#define RENDER_THREAD_MAX_DEPTH 4
+
+// Since resetStats(), in seconds
+struct RenderThreadStats {
+    size_t frames = 0;     // drawn and swapped
+    double elapsed = 0.0;
+    double simulate = 0.0; // main thread, from begin() to submit()
+    double wait = 0.0;     // main thread, in begin() waiting for a packet to come free
+    double render = 0.0;   // render thread, drawing
+    double swap = 0.0;     // render thread, in glfwSwapBuffers
+    double overlap = 0.0;  // the main thread simulating while the render thread drew or swapped
+
+    double perFrame(double seconds) const { return frames ? seconds * 1e3 / (double) frames : 0.0; } // ms
+    // How much of the render thread's time the main thread got to use for the next frame
+    double overlapRate() const { return render + swap > 0.0 ? overlap / (render + swap) : 0.0; }
+};
+
+template<typename Packet>
+class RenderThread {
+    typedef std::chrono::steady_clock::time_point Time;
+    typedef std::pair<Time, Time> Interval;
+
+public:
+    // Takes the window's context off the calling thread for the render thread (unless depth is 0).
+    // render(packet) draws a frame on it, before the swap, and presented(packet) (if any) goes after.
+    RenderThread(GLFWwindow *window, int depth, std::function<void(Packet &)> render,
+                 std::function<void(Packet &)> presented = nullptr)
+            : window(window), draw(std::move(render)), afterSwap(std::move(presented)), packets((size_t) std::max(std::min(depth, RENDER_THREAD_MAX_DEPTH), 1)),
+              pipelined(depth > 0), since(std::chrono::steady_clock::now()) {
+        if (!pipelined)
+            return;
+        glfwMakeContextCurrent(nullptr);
+        thread = std::thread([this]() { renderLoop(); });
+    }
+    // Draws what's been submitted, then gives the context back to the calling thread
+    ~RenderThread() { stop(); }
+    RenderThread(const RenderThread &) = delete;
+    RenderThread &operator=(const RenderThread &) = delete;
+
+    bool threaded() const { return pipelined; }
+    size_t depth() const { return packets.size(); }
+
+    // Main thread. The packet to fill for the next frame, once the render thread is done with it.
+    Packet &begin() {
+        const Time start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        freed.wait(lock, [this]() { return queued < packets.size(); });
+        simulateStart = std::chrono::steady_clock::now();
+        counters.wait += seconds(start, simulateStart);
+        return packets[(next + queued) % packets.size()];
+    }
+    // Main thread. Hands the packet from begin() over to be drawn.
+    void submit() {
+        const Time end = std::chrono::steady_clock::now();
+        if (!pipelined) {
+            // Nothing runs alongside, so there's no overlap to look for
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                counters.simulate += seconds(simulateStart, end);
+            }
+            present(packets[next]);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            counters.simulate += seconds(simulateStart, end);
+            addInterval(mainBusy, renderBusy, simulateStart, end);
+            queued++;
+        }
+        ready.notify_one();
+    }
+    // Waits for the submitted packets to be drawn, ends the render thread and makes the context current on
+    // the calling thread again
+    void stop() {
+        if (!thread.joinable())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        thread.join();
+        glfwMakeContextCurrent(window);
+    }
+
+    // From either thread
+    RenderThreadStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        RenderThreadStats result = counters;
+        result.elapsed = seconds(since, std::chrono::steady_clock::now());
+        return result;
+    }
+    void resetStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters = RenderThreadStats();
+        since = std::chrono::steady_clock::now();
+    }
+
+private:
+    GLFWwindow *window;
+    std::function<void(Packet &)> draw, afterSwap;
+    std::vector<Packet> packets;
+    const bool pipelined;
+    size_t next = 0;   // oldest packet submitted and not yet drawn (or being drawn)
+    size_t queued = 0; // packets submitted and not yet drawn, the one being drawn included
+    bool stopping = false;
+    mutable std::mutex mutex; // everything above and below, except packets themselves
+    std::condition_variable ready, freed;
+    std::thread thread;
+    Time simulateStart, since;
+    RenderThreadStats counters;
+    // Busy intervals that could still overlap ones to come on the other thread
+    std::deque<Interval> mainBusy, renderBusy;
+
+    static double seconds(Time from, Time to) { return std::chrono::duration<double>(to - from).count(); }
+
+    // Each interval meets the other thread's when it's added, so every overlapping pair is counted once.
+    // The other thread's ones that end before this one starts can't meet anything of ours from now on.
+    void addInterval(std::deque<Interval> &ours, std::deque<Interval> &theirs, Time start, Time end) {
+        for (const Interval &interval : theirs)
+            if (interval.second > start && interval.first < end)
+                counters.overlap += seconds(std::max(start, interval.first), std::min(end, interval.second));
+        while (!theirs.empty() && theirs.front().second <= start)
+            theirs.pop_front();
+        ours.emplace_back(start, end);
+    }
+
+    // Draws and swaps, with the lock not held (the drawing may well want stats())
+    void present(Packet &packet) {
+        const Time start = std::chrono::steady_clock::now();
+        draw(packet);
+        const Time drawn = std::chrono::steady_clock::now();
+        glfwSwapBuffers(window);
+        const Time swapped = std::chrono::steady_clock::now();
+        if (afterSwap)
+            afterSwap(packet);
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.render += seconds(start, drawn);
+        counters.swap += seconds(drawn, swapped);
+        counters.frames++;
+        if (pipelined)
+            addInterval(renderBusy, mainBusy, start, swapped);
+    }
+
+    void renderLoop() {
+        glfwMakeContextCurrent(window);
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            ready.wait(lock, [this]() { return queued > 0 || stopping; });
+            if (queued == 0)
+                break;
+            Packet &packet = packets[next];
+            lock.unlock();
+            present(packet);
+            lock.lock();
+            next = (next + 1) % packets.size();
+            queued--;
+            freed.notify_one();
+        }
+        lock.unlock();
+        glfwMakeContextCurrent(nullptr);
+    }
+};
+
+#endif //OPENGLPLAYGROUND_RENDERTHREAD_H
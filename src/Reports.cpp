@@ -0,0 +1,97 @@
+#include "Reports.h"
+#include <algorithm>
+#include <iostream>
+
+void reportJobs(const JobSystem &jobs) {
+    size_t total = 0, steals = 0;
+    std::cout << "Jobs on " << jobs.threadCount() << " workers, busy:";
+    for (const JobWorkerStats &worker : jobs.stats()) {
+        std::cout << " " << (int) (worker.utilisation * 100.0 + 0.5) << "%";
+        total += worker.jobs;
+        steals += worker.steals;
+    }
+    std::cout << " (" << total << " jobs, " << steals << " stolen)" << std::endl;
+}
+
+void reportTextureStreaming(const TextureStreamStats &stats, double milliseconds) {
+    std::cout << "Textures: " << stats.resident << "/" << stats.requested << " resident after " << milliseconds
+              << " ms (" << stats.failed << " failed, " << stats.deduplicated
+              << " sharing another's). Decode: " << stats.sourceBytes / 1024 << " KiB of files -> "
+              << stats.decodedBytes / 1024 << " KiB with mips (" << stats.compressed << " block compressed, "
+              << stats.cacheHits << " from the cache), " << stats.decodeSourceMBps() << " / "
+              << stats.decodePixelMBps() << " MB/s per thread. Upload: " << stats.uploadedBytes / 1024 << " KiB in "
+              << stats.uploads << " slices, " << stats.uploadMBps() << " MB/s, " << stats.stalls << " PBO stalls"
+              << std::endl;
+}
+
+void reportAssetStreaming(const AssetStreamStats &stats, double milliseconds) {
+    std::cout << "Streamed " << stats.ready << "/" << stats.requested << " assets in " << milliseconds << " ms ("
+              << stats.failed << " failed, " << stats.cancelled << " cancelled): read " << stats.readSeconds * 1000.0
+              << " ms, decode " << stats.decodeSeconds * 1000.0 << " ms, upload " << stats.uploadSeconds * 1000.0
+              << " ms in " << stats.uploadCalls << " calls over " << stats.updates << " frames, longest "
+              << stats.longestUpdate << " ms, " << stats.overBudget << " over budget" << std::endl;
+}
+
+void reportAssetRegistry(const AssetRegistryStats &stats) {
+    std::cout << "Assets: " << stats.references << " references to " << stats.assets << " distinct ("
+              << stats.hits << " found already loaded). Content " << stats.uniqueBytes / 1024 << " KiB held for "
+              << stats.referencedBytes / 1024 << " KiB referenced (" << stats.dedupedBytes() / 1024
+              << " KiB deduplicated), GPU " << stats.residentBytes / 1024 << " KiB for "
+              << stats.residentReferencedBytes / 1024 << " KiB (" << stats.dedupedResidentBytes() / 1024
+              << " KiB deduplicated)" << std::endl;
+}
+
+void reportRenderThread(const RenderThreadStats &stats, bool threaded) {
+    std::cout << "Frames: " << (stats.elapsed > 0.0 ? (double) stats.frames / stats.elapsed : 0.0) << " a second, "
+              << stats.perFrame(stats.simulate) << " ms simulating";
+    if (threaded)
+        std::cout << " (and " << stats.perFrame(stats.wait) << " ms waiting for a packet) on the main thread, "
+                  << stats.perFrame(stats.render) << " ms drawing and " << stats.perFrame(stats.swap)
+                  << " ms swapping on the render thread, the main thread busy with the next frame for "
+                  << stats.overlapRate() * 100.0 << "% of that" << std::endl;
+    else
+        std::cout << ", " << stats.perFrame(stats.render) << " ms drawing and " << stats.perFrame(stats.swap)
+                  << " ms swapping, one after the other" << std::endl;
+}
+
+void reportFramePacing(const FramePacingStats &stats, SwapMode swap, const FramePacingOptions &options) {
+    const char *swapNames[] = { "no vsync", "vsync", "adaptive vsync" };
+    std::cout << "Pacing (" << swapNames[(int) swap];
+    if (options.targetRate > 0.0)
+        std::cout << ", " << options.targetRate << " fps";
+    if (options.lowLatency)
+        std::cout << ", low latency";
+    std::cout << "): frame time " << stats.frameTime[0] << "/" << stats.frameTime[1] << "/" << stats.frameTime[2]
+              << "/" << stats.frameTime[3] << " ms (50th/95th/99th/worst), input to GPU done " << stats.inputToGPUDone[0]
+              << "/" << stats.inputToGPUDone[1] << "/" << stats.inputToGPUDone[2] << "/" << stats.inputToGPUDone[3]
+              << " ms, about " << stats.estimatedLatency << " ms to the screen, slept " << stats.sleptMilliseconds
+              << " ms a frame" << std::endl;
+}
+
+void reportSimulation(const SceneSimulationStats &from, const SceneSimulationStats &to, double stepRate,
+                      bool interpolate) {
+    const double frames = (double) std::max<size_t>(to.frames - from.frames, 1);
+    std::cout << "Simulation (" << stepRate << " Hz, " << (interpolate ? "interpolated" : "not interpolated")
+              << "): " << (double) (to.steps - from.steps) / frames << " steps a frame, stepping "
+              << (to.stepMilliseconds - from.stepMilliseconds) / frames << " ms, interpolating "
+              << (to.interpolateMilliseconds - from.interpolateMilliseconds) / frames << " ms, "
+              << to.droppedSeconds - from.droppedSeconds << " s dropped" << std::endl;
+}
+
+void reportSceneDrawing(const SceneRenderStats &stats) {
+    std::cout << "Scene: " << stats.drawn / std::max<size_t>(stats.frames, 1) << "/"
+              << stats.meshNodes / std::max<size_t>(stats.frames, 1) << " mesh nodes drawn, "
+              << stats.perFrame((double) stats.triangles) / 1e6 << "M triangles ("
+              << stats.perFrame((double) stats.fullDetailTriangles) / 1e6 << "M at full detail), "
+              << stats.commands / std::max<size_t>(stats.frames, 1) << " commands, transforms "
+              << stats.perFrame(stats.transformMilliseconds) << " ms, LOD selection "
+              << stats.perFrame(stats.lodMilliseconds) << " ms, ";
+    if (stats.commandBytes)
+        std::cout << "recorded into " << stats.commandBytes / std::max<size_t>(stats.frames, 1) / 1024
+                  << " KiB on the jobs in " << stats.perFrame(stats.recordMilliseconds) << " ms, replayed in "
+                  << stats.perFrame(stats.submitMilliseconds) << " ms (";
+    else
+        std::cout << "culled and drawn straight from the GL thread in " << stats.perFrame(stats.submitMilliseconds)
+                  << " ms (";
+    std::cout << stats.submitNanosecondsPerCommand() << " ns a command on the GL thread)" << std::endl;
+}
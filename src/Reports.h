@@ -0,0 +1,40 @@
+#ifndef OPENGLPLAYGROUND_REPORTS_H
+#define OPENGLPLAYGROUND_REPORTS_H
+
+#include "AssetRegistry.h"
+#include "AssetScheduler.h"
+#include "FramePacer.h"
+#include "JobSystem.h"
+#include "RenderThread.h"
+#include "SceneRenderer.h"
+#include "SceneSimulation.h"
+#include "TextureStreamer.h"
+
+// One line on std::cout each, for the stats the systems keep
+
+// How busy each job worker has been since the stats were last reset
+void reportJobs(const JobSystem &jobs);
+
+// Where texture streaming spent its time
+void reportTextureStreaming(const TextureStreamStats &stats, double milliseconds);
+
+// What the asset scheduler did, and how long it took
+void reportAssetStreaming(const AssetStreamStats &stats, double milliseconds);
+
+// What sharing identical content saved
+void reportAssetRegistry(const AssetRegistryStats &stats);
+
+// How the main and render threads spent the frames since the stats were last reset
+void reportRenderThread(const RenderThreadStats &stats, bool threaded);
+
+// Frame times and latency since the stats were last reset
+void reportFramePacing(const FramePacingStats &stats, SwapMode swap, const FramePacingOptions &options);
+
+// What the scene's simulation did between two frames' totals, per frame
+void reportSimulation(const SceneSimulationStats &from, const SceneSimulationStats &to, double stepRate,
+                      bool interpolate);
+
+// Where a scene's frames went since the stats were last reset, per frame
+void reportSceneDrawing(const SceneRenderStats &stats);
+
+#endif //OPENGLPLAYGROUND_REPORTS_H
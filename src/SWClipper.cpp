@@ -0,0 +1,140 @@
+#include "SWClipper.h"
+
+SWClipBuffer &swThreadClipBuffer() {
+    thread_local SWClipBuffer buffer;
+    return buffer;
+}
+
+SWClipper::SWClipper(int viewportWidth, int viewportHeight)
+        : guardX((0.5f * (float) viewportWidth + SW_GUARD_BAND_PIXELS) / (0.5f * (float) viewportWidth)),
+          guardY((0.5f * (float) viewportHeight + SW_GUARD_BAND_PIXELS) / (0.5f * (float) viewportHeight)) {
+}
+
+SWClipClassification SWClipper::classify(const SWTransformedVertices &verts, const uint32_t *indices, int count) const {
+    // Gather the 3 corners of each triangle into lanes: corner k of triangle l goes to lane l
+    float gathered[3][4][SW_LANES] = {};
+    for (int l = 0; l < count; l++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t idx = indices[l * 3 + k];
+            gathered[k][0][l] = verts.x[idx];
+            gathered[k][1][l] = verts.y[idx];
+            gathered[k][2][l] = verts.z[idx];
+            gathered[k][3][l] = verts.w[idx];
+        }
+    }
+
+    // 6 clip planes, then the 4 real viewport sides (only used to throw triangles away)
+    const int planeCount = SW_CLIP_PLANE_COUNT + 4;
+    Float8 allOut[planeCount], anyOut[planeCount];
+    const Float8 gx = f8Set1(guardX), gy = f8Set1(guardY);
+    for (int k = 0; k < 3; k++) {
+        const Float8 x = f8Load(gathered[k][0]), y = f8Load(gathered[k][1]);
+        const Float8 z = f8Load(gathered[k][2]), w = f8Load(gathered[k][3]);
+        const Float8 out[planeCount] = {
+                f8Less(z, -w), f8Greater(z, w),
+                f8Less(x, -(gx * w)), f8Greater(x, gx * w),
+                f8Less(y, -(gy * w)), f8Greater(y, gy * w),
+                f8Less(x, -w), f8Greater(x, w), f8Less(y, -w), f8Greater(y, w)
+        };
+        for (int p = 0; p < planeCount; p++) {
+            allOut[p] = k == 0 ? out[p] : f8And(allOut[p], out[p]);
+            anyOut[p] = k == 0 ? out[p] : f8Or(anyOut[p], out[p]);
+        }
+    }
+
+    Float8 reject = allOut[0];
+    for (int p = 1; p < planeCount; p++)
+        reject = f8Or(reject, allOut[p]);
+
+    SWClipClassification result;
+    const int valid = (1 << count) - 1;
+    const int rejectBits = f8MoveMask(reject);
+    int crossBits = 0;
+    int planeBits[SW_CLIP_PLANE_COUNT];
+    for (int p = 0; p < SW_CLIP_PLANE_COUNT; p++) {
+        planeBits[p] = f8MoveMask(anyOut[p]);
+        crossBits |= planeBits[p];
+    }
+    result.acceptBits = valid & ~rejectBits & ~crossBits;
+    result.clipBits = valid & ~rejectBits & crossBits;
+    for (int l = 0; l < SW_LANES; l++) {
+        result.planes[l] = 0;
+        for (int p = 0; p < SW_CLIP_PLANE_COUNT; p++)
+            result.planes[l] |= (uint8_t) (((planeBits[p] >> l) & 1) << p);
+    }
+    return result;
+}
+
+// Signed distance to a plane, >= 0 is inside
+static float planeDistance(const float *v, int plane, float guardX, float guardY) {
+    switch (plane) {
+        case SW_CLIP_NEAR: return v[2] + v[3];
+        case SW_CLIP_FAR: return v[3] - v[2];
+        case SW_CLIP_LEFT: return v[0] + guardX * v[3];
+        case SW_CLIP_RIGHT: return guardX * v[3] - v[0];
+        case SW_CLIP_BOTTOM: return v[1] + guardY * v[3];
+        default: return guardY * v[3] - v[1];
+    }
+}
+
+int SWClipper::clipTriangle(const SWTransformedVertices &verts, uint32_t i0, uint32_t i1, uint32_t i2, int planes,
+                            SWClipBuffer &out) const {
+    const int varyingCount = verts.varyingCount;
+    // Ping-pong between two polygons on the stack
+    SWClipVertex polygons[2][SW_CLIP_MAX_POLYGON];
+    int counts[2] = { 3, 0 };
+    const uint32_t idx[3] = { i0, i1, i2 };
+    for (int k = 0; k < 3; k++) {
+        SWClipVertex &v = polygons[0][k];
+        v.position[0] = verts.x[idx[k]];
+        v.position[1] = verts.y[idx[k]];
+        v.position[2] = verts.z[idx[k]];
+        v.position[3] = verts.w[idx[k]];
+        for (int c = 0; c < varyingCount; c++)
+            v.varyings[c] = verts.varying(c)[idx[k]];
+    }
+
+    int current = 0;
+    for (int p = 0; p < SW_CLIP_PLANE_COUNT; p++) {
+        const int plane = 1 << p;
+        if (!(planes & plane))
+            continue;
+        const SWClipVertex *in = polygons[current];
+        SWClipVertex *result = polygons[current ^ 1];
+        int n = 0;
+        for (int k = 0; k < counts[current]; k++) {
+            const SWClipVertex &a = in[k], &b = in[(k + 1) % counts[current]];
+            float da = planeDistance(a.position, plane, guardX, guardY);
+            float db = planeDistance(b.position, plane, guardX, guardY);
+            if (da >= 0.0f)
+                result[n++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                // Linear in clip space is correct for every attribute, perspective only happens after the divide
+                float t = da / (da - db);
+                SWClipVertex &v = result[n++];
+                for (int c = 0; c < 4; c++)
+                    v.position[c] = a.position[c] + (b.position[c] - a.position[c]) * t;
+                for (int c = 0; c < varyingCount; c++)
+                    v.varyings[c] = a.varyings[c] + (b.varyings[c] - a.varyings[c]) * t;
+            }
+        }
+        counts[current ^ 1] = n;
+        current ^= 1;
+        if (n < 3)
+            return 0;
+    }
+
+    // Fan triangulate into the thread's buffer
+    const int base = out.vertexCount;
+    const int n = counts[current];
+    for (int k = 0; k < n; k++)
+        out.vertices[base + k] = polygons[current][k];
+    out.vertexCount += n;
+    for (int k = 1; k + 1 < n; k++) {
+        uint16_t *tri = out.triangles[out.triangleCount++];
+        tri[0] = (uint16_t) base;
+        tri[1] = (uint16_t) (base + k);
+        tri[2] = (uint16_t) (base + k + 1);
+    }
+    return n - 2;
+}
@@ -0,0 +1,75 @@
+#ifndef OPENGLPLAYGROUND_SWCLIPPER_H
+#define OPENGLPLAYGROUND_SWCLIPPER_H
+
+#include <cstdint>
+#include "SWSimd.h"
+#include "SWVertexSoA.h"
+
+// Guard-band clipping for the CPU backend.
+// Triangles that poke off the side of the screen don't need real clipping: the rasterizer clamps its
+// bounding box to the framebuffer, so they're only clipped when they leave a much bigger "guard band"
+// (where the float edge functions would start losing precision), or cross the near/far planes.
+// In practice that's almost never, so the common case is one 8-wide outcode test per 8 triangles.
+
+// Window space margin around the viewport before a triangle has to be clipped for real
+#define SW_GUARD_BAND_PIXELS 4096.0f
+
+// A triangle clipped by all 6 planes can have up to 3 + 6 corners
+#define SW_CLIP_MAX_POLYGON 9
+
+// Outcode bits (clip planes in homogeneous clip space)
+enum SWClipPlane {
+    SW_CLIP_NEAR = 1 << 0,   // z >= -w
+    SW_CLIP_FAR = 1 << 1,    // z <= w
+    SW_CLIP_LEFT = 1 << 2,   // x >= -g*w, g = guard band scale
+    SW_CLIP_RIGHT = 1 << 3,  // x <= g*w
+    SW_CLIP_BOTTOM = 1 << 4, // y >= -g*w
+    SW_CLIP_TOP = 1 << 5,    // y <= g*w
+    SW_CLIP_PLANE_COUNT = 6
+};
+
+// A corner of a clipped polygon, AoS because clipping works on one triangle at a time
+struct SWClipVertex {
+    float position[4];
+    float varyings[SW_MAX_VARYINGS];
+};
+
+// Per-thread scratch for clipped triangles. Fixed size (enough for a whole batch of 8 triangles each
+// clipped to the max), so the clipper never touches the heap.
+struct SWClipBuffer {
+    int vertexCount;
+    int triangleCount;
+    SWClipVertex vertices[SW_LANES * SW_CLIP_MAX_POLYGON];
+    uint16_t triangles[SW_LANES * (SW_CLIP_MAX_POLYGON - 2)][3];
+
+    void reset() { vertexCount = triangleCount = 0; }
+};
+
+// The calling thread's clip buffer
+SWClipBuffer &swThreadClipBuffer();
+
+// Result of classifying a batch of up to 8 triangles, one bit per triangle
+struct SWClipClassification {
+    int acceptBits; // entirely inside the guard band and depth range: rasterize as is
+    int clipBits;   // crosses near/far/guard band: needs clipTriangle()
+    uint8_t planes[SW_LANES]; // for each clipped triangle, which planes it actually crosses
+};
+
+class SWClipper {
+public:
+    // Guard band expressed as a multiple of the viewport's half-size, per axis
+    float guardX, guardY;
+
+    SWClipper(int viewportWidth, int viewportHeight);
+
+    // Outcode tests for triangles indices[0..3*count) (count <= 8), all 8 at once.
+    // Triangles outside one of the clip planes, or wholly off one side of the viewport, are in neither set.
+    SWClipClassification classify(const SWTransformedVertices &verts, const uint32_t *indices, int count) const;
+
+    // Sutherland-Hodgman against the planes in `planes`, fan-triangulated into `out`.
+    // Returns the number of triangles added.
+    int clipTriangle(const SWTransformedVertices &verts, uint32_t i0, uint32_t i1, uint32_t i2, int planes,
+                     SWClipBuffer &out) const;
+};
+
+#endif //OPENGLPLAYGROUND_SWCLIPPER_H
@@ -0,0 +1,136 @@
+#include "SWMultisample.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+SWMultisampleFramebuffer::SWMultisampleFramebuffer(int width, int height, int samples)
+        : width(width), height(height), stride(swPadToLanes(width)), samples(samples) {
+    // Standard sample positions in 1/16ths of a pixel, the same ones GPUs use
+    static const int pattern4[4][2] = { { -2, -6 }, { 6, -2 }, { -6, 2 }, { 2, 6 } };
+    static const int pattern8[8][2] = { { 1, -3 }, { -1, 3 }, { 5, 1 }, { -3, -5 },
+                                        { -5, 5 }, { -7, -1 }, { 3, 7 }, { 7, -7 } };
+    if (samples != 4 && samples != 8) {
+        std::cerr << "ERROR::SWMULTISAMPLE::UNSUPPORTED_SAMPLE_COUNT " << samples << ", using 4" << std::endl;
+        this->samples = samples = 4;
+    }
+    for (int s = 0; s < samples; s++) {
+        sampleX[s] = (float) (samples == 4 ? pattern4[s][0] : pattern8[s][0]) / 16.0f;
+        sampleY[s] = (float) (samples == 4 ? pattern4[s][1] : pattern8[s][1]) / 16.0f;
+    }
+    const size_t pixels = (size_t) stride * height;
+    colour.assign(pixels, 0);
+    slot.assign(pixels, SW_MSAA_UNIFORM);
+    depth.assign(pixels * samples, 1.0f);
+}
+
+void SWMultisampleFramebuffer::clear(float r, float g, float b, float a) {
+    uint32_t packed[SW_LANES];
+    f8StoreRGBA8(packed, f8Set1(r), f8Set1(g), f8Set1(b), f8Set1(a), 0xFF);
+    std::fill(colour.begin(), colour.end(), packed[0]);
+    std::fill(slot.begin(), slot.end(), SW_MSAA_UNIFORM);
+    sampleColours.clear(); // keeps its capacity, so steady state frames don't allocate
+    freeSlots.clear();
+}
+
+void SWMultisampleFramebuffer::clearDepth(float value) {
+    std::fill(depth.begin(), depth.end(), value);
+}
+
+void SWMultisampleFramebuffer::writeSamples(size_t pixel, uint32_t value, int mask) {
+    const int all = (1 << samples) - 1;
+    uint32_t &block = slot[pixel];
+    if (mask == all) { // Fully covered: back to one colour
+        if (block != SW_MSAA_UNIFORM) {
+            freeSlots.push_back(block);
+            block = SW_MSAA_UNIFORM;
+        }
+        colour[pixel] = value;
+        return;
+    }
+    if (block == SW_MSAA_UNIFORM) {
+        if (colour[pixel] == value)
+            return; // Partial write of the colour it already has
+        if (freeSlots.empty()) {
+            block = (uint32_t) (sampleColours.size() / (size_t) samples);
+            sampleColours.resize(sampleColours.size() + (size_t) samples);
+        } else {
+            block = freeSlots.back();
+            freeSlots.pop_back();
+        }
+        std::fill_n(&sampleColours[(size_t) block * samples], samples, colour[pixel]);
+    }
+    uint32_t *s = &sampleColours[(size_t) block * samples];
+    bool same = true;
+    for (int i = 0; i < samples; i++) {
+        if ((mask >> i) & 1)
+            s[i] = value;
+        same = same && s[i] == s[0];
+    }
+    if (same) { // e.g. the second triangle of a quad filled in the rest of the edge pixel
+        colour[pixel] = s[0];
+        freeSlots.push_back(block);
+        block = SW_MSAA_UNIFORM;
+    }
+}
+
+// Average of n (4 or 8) RGBA8 colours, rounded
+static uint32_t averageSamples(const uint32_t *s, int n) {
+#if SW_SIMD_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128i sum = zero;
+    for (int i = 0; i < n; i += 4) {
+        // 4 colours -> two sets of 16 bit RGBA sums
+        __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+        sum = _mm_add_epi16(sum, _mm_add_epi16(_mm_unpacklo_epi8(v, zero), _mm_unpackhi_epi8(v, zero)));
+    }
+    sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+    sum = _mm_add_epi16(sum, _mm_set1_epi16((short) (n / 2)));
+    sum = _mm_srli_epi16(sum, n == 8 ? 3 : 2);
+    return (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(sum, zero));
+#else
+    uint32_t result = 0;
+    for (int c = 0; c < 4; c++) {
+        uint32_t total = (uint32_t) n / 2;
+        for (int i = 0; i < n; i++)
+            total += (s[i] >> (8 * c)) & 0xFF;
+        result |= (total / (uint32_t) n) << (8 * c);
+    }
+    return result;
+#endif
+}
+
+void SWMultisampleFramebuffer::resolve(SWFramebuffer &dst) const {
+    if (dst.width != width || dst.height != height) {
+        std::cerr << "ERROR::SWMULTISAMPLE::RESOLVE_SIZE_MISMATCH" << std::endl;
+        return;
+    }
+    for (int y = 0; y < height; y++) {
+        const size_t row = (size_t) y * stride;
+        for (int x = 0; x < stride; x += SW_LANES) {
+            const uint32_t *slots = &slot[row + x];
+            uint32_t *out = &dst.colour[row + x];
+            // Most spans have no expanded pixels at all: straight 8 pixel copy
+#if SW_SIMD_SSE2
+            const __m128i uniform = _mm_set1_epi32((int) SW_MSAA_UNIFORM);
+            __m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) slots), uniform);
+            __m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (slots + 4)), uniform);
+            const bool allUniform = _mm_movemask_epi8(_mm_and_si128(lo, hi)) == 0xFFFF;
+#else
+            bool allUniform = true;
+            for (int l = 0; l < SW_LANES; l++)
+                allUniform = allUniform && slots[l] == SW_MSAA_UNIFORM;
+#endif
+            std::memcpy(out, &colour[row + x], sizeof(uint32_t) * SW_LANES);
+            if (allUniform)
+                continue;
+            for (int l = 0; l < SW_LANES; l++)
+                if (slots[l] != SW_MSAA_UNIFORM)
+                    out[l] = averageSamples(&sampleColours[(size_t) slots[l] * samples], samples);
+        }
+    }
+}
+
+size_t SWMultisampleFramebuffer::memoryBytes() const {
+    return colour.size() * sizeof(uint32_t) + slot.size() * sizeof(uint32_t) +
+           sampleColours.capacity() * sizeof(uint32_t) + depth.size() * sizeof(float);
+}
@@ -0,0 +1,43 @@
+#ifndef OPENGLPLAYGROUND_SWMULTISAMPLE_H
+#define OPENGLPLAYGROUND_SWMULTISAMPLE_H
+
+#include <cstdint>
+#include <vector>
+#include "SWRasterizer.h"
+
+// Multisampled colour + depth target for the CPU backend (4x or 8x MSAA).
+// Depth is stored per sample, but colour is compressed: a pixel whose samples all have the same colour
+// (the vast majority, everything not on a triangle edge) stores just that one colour. Only pixels that end
+// up with different colours in different samples get a block in sampleColours.
+
+#define SW_MSAA_UNIFORM 0xFFFFFFFFu
+
+class SWMultisampleFramebuffer {
+public:
+    int width, height;
+    int stride; // pixels per row, width padded to lanes
+    int samples;
+    std::vector<uint32_t> colour;        // per pixel, the shared colour while all its samples agree
+    std::vector<uint32_t> slot;          // per pixel, SW_MSAA_UNIFORM or the block index in sampleColours
+    std::vector<uint32_t> sampleColours; // `samples` colours per expanded pixel
+    std::vector<float> depth;            // per sample, grouped by 8 pixel span: all 8 sample 0s, all 8 sample 1s...
+    float sampleX[8], sampleY[8];        // sample offsets from the pixel centre (standard D3D patterns)
+
+    SWMultisampleFramebuffer(int width, int height, int samples);
+    void clear(float r, float g, float b, float a);
+    void clearDepth(float value = 1.0f);
+
+    // Writes `value` into the samples of `pixel` set in `mask`, expanding or recompressing it as needed
+    void writeSamples(size_t pixel, uint32_t value, int mask);
+
+    // Box filters every pixel's samples into dst (which must be the same size)
+    void resolve(SWFramebuffer &dst) const;
+
+    size_t memoryBytes() const;
+    size_t expandedPixels() const { return sampleColours.size() / (size_t) samples - freeSlots.size(); }
+
+private:
+    std::vector<uint32_t> freeSlots;
+};
+
+#endif //OPENGLPLAYGROUND_SWMULTISAMPLE_H
@@ -0,0 +1,48 @@
+#include "SWProgramRegistry.h"
+#include <cstring>
+#include <iostream>
+#include <map>
+
+// Function-local so it exists before any static SWProgramRegistration runs
+static std::map<std::string, const SWProgram *> &programRegistry() {
+    static std::map<std::string, const SWProgram *> registry;
+    return registry;
+}
+
+void swRegisterProgram(const SWProgram *program) {
+    programRegistry()[program->name] = program;
+}
+
+const SWProgram *swFindProgram(const std::string &name) {
+    auto it = programRegistry().find(name);
+    if (it == programRegistry().end()) {
+        std::cerr << "ERROR::SWPROGRAM::NOT_FOUND " << name << std::endl;
+        return nullptr;
+    }
+    return it->second;
+}
+
+SWUniformBlock::SWUniformBlock(const SWProgram &program)
+        : program(&program), storage(program.uniformBlockSize, 0) {
+}
+
+void SWUniformBlock::set(const std::string &name, const void *value, size_t size) {
+    for (int i = 0; i < program->uniformCount; i++) {
+        const SWUniformInfo &info = program->uniforms[i];
+        if (name != info.name)
+            continue;
+        if (info.size != size) {
+            std::cerr << "ERROR::SWPROGRAM::UNIFORM_SIZE_MISMATCH " << name << std::endl;
+            return;
+        }
+        std::memcpy(&storage[info.offset], value, size);
+        return;
+    }
+    // Same as GL: setting a uniform the program doesn't have (or optimised out) is silently ignored
+}
+
+void SWUniformBlock::setInt(const std::string &name, int value) { set(name, &value, sizeof(value)); }
+void SWUniformBlock::setFloat(const std::string &name, float value) { set(name, &value, sizeof(value)); }
+void SWUniformBlock::setVec3(const std::string &name, const glm::vec3 &value) { set(name, &value, sizeof(value)); }
+void SWUniformBlock::setVec4(const std::string &name, const glm::vec4 &value) { set(name, &value, sizeof(value)); }
+void SWUniformBlock::setMat4(const std::string &name, const glm::mat4 &value) { set(name, &value, sizeof(value)); }
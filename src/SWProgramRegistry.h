@@ -0,0 +1,40 @@
+#ifndef OPENGLPLAYGROUND_SWPROGRAMREGISTRY_H
+#define OPENGLPLAYGROUND_SWPROGRAMREGISTRY_H
+
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "ShaderProgramName.h"
+#include "SWVertexSoA.h"
+
+// CPU programs register themselves here by name (the generated kernels do it at startup),
+// so code holding a GL Shader can ask for the matching CPU program with swFindProgram(shader.name).
+void swRegisterProgram(const SWProgram *program);
+const SWProgram *swFindProgram(const std::string &name);
+
+// Static object the generated code uses to register a program before main() runs
+struct SWProgramRegistration {
+    explicit SWProgramRegistration(const SWProgram *program) { swRegisterProgram(program); }
+};
+
+// Storage for a CPU program's uniforms, set by name like Shader::setFloat and friends
+class SWUniformBlock {
+public:
+    explicit SWUniformBlock(const SWProgram &program);
+
+    void setInt(const std::string &name, int value);
+    void setFloat(const std::string &name, float value);
+    void setVec3(const std::string &name, const glm::vec3 &value);
+    void setVec4(const std::string &name, const glm::vec4 &value);
+    void setMat4(const std::string &name, const glm::mat4 &value);
+
+    const void *data() const { return storage.data(); }
+
+private:
+    const SWProgram *program;
+    std::vector<unsigned char> storage;
+
+    void set(const std::string &name, const void *value, size_t size);
+};
+
+#endif //OPENGLPLAYGROUND_SWPROGRAMREGISTRY_H
@@ -0,0 +1,482 @@
+#include "SWRasterizer.h"
+#include "SWClipper.h"
+#include "SWMultisample.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "Parallel.h"
+
+SWFramebuffer::SWFramebuffer(int width, int height)
+        : width(width), height(height), stride(swPadToLanes(width)),
+          colour((size_t) stride * height, 0), depth((size_t) stride * height, 1.0f) {
+}
+
+void SWFramebuffer::clear(float r, float g, float b, float a) {
+    uint32_t packed[SW_LANES];
+    f8StoreRGBA8(packed, f8Set1(r), f8Set1(g), f8Set1(b), f8Set1(a), 0xFF);
+    std::fill(colour.begin(), colour.end(), packed[0]);
+}
+
+void SWFramebuffer::clearDepth(float value) {
+    std::fill(depth.begin(), depth.end(), value);
+}
+
+bool SWFramebuffer::writePPM(const char *path) const {
+    std::ofstream file(path, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not write file " << path << std::endl;
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row((size_t) width * 3);
+    for (int y = height - 1; y >= 0; y--) { // PPM is top row first, we're bottom row first
+        const uint32_t *src = &colour[(size_t) y * stride];
+        for (int x = 0; x < width; x++) {
+            row[x * 3 + 0] = (char) (src[x] & 0xFF);
+            row[x * 3 + 1] = (char) ((src[x] >> 8) & 0xFF);
+            row[x * 3 + 2] = (char) ((src[x] >> 16) & 0xFF);
+        }
+        file.write(row.data(), (std::streamsize) row.size());
+    }
+    return true;
+}
+
+SWRasterizer::SWRasterizer(SWFramebuffer &target)
+        : target(&target), visibilityIds(target.colour.size(), SW_VISIBILITY_EMPTY) {
+}
+
+void SWRasterizer::drawElements(const SWProgram &program, const SWAttributeStreams &attributes,
+                                const uint32_t *indices, int count, const void *uniforms) {
+    trianglesIn = trianglesCulled = trianglesClipped = trianglesRasterized = fragmentsShaded = 0;
+
+    SWVisibilityDraw *draw = nullptr;
+    if (visibilityMode && multisampleTarget) {
+        std::cerr << "ERROR::SWRASTERIZER::VISIBILITY_MSAA visibility mode doesn't support MSAA targets" << std::endl;
+        return;
+    }
+    if (visibilityMode) {
+        if (visibilityDraws.size() >= SW_VISIBILITY_MAX_DRAWS || count / 3 > (1 << SW_VISIBILITY_TRIANGLE_BITS)) {
+            std::cerr << "ERROR::SWRASTERIZER::VISIBILITY_ID_OVERFLOW resolve before drawing more" << std::endl;
+            return;
+        }
+        visibilityDraws.emplace_back();
+        draw = &visibilityDraws.back();
+        draw->program = &program;
+        draw->uniforms = uniforms;
+    }
+    runVertexStage(program, attributes, uniforms);
+
+    SWTriangleSetup setup;
+    bool idsExhausted = false;
+    // In visibility mode setup skips the varyings (they're only needed for triangles that end up visible)
+    // and the raster loop writes IDs instead of shading
+    auto emit = [&](const float position[3][4], const float *const varyings[3], size_t stride,
+                    const SWVisibilityTriangle &record) {
+        if (!setupTriangle(position, varyings, stride, draw ? 0 : vertices.varyingCount, setup))
+            return;
+        if (draw && draw->triangles.size() >= (1u << SW_VISIBILITY_TRIANGLE_BITS)) {
+            // Guard-band clipping can split one triangle into several, so the check above isn't enough
+            if (!idsExhausted)
+                std::cerr << "ERROR::SWRASTERIZER::VISIBILITY_ID_OVERFLOW dropping the rest of the draw" << std::endl;
+            idsExhausted = true;
+            return;
+        }
+        trianglesRasterized++;
+        if (draw) {
+            uint32_t id = ((uint32_t) (visibilityDraws.size() - 1) << SW_VISIBILITY_TRIANGLE_BITS) |
+                          (uint32_t) draw->triangles.size();
+            draw->triangles.push_back(record);
+            rasterizeVisibility(setup, id);
+        } else {
+            rasterizeTriangle(setup, program.fragment, uniforms);
+        }
+    };
+
+    const SWClipper clipper(target->width, target->height);
+    SWClipBuffer &clipBuffer = swThreadClipBuffer();
+    const int triangleCount = count / 3;
+    for (int first = 0; first < triangleCount; first += SW_LANES) {
+        const int batch = std::min(SW_LANES, triangleCount - first);
+        const uint32_t *batchIndices = indices + (size_t) first * 3;
+        const SWClipClassification classes = clipper.classify(vertices, batchIndices, batch);
+        trianglesIn += (uint64_t) batch;
+        trianglesCulled += (uint64_t) (batch - __builtin_popcount((unsigned) (classes.acceptBits | classes.clipBits)));
+
+        // Still one triangle at a time in submission order, so equal depths resolve like they do in GL
+        clipBuffer.reset();
+        float position[3][4];
+        const float *varyings[3];
+        for (int l = 0; l < batch; l++) {
+            const uint32_t *tri = batchIndices + l * 3;
+            if ((classes.acceptBits >> l) & 1) {
+                for (int k = 0; k < 3; k++) {
+                    position[k][0] = vertices.x[tri[k]];
+                    position[k][1] = vertices.y[tri[k]];
+                    position[k][2] = vertices.z[tri[k]];
+                    position[k][3] = vertices.w[tri[k]];
+                    varyings[k] = vertices.varyings.data() + tri[k];
+                }
+                emit(position, varyings, (size_t) vertices.capacity, { { tri[0], tri[1], tri[2] }, false });
+            } else if ((classes.clipBits >> l) & 1) {
+                trianglesClipped++;
+                const int firstClipped = clipBuffer.triangleCount;
+                clipper.clipTriangle(vertices, tri[0], tri[1], tri[2], classes.planes[l], clipBuffer);
+                for (int t = firstClipped; t < clipBuffer.triangleCount; t++) {
+                    SWVisibilityTriangle record = { { 0, 0, 0 }, true };
+                    for (int k = 0; k < 3; k++) {
+                        const SWClipVertex &v = clipBuffer.vertices[clipBuffer.triangles[t][k]];
+                        std::copy(v.position, v.position + 4, position[k]);
+                        varyings[k] = v.varyings;
+                        if (draw) {
+                            record.corners[k] = (uint32_t) draw->clippedCorners.size();
+                            draw->clippedCorners.push_back(v);
+                        }
+                    }
+                    emit(position, varyings, 1, record);
+                }
+            }
+        }
+    }
+
+    if (draw) // The resolve needs this draw's vertices, the next draw gets a fresh set
+        draw->vertices = std::move(vertices);
+}
+
+void SWRasterizer::runVertexStage(const SWProgram &program, const SWAttributeStreams &attributes,
+                                  const void *uniforms) {
+    vertices.resize(attributes.vertexCount, program.varyingComponents);
+
+    Float8 in[SW_MAX_ATTRIBUTES], position[4], out[SW_MAX_VARYINGS];
+    for (int v = 0; v < attributes.vertexCount; v += SW_LANES) {
+        for (int c = 0; c < program.attributeComponents; c++)
+            in[c] = f8Load(attributes.component(c) + v);
+        program.vertex(in, position, out, uniforms);
+        f8Store(&vertices.x[v], position[0]);
+        f8Store(&vertices.y[v], position[1]);
+        f8Store(&vertices.z[v], position[2]);
+        f8Store(&vertices.w[v], position[3]);
+        for (int c = 0; c < program.varyingComponents; c++)
+            f8Store(vertices.varying(c) + v, out[c]);
+    }
+}
+
+bool SWRasterizer::setupTriangle(const SWTransformedVertices &verts, uint32_t i0, uint32_t i1, uint32_t i2,
+                                 SWTriangleSetup &setup) const {
+    const uint32_t idx[3] = { i0, i1, i2 };
+    float position[3][4];
+    const float *varyings[3];
+    for (int k = 0; k < 3; k++) {
+        position[k][0] = verts.x[idx[k]];
+        position[k][1] = verts.y[idx[k]];
+        position[k][2] = verts.z[idx[k]];
+        position[k][3] = verts.w[idx[k]];
+        varyings[k] = verts.varyings.data() + idx[k];
+    }
+    return setupTriangle(position, varyings, (size_t) verts.capacity, verts.varyingCount, setup);
+}
+
+bool SWRasterizer::setupTriangle(const float position[3][4], const float *const varyings[3], size_t varyingStride,
+                                 int varyingCount, SWTriangleSetup &setup) const {
+    float sx[3], sy[3], sz[3], q[3];
+    for (int i = 0; i < 3; i++) {
+        float w = position[i][3];
+        if (w <= 1e-6f) // only possible for odd projections, the near plane clip normally keeps w positive
+            return false;
+        q[i] = 1.0f / w;
+        // Clip space -> NDC -> window coordinates (the glViewport transform)
+        sx[i] = (position[i][0] * q[i] * 0.5f + 0.5f) * (float) target->width;
+        sy[i] = (position[i][1] * q[i] * 0.5f + 0.5f) * (float) target->height;
+        sz[i] = position[i][2] * q[i] * 0.5f + 0.5f;
+    }
+
+    // Edge i is the one opposite vertex i, so E_i / area is vertex i's barycentric weight
+    for (int i = 0; i < 3; i++) {
+        int a = (i + 1) % 3, b = (i + 2) % 3;
+        setup.edgeA[i] = sy[a] - sy[b];
+        setup.edgeB[i] = sx[b] - sx[a];
+        setup.edgeC[i] = sx[a] * sy[b] - sx[b] * sy[a];
+    }
+    float area = setup.edgeC[0] + setup.edgeC[1] + setup.edgeC[2]; // = twice the signed area
+    if (std::fabs(area) < 1e-12f)
+        return false;
+    if (area < 0.0f) { // No culling, so just flip clockwise triangles round
+        for (int i = 0; i < 3; i++) {
+            setup.edgeA[i] = -setup.edgeA[i];
+            setup.edgeB[i] = -setup.edgeB[i];
+            setup.edgeC[i] = -setup.edgeC[i];
+        }
+        area = -area;
+    }
+    for (int i = 0; i < 3; i++)
+        setup.edgeInclusive[i] = setup.edgeA[i] > 0.0f || (setup.edgeA[i] == 0.0f && setup.edgeB[i] < 0.0f);
+
+    // Any per-vertex value f interpolates as sum(f_i * E_i) / area, which is itself a plane
+    float invArea = 1.0f / area;
+    float wA[3], wB[3], wC[3];
+    for (int i = 0; i < 3; i++) {
+        wA[i] = setup.edgeA[i] * invArea;
+        wB[i] = setup.edgeB[i] * invArea;
+        wC[i] = setup.edgeC[i] * invArea;
+    }
+    auto plane = [&](const float f[3], float &A, float &B, float &C) {
+        A = f[0] * wA[0] + f[1] * wA[1] + f[2] * wA[2];
+        B = f[0] * wB[0] + f[1] * wB[1] + f[2] * wB[2];
+        C = f[0] * wC[0] + f[1] * wC[1] + f[2] * wC[2];
+    };
+    plane(sz, setup.zA, setup.zB, setup.zC);
+    plane(q, setup.qA, setup.qB, setup.qC);
+    setup.varyingCount = varyingCount;
+    for (int c = 0; c < varyingCount; c++) {
+        const size_t offset = (size_t) c * varyingStride;
+        float f[3] = { varyings[0][offset] * q[0], varyings[1][offset] * q[1], varyings[2][offset] * q[2] };
+        plane(f, setup.vA[c], setup.vB[c], setup.vC[c]);
+    }
+
+    setup.minX = std::max(0, (int) std::floor(std::min({ sx[0], sx[1], sx[2] })));
+    setup.minY = std::max(0, (int) std::floor(std::min({ sy[0], sy[1], sy[2] })));
+    setup.maxX = std::min(target->width - 1, (int) std::ceil(std::max({ sx[0], sx[1], sx[2] })));
+    setup.maxY = std::min(target->height - 1, (int) std::ceil(std::max({ sy[0], sy[1], sy[2] })));
+    return setup.minX <= setup.maxX && setup.minY <= setup.maxY;
+}
+
+void SWRasterizer::rasterizeTriangle(const SWTriangleSetup &setup, SWFragmentKernel fragment, const void *uniforms) {
+    if (multisampleTarget) {
+        rasterizeMultisample(setup, fragment, uniforms);
+        return;
+    }
+    const Float8 width = f8Set1((float) target->width);
+    Float8 varyings[SW_MAX_VARYINGS], colour[4];
+
+    for (int y = setup.minY; y <= setup.maxY; y++) {
+        const float py = (float) y + 0.5f;
+        uint32_t *colourRow = &target->colour[(size_t) y * target->stride];
+        float *depthRow = &target->depth[(size_t) y * target->stride];
+
+        // Spans are 8-aligned so loads/stores line up with the padded rows
+        for (int x = setup.minX & ~(SW_LANES - 1); x <= setup.maxX; x += SW_LANES) {
+            const Float8 px = f8Ramp((float) x + 0.5f);
+
+            Float8 inside = swSpanCoverage(setup, px, py, width);
+            if (!f8MoveMask(inside))
+                continue;
+
+            const Float8 z = px * setup.zA + f8Set1(py * setup.zB + setup.zC);
+            if (depthTest)
+                inside = f8And(inside, f8Less(z, f8Load(depthRow + x)));
+            const int bits = f8MoveMask(inside);
+            if (!bits)
+                continue;
+
+            swInterpolateVaryings(setup, px, py, varyings);
+            fragment(varyings, colour, uniforms);
+            f8StoreRGBA8(colourRow + x, colour[0], colour[1], colour[2], colour[3], bits);
+            if (depthTest)
+                f8Store(depthRow + x, f8Select(inside, z, f8Load(depthRow + x)));
+            fragmentsShaded += (uint64_t) __builtin_popcount((unsigned) bits);
+        }
+    }
+}
+
+void SWRasterizer::rasterizeMultisample(const SWTriangleSetup &setup, SWFragmentKernel fragment,
+                                        const void *uniforms) {
+    SWMultisampleFramebuffer &msaa = *multisampleTarget;
+    const Float8 width = f8Set1((float) target->width);
+    const Float8 zero = f8Zero();
+    Float8 varyings[SW_MAX_VARYINGS], colour[4];
+    uint32_t packed[SW_LANES];
+
+    // Every plane is linear, so a sample's edge/depth values are the pixel centre's plus a per-triangle constant
+    float edgeOffset[8][3], zOffset[8];
+    for (int s = 0; s < msaa.samples; s++) {
+        for (int e = 0; e < 3; e++)
+            edgeOffset[s][e] = setup.edgeA[e] * msaa.sampleX[s] + setup.edgeB[e] * msaa.sampleY[s];
+        zOffset[s] = setup.zA * msaa.sampleX[s] + setup.zB * msaa.sampleY[s];
+    }
+
+    for (int y = setup.minY; y <= setup.maxY; y++) {
+        const float py = (float) y + 0.5f;
+        const size_t row = (size_t) y * msaa.stride;
+        for (int x = setup.minX & ~(SW_LANES - 1); x <= setup.maxX; x += SW_LANES) {
+            const Float8 px = f8Ramp((float) x + 0.5f);
+            const Float8 inViewport = f8Less(px, width);
+            Float8 edge[3];
+            for (int e = 0; e < 3; e++)
+                edge[e] = px * setup.edgeA[e] + f8Set1(py * setup.edgeB[e] + setup.edgeC[e]);
+            const Float8 centreZ = px * setup.zA + f8Set1(py * setup.zB + setup.zC);
+
+            // Coverage + depth per sample. sampleBits[s] has a bit per pixel
+            int sampleBits[8];
+            int anyBits = 0, fullBits = 0xFF;
+            for (int s = 0; s < msaa.samples; s++) {
+                Float8 inside = inViewport;
+                for (int e = 0; e < 3; e++) {
+                    const Float8 value = edge[e] + f8Set1(edgeOffset[s][e]);
+                    inside = f8And(inside, setup.edgeInclusive[e] ? f8GreaterEqual(value, zero) : f8Greater(value, zero));
+                }
+                const Float8 z = centreZ + f8Set1(zOffset[s]);
+                float *depth = &msaa.depth[(row + x) * msaa.samples + s * SW_LANES];
+                if (depthTest)
+                    inside = f8And(inside, f8Less(z, f8Load(depth)));
+                sampleBits[s] = f8MoveMask(inside);
+                if (depthTest && sampleBits[s])
+                    f8Store(depth, f8Select(inside, z, f8Load(depth)));
+                anyBits |= sampleBits[s];
+                fullBits &= sampleBits[s];
+            }
+            if (!anyBits)
+                continue;
+
+            // Shade once per pixel, at the centre, and copy the result to every covered sample
+            swInterpolateVaryings(setup, px, py, varyings);
+            fragment(varyings, colour, uniforms);
+            fragmentsShaded += (uint64_t) __builtin_popcount((unsigned) anyBits);
+
+            // Pixels with every sample covered (the inside of the triangle) just get the shared colour,
+            // only edge pixels need the per-sample bookkeeping
+            f8StoreRGBA8(&msaa.colour[row + x], colour[0], colour[1], colour[2], colour[3], fullBits);
+            const int partialBits = anyBits & ~fullBits;
+            for (int l = 0; l < SW_LANES; l++) {
+                if (((fullBits >> l) & 1) && msaa.slot[row + x + l] != SW_MSAA_UNIFORM)
+                    msaa.writeSamples(row + x + l, msaa.colour[row + x + l], (1 << msaa.samples) - 1);
+            }
+            if (!partialBits)
+                continue;
+            f8StoreRGBA8(packed, colour[0], colour[1], colour[2], colour[3], 0xFF);
+            for (int l = 0; l < SW_LANES; l++) {
+                if (!((partialBits >> l) & 1))
+                    continue;
+                int mask = 0;
+                for (int s = 0; s < msaa.samples; s++)
+                    mask |= ((sampleBits[s] >> l) & 1) << s;
+                msaa.writeSamples(row + x + l, packed[l], mask);
+            }
+        }
+    }
+}
+
+void SWRasterizer::rasterizeVisibility(const SWTriangleSetup &setup, uint32_t id) {
+    const Float8 width = f8Set1((float) target->width);
+    // IDs ride through the float select as raw bits
+    float idBits;
+    std::memcpy(&idBits, &id, sizeof(idBits));
+    const Float8 idLanes = f8Set1(idBits);
+
+    for (int y = setup.minY; y <= setup.maxY; y++) {
+        const float py = (float) y + 0.5f;
+        float *idRow = reinterpret_cast<float *>(&visibilityIds[(size_t) y * target->stride]);
+        float *depthRow = &target->depth[(size_t) y * target->stride];
+        for (int x = setup.minX & ~(SW_LANES - 1); x <= setup.maxX; x += SW_LANES) {
+            const Float8 px = f8Ramp((float) x + 0.5f);
+            Float8 inside = swSpanCoverage(setup, px, py, width);
+            if (!f8MoveMask(inside))
+                continue;
+            const Float8 z = px * setup.zA + f8Set1(py * setup.zB + setup.zC);
+            if (depthTest)
+                inside = f8And(inside, f8Less(z, f8Load(depthRow + x)));
+            const int bits = f8MoveMask(inside);
+            if (!bits)
+                continue;
+            f8Store(idRow + x, f8Select(inside, idLanes, f8Load(idRow + x)));
+            f8Store(depthRow + x, f8Select(inside, z, f8Load(depthRow + x)));
+            visibilityFragments += (uint64_t) __builtin_popcount((unsigned) bits);
+        }
+    }
+}
+
+void SWRasterizer::resolveVisibility(int threadCount) {
+    const int width = target->width, height = target->height, stride = target->stride;
+
+    // 1. Find the triangles that survived the depth test, and give each a slot for its full setup
+    std::vector<std::vector<uint32_t>> slots(visibilityDraws.size());
+    for (size_t d = 0; d < visibilityDraws.size(); d++)
+        slots[d].assign(visibilityDraws[d].triangles.size(), SW_VISIBILITY_EMPTY);
+    std::vector<uint32_t> visible; // IDs
+    for (int y = 0; y < height; y++) {
+        const uint32_t *row = &visibilityIds[(size_t) y * stride];
+        for (int x = 0; x < width; x++) {
+            const uint32_t id = row[x];
+            if (id == SW_VISIBILITY_EMPTY)
+                continue;
+            uint32_t &slot = slots[id >> SW_VISIBILITY_TRIANGLE_BITS][id & ((1u << SW_VISIBILITY_TRIANGLE_BITS) - 1)];
+            if (slot == SW_VISIBILITY_EMPTY) {
+                slot = (uint32_t) visible.size();
+                visible.push_back(id);
+            }
+        }
+    }
+
+    // 2. Full triangle setup (with varyings this time), only for visible triangles
+    std::vector<SWTriangleSetup> setups(visible.size());
+    const int setupBlock = 256;
+    parallelBlocks((visible.size() + setupBlock - 1) / setupBlock, [&](size_t block) {
+        const size_t end = std::min(visible.size(), (size_t) (block + 1) * setupBlock);
+        for (size_t i = (size_t) block * setupBlock; i < end; i++) {
+            const SWVisibilityDraw &draw = visibilityDraws[visible[i] >> SW_VISIBILITY_TRIANGLE_BITS];
+            const SWVisibilityTriangle &tri = draw.triangles[visible[i] & ((1u << SW_VISIBILITY_TRIANGLE_BITS) - 1)];
+            if (!tri.clipped) {
+                setupTriangle(draw.vertices, tri.corners[0], tri.corners[1], tri.corners[2], setups[i]);
+                continue;
+            }
+            float position[3][4];
+            const float *varyings[3];
+            for (int k = 0; k < 3; k++) {
+                const SWClipVertex &v = draw.clippedCorners[tri.corners[k]];
+                std::copy(v.position, v.position + 4, position[k]);
+                varyings[k] = v.varyings;
+            }
+            setupTriangle(position, varyings, 1, draw.vertices.varyingCount, setups[i]);
+        }
+    }, threadCount);
+
+    // 3. Shade. Each 8 pixel span runs the fragment kernel once per distinct triangle in it,
+    // with only that triangle's pixels written, so every visible pixel is shaded exactly once.
+    std::atomic<uint64_t> shaded(0);
+    const int rowBlock = 8;
+    parallelBlocks((size_t) (height + rowBlock - 1) / rowBlock, [&](size_t blockIndex) {
+        const int block = (int) blockIndex;
+        Float8 varyings[SW_MAX_VARYINGS], colour[4];
+        uint64_t localShaded = 0;
+        for (int y = block * rowBlock; y < std::min(height, (block + 1) * rowBlock); y++) {
+            const float py = (float) y + 0.5f;
+            const uint32_t *idRow = &visibilityIds[(size_t) y * stride];
+            uint32_t *colourRow = &target->colour[(size_t) y * stride];
+            for (int x = 0; x < width; x += SW_LANES) {
+                int pending = 0;
+                for (int l = 0; l < SW_LANES && x + l < width; l++)
+                    pending |= (idRow[x + l] != SW_VISIBILITY_EMPTY) << l;
+                const Float8 px = f8Ramp((float) x + 0.5f);
+                while (pending) {
+                    const uint32_t id = idRow[x + __builtin_ctz((unsigned) pending)];
+                    int bits = 0;
+                    for (int l = 0; l < SW_LANES; l++)
+                        bits |= (((pending >> l) & 1) && idRow[x + l] == id) << l;
+                    pending &= ~bits;
+
+                    const SWVisibilityDraw &draw = visibilityDraws[id >> SW_VISIBILITY_TRIANGLE_BITS];
+                    const SWTriangleSetup &setup = setups[slots[id >> SW_VISIBILITY_TRIANGLE_BITS]
+                                                          [id & ((1u << SW_VISIBILITY_TRIANGLE_BITS) - 1)]];
+                    swInterpolateVaryings(setup, px, py, varyings);
+                    draw.program->fragment(varyings, colour, draw.uniforms);
+                    f8StoreRGBA8(colourRow + x, colour[0], colour[1], colour[2], colour[3], bits);
+                    localShaded += (uint64_t) __builtin_popcount((unsigned) bits);
+                }
+            }
+        }
+        shaded += localShaded;
+    }, threadCount);
+
+    visibilityStats.fragmentsRasterized = visibilityFragments;
+    visibilityStats.pixelsShaded = shaded;
+    visibilityStats.trianglesVisible = visible.size();
+    visibilityStats.trianglesRecorded = 0;
+    for (const SWVisibilityDraw &draw : visibilityDraws)
+        visibilityStats.trianglesRecorded += draw.triangles.size();
+
+    // Ready for the next frame
+    std::fill(visibilityIds.begin(), visibilityIds.end(), SW_VISIBILITY_EMPTY);
+    visibilityDraws.clear();
+    visibilityFragments = 0;
+}
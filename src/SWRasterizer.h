@@ -0,0 +1,142 @@
+#ifndef OPENGLPLAYGROUND_SWRASTERIZER_H
+#define OPENGLPLAYGROUND_SWRASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+#include "SWClipper.h"
+#include "SWSimd.h"
+#include "SWVertexSoA.h"
+
+// Colour + depth target for the CPU backend.
+// Rows go bottom to top like a GL framebuffer, and each row is padded to a multiple of 8 pixels
+// so a span of 8 never has to be split at the right edge.
+class SWFramebuffer {
+public:
+    int width, height;
+    int stride; // pixels per row, width padded to lanes
+    std::vector<uint32_t> colour; // RGBA8, R in the low byte (same bytes as GL_RGBA / GL_UNSIGNED_BYTE)
+    std::vector<float> depth;
+
+    SWFramebuffer(int width, int height);
+    void clear(float r, float g, float b, float a);
+    void clearDepth(float value = 1.0f);
+    // Writes a binary PPM (top row first), returns false if the file can't be opened
+    bool writePPM(const char *path) const;
+};
+
+// Everything the raster loop needs about one triangle, computed once in setup.
+// Every quantity is a plane a*x + b*y + c over window coordinates, so per pixel it is just two multiply-adds.
+struct SWTriangleSetup {
+    int minX, minY, maxX, maxY;      // pixel bounding box, clamped to the framebuffer
+    float edgeA[3], edgeB[3], edgeC[3]; // edge functions, >= 0 inside
+    bool edgeInclusive[3];           // top-left fill rule: pixels exactly on the edge belong to top/left edges
+    float zA, zB, zC;                // window space depth
+    float qA, qB, qC;                // 1/w, which is linear in screen space (w itself isn't)
+    int varyingCount;
+    float vA[SW_MAX_VARYINGS], vB[SW_MAX_VARYINGS], vC[SW_MAX_VARYINGS]; // varying/w
+};
+
+// Visibility buffer IDs: the top 8 bits say which draw call (instance), the low 24 which of its triangles
+#define SW_VISIBILITY_TRIANGLE_BITS 24
+#define SW_VISIBILITY_MAX_DRAWS 255
+#define SW_VISIBILITY_EMPTY 0xFFFFFFFFu
+
+// A triangle recorded in visibility mode, enough to rebuild its varyings when resolving
+struct SWVisibilityTriangle {
+    uint32_t corners[3];
+    bool clipped; // corners index SWVisibilityDraw::clippedCorners rather than the transformed vertices
+};
+
+// Everything a draw call leaves behind in visibility mode until resolveVisibility()
+struct SWVisibilityDraw {
+    const SWProgram *program;
+    const void *uniforms;
+    SWTransformedVertices vertices;
+    std::vector<SWClipVertex> clippedCorners;
+    std::vector<SWVisibilityTriangle> triangles;
+};
+
+struct SWVisibilityStats {
+    uint64_t fragmentsRasterized = 0; // pixels that passed the depth test while rasterizing, i.e. what forward shading pays for
+    uint64_t pixelsShaded = 0;        // what the resolve actually shaded
+    uint64_t trianglesRecorded = 0;
+    uint64_t trianglesVisible = 0;
+
+    // How many times over a forward renderer would have shaded each visible pixel
+    double overdraw() const { return pixelsShaded ? (double) fragmentsRasterized / (double) pixelsShaded : 0.0; }
+};
+
+class SWMultisampleFramebuffer;
+
+class SWRasterizer {
+public:
+    SWFramebuffer *target;
+    bool depthTest = true;
+    // When set (same size as target), triangles are rasterized into this instead of target: coverage and
+    // depth per sample, but the fragment kernel still runs once per pixel per triangle. Call
+    // multisampleTarget->resolve(*target) at the end of the frame.
+    SWMultisampleFramebuffer *multisampleTarget = nullptr;
+
+    // Counters for the last draw call
+    uint64_t trianglesIn = 0;
+    uint64_t trianglesCulled = 0;  // rejected by the outcode test
+    uint64_t trianglesClipped = 0; // had to go through the clipper (so should be rare)
+    uint64_t trianglesRasterized = 0;
+    uint64_t fragmentsShaded = 0;
+
+    // Visibility buffer mode: drawElements only writes depth + a 32 bit draw/triangle ID per pixel, and
+    // resolveVisibility() later runs the fragment kernel exactly once per visible pixel, however deep the
+    // overdraw was. The uniforms passed to drawElements have to stay alive until the resolve.
+    bool visibilityMode = false;
+    SWVisibilityStats visibilityStats; // from the last resolveVisibility()
+
+    explicit SWRasterizer(SWFramebuffer &target);
+
+    // The CPU version of glDrawElements(GL_TRIANGLES, ...)
+    void drawElements(const SWProgram &program, const SWAttributeStreams &attributes,
+                      const uint32_t *indices, int count, const void *uniforms);
+    // Shades the visibility buffer into the colour target on `threadCount` threads (0 = one per core)
+    void resolveVisibility(int threadCount = 0);
+
+    // Pieces of the pipeline, exposed so other passes can reuse them
+    void runVertexStage(const SWProgram &program, const SWAttributeStreams &attributes, const void *uniforms);
+    bool setupTriangle(const SWTransformedVertices &verts, uint32_t i0, uint32_t i1, uint32_t i2,
+                       SWTriangleSetup &setup) const;
+    // Same thing for corners that don't live in the SoA arrays (clipper output).
+    // Varying c of corner k is varyings[k][c * varyingStride].
+    bool setupTriangle(const float position[3][4], const float *const varyings[3], size_t varyingStride,
+                       int varyingCount, SWTriangleSetup &setup) const;
+    void rasterizeTriangle(const SWTriangleSetup &setup, SWFragmentKernel fragment, const void *uniforms);
+
+    const SWTransformedVertices &transformed() const { return vertices; }
+
+private:
+    SWTransformedVertices vertices;
+    std::vector<uint32_t> visibilityIds; // same layout as the framebuffer
+    std::vector<SWVisibilityDraw> visibilityDraws;
+    uint64_t visibilityFragments = 0;
+
+    void rasterizeVisibility(const SWTriangleSetup &setup, uint32_t id);
+    void rasterizeMultisample(const SWTriangleSetup &setup, SWFragmentKernel fragment, const void *uniforms);
+};
+
+// Coverage of the 8 pixels starting at x on the row through py, before any depth test
+inline Float8 swSpanCoverage(const SWTriangleSetup &setup, Float8 px, float py, Float8 width) {
+    const Float8 zero = f8Zero();
+    Float8 inside = f8Less(px, width);
+    for (int e = 0; e < 3; e++) {
+        Float8 edge = px * setup.edgeA[e] + f8Set1(py * setup.edgeB[e] + setup.edgeC[e]);
+        inside = f8And(inside, setup.edgeInclusive[e] ? f8GreaterEqual(edge, zero) : f8Greater(edge, zero));
+    }
+    return inside;
+}
+
+// Perspective correct interpolation: interpolate v/w and 1/w linearly, then divide.
+// One reciprocal per pixel, then one multiply-add pair + one multiply per varying component.
+inline void swInterpolateVaryings(const SWTriangleSetup &setup, Float8 px, float py, Float8 *varyings) {
+    const Float8 w = f8Set1(1.0f) / (px * setup.qA + f8Set1(py * setup.qB + setup.qC));
+    for (int c = 0; c < setup.varyingCount; c++)
+        varyings[c] = (px * setup.vA[c] + f8Set1(py * setup.vB[c] + setup.vC[c])) * w;
+}
+
+#endif //OPENGLPLAYGROUND_SWRASTERIZER_H
@@ -0,0 +1,260 @@
+#ifndef OPENGLPLAYGROUND_SWSHADERLANGUAGE_H
+#define OPENGLPLAYGROUND_SWSHADERLANGUAGE_H
+
+// GLSL types and built-ins for the CPU backend, 8 lanes wide.
+// ShaderTranslator copies the bodies of our .glsl files almost verbatim into C++, and this header is what
+// makes that compile: `float`, `vec2`, `vec3` and `vec4` are 8 values each (one per pixel / vertex), while
+// uniforms stay plain glm types since they're the same for every lane.
+//
+// Things that don't translate (yet):
+// - Branching on per-lane values (`if (x > 0.5)`). Use step/mix/clamp instead, like you would for speed on a GPU.
+// - Swizzle writes (`v.xy = ...`). Swizzle reads are fine, the translator turns `v.zyx` into `v.swz<2,1,0>()`.
+// - Per-lane matrices. mat3/mat4 are glm matrices, so they have to come from uniforms or constants.
+
+#include <cmath>
+#include <glm/glm.hpp>
+#include "SWSimd.h"
+
+namespace swsl {
+
+// GLSL float. Implicitly converts from a C++ float so `x * 2.0f` and `vec4(Colour, 1.0f)` just work
+struct Float {
+    Float8 v;
+
+    Float() : v(f8Zero()) {}
+    Float(float f) : v(f8Set1(f)) {}
+    Float(double d) : v(f8Set1((float) d)) {}
+    Float(int i) : v(f8Set1((float) i)) {}
+    Float(Float8 f) : v(f) {}
+
+    Float &operator+=(Float o) { v = v + o.v; return *this; }
+    Float &operator-=(Float o) { v = v - o.v; return *this; }
+    Float &operator*=(Float o) { v = v * o.v; return *this; }
+    Float &operator/=(Float o) { v = v / o.v; return *this; }
+};
+
+inline Float operator+(Float a, Float b) { return a.v + b.v; }
+inline Float operator-(Float a, Float b) { return a.v - b.v; }
+inline Float operator*(Float a, Float b) { return a.v * b.v; }
+inline Float operator/(Float a, Float b) { return a.v / b.v; }
+inline Float operator-(Float a) { return -a.v; }
+
+// Applies a scalar function lane by lane, for the built-ins that have no SIMD instruction
+template<typename F>
+inline Float perLane(Float a, F f) {
+    float tmp[SW_LANES];
+    f8Store(tmp, a.v);
+    for (int i = 0; i < SW_LANES; i++)
+        tmp[i] = f(tmp[i]);
+    return f8Load(tmp);
+}
+
+struct vec3;
+struct vec4;
+
+struct vec2 {
+    Float x, y;
+
+    vec2() {}
+    explicit vec2(Float s) : x(s), y(s) {}
+    vec2(Float x, Float y) : x(x), y(y) {}
+    vec2(const glm::vec2 &g) : x(g.x), y(g.y) {}
+    explicit vec2(const vec3 &v);
+    explicit vec2(const vec4 &v);
+
+    Float operator[](int i) const { return i == 0 ? x : y; }
+    template<int A, int B> vec2 swz() const;
+    template<int A, int B, int C> vec3 swz() const;
+    template<int A, int B, int C, int D> vec4 swz() const;
+};
+
+struct vec3 {
+    Float x, y, z;
+
+    vec3() {}
+    explicit vec3(Float s) : x(s), y(s), z(s) {}
+    vec3(Float x, Float y, Float z) : x(x), y(y), z(z) {}
+    vec3(const vec2 &v, Float z) : x(v.x), y(v.y), z(z) {}
+    vec3(Float x, const vec2 &v) : x(x), y(v.x), z(v.y) {}
+    vec3(const glm::vec3 &g) : x(g.x), y(g.y), z(g.z) {}
+    explicit vec3(const vec4 &v);
+
+    Float operator[](int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+    template<int A, int B> vec2 swz() const;
+    template<int A, int B, int C> vec3 swz() const;
+    template<int A, int B, int C, int D> vec4 swz() const;
+};
+
+struct vec4 {
+    Float x, y, z, w;
+
+    vec4() {}
+    explicit vec4(Float s) : x(s), y(s), z(s), w(s) {}
+    vec4(Float x, Float y, Float z, Float w) : x(x), y(y), z(z), w(w) {}
+    vec4(const vec3 &v, Float w) : x(v.x), y(v.y), z(v.z), w(w) {}
+    vec4(const vec2 &v, Float z, Float w) : x(v.x), y(v.y), z(z), w(w) {}
+    vec4(const vec2 &a, const vec2 &b) : x(a.x), y(a.y), z(b.x), w(b.y) {}
+    vec4(const glm::vec4 &g) : x(g.x), y(g.y), z(g.z), w(g.w) {}
+
+    Float operator[](int i) const { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+    template<int A, int B> vec2 swz() const;
+    template<int A, int B, int C> vec3 swz() const;
+    template<int A, int B, int C, int D> vec4 swz() const;
+};
+
+inline vec2::vec2(const vec3 &v) : x(v.x), y(v.y) {}
+inline vec2::vec2(const vec4 &v) : x(v.x), y(v.y) {}
+inline vec3::vec3(const vec4 &v) : x(v.x), y(v.y), z(v.z) {}
+
+#define SWSL_SWIZZLES(T) \
+    template<int A, int B> inline vec2 T::swz() const { return vec2((*this)[A], (*this)[B]); } \
+    template<int A, int B, int C> inline vec3 T::swz() const { return vec3((*this)[A], (*this)[B], (*this)[C]); } \
+    template<int A, int B, int C, int D> inline vec4 T::swz() const { \
+        return vec4((*this)[A], (*this)[B], (*this)[C], (*this)[D]); \
+    }
+SWSL_SWIZZLES(vec2)
+SWSL_SWIZZLES(vec3)
+SWSL_SWIZZLES(vec4)
+#undef SWSL_SWIZZLES
+
+// Component-wise helpers, so every operator and built-in below is written once for all three sizes
+template<typename F> inline vec2 map(const vec2 &a, F f) { return vec2(f(a.x), f(a.y)); }
+template<typename F> inline vec3 map(const vec3 &a, F f) { return vec3(f(a.x), f(a.y), f(a.z)); }
+template<typename F> inline vec4 map(const vec4 &a, F f) { return vec4(f(a.x), f(a.y), f(a.z), f(a.w)); }
+template<typename F> inline vec2 zip(const vec2 &a, const vec2 &b, F f) { return vec2(f(a.x, b.x), f(a.y, b.y)); }
+template<typename F> inline vec3 zip(const vec3 &a, const vec3 &b, F f) {
+    return vec3(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z));
+}
+template<typename F> inline vec4 zip(const vec4 &a, const vec4 &b, F f) {
+    return vec4(f(a.x, b.x), f(a.y, b.y), f(a.z, b.z), f(a.w, b.w));
+}
+
+#define SWSL_VECTOR_OPERATORS(T) \
+    inline T operator+(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return x + y; }); } \
+    inline T operator-(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return x - y; }); } \
+    inline T operator*(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return x * y; }); } \
+    inline T operator/(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return x / y; }); } \
+    inline T operator+(const T &a, Float s) { return a + T(s); } \
+    inline T operator-(const T &a, Float s) { return a - T(s); } \
+    inline T operator*(const T &a, Float s) { return a * T(s); } \
+    inline T operator/(const T &a, Float s) { return a / T(s); } \
+    inline T operator+(Float s, const T &a) { return T(s) + a; } \
+    inline T operator-(Float s, const T &a) { return T(s) - a; } \
+    inline T operator*(Float s, const T &a) { return T(s) * a; } \
+    inline T operator/(Float s, const T &a) { return T(s) / a; } \
+    inline T operator-(const T &a) { return map(a, [](Float x) { return -x; }); } \
+    inline T &operator+=(T &a, const T &b) { a = a + b; return a; } \
+    inline T &operator-=(T &a, const T &b) { a = a - b; return a; } \
+    inline T &operator*=(T &a, const T &b) { a = a * b; return a; } \
+    inline T &operator/=(T &a, const T &b) { a = a / b; return a; } \
+    inline T &operator*=(T &a, Float s) { a = a * s; return a; } \
+    inline T &operator/=(T &a, Float s) { a = a / s; return a; }
+SWSL_VECTOR_OPERATORS(vec2)
+SWSL_VECTOR_OPERATORS(vec3)
+SWSL_VECTOR_OPERATORS(vec4)
+#undef SWSL_VECTOR_OPERATORS
+
+// Matrices are uniform (glm, column major) and multiply lane vectors
+typedef glm::mat3 mat3;
+typedef glm::mat4 mat4;
+
+inline vec4 operator*(const glm::mat4 &m, const vec4 &v) {
+    vec4 r;
+    r.x = v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0] + v.w * m[3][0];
+    r.y = v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1] + v.w * m[3][1];
+    r.z = v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2] + v.w * m[3][2];
+    r.w = v.x * m[0][3] + v.y * m[1][3] + v.z * m[2][3] + v.w * m[3][3];
+    return r;
+}
+
+inline vec3 operator*(const glm::mat3 &m, const vec3 &v) {
+    vec3 r;
+    r.x = v.x * m[0][0] + v.y * m[1][0] + v.z * m[2][0];
+    r.y = v.x * m[0][1] + v.y * m[1][1] + v.z * m[2][1];
+    r.z = v.x * m[0][2] + v.y * m[1][2] + v.z * m[2][2];
+    return r;
+}
+
+// Built-ins. Scalar versions first, then vector versions built from them
+inline Float min(Float a, Float b) { return f8Min(a.v, b.v); }
+inline Float max(Float a, Float b) { return f8Max(a.v, b.v); }
+inline Float clamp(Float x, Float lo, Float hi) { return min(max(x, lo), hi); }
+inline Float mix(Float a, Float b, Float t) { return a + (b - a) * t; }
+inline Float step(Float edge, Float x) { return f8Select(f8Less(x.v, edge.v), f8Zero(), f8Set1(1.0f)); }
+inline Float smoothstep(Float e0, Float e1, Float x) {
+    Float t = clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+inline Float sqrt(Float a) { return f8Sqrt(a.v); }
+inline Float inversesqrt(Float a) { return 1.0f / sqrt(a); }
+inline Float abs(Float a) { return max(a, -a); }
+inline Float sign(Float a) {
+    return f8Select(f8Greater(a.v, f8Zero()), f8Set1(1.0f), f8Select(f8Less(a.v, f8Zero()), f8Set1(-1.0f), f8Zero()));
+}
+inline Float floor(Float a) { return perLane(a, [](float x) { return std::floor(x); }); }
+inline Float ceil(Float a) { return perLane(a, [](float x) { return std::ceil(x); }); }
+inline Float fract(Float a) { return a - floor(a); }
+inline Float mod(Float a, Float b) { return a - b * floor(a / b); }
+inline Float sin(Float a) { return perLane(a, [](float x) { return std::sin(x); }); }
+inline Float cos(Float a) { return perLane(a, [](float x) { return std::cos(x); }); }
+inline Float tan(Float a) { return perLane(a, [](float x) { return std::tan(x); }); }
+inline Float exp(Float a) { return perLane(a, [](float x) { return std::exp(x); }); }
+inline Float log(Float a) { return perLane(a, [](float x) { return std::log(x); }); }
+inline Float exp2(Float a) { return perLane(a, [](float x) { return std::exp2(x); }); }
+inline Float log2(Float a) { return perLane(a, [](float x) { return std::log2(x); }); }
+inline Float pow(Float a, Float b) {
+    float x[SW_LANES], y[SW_LANES];
+    f8Store(x, a.v);
+    f8Store(y, b.v);
+    for (int i = 0; i < SW_LANES; i++)
+        x[i] = std::pow(x[i], y[i]);
+    return f8Load(x);
+}
+
+#define SWSL_VECTOR_BUILTINS(T) \
+    inline T min(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return min(x, y); }); } \
+    inline T max(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return max(x, y); }); } \
+    inline T min(const T &a, Float b) { return min(a, T(b)); } \
+    inline T max(const T &a, Float b) { return max(a, T(b)); } \
+    inline T clamp(const T &x, const T &lo, const T &hi) { return min(max(x, lo), hi); } \
+    inline T clamp(const T &x, Float lo, Float hi) { return min(max(x, T(lo)), T(hi)); } \
+    inline T mix(const T &a, const T &b, Float t) { return a + (b - a) * t; } \
+    inline T mix(const T &a, const T &b, const T &t) { return a + (b - a) * t; } \
+    inline T step(Float edge, const T &x) { return map(x, [&](Float c) { return step(edge, c); }); } \
+    inline T step(const T &edge, const T &x) { return zip(edge, x, [](Float e, Float c) { return step(e, c); }); } \
+    inline T smoothstep(Float e0, Float e1, const T &x) { return map(x, [&](Float c) { return smoothstep(e0, e1, c); }); } \
+    inline T pow(const T &a, const T &b) { return zip(a, b, [](Float x, Float y) { return pow(x, y); }); } \
+    inline T mod(const T &a, Float b) { return map(a, [&](Float x) { return mod(x, b); }); } \
+    inline T sqrt(const T &a) { return map(a, [](Float x) { return sqrt(x); }); } \
+    inline T inversesqrt(const T &a) { return map(a, [](Float x) { return inversesqrt(x); }); } \
+    inline T abs(const T &a) { return map(a, [](Float x) { return abs(x); }); } \
+    inline T sign(const T &a) { return map(a, [](Float x) { return sign(x); }); } \
+    inline T floor(const T &a) { return map(a, [](Float x) { return floor(x); }); } \
+    inline T ceil(const T &a) { return map(a, [](Float x) { return ceil(x); }); } \
+    inline T fract(const T &a) { return map(a, [](Float x) { return fract(x); }); } \
+    inline T sin(const T &a) { return map(a, [](Float x) { return sin(x); }); } \
+    inline T cos(const T &a) { return map(a, [](Float x) { return cos(x); }); } \
+    inline T exp(const T &a) { return map(a, [](Float x) { return exp(x); }); } \
+    inline T log(const T &a) { return map(a, [](Float x) { return log(x); }); } \
+    inline Float length(const T &a) { return sqrt(dot(a, a)); } \
+    inline Float distance(const T &a, const T &b) { return length(a - b); } \
+    inline T normalize(const T &a) { return a * inversesqrt(dot(a, a)); } \
+    inline T reflect(const T &i, const T &n) { return i - 2.0f * dot(n, i) * n; }
+
+inline Float dot(const vec2 &a, const vec2 &b) { return a.x * b.x + a.y * b.y; }
+inline Float dot(const vec3 &a, const vec3 &b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Float dot(const vec4 &a, const vec4 &b) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+inline vec3 cross(const vec3 &a, const vec3 &b) {
+    return vec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+inline Float length(Float a) { return abs(a); }
+inline Float normalize(Float a) { return sign(a); }
+
+SWSL_VECTOR_BUILTINS(vec2)
+SWSL_VECTOR_BUILTINS(vec3)
+SWSL_VECTOR_BUILTINS(vec4)
+#undef SWSL_VECTOR_BUILTINS
+
+} // namespace swsl
+
+#endif //OPENGLPLAYGROUND_SWSHADERLANGUAGE_H
@@ -0,0 +1,203 @@
+#ifndef OPENGLPLAYGROUND_SWSIMD_H
+#define OPENGLPLAYGROUND_SWSIMD_H
+
+// 8-wide float lanes for the software (CPU) backend.
+// Everything in the CPU backend works on 8 pixels / 8 vertices at a time, so this is the one place that
+// knows about intrinsics. On x86-64 SSE2 is always there, so a Float8 is two __m128 halves. Anywhere else
+// (arm64 Macs, for now) it falls back to a plain float[8] that the compiler can usually auto-vectorize.
+// Masks are Float8 values whose lanes are either all-ones or all-zeros bits, just like SSE compares.
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SW_SIMD_SSE2 1
+#else
+#define SW_SIMD_SSE2 0
+#endif
+
+#define SW_LANES 8
+
+struct Float8 {
+#if SW_SIMD_SSE2
+    __m128 lo, hi;
+#else
+    float v[SW_LANES];
+#endif
+};
+
+#if SW_SIMD_SSE2
+
+inline Float8 f8Make(__m128 lo, __m128 hi) { Float8 r; r.lo = lo; r.hi = hi; return r; }
+
+inline Float8 f8Set1(float x) { return f8Make(_mm_set1_ps(x), _mm_set1_ps(x)); }
+inline Float8 f8Zero() { return f8Make(_mm_setzero_ps(), _mm_setzero_ps()); }
+inline Float8 f8Load(const float *p) { return f8Make(_mm_loadu_ps(p), _mm_loadu_ps(p + 4)); }
+inline void f8Store(float *p, Float8 a) { _mm_storeu_ps(p, a.lo); _mm_storeu_ps(p + 4, a.hi); }
+// Two 4-float halves from different places: two RGBA pixels at a time (the mip builder)
+inline Float8 f8LoadHalves(const float *lo, const float *hi) { return f8Make(_mm_loadu_ps(lo), _mm_loadu_ps(hi)); }
+// a in lanes 0-3, b in lanes 4-7
+inline Float8 f8Set2(float a, float b) { return f8Make(_mm_set1_ps(a), _mm_set1_ps(b)); }
+// base, base + 1, ..., base + 7 -> the x coordinate of each pixel in a span
+inline Float8 f8Ramp(float base) {
+    return f8Make(_mm_add_ps(_mm_set1_ps(base), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f)),
+                  _mm_add_ps(_mm_set1_ps(base), _mm_setr_ps(4.0f, 5.0f, 6.0f, 7.0f)));
+}
+
+inline Float8 operator+(Float8 a, Float8 b) { return f8Make(_mm_add_ps(a.lo, b.lo), _mm_add_ps(a.hi, b.hi)); }
+inline Float8 operator-(Float8 a, Float8 b) { return f8Make(_mm_sub_ps(a.lo, b.lo), _mm_sub_ps(a.hi, b.hi)); }
+inline Float8 operator*(Float8 a, Float8 b) { return f8Make(_mm_mul_ps(a.lo, b.lo), _mm_mul_ps(a.hi, b.hi)); }
+inline Float8 operator/(Float8 a, Float8 b) { return f8Make(_mm_div_ps(a.lo, b.lo), _mm_div_ps(a.hi, b.hi)); }
+inline Float8 operator-(Float8 a) { return f8Make(_mm_sub_ps(_mm_setzero_ps(), a.lo), _mm_sub_ps(_mm_setzero_ps(), a.hi)); }
+
+inline Float8 f8Min(Float8 a, Float8 b) { return f8Make(_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)); }
+inline Float8 f8Max(Float8 a, Float8 b) { return f8Make(_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)); }
+inline Float8 f8Sqrt(Float8 a) { return f8Make(_mm_sqrt_ps(a.lo), _mm_sqrt_ps(a.hi)); }
+
+inline Float8 f8Less(Float8 a, Float8 b) { return f8Make(_mm_cmplt_ps(a.lo, b.lo), _mm_cmplt_ps(a.hi, b.hi)); }
+inline Float8 f8LessEqual(Float8 a, Float8 b) { return f8Make(_mm_cmple_ps(a.lo, b.lo), _mm_cmple_ps(a.hi, b.hi)); }
+inline Float8 f8Greater(Float8 a, Float8 b) { return f8Make(_mm_cmpgt_ps(a.lo, b.lo), _mm_cmpgt_ps(a.hi, b.hi)); }
+inline Float8 f8GreaterEqual(Float8 a, Float8 b) { return f8Make(_mm_cmpge_ps(a.lo, b.lo), _mm_cmpge_ps(a.hi, b.hi)); }
+inline Float8 f8Equal(Float8 a, Float8 b) { return f8Make(_mm_cmpeq_ps(a.lo, b.lo), _mm_cmpeq_ps(a.hi, b.hi)); }
+
+inline Float8 f8And(Float8 a, Float8 b) { return f8Make(_mm_and_ps(a.lo, b.lo), _mm_and_ps(a.hi, b.hi)); }
+inline Float8 f8Or(Float8 a, Float8 b) { return f8Make(_mm_or_ps(a.lo, b.lo), _mm_or_ps(a.hi, b.hi)); }
+// (~a) & b, same argument order as _mm_andnot_ps
+inline Float8 f8AndNot(Float8 a, Float8 b) { return f8Make(_mm_andnot_ps(a.lo, b.lo), _mm_andnot_ps(a.hi, b.hi)); }
+// mask ? a : b
+inline Float8 f8Select(Float8 mask, Float8 a, Float8 b) { return f8Or(f8And(mask, a), f8AndNot(mask, b)); }
+// One bit per lane, lane 0 in bit 0
+inline int f8MoveMask(Float8 mask) { return _mm_movemask_ps(mask.lo) | (_mm_movemask_ps(mask.hi) << 4); }
+// Every lane the sum of the four in its half (lanes 0-3 and 4-7): a dot product per half after a multiply,
+// for things that hold two 4-vectors at once
+inline __m128 swSum4(__m128 a) {
+    const __m128 pairs = _mm_add_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+inline Float8 f8HalfSums(Float8 a) { return f8Make(swSum4(a.lo), swSum4(a.hi)); }
+
+// Expands the low 8 bits of `bits` into a lane mask (the inverse of f8MoveMask)
+inline Float8 f8MaskFromBits(int bits) {
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    __m128i lo = _mm_and_si128(_mm_set1_epi32(bits), lanes);
+    __m128i hi = _mm_and_si128(_mm_set1_epi32(bits >> 4), lanes);
+    return f8Make(_mm_castsi128_ps(_mm_cmpeq_epi32(lo, lanes)), _mm_castsi128_ps(_mm_cmpeq_epi32(hi, lanes)));
+}
+
+// Packs 8 colours in [0, 1] into RGBA8 and writes the lanes set in `bits` to dst[0..7]
+inline void f8StoreRGBA8(uint32_t *dst, Float8 r, Float8 g, Float8 b, Float8 a, int bits) {
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+    __m128i halves[2];
+    for (int h = 0; h < 2; h++) {
+        __m128 c[4] = { h ? r.hi : r.lo, h ? g.hi : g.lo, h ? b.hi : b.lo, h ? a.hi : a.lo };
+        __m128i packed = _mm_setzero_si128();
+        for (int i = 0; i < 4; i++) {
+            __m128i v = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(c[i], zero), one), scale));
+            packed = _mm_or_si128(packed, _mm_slli_epi32(v, 8 * i));
+        }
+        halves[h] = packed;
+    }
+    if (bits == 0xFF) {
+        _mm_storeu_si128((__m128i *) dst, halves[0]);
+        _mm_storeu_si128((__m128i *) (dst + 4), halves[1]);
+        return;
+    }
+    Float8 m = f8MaskFromBits(bits);
+    __m128i mlo = _mm_castps_si128(m.lo), mhi = _mm_castps_si128(m.hi);
+    __m128i oldLo = _mm_loadu_si128((const __m128i *) dst), oldHi = _mm_loadu_si128((const __m128i *) (dst + 4));
+    _mm_storeu_si128((__m128i *) dst, _mm_or_si128(_mm_and_si128(mlo, halves[0]), _mm_andnot_si128(mlo, oldLo)));
+    _mm_storeu_si128((__m128i *) (dst + 4), _mm_or_si128(_mm_and_si128(mhi, halves[1]), _mm_andnot_si128(mhi, oldHi)));
+}
+
+#else // Scalar fallback
+
+inline Float8 f8Set1(float x) { Float8 r; for (int i = 0; i < SW_LANES; i++) r.v[i] = x; return r; }
+inline Float8 f8Zero() { return f8Set1(0.0f); }
+inline Float8 f8Load(const float *p) { Float8 r; std::memcpy(r.v, p, sizeof(r.v)); return r; }
+inline void f8Store(float *p, Float8 a) { std::memcpy(p, a.v, sizeof(a.v)); }
+inline Float8 f8LoadHalves(const float *lo, const float *hi) {
+    Float8 r; std::memcpy(r.v, lo, 4 * sizeof(float)); std::memcpy(r.v + 4, hi, 4 * sizeof(float)); return r;
+}
+inline Float8 f8Set2(float a, float b) { Float8 r; for (int i = 0; i < SW_LANES; i++) r.v[i] = i < 4 ? a : b; return r; }
+inline Float8 f8Ramp(float base) { Float8 r; for (int i = 0; i < SW_LANES; i++) r.v[i] = base + (float) i; return r; }
+
+#define SW_F8_BINARY(NAME, EXPR) \
+    inline Float8 NAME(Float8 a, Float8 b) { Float8 r; for (int i = 0; i < SW_LANES; i++) { float x = a.v[i], y = b.v[i]; r.v[i] = (EXPR); } return r; }
+#define SW_F8_COMPARE(NAME, OP) \
+    inline Float8 NAME(Float8 a, Float8 b) { Float8 r; for (int i = 0; i < SW_LANES; i++) { uint32_t m = a.v[i] OP b.v[i] ? 0xFFFFFFFFu : 0u; std::memcpy(&r.v[i], &m, 4); } return r; }
+#define SW_F8_BITWISE(NAME, EXPR) \
+    inline Float8 NAME(Float8 a, Float8 b) { Float8 r; for (int i = 0; i < SW_LANES; i++) { uint32_t x, y, z; std::memcpy(&x, &a.v[i], 4); std::memcpy(&y, &b.v[i], 4); z = (EXPR); std::memcpy(&r.v[i], &z, 4); } return r; }
+
+SW_F8_BINARY(operator+, x + y)
+SW_F8_BINARY(operator-, x - y)
+SW_F8_BINARY(operator*, x * y)
+SW_F8_BINARY(operator/, x / y)
+SW_F8_BINARY(f8Min, y < x ? y : x)
+SW_F8_BINARY(f8Max, y > x ? y : x)
+SW_F8_COMPARE(f8Less, <)
+SW_F8_COMPARE(f8LessEqual, <=)
+SW_F8_COMPARE(f8Greater, >)
+SW_F8_COMPARE(f8GreaterEqual, >=)
+SW_F8_COMPARE(f8Equal, ==)
+SW_F8_BITWISE(f8And, x & y)
+SW_F8_BITWISE(f8Or, x | y)
+SW_F8_BITWISE(f8AndNot, ~x & y)
+
+#undef SW_F8_BINARY
+#undef SW_F8_COMPARE
+#undef SW_F8_BITWISE
+
+inline Float8 operator-(Float8 a) { return f8Zero() - a; }
+inline Float8 f8Sqrt(Float8 a) { Float8 r; for (int i = 0; i < SW_LANES; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+inline Float8 f8Select(Float8 mask, Float8 a, Float8 b) { return f8Or(f8And(mask, a), f8AndNot(mask, b)); }
+inline int f8MoveMask(Float8 mask) {
+    int bits = 0;
+    for (int i = 0; i < SW_LANES; i++) { uint32_t m; std::memcpy(&m, &mask.v[i], 4); bits |= (int) (m >> 31) << i; }
+    return bits;
+}
+inline Float8 f8HalfSums(Float8 a) {
+    Float8 r;
+    for (int h = 0; h < SW_LANES; h += 4) {
+        const float sum = a.v[h] + a.v[h + 1] + a.v[h + 2] + a.v[h + 3];
+        for (int i = h; i < h + 4; i++) r.v[i] = sum;
+    }
+    return r;
+}
+inline Float8 f8MaskFromBits(int bits) {
+    Float8 r;
+    for (int i = 0; i < SW_LANES; i++) { uint32_t m = (bits >> i) & 1 ? 0xFFFFFFFFu : 0u; std::memcpy(&r.v[i], &m, 4); }
+    return r;
+}
+inline void f8StoreRGBA8(uint32_t *dst, Float8 r, Float8 g, Float8 b, Float8 a, int bits) {
+    for (int i = 0; i < SW_LANES; i++) {
+        if (!((bits >> i) & 1)) continue;
+        const float c[4] = { r.v[i], g.v[i], b.v[i], a.v[i] };
+        uint32_t packed = 0;
+        for (int k = 0; k < 4; k++) {
+            float x = c[k] < 0.0f ? 0.0f : (c[k] > 1.0f ? 1.0f : c[k]);
+            packed |= (uint32_t) std::lround(x * 255.0f) << (8 * k);
+        }
+        dst[i] = packed;
+    }
+}
+
+#endif
+
+inline Float8 &operator+=(Float8 &a, Float8 b) { a = a + b; return a; }
+inline Float8 &operator-=(Float8 &a, Float8 b) { a = a - b; return a; }
+inline Float8 &operator*=(Float8 &a, Float8 b) { a = a * b; return a; }
+inline Float8 operator*(Float8 a, float b) { return a * f8Set1(b); }
+inline Float8 operator*(float a, Float8 b) { return f8Set1(a) * b; }
+inline Float8 operator+(Float8 a, float b) { return a + f8Set1(b); }
+inline Float8 operator-(Float8 a, float b) { return a - f8Set1(b); }
+
+// Reads one lane back out, mostly for the odd scalar fix-up and for debugging
+inline float f8Lane(Float8 a, int lane) {
+    float tmp[SW_LANES];
+    f8Store(tmp, a);
+    return tmp[lane];
+}
+
+#endif //OPENGLPLAYGROUND_SWSIMD_H
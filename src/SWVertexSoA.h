@@ -0,0 +1,103 @@
+#ifndef OPENGLPLAYGROUND_SWVERTEXSOA_H
+#define OPENGLPLAYGROUND_SWVERTEXSOA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "SWSimd.h"
+
+// The CPU backend keeps vertex data as Structure-of-Arrays (SoA): instead of the interleaved
+// {x, y, r, g, b}, {x, y, r, g, b}, ... that we hand to glBufferData, every scalar component gets its own
+// array: {x, x, x, ...}, {y, y, y, ...}, ... That way 8 consecutive vertices are one Float8 load per component.
+
+// Upper bounds on the flattened (scalar) component counts a CPU program can use.
+// A vec3 colour is 3 components, a vec2 uv is 2, etc.
+#define SW_MAX_ATTRIBUTES 16
+#define SW_MAX_VARYINGS 16
+
+// Rounds a count up to a whole number of lanes, so 8-wide loads never run off the end of an array
+inline int swPadToLanes(int count) { return (count + SW_LANES - 1) & ~(SW_LANES - 1); }
+
+// Vertex shader kernel: runs 8 vertices at once.
+// attributes[c] is component c of the (flattened) vertex inputs, position[0..3] receives gl_Position and
+// varyings[c] receives component c of the vertex shader outputs.
+typedef void (*SWVertexKernel)(const Float8 *attributes, Float8 *position, Float8 *varyings, const void *uniforms);
+// Fragment shader kernel: runs 8 pixels at once. varyings are already perspective-corrected,
+// colour[0..3] receives the RGBA output.
+typedef void (*SWFragmentKernel)(const Float8 *varyings, Float8 *colour, const void *uniforms);
+
+// Where a named vertex input lives in the flattened attribute list (the CPU glGetAttribLocation)
+struct SWAttributeInfo {
+    const char *name;
+    int firstComponent;
+    int components;
+};
+
+// Where a named uniform lives in the program's uniform block (the CPU glGetUniformLocation)
+struct SWUniformInfo {
+    const char *name;
+    size_t offset;
+    size_t size;
+};
+
+// The CPU equivalent of a linked shader program
+struct SWProgram {
+    const char *name;
+    int attributeComponents; // flattened vertex input components
+    int varyingComponents;   // flattened vertex -> fragment components
+    SWVertexKernel vertex;
+    SWFragmentKernel fragment;
+    const SWAttributeInfo *attributes;
+    int attributeCount;
+    const SWUniformInfo *uniforms;
+    int uniformCount;
+    size_t uniformBlockSize; // bytes the caller has to provide for `uniforms` in the kernels
+};
+
+// Vertex shader inputs, one array per component
+struct SWAttributeStreams {
+    int vertexCount = 0;
+    int components = 0;
+    int capacity = 0; // vertexCount padded to lanes
+    std::vector<float> data;
+
+    const float *component(int c) const { return &data[(size_t) c * capacity]; }
+    float *component(int c) { return &data[(size_t) c * capacity]; }
+
+    // Splits an interleaved vertex array (what main.cpp uploads to the VBO) into one stream per component.
+    // stride is in floats, and the first `components` floats of each vertex are used.
+    void fromInterleaved(const float *vertices, int count, int stride, int componentCount) {
+        vertexCount = count;
+        components = componentCount;
+        capacity = swPadToLanes(count);
+        data.assign((size_t) components * capacity, 0.0f);
+        for (int v = 0; v < count; v++)
+            for (int c = 0; c < components; c++)
+                data[(size_t) c * capacity + v] = vertices[(size_t) v * stride + c];
+    }
+};
+
+// Post-transform vertices: clip space position plus every varying, all SoA
+struct SWTransformedVertices {
+    int count = 0;
+    int varyingCount = 0;
+    int capacity = 0;
+    std::vector<float> x, y, z, w;
+    std::vector<float> varyings; // varyingCount arrays of `capacity` floats
+
+    void resize(int vertexCount, int varyingComponents) {
+        count = vertexCount;
+        varyingCount = varyingComponents;
+        capacity = swPadToLanes(vertexCount);
+        x.resize(capacity);
+        y.resize(capacity);
+        z.resize(capacity);
+        w.resize(capacity);
+        varyings.resize((size_t) varyingCount * capacity);
+    }
+
+    float *varying(int c) { return &varyings[(size_t) c * capacity]; }
+    const float *varying(int c) const { return &varyings[(size_t) c * capacity]; }
+};
+
+#endif //OPENGLPLAYGROUND_SWVERTEXSOA_H
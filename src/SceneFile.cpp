@@ -0,0 +1,205 @@
+#include "SceneFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+uint64_t alignUp(uint64_t value) {
+    return (value + SCENE_ALIGNMENT - 1) & ~(uint64_t) (SCENE_ALIGNMENT - 1);
+}
+
+// Offset of the next section, and where the file ends after it
+uint64_t section(uint64_t &end, size_t bytes) {
+    const uint64_t offset = alignUp(end);
+    end = offset + bytes;
+    return offset;
+}
+
+bool inFile(uint64_t offset, uint64_t count, size_t elementBytes, size_t fileSize) {
+    return offset % SCENE_ALIGNMENT == 0 && offset <= fileSize && count <= (fileSize - offset) / elementBytes;
+}
+
+} // namespace
+
+uint32_t SceneData::addNode(uint32_t parent, const glm::vec3 &translation, const glm::vec4 &rotation,
+                            const glm::vec3 &scale, uint32_t mesh, uint32_t material, const SceneBounds &meshBounds) {
+    parents.push_back(parent);
+    translations.push_back(translation);
+    rotations.push_back(rotation);
+    scales.push_back(scale);
+    meshes.push_back(mesh);
+    materials.push_back(material);
+    bounds.push_back(meshBounds);
+    return (uint32_t) (parents.size() - 1);
+}
+
+bool writeScene(const SceneData &scene, const char *path) {
+    const size_t count = scene.parents.size();
+    if (scene.translations.size() != count || scene.rotations.size() != count || scene.scales.size() != count ||
+        scene.meshes.size() != count || scene.materials.size() != count || scene.bounds.size() != count ||
+        count >= SCENE_NONE || scene.meshPaths.size() >= SCENE_NONE || scene.materialNames.size() >= SCENE_NONE) {
+        std::cerr << "ERROR::SCENE::BAD_ARRAYS " << path << std::endl;
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if ((scene.parents[i] != TRANSFORM_NO_PARENT && scene.parents[i] >= i) ||
+            (scene.meshes[i] != SCENE_NONE && scene.meshes[i] >= scene.meshPaths.size()) ||
+            (scene.materials[i] != SCENE_NONE && scene.materials[i] >= scene.materialNames.size())) {
+            std::cerr << "ERROR::SCENE::BAD_NODE " << i << " in " << path << std::endl;
+            return false;
+        }
+    }
+
+    SceneHeader header = SceneHeader(); // zeroed, padding and all
+    header.magic = SCENE_MAGIC;
+    header.version = SCENE_VERSION;
+    header.nodeCount = (uint32_t) count;
+    header.meshCount = (uint32_t) scene.meshPaths.size();
+    header.materialCount = (uint32_t) scene.materialNames.size();
+
+    // World bounds, through the same transform pass the loader will do
+    TransformArrays arrays;
+    arrays.count = count;
+    arrays.parents = scene.parents.data();
+    arrays.translations = scene.translations.data();
+    arrays.rotations = scene.rotations.data();
+    arrays.scales = scene.scales.data();
+    TransformHierarchy hierarchy;
+    hierarchy.attach(arrays);
+    hierarchy.update();
+    bool empty = true;
+    for (size_t i = 0; i < count; i++) {
+        if (scene.meshes[i] == SCENE_NONE)
+            continue;
+        glm::vec3 nodeMin, nodeMax;
+        transformBounds(hierarchy.world(i), scene.bounds[i].min, scene.bounds[i].max, nodeMin, nodeMax);
+        header.bounds.min = empty ? nodeMin : glm::min(header.bounds.min, nodeMin);
+        header.bounds.max = empty ? nodeMax : glm::max(header.bounds.max, nodeMax);
+        empty = false;
+    }
+
+    std::vector<uint32_t> meshNames, materialNames;
+    std::string strings;
+    for (const std::string &name : scene.meshPaths) {
+        meshNames.push_back((uint32_t) strings.size());
+        strings.append(name.c_str(), name.size() + 1);
+    }
+    for (const std::string &name : scene.materialNames) {
+        materialNames.push_back((uint32_t) strings.size());
+        strings.append(name.c_str(), name.size() + 1);
+    }
+    header.stringBytes = (uint32_t) strings.size();
+
+    uint64_t end = sizeof(header);
+    header.parents = section(end, count * sizeof(uint32_t));
+    header.translations = section(end, count * sizeof(glm::vec3));
+    header.rotations = section(end, count * sizeof(glm::vec4));
+    header.scales = section(end, count * sizeof(glm::vec3));
+    header.meshes = section(end, count * sizeof(uint32_t));
+    header.materials = section(end, count * sizeof(uint32_t));
+    header.nodeBounds = section(end, count * sizeof(SceneBounds));
+    header.meshNames = section(end, meshNames.size() * sizeof(uint32_t));
+    header.materialNames = section(end, materialNames.size() * sizeof(uint32_t));
+    header.strings = section(end, strings.size());
+    header.fileSize = end;
+
+    const std::string temporary = std::string(path) + ".tmp";
+    std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR::SCENE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    uint64_t written = 0;
+    auto write = [&](uint64_t offset, const void *data, size_t bytes) {
+        static const char padding[SCENE_ALIGNMENT] = {};
+        out.write(padding, (std::streamsize) (offset - written));
+        out.write(static_cast<const char *>(data), (std::streamsize) bytes);
+        written = offset + bytes;
+    };
+    write(0, &header, sizeof(header));
+    write(header.parents, scene.parents.data(), count * sizeof(uint32_t));
+    write(header.translations, scene.translations.data(), count * sizeof(glm::vec3));
+    write(header.rotations, scene.rotations.data(), count * sizeof(glm::vec4));
+    write(header.scales, scene.scales.data(), count * sizeof(glm::vec3));
+    write(header.meshes, scene.meshes.data(), count * sizeof(uint32_t));
+    write(header.materials, scene.materials.data(), count * sizeof(uint32_t));
+    write(header.nodeBounds, scene.bounds.data(), count * sizeof(SceneBounds));
+    write(header.meshNames, meshNames.data(), meshNames.size() * sizeof(uint32_t));
+    write(header.materialNames, materialNames.data(), materialNames.size() * sizeof(uint32_t));
+    write(header.strings, strings.data(), strings.size());
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path) != 0) {
+        std::cerr << "ERROR::SCENE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool SceneFile::open(const char *path) {
+    locals = TransformArrays();
+    if (!file.open(path))
+        return false;
+    const unsigned char *data = file.data();
+    const size_t size = file.size();
+    if (size < sizeof(head)) {
+        std::cerr << "ERROR::SCENE::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&head, data, sizeof(head));
+    if (head.magic != SCENE_MAGIC || head.version != SCENE_VERSION) {
+        std::cerr << "ERROR::SCENE::WRONG_VERSION " << path << std::endl;
+        return false;
+    }
+    const uint64_t nodes = head.nodeCount;
+    if (head.fileSize != size || !inFile(head.parents, nodes, sizeof(uint32_t), size) ||
+        !inFile(head.translations, nodes, sizeof(glm::vec3), size) ||
+        !inFile(head.rotations, nodes, sizeof(glm::vec4), size) ||
+        !inFile(head.scales, nodes, sizeof(glm::vec3), size) ||
+        !inFile(head.meshes, nodes, sizeof(uint32_t), size) ||
+        !inFile(head.materials, nodes, sizeof(uint32_t), size) ||
+        !inFile(head.nodeBounds, nodes, sizeof(SceneBounds), size) ||
+        !inFile(head.meshNames, head.meshCount, sizeof(uint32_t), size) ||
+        !inFile(head.materialNames, head.materialCount, sizeof(uint32_t), size) ||
+        !inFile(head.strings, head.stringBytes, 1, size) ||
+        (head.stringBytes > 0 && data[head.strings + head.stringBytes - 1] != 0)) {
+        std::cerr << "ERROR::SCENE::CORRUPT " << path << std::endl;
+        return false;
+    }
+
+    // The fix-up: offsets become pointers into wherever the file got mapped
+    meshIndices = reinterpret_cast<const uint32_t *>(data + head.meshes);
+    materialIndices = reinterpret_cast<const uint32_t *>(data + head.materials);
+    nodeBounds = reinterpret_cast<const SceneBounds *>(data + head.nodeBounds);
+    meshNames = reinterpret_cast<const uint32_t *>(data + head.meshNames);
+    materialNames = reinterpret_cast<const uint32_t *>(data + head.materialNames);
+    strings = reinterpret_cast<const char *>(data + head.strings);
+    TransformArrays arrays;
+    arrays.count = head.nodeCount;
+    arrays.parents = reinterpret_cast<const uint32_t *>(data + head.parents);
+    arrays.translations = reinterpret_cast<const glm::vec3 *>(data + head.translations);
+    arrays.rotations = reinterpret_cast<const glm::vec4 *>(data + head.rotations);
+    arrays.scales = reinterpret_cast<const glm::vec3 *>(data + head.scales);
+
+    // Indices are what could send a reader outside the mapping, so they're checked (the floats aren't)
+    bool valid = true;
+    for (uint32_t i = 0; i < head.meshCount; i++)
+        valid = valid && meshNames[i] < head.stringBytes;
+    for (uint32_t i = 0; i < head.materialCount; i++)
+        valid = valid && materialNames[i] < head.stringBytes;
+    for (size_t i = 0; valid && i < arrays.count; i++) {
+        const uint32_t parent = arrays.parents[i], mesh = meshIndices[i], material = materialIndices[i];
+        valid = (parent == TRANSFORM_NO_PARENT || parent < i) && (mesh == SCENE_NONE || mesh < head.meshCount) &&
+                (material == SCENE_NONE || material < head.materialCount);
+    }
+    if (!valid) {
+        std::cerr << "ERROR::SCENE::CORRUPT " << path << std::endl;
+        head.nodeCount = 0;
+        return false;
+    }
+    locals = arrays;
+    return true;
+}
@@ -0,0 +1,93 @@
+#ifndef OPENGLPLAYGROUND_SCENEFILE_H
+#define OPENGLPLAYGROUND_SCENEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "GLTransform.h"
+#include "MappedFile.h"
+
+// Binary scenes (.scene): the node hierarchy as flat arrays, one entry per node in each, parents before
+// children (so it goes straight into a TransformHierarchy):
+//   parents, translations, rotations, scales - the locals, see TransformArrays
+//   meshes, materials                        - indices into the name tables, or SCENE_NONE
+//   bounds                                   - of the node's mesh, in the node's space
+// then the mesh paths and material names, as offsets into a block of NUL terminated strings.
+// Every array is at an offset from the start of the file (SCENE_ALIGNMENT aligned) stored in the header, so
+// the file doesn't care where it's mapped: opening it is an mmap, a check, and adding the offsets to the
+// mapping's address. Nothing is allocated per node.
+
+#define SCENE_MAGIC 0x5350474Fu // "OGPS"
+#define SCENE_VERSION 1
+#define SCENE_ALIGNMENT 64
+#define SCENE_NONE 0xFFFFFFFFu
+
+struct SceneBounds {
+    glm::vec3 min, max;
+};
+
+struct SceneHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t nodeCount, meshCount, materialCount;
+    uint32_t stringBytes;
+    uint64_t fileSize;
+    SceneBounds bounds; // of every mesh node, in world space
+    uint32_t reserved[2];
+    // Offsets from the start of the file
+    uint64_t parents, translations, rotations, scales;
+    uint64_t meshes, materials, nodeBounds;
+    uint64_t meshNames, materialNames, strings;
+};
+
+// A scene being put together to write: push a node into every array at once, see addNode()
+struct SceneData {
+    std::vector<uint32_t> parents;
+    std::vector<glm::vec3> translations;
+    std::vector<glm::vec4> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<uint32_t> meshes, materials;
+    std::vector<SceneBounds> bounds;
+    std::vector<std::string> meshPaths, materialNames;
+
+    // Returns the new node's index. Parent has to be added first (or TRANSFORM_NO_PARENT).
+    uint32_t addNode(uint32_t parent, const glm::vec3 &translation, const glm::vec4 &rotation,
+                     const glm::vec3 &scale, uint32_t mesh = SCENE_NONE, uint32_t material = SCENE_NONE,
+                     const SceneBounds &meshBounds = SceneBounds());
+};
+
+// Checks the hierarchy and references, works out the world bounds and writes path (through a temporary
+// file, like the caches). False, after an error, if anything is out of order or the write fails.
+bool writeScene(const SceneData &scene, const char *path);
+
+// A .scene mapped for reading. The arrays point straight into the mapping, and live as long as this does.
+class SceneFile {
+public:
+    // Prints an error and returns false if the file is missing or isn't a valid .scene
+    bool open(const char *path);
+
+    const SceneHeader &header() const { return head; }
+    size_t nodeCount() const { return head.nodeCount; }
+    // For TransformHierarchy::attach
+    const TransformArrays &transforms() const { return locals; }
+    const uint32_t *meshes() const { return meshIndices; }
+    const uint32_t *materials() const { return materialIndices; }
+    const SceneBounds *bounds() const { return nodeBounds; }
+    size_t meshCount() const { return head.meshCount; }
+    size_t materialCount() const { return head.materialCount; }
+    const char *meshPath(uint32_t mesh) const { return strings + meshNames[mesh]; }
+    const char *materialName(uint32_t material) const { return strings + materialNames[material]; }
+
+private:
+    MappedFile file;
+    SceneHeader head = {};
+    TransformArrays locals;
+    const uint32_t *meshIndices = nullptr, *materialIndices = nullptr;
+    const SceneBounds *nodeBounds = nullptr;
+    const uint32_t *meshNames = nullptr, *materialNames = nullptr;
+    const char *strings = nullptr;
+};
+
+#endif //OPENGLPLAYGROUND_SCENEFILE_H
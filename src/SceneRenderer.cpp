@@ -0,0 +1,296 @@
+#include "SceneRenderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "GLBLoader.h"
+#include "MeshCache.h"
+
+namespace {
+
+// Frustum planes straight from the matrix (Gribb & Hartmann), pointing in
+void frustumPlanes(const glm::mat4 &viewProjection, glm::vec4 *planes) {
+    const glm::mat4 m = glm::transpose(viewProjection);
+    for (int axis = 0; axis < 3; axis++) {
+        planes[axis * 2] = m[3] + m[axis];
+        planes[axis * 2 + 1] = m[3] - m[axis];
+    }
+}
+
+// Whether a box is wholly behind one of the planes: the corner furthest along the plane's normal is
+bool outsideFrustum(const glm::vec4 *planes, const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+    for (int p = 0; p < 6; p++) {
+        const glm::vec3 normal(planes[p]);
+        const glm::vec3 corner(normal.x >= 0.0f ? boundsMax.x : boundsMin.x, normal.y >= 0.0f ? boundsMax.y : boundsMin.y,
+                               normal.z >= 0.0f ? boundsMax.z : boundsMin.z);
+        if (glm::dot(normal, corner) + planes[p].w < 0.0f)
+            return true;
+    }
+    return false;
+}
+
+// A unit cube around the origin, positions only
+bool uploadCube(GLMesh &mesh, GLuint program) {
+    static const float corners[] = {
+            -0.5f, -0.5f, -0.5f, 0.5f, -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, -0.5f, 0.5f, -0.5f,
+            -0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f, 0.5f, 0.5f, 0.5f, -0.5f, 0.5f, 0.5f,
+    };
+    static const GLushort faces[] = {
+            0, 2, 1, 2, 0, 3, // -z
+            4, 5, 6, 6, 7, 4, // +z
+            0, 4, 7, 7, 3, 0, // -x
+            1, 2, 6, 6, 5, 1, // +x
+            0, 1, 5, 5, 4, 0, // -y
+            3, 7, 6, 6, 2, 3, // +y
+    };
+    GLuint vertexArray;
+    glGenVertexArrays(1, &vertexArray);
+    glBindVertexArray(vertexArray);
+    mesh.vertexArrays.push_back(vertexArray);
+    glGenBuffers(1, &mesh.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glGenBuffers(1, &mesh.indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+    VertexLayout layout;
+    layout.add("position", 3);
+    applyVertexLayout(layout, program);
+    glBindVertexArray(0);
+    mesh.draws.push_back({ vertexArray, GL_TRIANGLES, true, GL_UNSIGNED_SHORT, 0, 36, 0 });
+    mesh.uploadedBytes = sizeof(corners) + sizeof(faces);
+    return true;
+}
+
+} // namespace
+
+std::shared_ptr<GLMesh> SceneRenderer::loadMesh(const char *path) {
+    const size_t length = std::strlen(path);
+    const bool isGLB = length > 4 && std::strcmp(path + length - 4, ".glb") == 0;
+    GLBFile glb;
+    CachedMesh cached;
+    if (isGLB ? !glb.open(path) : !cached.load(path))
+        return nullptr;
+    // Hashing reads the whole mesh, but glBufferData was going to anyway, and now finds it paged in
+    const uint64_t hash = isGLB ? meshContentHash(glb, program) : meshContentHash(cached, program);
+    const size_t bytes = isGLB ? glb.binarySize() : cached.vertexBytes() + cached.indexBytes();
+    bool added = false;
+    const AssetId content = registry.acquire(AssetKind::Mesh, hash, bytes, &added);
+    if (content && !added) {
+        std::shared_ptr<GLMesh> shared = std::static_pointer_cast<GLMesh>(registry.instance(content));
+        if (shared) {
+            meshContents.push_back(content);
+            sharedMeshes++;
+            return shared;
+        }
+        // Whoever added it hasn't uploaded it yet: upload one of our own rather than wait
+        registry.release(content);
+    }
+    std::shared_ptr<GLMesh> mesh = std::make_shared<GLMesh>();
+    if (isGLB ? !mesh->upload(glb, program) : !mesh->upload(cached, program)) {
+        if (added) {
+            registry.fail(content);
+            registry.release(content);
+        }
+        return nullptr;
+    }
+    if (added) {
+        registry.publish(content, mesh, mesh->uploadedBytes);
+        meshContents.push_back(content);
+    }
+    return mesh;
+}
+
+void SceneRenderer::releaseMeshes() {
+    for (AssetId content : meshContents)
+        registry.release(content);
+    meshContents.clear();
+    meshes.clear();
+    sharedMeshes = 0;
+}
+
+bool SceneRenderer::open(const char *path, const Shader &shader) {
+    if (!file.open(path))
+        return false;
+    hierarchy.attach(file.transforms());
+    program = shader.ID;
+    transformLocation = glGetUniformLocation(program, "transform");
+    tintLocation = glGetUniformLocation(program, "tint");
+
+    releaseMeshes();
+    std::shared_ptr<GLMesh> cube;
+    for (uint32_t m = 0; m < file.meshCount(); m++) {
+        const char *meshPath = file.meshPath(m);
+        std::shared_ptr<GLMesh> mesh = std::strcmp(meshPath, "cube") != 0 ? loadMesh(meshPath) : nullptr;
+        if (!mesh && !cube) {
+            cube = std::make_shared<GLMesh>();
+            uploadCube(*cube, program);
+        }
+        meshes.push_back(mesh ? mesh : cube);
+    }
+    // Materials are only names here, so each gets a colour of its own from its index
+    tints.clear();
+    for (uint32_t m = 0; m < file.materialCount(); m++) {
+        const float hue = (float) m * 0.618034f;
+        tints.emplace_back(0.55f + 0.4f * std::cos(6.2831853f * hue), 0.55f + 0.4f * std::cos(6.2831853f * (hue + 0.333f)),
+                           0.55f + 0.4f * std::cos(6.2831853f * (hue + 0.667f)), 1.0f);
+    }
+    tints.emplace_back(0.8f, 0.8f, 0.8f, 1.0f);
+
+    meshNodes = 0;
+    nodesByMesh.assign(meshes.size(), std::vector<uint32_t>());
+    for (size_t i = 0; i < file.nodeCount(); i++) {
+        const uint32_t mesh = file.meshes()[i];
+        if (mesh == SCENE_NONE)
+            continue;
+        meshNodes++;
+        if (mesh < meshes.size())
+            nodesByMesh[mesh].push_back((uint32_t) i);
+    }
+    lodInstances.assign(meshes.size(), LODInstances());
+    for (size_t m = 0; m < meshes.size(); m++)
+        lodInstances[m].resize(nodesByMesh[m].size());
+    nodeLevels.assign(file.nodeCount(), 0);
+    std::cout << path << ": " << file.nodeCount() << " nodes, " << meshNodes << " of them drawn with "
+              << file.meshCount() << " meshes (" << sharedMeshes << " shared with one loaded before)" << std::endl;
+    return true;
+}
+
+template<typename Commands>
+size_t SceneRenderer::record(Commands &commands, size_t begin, size_t end, const glm::mat4 &viewProjection,
+                             const glm::vec4 *planes, size_t &triangles, size_t &fullDetailTriangles) const {
+    const uint32_t *nodeMeshes = file.meshes();
+    const uint32_t *nodeMaterials = file.materials();
+    const SceneBounds *nodeBounds = file.bounds();
+    // What GL has bound isn't known at the start, so the first of everything always goes in
+    const uint32_t unknown = 0xFFFFFFFFu;
+    uint32_t material = unknown, restartIndex = unknown;
+    GLuint vertexArray = unknown;
+    size_t drawn = 0;
+    commands.useProgram(program);
+    for (size_t i = begin; i < end; i++) {
+        if (nodeMeshes[i] == SCENE_NONE)
+            continue;
+        const glm::mat4 &world = hierarchy.world(i);
+        glm::vec3 boundsMin, boundsMax;
+        transformBounds(world, nodeBounds[i].min, nodeBounds[i].max, boundsMin, boundsMax);
+        if (outsideFrustum(planes, boundsMin, boundsMax))
+            continue;
+        drawn++;
+        const GLMesh &mesh = *meshes[nodeMeshes[i]];
+        if (mesh.restartIndex != restartIndex)
+            commands.primitiveRestart(restartIndex = mesh.restartIndex);
+        const uint32_t nodeMaterial = nodeMaterials[i] == SCENE_NONE ? (uint32_t) tints.size() - 1 : nodeMaterials[i];
+        if (nodeMaterial != material)
+            commands.uniform(tintLocation, tints[material = nodeMaterial]);
+        commands.uniform(transformLocation, viewProjection * world);
+        const size_t level = nodeLevels[i];
+        triangles += mesh.levelTriangles(level);
+        fullDetailTriangles += mesh.levelTriangles(0);
+        for (const GLMesh::Draw &draw : mesh.levelDraws(level)) {
+            if (draw.VAO != vertexArray)
+                commands.bindVertexArray(vertexArray = draw.VAO);
+            if (draw.indexed)
+                commands.drawElements(draw.mode, draw.count, draw.indexType, draw.indexOffset, draw.baseVertex);
+            else
+                commands.drawArrays(draw.mode, 0, draw.count);
+        }
+    }
+    return drawn;
+}
+
+void SceneRenderer::selectLevels(const glm::vec3 &eye, float projectionScale) {
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const GLMesh &mesh = *meshes[m];
+        const std::vector<uint32_t> &nodes = nodesByMesh[m];
+        if (mesh.levelCount() < 2 || nodes.empty())
+            continue;
+        LODInstances &instances = lodInstances[m];
+        for (size_t k = 0; k < nodes.size(); k++) {
+            // The node's origin, and its largest axis scale so the error is never underestimated
+            const glm::mat4 &world = hierarchy.world(nodes[k]);
+            const float scale = std::max(glm::length(glm::vec3(world[0])),
+                                         std::max(glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))));
+            instances.set(k, glm::vec3(world[3]), scale);
+        }
+        selector.select(mesh.lods.data(), mesh.lods.size(), mesh.radius, instances, eye, projectionScale);
+        for (size_t k = 0; k < nodes.size(); k++)
+            nodeLevels[nodes[k]] = instances.lod[k];
+    }
+}
+
+void SceneRenderer::prepare(SceneFrame &frame, const glm::mat4 &viewProjection, const glm::vec3 &eye,
+                            float projectionScale) {
+    auto start = std::chrono::steady_clock::now();
+    hierarchy.update();
+    auto updated = std::chrono::steady_clock::now();
+    selectLevels(eye, projectionScale);
+    auto selected = std::chrono::steady_clock::now();
+    frame.viewProjection = viewProjection;
+    frame.recorded = recordCommands;
+    frame.blocks = 0;
+    frame.drawn = frame.triangles = frame.fullDetailTriangles = 0;
+    if (recordCommands) {
+        glm::vec4 planes[6];
+        frustumPlanes(viewProjection, planes);
+        const size_t count = file.nodeCount();
+        frame.blocks = (count + SCENE_DRAW_BLOCK - 1) / SCENE_DRAW_BLOCK;
+        if (frame.buffers.size() < frame.blocks)
+            frame.buffers.resize(frame.blocks);
+        blockDrawn.resize(frame.blocks);
+        blockTriangles.assign(frame.blocks, 0);
+        blockFullTriangles.assign(frame.blocks, 0);
+        jobs.parallelFor(frame.blocks, 1, [&](size_t first, size_t last) {
+            for (size_t b = first; b < last; b++) {
+                frame.buffers[b].clear();
+                blockDrawn[b] = record(frame.buffers[b], b * SCENE_DRAW_BLOCK, std::min(count, (b + 1) * SCENE_DRAW_BLOCK),
+                                       viewProjection, planes, blockTriangles[b], blockFullTriangles[b]);
+            }
+        });
+        for (size_t b = 0; b < frame.blocks; b++) {
+            frame.drawn += blockDrawn[b];
+            frame.triangles += blockTriangles[b];
+            frame.fullDetailTriangles += blockFullTriangles[b];
+        }
+    }
+    frame.transformMilliseconds = std::chrono::duration<double, std::milli>(updated - start).count();
+    frame.lodMilliseconds = std::chrono::duration<double, std::milli>(selected - updated).count();
+    frame.recordMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - selected).count();
+}
+
+void SceneRenderer::submit(SceneFrame &frame) {
+    auto start = std::chrono::steady_clock::now();
+    size_t commands = 0, bytes = 0;
+    glEnable(GL_DEPTH_TEST);
+    if (frame.recorded) {
+        for (size_t b = 0; b < frame.blocks; b++) {
+            frame.buffers[b].replay();
+            commands += frame.buffers[b].commandCount();
+            bytes += frame.buffers[b].bytes();
+        }
+    } else {
+        glm::vec4 planes[6];
+        frustumPlanes(frame.viewProjection, planes);
+        DirectCommands direct;
+        frame.triangles = frame.fullDetailTriangles = 0;
+        frame.drawn = record(direct, 0, file.nodeCount(), frame.viewProjection, planes, frame.triangles,
+                             frame.fullDetailTriangles);
+        commands = direct.commands;
+    }
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+
+    counters.frames++;
+    counters.meshNodes += meshNodes;
+    counters.drawn += frame.drawn;
+    counters.triangles += frame.triangles;
+    counters.fullDetailTriangles += frame.fullDetailTriangles;
+    counters.commands += commands;
+    counters.commandBytes += bytes;
+    counters.transformMilliseconds += frame.transformMilliseconds;
+    counters.lodMilliseconds += frame.lodMilliseconds;
+    counters.recordMilliseconds += frame.recordMilliseconds;
+    counters.submitMilliseconds += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,125 @@
+#ifndef OPENGLPLAYGROUND_SCENERENDERER_H
+#define OPENGLPLAYGROUND_SCENERENDERER_H
+
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+#include "AssetRegistry.h"
+#include "CommandBuffer.h"
+#include "GLMesh.h"
+#include "GLShader.h"
+#include "GLTransform.h"
+#include "JobSystem.h"
+#include "LODSelector.h"
+#include "SceneFile.h"
+
+// Draws a .scene: a draw per mesh node in the view, each with its own transform and its material's colour,
+// at the level of detail LODSelector picks for it from where the camera is.
+// A frame is prepared, then submitted. prepare() runs the transform pass on the jobs, then cuts the nodes
+// into blocks that workers cull and record into command buffers (one per block, so nobody shares one and
+// the replay order doesn't depend on who ran what). submit() is the GL thread replaying them. Everything a
+// frame needs from prepare() is in its SceneFrame, so with a frame per packet the next frame can be
+// prepared while the GL thread is still submitting this one.
+// With recordCommands off, submit() does the culling and makes the calls itself, the way the GL thread would
+// without command buffers, so the two can be compared. It reads the transforms as they are then, so that only
+// works when nothing prepares the next frame in the meantime.
+
+#define SCENE_DRAW_BLOCK 2048 // nodes per recording job
+
+// What prepare() hands submit()
+struct SceneFrame {
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    bool recorded = false;              // false: submit() culls and draws straight away
+    std::vector<CommandBuffer> buffers; // by block, kept between frames so recording doesn't allocate
+    size_t blocks = 0;                  // of buffers, how many this frame uses
+    size_t drawn = 0;
+    size_t triangles = 0;           // of the nodes drawn, at their levels
+    size_t fullDetailTriangles = 0; // the same nodes at level 0
+    double transformMilliseconds = 0.0;
+    double lodMilliseconds = 0.0;
+    double recordMilliseconds = 0.0;
+};
+
+// Totals since resetStats()
+struct SceneRenderStats {
+    size_t frames = 0;
+    size_t meshNodes = 0;    // nodes with a mesh, per frame
+    size_t drawn = 0;        // of those, in the view
+    size_t triangles = 0;
+    size_t fullDetailTriangles = 0;
+    size_t commands = 0;
+    size_t commandBytes = 0; // recorded, 0 when drawing directly
+    double transformMilliseconds = 0.0;
+    double lodMilliseconds = 0.0;
+    double recordMilliseconds = 0.0; // on the jobs, waiting for them included
+    double submitMilliseconds = 0.0; // GL thread: the replay, or the culling and the calls when not recorded
+
+    double perFrame(double total) const { return frames ? total / (double) frames : 0.0; }
+    // What a command costs the GL thread
+    double submitNanosecondsPerCommand() const { return commands ? submitMilliseconds * 1e6 / (double) commands : 0.0; }
+};
+
+class SceneRenderer {
+public:
+    bool recordCommands = true;
+
+    // The registry has to outlive the renderer
+    SceneRenderer(JobSystem &jobs, AssetRegistry &registry) : jobs(jobs), registry(registry) {}
+    // GL thread
+    ~SceneRenderer() { releaseMeshes(); }
+    SceneRenderer(const SceneRenderer &) = delete;
+    SceneRenderer &operator=(const SceneRenderer &) = delete;
+
+    // GL thread. Opens the scene and uploads its meshes (.glb straight, anything else through the .mesh cache),
+    // for drawing with program, which takes a vec3 "position" and has "transform" and "tint" uniforms. Meshes
+    // called "cube" (what SceneBuilder writes without any), or that fail to load, are drawn as a unit cube.
+    // Meshes go through the registry by content, so the same one under two paths (or loaded by someone
+    // else with the same program) is uploaded once.
+    bool open(const char *path, const Shader &program);
+    // Draws the nodes with these locals instead of the scene's own, from the next prepare() on. They have to
+    // stay where they are (their contents can change between frames) and have the scene's node count.
+    void attachTransforms(const TransformArrays &locals) { hierarchy.attach(locals); }
+    // On the thread that made the jobs. Updates the transforms, picks each mesh node's level of detail for a
+    // camera at eye (projectionScale as in LODSelector) and records the draws of every one in the view into
+    // frame.
+    void prepare(SceneFrame &frame, const glm::mat4 &viewProjection, const glm::vec3 &eye, float projectionScale);
+    // GL thread. Draws a prepared frame.
+    void submit(SceneFrame &frame);
+
+    const SceneFile &scene() const { return file; }
+    // GL thread, like submit()
+    const SceneRenderStats &stats() const { return counters; }
+    void resetStats() { counters = SceneRenderStats(); }
+
+private:
+    JobSystem &jobs;
+    AssetRegistry &registry;
+    SceneFile file;
+    TransformHierarchy hierarchy;
+    GLuint program = 0;
+    GLint transformLocation = -1, tintLocation = -1;
+    std::vector<std::shared_ptr<GLMesh>> meshes; // by scene mesh index
+    std::vector<AssetId> meshContents;           // registry references held for them
+    size_t sharedMeshes = 0;                     // of meshes, how many were already in the registry
+    std::vector<glm::vec4> tints;                // by material, plus one for nodes without
+    size_t meshNodes = 0;
+    std::vector<std::vector<uint32_t>> nodesByMesh; // the nodes drawing each mesh
+    std::vector<LODInstances> lodInstances;         // by mesh, in nodesByMesh order
+    std::vector<uint8_t> nodeLevels;                // by node, as selected by the last prepare()
+    LODSelector selector;
+    std::vector<size_t> blockDrawn, blockTriangles, blockFullTriangles;
+    SceneRenderStats counters;                   // GL thread
+
+    // Culls nodes [begin, end) against the planes and records the draws of the ones left, each at its level.
+    // Returns how many, and adds their triangles (and what they'd be at level 0) to the counts.
+    template<typename Commands>
+    size_t record(Commands &commands, size_t begin, size_t end, const glm::mat4 &viewProjection,
+                  const glm::vec4 *planes, size_t &triangles, size_t &fullDetailTriangles) const;
+    // Loads and uploads a mesh file, or takes the registry's copy. Null if it can't be loaded.
+    std::shared_ptr<GLMesh> loadMesh(const char *path);
+    void releaseMeshes();
+    // Fills nodeLevels for a camera at eye
+    void selectLevels(const glm::vec3 &eye, float projectionScale);
+};
+
+#endif //OPENGLPLAYGROUND_SCENERENDERER_H
@@ -0,0 +1,58 @@
+#include "SceneSimulation.h"
+#include <chrono>
+#include <cmath>
+
+void SceneSimulation::attach(const TransformArrays &locals) {
+    states[0].assign(locals);
+    states[1].assign(locals);
+    blended.assign(locals);
+    current = 0;
+    drawn = blended.view(locals.parents);
+    spins.resize(locals.count);
+    for (size_t i = 0; i < locals.count; i++) {
+        // Up to a third of a turn a second either way, scattered by a hash of the index
+        const uint32_t hash = (uint32_t) i * 2654435761u;
+        const float speed = locals.parents[i] == TRANSFORM_NO_PARENT ? 0.0f
+                                                                      : ((float) (hash >> 16) / 65535.0f * 2.0f - 1.0f) * 2.1f;
+        const float half = speed * (float) clock.stepSeconds() * 0.5f;
+        spins[i] = glm::vec2(std::sin(half), std::cos(half));
+    }
+}
+
+void SceneSimulation::step() {
+    const TransformState &from = states[current];
+    TransformState &to = states[1 - current];
+    parallelFor(spins.size(), SCENE_SIMULATION_BLOCK, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            // (0, s, 0, c) * q: a turn about y, in the parent's space
+            const float s = spins[i].x, c = spins[i].y;
+            const glm::vec4 &q = from.rotations[i];
+            to.rotations[i] = glm::normalize(glm::vec4(c * q.x + s * q.z, c * q.y + s * q.w, c * q.z - s * q.x,
+                                                       c * q.w - s * q.y));
+            to.translations[i] = from.translations[i];
+            to.scales[i] = from.scales[i];
+        }
+    });
+    current = 1 - current;
+}
+
+void SceneSimulation::advance(double seconds) {
+    auto start = std::chrono::steady_clock::now();
+    const int steps = clock.advance(seconds);
+    for (int s = 0; s < steps; s++)
+        step();
+    auto stepped = std::chrono::steady_clock::now();
+    const TransformArrays previous = states[1 - current].view(drawn.parents);
+    const TransformArrays latest = states[current].view(drawn.parents);
+    const float t = interpolate ? clock.alpha() : 1.0f;
+    parallelFor(drawn.count, SCENE_SIMULATION_BLOCK, [&](size_t begin, size_t end) {
+        interpolateTransforms(previous, latest, t, blended, begin, end);
+    });
+    auto interpolated = std::chrono::steady_clock::now();
+
+    counters.frames++;
+    counters.steps += (size_t) steps;
+    counters.stepMilliseconds += std::chrono::duration<double, std::milli>(stepped - start).count();
+    counters.interpolateMilliseconds += std::chrono::duration<double, std::milli>(interpolated - stepped).count();
+    counters.droppedSeconds = clock.droppedSeconds();
+}
@@ -0,0 +1,55 @@
+#ifndef OPENGLPLAYGROUND_SCENESIMULATION_H
+#define OPENGLPLAYGROUND_SCENESIMULATION_H
+
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include "GLTransform.h"
+#include "SimulationClock.h"
+
+// Something for a scene to do: every node but the root turns about its parent's y axis at a speed of its
+// own, stepped on the fixed timestep of a SimulationClock. The last two states are kept, and what gets drawn
+// is the two blended by how far into the next step the frame is, for the whole scene in one SIMD pass over
+// the arrays (see interpolateTransforms) rather than node by node. So the simulation can run at 30 Hz under
+// a 144 Hz display without every few frames showing the same thing.
+
+#define SCENE_SIMULATION_BLOCK 4096 // nodes per parallelFor block
+
+// Totals since the simulation started
+struct SceneSimulationStats {
+    size_t frames = 0;
+    size_t steps = 0;
+    double stepMilliseconds = 0.0;
+    double interpolateMilliseconds = 0.0;
+    double droppedSeconds = 0.0; // hitches too long to catch up on
+};
+
+class SceneSimulation {
+public:
+    bool interpolate = true; // off: draw the current state as it is, to see the judder that saves
+
+    explicit SceneSimulation(double stepRate) : clock(stepRate) {}
+
+    // Starts from these locals (copied), with the parents as they are, which have to stay put
+    void attach(const TransformArrays &locals);
+    // Runs the steps a frame's time adds up to, then blends the last two states for drawing
+    void advance(double seconds);
+
+    // The locals to draw, valid from attach() on and always at the same place, so a TransformHierarchy only
+    // has to attach() them once
+    const TransformArrays &transforms() const { return drawn; }
+    const SceneSimulationStats &stats() const { return counters; }
+
+private:
+    SimulationClock clock;
+    TransformState states[2]; // the previous one and the current one, by turns
+    int current = 0;
+    TransformState blended;
+    TransformArrays drawn;
+    std::vector<glm::vec2> spins; // each node's turn in a step, as sin and cos of half the angle
+    SceneSimulationStats counters;
+
+    void step();
+};
+
+#endif //OPENGLPLAYGROUND_SCENESIMULATION_H
@@ -0,0 +1,24 @@
+#ifndef OPENGLPLAYGROUND_SHADERPROGRAMNAME_H
+#define OPENGLPLAYGROUND_SHADERPROGRAMNAME_H
+
+#include <string>
+
+// A program is named after its two source files, without folders or extensions:
+// ("../Assets/Shaders/VertexShader.glsl", "../Assets/Shaders/FragmentShader.glsl") -> "VertexShader+FragmentShader"
+// The GL Shader and ShaderTranslator both use this, which is how a CPU kernel finds its GL twin.
+inline std::string shaderFileStem(const char *path) {
+    std::string stem(path);
+    size_t slash = stem.find_last_of("/\\");
+    if (slash != std::string::npos)
+        stem = stem.substr(slash + 1);
+    size_t dot = stem.find_last_of('.');
+    if (dot != std::string::npos)
+        stem = stem.substr(0, dot);
+    return stem;
+}
+
+inline std::string shaderProgramName(const char *vertexPath, const char *fragmentPath) {
+    return shaderFileStem(vertexPath) + "+" + shaderFileStem(fragmentPath);
+}
+
+#endif //OPENGLPLAYGROUND_SHADERPROGRAMNAME_H
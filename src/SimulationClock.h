@@ -0,0 +1,47 @@
+#ifndef OPENGLPLAYGROUND_SIMULATIONCLOCK_H
+#define OPENGLPLAYGROUND_SIMULATIONCLOCK_H
+
+#include <algorithm>
+#include <cmath>
+
+// Fixed steps for the simulation, however long frames take (Glenn Fiedler's "Fix Your Timestep!"): frame
+// time goes into an accumulator and whole steps come out, so the simulation runs the same at 30 fps as at
+// 144. What's left over, as a fraction of a step, is how far to blend from the previous state to the
+// current one when drawing, so frames in between steps don't all show the same state and then jump.
+
+#define SIMULATION_MAX_STEPS 8 // per frame: after a long hitch, time is dropped rather than run all at once
+
+class SimulationClock {
+public:
+    explicit SimulationClock(double stepRate = 30.0) : step(1.0 / std::max(stepRate, 1.0)) {}
+
+    // Adds a frame's time. Returns how many steps to run for it.
+    int advance(double seconds) {
+        accumulator += std::max(seconds, 0.0);
+        int steps = 0;
+        while (accumulator >= step && steps < SIMULATION_MAX_STEPS) {
+            accumulator -= step;
+            steps++;
+        }
+        if (accumulator >= step) {
+            dropped += accumulator - std::fmod(accumulator, step);
+            accumulator = std::fmod(accumulator, step);
+        }
+        simulated += steps * step;
+        return steps;
+    }
+
+    // From the previous state (0) to the current one (1)
+    float alpha() const { return (float) (accumulator / step); }
+    double stepSeconds() const { return step; }
+    double simulatedSeconds() const { return simulated; }
+    double droppedSeconds() const { return dropped; }
+
+private:
+    double step;
+    double accumulator = 0.0;
+    double simulated = 0.0;
+    double dropped = 0.0;
+};
+
+#endif //OPENGLPLAYGROUND_SIMULATIONCLOCK_H
@@ -0,0 +1,164 @@
+#include "TextureCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include "ContentHash.h"
+#include "MappedFile.h"
+
+namespace {
+
+struct TextureCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;     // BCFormat
+    uint32_t levelCount;
+};
+
+struct TextureCacheLevel {
+    uint32_t width, height;
+    uint64_t offset, bytes;
+};
+
+size_t alignUp(size_t value) {
+    return (value + TEXTURE_CACHE_ALIGNMENT - 1) & ~(size_t) (TEXTURE_CACHE_ALIGNMENT - 1);
+}
+
+} // namespace
+
+uint64_t textureCacheKey(const unsigned char *source, size_t size, const TextureCacheOptions &options,
+                         const MipOptions &mipOptions) {
+    // Everything that changes the output goes in the seed. Not the thread count, which doesn't.
+    uint32_t settings[8] = { TEXTURE_CACHE_VERSION, (uint32_t) options.format, (uint32_t) options.quality,
+                             mipOptions.srgb ? 1u : 0u, (uint32_t) mipOptions.filter,
+                             mipOptions.alphaWeighted ? 1u : 0u, 0, 0 };
+    std::memcpy(&settings[6], &mipOptions.alphaCutoff, sizeof(float));
+    const uint64_t seed = contentHash(reinterpret_cast<const unsigned char *>(settings), sizeof(settings));
+    return contentHash(source, size, seed);
+}
+
+std::string textureCachePath(const std::string &directory, uint64_t key) {
+    return directory + "/" + contentHashString(key) + ".btex";
+}
+
+bool writeTextureCache(const char *path, uint64_t key, const std::vector<CompressedImage> &levels) {
+    if (levels.empty())
+        return false;
+    TextureCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = TEXTURE_CACHE_MAGIC;
+    header.version = TEXTURE_CACHE_VERSION;
+    header.key = key;
+    header.format = (uint32_t) levels[0].format;
+    header.levelCount = (uint32_t) levels.size();
+    std::vector<TextureCacheLevel> table(levels.size());
+    size_t offset = alignUp(sizeof(header) + table.size() * sizeof(TextureCacheLevel));
+    for (size_t l = 0; l < levels.size(); l++) {
+        table[l].width = (uint32_t) levels[l].width;
+        table[l].height = (uint32_t) levels[l].height;
+        table[l].offset = offset;
+        table[l].bytes = levels[l].bytes();
+        offset = alignUp(offset + levels[l].bytes());
+    }
+
+    // Temporary name and rename, like the mesh cache, so a reader never maps a half written file
+    const std::string temporary = std::string(path) + ".tmp";
+    std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR::TEXTURECACHE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    const char padding[TEXTURE_CACHE_ALIGNMENT] = {};
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(table.data()), (std::streamsize) (table.size() * sizeof(TextureCacheLevel)));
+    size_t written = sizeof(header) + table.size() * sizeof(TextureCacheLevel);
+    for (size_t l = 0; l < levels.size(); l++) {
+        out.write(padding, (std::streamsize) (table[l].offset - written));
+        out.write(reinterpret_cast<const char *>(levels[l].blocks.data()), (std::streamsize) levels[l].bytes());
+        written = (size_t) (table[l].offset + table[l].bytes);
+    }
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path) != 0) {
+        std::cerr << "ERROR::TEXTURECACHE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readTextureCache(const char *path, uint64_t key, std::vector<CompressedImage> &levels) {
+    levels.clear();
+    struct stat info;
+    if (stat(path, &info) != 0)
+        return false; // not built yet
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+    const unsigned char *data = file.data();
+    const size_t size = file.size();
+    TextureCacheHeader header;
+    if (size < sizeof(header)) {
+        std::cerr << "ERROR::TEXTURECACHE::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != TEXTURE_CACHE_MAGIC || header.version != TEXTURE_CACHE_VERSION || header.key != key) {
+        std::cerr << "ERROR::TEXTURECACHE::WRONG_VERSION " << path << std::endl;
+        return false;
+    }
+    const BCFormat format = (BCFormat) header.format;
+    if ((format != BCFormat::BC1 && format != BCFormat::BC3 && format != BCFormat::BC5 && format != BCFormat::BC7) ||
+        header.levelCount == 0 || header.levelCount > 32 ||
+        sizeof(header) + (uint64_t) header.levelCount * sizeof(TextureCacheLevel) > size) {
+        std::cerr << "ERROR::TEXTURECACHE::CORRUPT " << path << std::endl;
+        return false;
+    }
+    levels.resize(header.levelCount);
+    for (uint32_t l = 0; l < header.levelCount; l++) {
+        TextureCacheLevel level;
+        std::memcpy(&level, data + sizeof(header) + l * sizeof(level), sizeof(level));
+        CompressedImage &image = levels[l];
+        image.format = format;
+        image.width = (int) level.width;
+        image.height = (int) level.height;
+        if (level.width == 0 || level.height == 0 || level.width > 65536 || level.height > 65536 ||
+            level.bytes != (uint64_t) image.blocksWide() * image.blocksHigh() * bcBlockBytes(format) ||
+            level.offset > size || level.bytes > size - level.offset) {
+            std::cerr << "ERROR::TEXTURECACHE::CORRUPT " << path << std::endl;
+            levels.clear();
+            return false;
+        }
+        image.blocks.assign(data + level.offset, data + level.offset + level.bytes);
+    }
+    return true;
+}
+
+void compressMipChain(Image &&image, const TextureCacheOptions &options, const MipOptions &mipOptions,
+                      std::vector<CompressedImage> &levels) {
+    std::vector<Image> mips;
+    buildMipChain(std::move(image), mips, mipOptions);
+    levels.resize(mips.size());
+    for (size_t l = 0; l < mips.size(); l++)
+        compressImage(mips[l], options.format, options.quality, levels[l], options.threadCount);
+}
+
+bool loadCompressedTexture(const unsigned char *source, size_t size, const TextureCacheOptions &options,
+                           const MipOptions &mipOptions, std::vector<CompressedImage> &levels, bool *fromCache) {
+    const uint64_t key = textureCacheKey(source, size, options, mipOptions);
+    const std::string path = textureCachePath(options.directory, key);
+    if (fromCache)
+        *fromCache = false;
+    if (readTextureCache(path.c_str(), key, levels)) {
+        if (fromCache)
+            *fromCache = true;
+        return true;
+    }
+    Image image;
+    if (!decodeImage(source, size, image))
+        return false;
+    compressMipChain(std::move(image), options, mipOptions, levels);
+    writeTextureCache(path.c_str(), key, levels); // a cache we can't write only costs the next load
+    return true;
+}
@@ -0,0 +1,45 @@
+#ifndef OPENGLPLAYGROUND_TEXTURECACHE_H
+#define OPENGLPLAYGROUND_TEXTURECACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MipBuilder.h"
+#include "TextureCompression.h"
+
+// Block compressed mip chains on disk (.btex), so the encoder only ever runs once per image. Files are named
+// by a key that hashes the source file's contents with the settings they were built with: renaming or
+// touching a texture still hits, and changing a pixel or a setting misses (the stale file is just left
+// behind). Layout: a header, a table with a record per level, then each level's blocks 64 byte aligned,
+// exactly as glCompressedTexSubImage2D takes them.
+
+#define TEXTURE_CACHE_MAGIC 0x5450474Fu // "OGPT"
+#define TEXTURE_CACHE_VERSION 1
+#define TEXTURE_CACHE_ALIGNMENT 64
+
+struct TextureCacheOptions {
+    BCFormat format = BCFormat::BC7;
+    BCQuality quality = BCQuality::Normal;
+    std::string directory = "."; // has to exist
+    int threadCount = 0;         // for the encoder, 0 = one per core
+};
+
+uint64_t textureCacheKey(const unsigned char *source, size_t size, const TextureCacheOptions &options,
+                         const MipOptions &mipOptions);
+std::string textureCachePath(const std::string &directory, uint64_t key);
+
+bool writeTextureCache(const char *path, uint64_t key, const std::vector<CompressedImage> &levels);
+// False without a message if the file doesn't exist, with one if it's corrupt
+bool readTextureCache(const char *path, uint64_t key, std::vector<CompressedImage> &levels);
+
+// Builds the mip chain and compresses every level
+void compressMipChain(Image &&image, const TextureCacheOptions &options, const MipOptions &mipOptions,
+                      std::vector<CompressedImage> &levels);
+
+// The cache's levels for an encoded image (PNG/JPEG bytes), or decodes, compresses and writes them to the
+// cache. fromCache says which.
+bool loadCompressedTexture(const unsigned char *source, size_t size, const TextureCacheOptions &options,
+                           const MipOptions &mipOptions, std::vector<CompressedImage> &levels,
+                           bool *fromCache = nullptr);
+
+#endif //OPENGLPLAYGROUND_TEXTURECACHE_H
@@ -0,0 +1,687 @@
+#include "TextureCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glad/glad.h>
+#include "Parallel.h"
+
+// Rows of blocks per parallelFor job: a 4096 wide texture is 1024 blocks a row
+#define BC_ROWS_PER_JOB 4
+
+namespace {
+
+// 16 texels of a block, 0-255 floats, RGBA
+struct BlockTexels {
+    float v[16][4];
+};
+
+void loadBlock(const Image &image, int blockX, int blockY, BlockTexels &block) {
+    // Blocks hanging over the edge repeat the last row/column, which keeps them out of the endpoint fit
+    for (int y = 0; y < 4; y++) {
+        const int sy = std::min(blockY * 4 + y, image.height - 1);
+        for (int x = 0; x < 4; x++) {
+            const int sx = std::min(blockX * 4 + x, image.width - 1);
+            const unsigned char *texel = &image.pixels[((size_t) sy * image.width + sx) * 4];
+            for (int c = 0; c < 4; c++)
+                block.v[y * 4 + x][c] = texel[c];
+        }
+    }
+}
+
+inline float clamp255(float v) {
+    return std::min(std::max(v, 0.0f), 255.0f);
+}
+
+// Endpoints of a line through the selected texels' first `channels` channels: the bounding box diagonal
+// for Fast, otherwise the principal axis (power iteration on the covariance) across the extent of the texels
+void fitLine(const BlockTexels &block, const bool *selected, int channels, BCQuality quality, float lo[4], float hi[4]) {
+    float minimum[4] = { 255.0f, 255.0f, 255.0f, 255.0f }, maximum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float mean[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    int count = 0;
+    for (int i = 0; i < 16; i++) {
+        if (!selected[i])
+            continue;
+        count++;
+        for (int c = 0; c < channels; c++) {
+            minimum[c] = std::min(minimum[c], block.v[i][c]);
+            maximum[c] = std::max(maximum[c], block.v[i][c]);
+            mean[c] += block.v[i][c];
+        }
+    }
+    if (count == 0) {
+        for (int c = 0; c < 4; c++)
+            lo[c] = hi[c] = 0.0f;
+        return;
+    }
+    if (quality == BCQuality::Fast) {
+        // Inset by 1/16 of the range: the extremes are rarely worth a whole endpoint
+        for (int c = 0; c < channels; c++) {
+            const float inset = (maximum[c] - minimum[c]) / 16.0f;
+            lo[c] = minimum[c] + inset;
+            hi[c] = maximum[c] - inset;
+        }
+        return;
+    }
+
+    for (int c = 0; c < channels; c++)
+        mean[c] /= (float) count;
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++) {
+        if (!selected[i])
+            continue;
+        for (int a = 0; a < channels; a++)
+            for (int b = a; b < channels; b++)
+                covariance[a][b] += (block.v[i][a] - mean[a]) * (block.v[i][b] - mean[b]);
+    }
+    for (int a = 0; a < channels; a++)
+        for (int b = 0; b < a; b++)
+            covariance[a][b] = covariance[b][a];
+    float axis[4];
+    for (int c = 0; c < channels; c++)
+        axis[c] = maximum[c] - minimum[c];
+    for (int iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {}, length = 0.0f;
+        for (int a = 0; a < channels; a++) {
+            for (int b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length == 0.0f)
+            break; // every texel the same colour
+        for (int c = 0; c < channels; c++)
+            axis[c] = next[c] / length;
+    }
+    float tMin = 1e30f, tMax = -1e30f, axisLength = 0.0f;
+    for (int c = 0; c < channels; c++)
+        axisLength += axis[c] * axis[c];
+    if (axisLength == 0.0f) {
+        for (int c = 0; c < channels; c++)
+            lo[c] = hi[c] = mean[c];
+        return;
+    }
+    for (int i = 0; i < 16; i++) {
+        if (!selected[i])
+            continue;
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (block.v[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (int c = 0; c < channels; c++) {
+        lo[c] = clamp255(mean[c] + axis[c] * tMin / axisLength);
+        hi[c] = clamp255(mean[c] + axis[c] * tMax / axisLength);
+    }
+}
+
+// Least squares endpoints for fixed indices: each texel is (1 - w) * lo + w * hi. False if the weights
+// don't pin the line down (all texels on one index).
+bool refitLine(const BlockTexels &block, const bool *selected, const float *weights, int channels, float lo[4],
+               float hi[4]) {
+    float a = 0.0f, b = 0.0f, c = 0.0f, x0[4] = {}, x1[4] = {};
+    for (int i = 0; i < 16; i++) {
+        if (!selected[i])
+            continue;
+        const float w = weights[i], v = 1.0f - w;
+        a += v * v;
+        b += v * w;
+        c += w * w;
+        for (int k = 0; k < channels; k++) {
+            x0[k] += v * block.v[i][k];
+            x1[k] += w * block.v[i][k];
+        }
+    }
+    const float determinant = a * c - b * b;
+    if (std::fabs(determinant) < 1e-6f)
+        return false;
+    for (int k = 0; k < channels; k++) {
+        lo[k] = clamp255((c * x0[k] - b * x1[k]) / determinant);
+        hi[k] = clamp255((a * x1[k] - b * x0[k]) / determinant);
+    }
+    return true;
+}
+
+// ---- BC1 ----
+
+inline uint16_t to565(const float *c) {
+    const int r = (int) std::lround(c[0] * 31.0f / 255.0f), g = (int) std::lround(c[1] * 63.0f / 255.0f);
+    const int b = (int) std::lround(c[2] * 31.0f / 255.0f);
+    return (uint16_t) ((r << 11) | (g << 5) | b);
+}
+
+inline void from565(uint16_t c, int rgb[3]) {
+    const int r = c >> 11, g = (c >> 5) & 63, b = c & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// The palette a decoder derives from two endpoints. Four colours if c0 > c1 (or always, for BC3's colour
+// half), otherwise three and transparent black.
+void bc1Palette(uint16_t c0, uint16_t c1, bool alwaysFourColours, unsigned char palette[4][4]) {
+    int a[3], b[3];
+    from565(c0, a);
+    from565(c1, b);
+    const bool four = alwaysFourColours || c0 > c1;
+    for (int c = 0; c < 3; c++) {
+        palette[0][c] = (unsigned char) a[c];
+        palette[1][c] = (unsigned char) b[c];
+        palette[2][c] = (unsigned char) (four ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2);
+        palette[3][c] = (unsigned char) (four ? (a[c] + 2 * b[c]) / 3 : 0);
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = (unsigned char) (four ? 255 : 0);
+}
+
+// Where each BC1 index sits on the line, for the refit
+const float BC1_WEIGHTS_FOUR[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+const float BC1_WEIGHTS_THREE[4] = { 0.0f, 1.0f, 0.5f, 0.0f };
+
+struct BC1Result {
+    uint16_t c0 = 0, c1 = 0;
+    uint32_t indices = 0;
+    float error = 1e30f;
+    int index[16] = {};
+};
+
+// Picks indices for a given pair of endpoints. Transparent texels get index 3 of a three colour block.
+BC1Result bc1Evaluate(const BlockTexels &block, const bool *opaque, uint16_t c0, uint16_t c1, bool alwaysFourColours) {
+    BC1Result result;
+    result.c0 = c0;
+    result.c1 = c1;
+    result.error = 0.0f;
+    unsigned char palette[4][4];
+    bc1Palette(c0, c1, alwaysFourColours, palette);
+    const bool four = alwaysFourColours || c0 > c1;
+    for (int i = 0; i < 16; i++) {
+        int best = 3;
+        if (opaque[i]) {
+            float bestError = 1e30f;
+            for (int p = 0; p < (four ? 4 : 3); p++) {
+                float error = 0.0f;
+                for (int c = 0; c < 3; c++) {
+                    const float d = block.v[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            result.error += bestError;
+        }
+        result.index[i] = best;
+        result.indices |= (uint32_t) best << (2 * i);
+    }
+    return result;
+}
+
+// Encodes lo-hi in one of the two modes: four colours wants c0 > c1, three colours c0 <= c1
+BC1Result bc1Try(const BlockTexels &block, const bool *opaque, const float lo[4], const float hi[4], bool threeColours,
+                 bool alwaysFourColours) {
+    uint16_t c0 = to565(hi), c1 = to565(lo);
+    if (threeColours ? c0 > c1 : c0 < c1)
+        std::swap(c0, c1);
+    return bc1Evaluate(block, opaque, c0, c1, alwaysFourColours);
+}
+
+void bc1Encode(const BlockTexels &block, BCQuality quality, bool alwaysFourColours, unsigned char *out) {
+    bool opaque[16];
+    bool anyTransparent = false;
+    for (int i = 0; i < 16; i++) {
+        opaque[i] = alwaysFourColours || block.v[i][3] >= 128.0f;
+        anyTransparent |= !opaque[i];
+    }
+    float lo[4], hi[4];
+    fitLine(block, opaque, 3, quality, lo, hi);
+
+    // Punched out texels need the three colour mode, otherwise four colours and (Best) three tried too
+    const bool tryFour = !anyTransparent, tryThree = anyTransparent || (quality == BCQuality::Best && !alwaysFourColours);
+    BC1Result best;
+    for (int mode = 0; mode < 2; mode++) {
+        const bool three = mode == 1;
+        if (three ? !tryThree : !tryFour)
+            continue;
+        float l[4] = { lo[0], lo[1], lo[2], 0.0f }, h[4] = { hi[0], hi[1], hi[2], 0.0f };
+        BC1Result result = bc1Try(block, opaque, l, h, three, alwaysFourColours);
+        const int refits = quality == BCQuality::Fast ? 0 : quality == BCQuality::Normal ? 1 : 4;
+        for (int r = 0; r < refits; r++) {
+            // Weights relative to whichever endpoint ended up as c0
+            float weights[16];
+            const bool four = alwaysFourColours || result.c0 > result.c1;
+            for (int i = 0; i < 16; i++)
+                weights[i] = (four ? BC1_WEIGHTS_FOUR : BC1_WEIGHTS_THREE)[result.index[i]];
+            float c0[4], c1[4];
+            if (!refitLine(block, opaque, weights, 3, c0, c1))
+                break;
+            BC1Result refit = bc1Try(block, opaque, c1, c0, three, alwaysFourColours);
+            if (refit.error >= result.error)
+                break;
+            result = refit;
+        }
+        if (result.error < best.error)
+            best = result;
+    }
+    std::memcpy(out, &best.c0, 2);
+    std::memcpy(out + 2, &best.c1, 2);
+    std::memcpy(out + 4, &best.indices, 4);
+}
+
+// ---- BC4 (BC3's alpha, each of BC5's channels) ----
+
+void bc4Palette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; i++)
+            palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    } else {
+        for (int i = 1; i < 5; i++)
+            palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+float bc4Evaluate(const float *values, int a0, int a1, int index[16]) {
+    int palette[8];
+    bc4Palette(a0, a1, palette);
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float bestError = 1e30f;
+        for (int p = 0; p < 8; p++) {
+            const float d = values[i] - (float) palette[p];
+            if (d * d < bestError) {
+                bestError = d * d;
+                index[i] = p;
+            }
+        }
+        total += bestError;
+    }
+    return total;
+}
+
+void bc4Encode(const float *values, BCQuality quality, unsigned char *out) {
+    float lo = 255.0f, hi = 0.0f, innerLo = 255.0f, innerHi = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        lo = std::min(lo, values[i]);
+        hi = std::max(hi, values[i]);
+        if (values[i] > 0.0f && values[i] < 255.0f) {
+            innerLo = std::min(innerLo, values[i]);
+            innerHi = std::max(innerHi, values[i]);
+        }
+    }
+    // Eight values between the extremes (a0 > a1)
+    int a0 = (int) std::lround(hi), a1 = (int) std::lround(lo);
+    int index[16], bestIndex[16];
+    float bestError = bc4Evaluate(values, a0, a1, bestIndex);
+    int best0 = a0, best1 = a1;
+    const int refits = quality == BCQuality::Fast ? 0 : quality == BCQuality::Normal ? 1 : 4;
+    for (int r = 0; r < refits && best0 > best1; r++) {
+        float a = 0.0f, b = 0.0f, c = 0.0f, x0 = 0.0f, x1 = 0.0f;
+        for (int i = 0; i < 16; i++) {
+            const float w = bestIndex[i] == 0 ? 0.0f : bestIndex[i] == 1 ? 1.0f : (float) (bestIndex[i] - 1) / 7.0f;
+            a += (1.0f - w) * (1.0f - w);
+            b += (1.0f - w) * w;
+            c += w * w;
+            x0 += (1.0f - w) * values[i];
+            x1 += w * values[i];
+        }
+        const float determinant = a * c - b * b;
+        if (std::fabs(determinant) < 1e-6f)
+            break;
+        const int n0 = (int) std::lround(clamp255((c * x0 - b * x1) / determinant));
+        const int n1 = (int) std::lround(clamp255((a * x1 - b * x0) / determinant));
+        if (n0 <= n1)
+            break;
+        const float error = bc4Evaluate(values, n0, n1, index);
+        if (error >= bestError)
+            break;
+        bestError = error;
+        best0 = n0;
+        best1 = n1;
+        std::memcpy(bestIndex, index, sizeof(index));
+    }
+    // Six values between the texels that aren't exactly 0 or 255, which get their own codes (a0 <= a1)
+    if (quality == BCQuality::Best && innerLo <= innerHi) {
+        const int s0 = (int) std::lround(innerLo), s1 = (int) std::lround(innerHi);
+        const float error = bc4Evaluate(values, s0, s1, index);
+        if (error < bestError) {
+            bestError = error;
+            best0 = s0;
+            best1 = s1;
+            std::memcpy(bestIndex, index, sizeof(index));
+        }
+    }
+
+    out[0] = (unsigned char) best0;
+    out[1] = (unsigned char) best1;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint64_t) bestIndex[i] << (3 * i);
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (unsigned char) (bits >> (8 * i));
+}
+
+void bc4Decode(const unsigned char *block, unsigned char *texels, int stride) {
+    int palette[8];
+    bc4Palette(block[0], block[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t) block[2 + i] << (8 * i);
+    for (int i = 0; i < 16; i++)
+        texels[i * stride] = (unsigned char) palette[(bits >> (3 * i)) & 7];
+}
+
+// ---- BC7 mode 6 ----
+
+const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+inline int bc7Interpolate(int e0, int e1, int weight) {
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+struct BC7Result {
+    int endpoint[2][4] = {}; // 7 bit values
+    int pbit[2] = {};
+    int index[16] = {};
+    float error = 1e30f;
+};
+
+// Nearest of the 16 interpolated colours for each texel: project onto the line for a first guess,
+// then compare against its neighbours (the weights aren't evenly spaced)
+void bc7Evaluate(const BlockTexels &block, BC7Result &result) {
+    int e[2][4];
+    for (int s = 0; s < 2; s++)
+        for (int c = 0; c < 4; c++)
+            e[s][c] = (result.endpoint[s][c] << 1) | result.pbit[s];
+    int palette[16][4];
+    for (int w = 0; w < 16; w++)
+        for (int c = 0; c < 4; c++)
+            palette[w][c] = bc7Interpolate(e[0][c], e[1][c], BC7_WEIGHTS[w]);
+    float direction[4], lengthSquared = 0.0f;
+    for (int c = 0; c < 4; c++) {
+        direction[c] = (float) (e[1][c] - e[0][c]);
+        lengthSquared += direction[c] * direction[c];
+    }
+    result.error = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        int guess = 0;
+        if (lengthSquared > 0.0f) {
+            float t = 0.0f;
+            for (int c = 0; c < 4; c++)
+                t += (block.v[i][c] - (float) e[0][c]) * direction[c];
+            guess = std::min(std::max((int) std::lround(t / lengthSquared * 15.0f), 0), 15);
+        }
+        float bestError = 1e30f;
+        for (int w = std::max(guess - 1, 0); w <= std::min(guess + 1, 15); w++) {
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++) {
+                const float d = block.v[i][c] - (float) palette[w][c];
+                error += d * d;
+            }
+            if (error < bestError) {
+                bestError = error;
+                result.index[i] = w;
+            }
+        }
+        result.error += bestError;
+    }
+}
+
+// 8 bit endpoint -> 7 bits + shared p-bit. pbit < 0 picks whichever p-bit fits the endpoint best.
+void bc7Quantize(const float value[4], int pbit, int endpoint[4], int &chosen) {
+    float bestError = 1e30f;
+    for (int p = 0; p < 2; p++) {
+        if (pbit >= 0 && p != pbit)
+            continue;
+        int q[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++) {
+            q[c] = std::min(std::max((int) std::lround((value[c] - (float) p) / 2.0f), 0), 127);
+            const float d = value[c] - (float) ((q[c] << 1) | p);
+            error += d * d;
+        }
+        if (error < bestError) {
+            bestError = error;
+            chosen = p;
+            std::memcpy(endpoint, q, sizeof(q));
+        }
+    }
+}
+
+BC7Result bc7Try(const BlockTexels &block, const float lo[4], const float hi[4], int pbit0, int pbit1) {
+    BC7Result result;
+    bc7Quantize(lo, pbit0, result.endpoint[0], result.pbit[0]);
+    bc7Quantize(hi, pbit1, result.endpoint[1], result.pbit[1]);
+    bc7Evaluate(block, result);
+    return result;
+}
+
+void bc7Encode(const BlockTexels &block, BCQuality quality, unsigned char *out) {
+    bool all[16];
+    std::fill(all, all + 16, true);
+    float lo[4], hi[4];
+    fitLine(block, all, 4, quality, lo, hi);
+
+    BC7Result best;
+    // Best tries every p-bit pair against the real error, otherwise each endpoint picks its own
+    const int combinations = quality == BCQuality::Best ? 4 : 1;
+    for (int combination = 0; combination < combinations; combination++) {
+        const int p0 = combinations == 1 ? -1 : combination & 1, p1 = combinations == 1 ? -1 : combination >> 1;
+        BC7Result result = bc7Try(block, lo, hi, p0, p1);
+        const int refits = quality == BCQuality::Fast ? 0 : quality == BCQuality::Normal ? 1 : 4;
+        for (int r = 0; r < refits; r++) {
+            float weights[16], l[4], h[4];
+            for (int i = 0; i < 16; i++)
+                weights[i] = (float) BC7_WEIGHTS[result.index[i]] / 64.0f;
+            if (!refitLine(block, all, weights, 4, l, h))
+                break;
+            BC7Result refit = bc7Try(block, l, h, p0, p1);
+            if (refit.error >= result.error)
+                break;
+            result = refit;
+        }
+        if (result.error < best.error)
+            best = result;
+    }
+
+    // Texel 0's index is stored with its top bit implied zero: flip the line if it's in the upper half
+    if (best.index[0] >= 8) {
+        for (int c = 0; c < 4; c++)
+            std::swap(best.endpoint[0][c], best.endpoint[1][c]);
+        std::swap(best.pbit[0], best.pbit[1]);
+        for (int &index : best.index)
+            index = 15 - index;
+    }
+
+    // Mode 6: 7 bit mode (1 << 6), R0 R1 G0 G1 B0 B1 A0 A1 at 7 bits, P0 P1, then 3 + 15 * 4 index bits
+    uint64_t bits[2] = { 0, 0 };
+    int position = 0;
+    auto write = [&](uint64_t value, int count) {
+        for (int i = 0; i < count; i++, position++)
+            bits[position >> 6] |= ((value >> i) & 1) << (position & 63);
+    };
+    write(1u << 6, 7);
+    for (int c = 0; c < 4; c++) {
+        write((uint64_t) best.endpoint[0][c], 7);
+        write((uint64_t) best.endpoint[1][c], 7);
+    }
+    write((uint64_t) best.pbit[0], 1);
+    write((uint64_t) best.pbit[1], 1);
+    for (int i = 0; i < 16; i++)
+        write((uint64_t) best.index[i], i == 0 ? 3 : 4);
+    std::memcpy(out, bits, 16);
+}
+
+void bc7Decode(const unsigned char *block, unsigned char texels[64]) {
+    uint64_t bits[2];
+    std::memcpy(bits, block, 16);
+    int position = 0;
+    auto read = [&](int count) {
+        int value = 0;
+        for (int i = 0; i < count; i++, position++)
+            value |= (int) ((bits[position >> 6] >> (position & 63)) & 1) << i;
+        return value;
+    };
+    if (read(7) != (1 << 6)) {
+        // Not mode 6, so not ours: transparent black, like a GPU does with a malformed block
+        std::memset(texels, 0, 64);
+        return;
+    }
+    int e[2][4];
+    for (int c = 0; c < 4; c++) {
+        e[0][c] = read(7);
+        e[1][c] = read(7);
+    }
+    const int p0 = read(1), p1 = read(1);
+    for (int c = 0; c < 4; c++) {
+        e[0][c] = (e[0][c] << 1) | p0;
+        e[1][c] = (e[1][c] << 1) | p1;
+    }
+    for (int i = 0; i < 16; i++) {
+        const int weight = BC7_WEIGHTS[read(i == 0 ? 3 : 4)];
+        for (int c = 0; c < 4; c++)
+            texels[i * 4 + c] = (unsigned char) bc7Interpolate(e[0][c], e[1][c], weight);
+    }
+}
+
+void encodeBlock(const BlockTexels &block, BCFormat format, BCQuality quality, unsigned char *out) {
+    switch (format) {
+        case BCFormat::BC1:
+            bc1Encode(block, quality, false, out);
+            break;
+        case BCFormat::BC3: {
+            float alpha[16];
+            for (int i = 0; i < 16; i++)
+                alpha[i] = block.v[i][3];
+            bc4Encode(alpha, quality, out);
+            bc1Encode(block, quality, true, out + 8);
+            break;
+        }
+        case BCFormat::BC5:
+            for (int c = 0; c < 2; c++) {
+                float channel[16];
+                for (int i = 0; i < 16; i++)
+                    channel[i] = block.v[i][c];
+                bc4Encode(channel, quality, out + c * 8);
+            }
+            break;
+        case BCFormat::BC7:
+            bc7Encode(block, quality, out);
+            break;
+    }
+}
+
+} // namespace
+
+uint32_t bcGLFormat(BCFormat format) {
+    switch (format) {
+        case BCFormat::BC1: return BC_GL_COMPRESSED_RGBA_S3TC_DXT1;
+        case BCFormat::BC3: return BC_GL_COMPRESSED_RGBA_S3TC_DXT5;
+        case BCFormat::BC5: return BC_GL_COMPRESSED_RG_RGTC2;
+        case BCFormat::BC7: return BC_GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+bool bcFormatSupported(BCFormat format) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (format == BCFormat::BC5)
+        return major >= 3;
+    if (format == BCFormat::BC7 && (major > 4 || (major == 4 && minor >= 2)))
+        return true;
+    const char *wanted = format == BCFormat::BC7 ? "GL_ARB_texture_compression_bptc" : "GL_EXT_texture_compression_s3tc";
+    GLint extensions = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+    for (GLint i = 0; i < extensions; i++) {
+        const char *name = (const char *) glGetStringi(GL_EXTENSIONS, (GLuint) i);
+        if (name && std::strcmp(name, wanted) == 0)
+            return true;
+    }
+    return false;
+}
+
+const char *bcFormatName(BCFormat format) {
+    switch (format) {
+        case BCFormat::BC1: return "BC1";
+        case BCFormat::BC3: return "BC3";
+        case BCFormat::BC5: return "BC5";
+        case BCFormat::BC7: return "BC7";
+    }
+    return "?";
+}
+
+void compressImage(const Image &image, BCFormat format, BCQuality quality, CompressedImage &out, int threadCount) {
+    out.format = format;
+    out.width = image.width;
+    out.height = image.height;
+    const size_t blockBytes = bcBlockBytes(format);
+    const int wide = out.blocksWide(), high = out.blocksHigh();
+    out.blocks.assign((size_t) wide * high * blockBytes, 0);
+    if (image.width <= 0 || image.height <= 0)
+        return;
+    parallelFor((size_t) high, BC_ROWS_PER_JOB, [&](size_t begin, size_t end) {
+        BlockTexels block;
+        for (size_t y = begin; y < end; y++)
+            for (int x = 0; x < wide; x++) {
+                loadBlock(image, x, (int) y, block);
+                encodeBlock(block, format, quality, &out.blocks[(y * wide + x) * blockBytes]);
+            }
+    }, threadCount);
+}
+
+void decompressBlock(BCFormat format, const unsigned char *block, unsigned char texels[64]) {
+    switch (format) {
+        case BCFormat::BC1:
+        case BCFormat::BC3: {
+            const unsigned char *colour = format == BCFormat::BC3 ? block + 8 : block;
+            uint16_t c0, c1;
+            uint32_t indices;
+            std::memcpy(&c0, colour, 2);
+            std::memcpy(&c1, colour + 2, 2);
+            std::memcpy(&indices, colour + 4, 4);
+            unsigned char palette[4][4];
+            bc1Palette(c0, c1, format == BCFormat::BC3, palette);
+            for (int i = 0; i < 16; i++)
+                std::memcpy(texels + i * 4, palette[(indices >> (2 * i)) & 3], 4);
+            if (format == BCFormat::BC3)
+                bc4Decode(block, texels + 3, 4);
+            break;
+        }
+        case BCFormat::BC5:
+            bc4Decode(block, texels, 4);
+            bc4Decode(block + 8, texels + 1, 4);
+            for (int i = 0; i < 16; i++) {
+                texels[i * 4 + 2] = 0;
+                texels[i * 4 + 3] = 255;
+            }
+            break;
+        case BCFormat::BC7:
+            bc7Decode(block, texels);
+            break;
+    }
+}
+
+void decompressImage(const CompressedImage &image, Image &out, int threadCount) {
+    out.width = image.width;
+    out.height = image.height;
+    out.pixels.resize((size_t) image.width * image.height * 4);
+    const size_t blockBytes = bcBlockBytes(image.format);
+    const int wide = image.blocksWide();
+    parallelFor((size_t) image.blocksHigh(), BC_ROWS_PER_JOB, [&](size_t begin, size_t end) {
+        unsigned char texels[64];
+        for (size_t by = begin; by < end; by++)
+            for (int bx = 0; bx < wide; bx++) {
+                decompressBlock(image.format, &image.blocks[(by * wide + bx) * blockBytes], texels);
+                // Only the part of the block inside the image
+                for (int y = 0; y < 4 && (int) by * 4 + y < image.height; y++) {
+                    const int columns = std::min(4, image.width - bx * 4);
+                    std::memcpy(&out.pixels[(((size_t) by * 4 + y) * image.width + bx * 4) * 4], texels + y * 16,
+                                (size_t) columns * 4);
+                }
+            }
+    }, threadCount);
+}
@@ -0,0 +1,67 @@
+#ifndef OPENGLPLAYGROUND_TEXTURECOMPRESSION_H
+#define OPENGLPLAYGROUND_TEXTURECOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageDecoder.h"
+
+// Block compressed (BCn / DXT) texture encoding and decoding. Each 4x4 texel block becomes 8 or 16
+// bytes the GPU samples directly: 4 to 8 times less VRAM and bandwidth than RGBA8.
+//   BC1: RGB (+ 1 bit alpha), 8 bytes a block
+//   BC3: RGBA, BC1 colour + an 8 value alpha ramp, 16 bytes
+//   BC5: two channels (R, G) with a ramp each, for normal maps, 16 bytes
+//   BC7: RGBA, 16 bytes, much better quality than BC1/3. Only mode 6 (one RGBA line, 16 step index) is
+//        encoded: a fraction of a full BC7 search's cost and good enough for most colour textures. The
+//        decoder handles mode 6 blocks only too, which is all this encoder writes.
+// Encoding splits the image into rows of blocks across threads. Decoding is there for the software
+// backend and tools, which can't sample compressed formats the way a GPU does.
+
+// The GL enums, which glad only has for the core ones (RGTC2). S3TC is an extension everywhere and BPTC
+// is core from 4.2, so check bcFormatSupported() before uploading.
+#define BC_GL_COMPRESSED_RGBA_S3TC_DXT1 0x83F1
+#define BC_GL_COMPRESSED_RGBA_S3TC_DXT5 0x83F3
+#define BC_GL_COMPRESSED_RG_RGTC2 0x8DBD
+#define BC_GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+
+enum class BCFormat : uint32_t {
+    BC1 = 1,
+    BC3 = 3,
+    BC5 = 5,
+    BC7 = 7
+};
+
+// How hard the encoder looks for endpoints
+enum class BCQuality : uint32_t {
+    Fast,   // bounding box of the block's colours
+    Normal, // principal axis, then one least squares refit
+    Best    // principal axis, refits until they stop helping, every alternative mode and p-bit tried
+};
+
+struct CompressedImage {
+    BCFormat format = BCFormat::BC1;
+    int width = 0, height = 0; // in texels, the blocks cover them rounded up to 4
+    std::vector<unsigned char> blocks; // rows of blocks, top to bottom
+
+    int blocksWide() const { return (width + 3) / 4; }
+    int blocksHigh() const { return (height + 3) / 4; }
+    size_t bytes() const { return blocks.size(); }
+};
+
+inline size_t bcBlockBytes(BCFormat format) {
+    return format == BCFormat::BC1 ? 8 : 16;
+}
+uint32_t bcGLFormat(BCFormat format);
+// Needs a current context. Checks the GL version and extension strings.
+bool bcFormatSupported(BCFormat format);
+const char *bcFormatName(BCFormat format);
+
+// BC1 punches out texels with alpha < 128, BC5 takes red and green and ignores the rest
+void compressImage(const Image &image, BCFormat format, BCQuality quality, CompressedImage &out,
+                   int threadCount = 0);
+// Back to RGBA8. BC5 comes back as (R, G, 0, 255).
+void decompressImage(const CompressedImage &image, Image &out, int threadCount = 0);
+// One block to 4x4 RGBA8 texels, rows top to bottom: for sampling without decompressing everything
+void decompressBlock(BCFormat format, const unsigned char *block, unsigned char texels[64]);
+
+#endif //OPENGLPLAYGROUND_TEXTURECOMPRESSION_H
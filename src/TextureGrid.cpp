@@ -0,0 +1,244 @@
+#include "TextureGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <unordered_map>
+#include "GLMesh.h"
+#include "Playground.h"
+#include "Reports.h"
+
+AssetHandle requestPackedTextures(AssetScheduler &assets, AssetRegistry &registry,
+                                  const std::vector<std::string> &paths, const TexturePackOptions &options,
+                                  PackedTextures &packed, std::vector<GLuint> &pageTextures) {
+    auto start = std::chrono::steady_clock::now();
+    auto sources = std::make_shared<std::vector<std::vector<unsigned char>>>(paths.size());
+    auto images = std::make_shared<std::vector<Image>>(paths.size());
+    // References on each image's content, let go of with the last callback holding them
+    auto contents = std::shared_ptr<std::vector<AssetId>>(
+            new std::vector<AssetId>(paths.size()), [&registry](std::vector<AssetId> *ids) {
+                for (AssetId id : *ids)
+                    if (id)
+                        registry.release(id);
+                delete ids;
+            });
+    AssetRequest pack;
+    pack.name = "texture pack";
+    pack.priority = assetPriority(0.0f, true);
+    for (size_t i = 0; i < paths.size(); i++) {
+        AssetRequest image;
+        image.name = paths[i];
+        image.priority = pack.priority;
+        const std::string path = paths[i];
+        image.read = [sources, path, i]() { return readAssetFile(path.c_str(), (*sources)[i]); };
+        image.decode = [sources, images, contents, &registry, i]() {
+            bool added = false;
+            (*contents)[i] = registry.acquire(AssetKind::Texture, (*sources)[i].data(), (*sources)[i].size(), &added);
+            // A copy of an image another request has: that one decodes it
+            const bool decoded = !added || decodeImage((*sources)[i].data(), (*sources)[i].size(), (*images)[i]);
+            if (!decoded && (*contents)[i])
+                registry.fail((*contents)[i]); // so it's decoded afresh next time rather than shared
+            (*sources)[i] = std::vector<unsigned char>();
+            return decoded;
+        };
+        pack.dependencies.push_back(assets.request(std::move(image)));
+    }
+    pack.decode = [images, contents, options, &packed, start]() {
+        // Each content packed once, by whichever request decoded it, and every copy pointed at its region
+        std::vector<const Image *> inputs;
+        std::vector<size_t> input(images->size());
+        std::unordered_map<AssetId, size_t> inputOf;
+        for (size_t i = 0; i < images->size(); i++) {
+            if (!(*images)[i].pixels.empty()) {
+                inputOf[(*contents)[i]] = inputs.size();
+                inputs.push_back(&(*images)[i]);
+            }
+        }
+        for (size_t i = 0; i < images->size(); i++)
+            input[i] = inputOf[(*contents)[i]];
+        packTextures(inputs, options, packed);
+        std::vector<TextureRegion> regions(images->size());
+        for (size_t i = 0; i < images->size(); i++)
+            regions[i] = packed.regions[input[i]];
+        packed.regions.swap(regions);
+        images->clear();
+        const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        size_t atlases = 0, arrays = 0, layers = 0, singles = 0;
+        float usage = 0.0f;
+        for (const TexturePage &page : packed.pages) {
+            if (page.array) {
+                arrays++;
+                layers += page.layers.size();
+            } else if (page.textureCount > 1) {
+                atlases++;
+                usage += page.usage;
+            } else {
+                singles++;
+            }
+        }
+        std::cout << "Packed " << input.size() << " textures (" << inputs.size() << " distinct) into "
+                  << packed.pages.size() << " in " << ms << " ms: " << atlases << " atlases (" << (atlases ? usage / atlases * 100.0f : 0.0f) << "% used), "
+                  << arrays << " arrays (" << layers << " layers), " << singles << " on their own. Binds per frame: "
+                  << input.size() << " -> " << packed.pages.size() << std::endl;
+        return true;
+    };
+    pack.upload = [&packed, &pageTextures]() {
+        TexturePage &page = packed.pages[pageTextures.size()];
+        pageTextures.push_back(uploadTexturePage(page));
+        if (!pageTextures.back())
+            return AssetUpload::Failed;
+        page.layers = std::vector<std::vector<Image>>(); // GL has it now
+        return pageTextures.size() == packed.pages.size() ? AssetUpload::Done : AssetUpload::More;
+    };
+    pack.discard = [&pageTextures]() {
+        glDeleteTextures((GLsizei) pageTextures.size(), pageTextures.data());
+        pageTextures.clear();
+    };
+    return assets.request(std::move(pack));
+}
+
+TextureGrid::TextureGrid(AssetRegistry &registry, GLuint vertexBuffer, GLuint elementBuffer) : registry(registry) {
+    // Textures are drawn with their own program, so they get a VAO of the quad with its attribute locations
+    // (and array textures with a program and VAO of their own). Where each quad goes and which part of its
+    // texture it shows are per instance attributes, from a buffer draw() fills.
+    program.reset(new Shader(texturedGridVertexShaderPath, texturedFragmentShaderPath));
+    arrayProgram.reset(new Shader(texturedGridVertexShaderPath, texturedArrayFragmentShaderPath));
+    glGenBuffers(1, &instanceBuffer);
+    GLuint *vaos[2] = { &vertexArray, &arrayVertexArray };
+    Shader *programs[2] = { program.get(), arrayProgram.get() };
+    for (int i = 0; i < 2; i++) {
+        programs[i]->use();
+        programs[i]->setInt(i ? "images" : "image", 0);
+        glGenVertexArrays(1, vaos[i]);
+        glBindVertexArray(*vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        applyVertexLayout(quadLayout(), programs[i]->ID);
+        placementLocation[i] = glGetAttribLocation(programs[i]->ID, "placement");
+        uvTransformLocation[i] = glGetAttribLocation(programs[i]->ID, "uvTransform");
+        for (GLint location : { placementLocation[i], uvTransformLocation[i] }) {
+            if (location < 0)
+                continue;
+            glEnableVertexAttribArray((GLuint) location);
+            glVertexAttribDivisor((GLuint) location, 1);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+TextureGrid::~TextureGrid() {
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteVertexArrays(1, &arrayVertexArray);
+    glDeleteBuffers(1, &instanceBuffer);
+    if (!pageTextures.empty())
+        glDeleteTextures((GLsizei) pageTextures.size(), pageTextures.data());
+}
+
+void TextureGrid::stream(const std::vector<std::string> &paths, bool compress, const TextureCacheOptions &compression) {
+    streamer.reset(new TextureStreamer(0, &registry));
+    streamer->compress = compress;
+    streamer->compression.format = compression.format;
+    streamer->compression.quality = compression.quality;
+    streamStart = std::chrono::steady_clock::now();
+    for (const std::string &path : paths) {
+        TexturedQuad quad;
+        quad.streamed = streamer->load(path);
+        quad.texture = streamer->texture(quad.streamed);
+        quads.push_back(quad);
+    }
+    sortQuads();
+}
+
+void TextureGrid::pack(AssetScheduler &assets, const std::vector<std::string> &paths, const TexturePackOptions &options) {
+    packAsset = requestPackedTextures(assets, registry, paths, options, packed, pageTextures);
+}
+
+bool TextureGrid::update(AssetScheduler &assets) {
+    if (packAsset) {
+        const AssetState state = assets.state(packAsset);
+        if (state == AssetState::Ready) {
+            for (const TextureRegion &region : packed.regions) {
+                TexturedQuad quad;
+                quad.texture = pageTextures[region.page];
+                quad.array = packed.pages[region.page].array;
+                quad.layer = region.layer;
+                quad.uvTransform = region.uvTransform;
+                quads.push_back(quad);
+            }
+            sortQuads();
+            packAsset = 0;
+        } else if (state == AssetState::Failed) {
+            return false;
+        }
+    }
+    if (streamer) {
+        streamer->update();
+        // Placeholders give way to the textures as they arrive, copies to the one they share
+        bool changed = false;
+        for (TexturedQuad &quad : quads) {
+            if (!quad.streamed)
+                continue;
+            const GLuint texture = streamer->texture(quad.streamed);
+            changed = changed || texture != quad.texture;
+            quad.texture = texture;
+        }
+        if (changed)
+            sortQuads();
+        if (!streamReported && !streamer->busy()) {
+            reportTextureStreaming(streamer->stats(), std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - streamStart).count());
+            reportAssetRegistry(registry.stats());
+            streamReported = true;
+        }
+    }
+    return true;
+}
+
+// Drawn grouped by texture, so each page is bound and drawn once however many quads use it
+void TextureGrid::sortQuads() {
+    order.resize(quads.size());
+    for (size_t i = 0; i < quads.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return quads[a].array != quads[b].array ? quads[b].array : quads[a].texture < quads[b].texture;
+    });
+}
+
+void TextureGrid::draw() {
+    const int columns = (int) std::ceil(std::sqrt((double) quads.size()));
+    const float cell = 2.0f / (float) columns;
+    instances.clear();
+    for (size_t i : order) {
+        const TexturedQuad &quad = quads[i];
+        instances.emplace_back(-1.0f + cell * ((float) (i % columns) + 0.5f), 1.0f - cell * ((float) (i / columns) + 0.5f),
+                               cell * 0.95f, (float) quad.layer);
+        instances.push_back(quad.uvTransform);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (instances.size() * sizeof(glm::vec4)), instances.data(), GL_STREAM_DRAW);
+
+    // Without a base instance (GL 4.2) each run points the attributes at its own quads instead
+    glActiveTexture(GL_TEXTURE0);
+    const size_t stride = 2 * sizeof(glm::vec4);
+    int current = -1;
+    for (size_t first = 0, last; first < order.size(); first = last) {
+        const TexturedQuad &quad = quads[order[first]];
+        for (last = first + 1; last < order.size(); last++)
+            if (quads[order[last]].texture != quad.texture || quads[order[last]].array != quad.array)
+                break;
+        const int wanted = quad.array ? 1 : 0;
+        if (wanted != current) {
+            current = wanted;
+            glUseProgram(current ? arrayProgram->ID : program->ID);
+            glBindVertexArray(current ? arrayVertexArray : vertexArray);
+        }
+        if (placementLocation[current] >= 0)
+            glVertexAttribPointer((GLuint) placementLocation[current], 4, GL_FLOAT, GL_FALSE, (GLsizei) stride,
+                                  (void *) (first * stride));
+        if (uvTransformLocation[current] >= 0)
+            glVertexAttribPointer((GLuint) uvTransformLocation[current], 4, GL_FLOAT, GL_FALSE, (GLsizei) stride,
+                                  (void *) (first * stride + sizeof(glm::vec4)));
+        glBindTexture(quad.array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, quad.texture);
+        glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0, (GLsizei) (last - first));
+    }
+}
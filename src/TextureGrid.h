@@ -0,0 +1,77 @@
+#ifndef OPENGLPLAYGROUND_TEXTUREGRID_H
+#define OPENGLPLAYGROUND_TEXTUREGRID_H
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "AssetRegistry.h"
+#include "AssetScheduler.h"
+#include "GLShader.h"
+#include "TextureCache.h"
+#include "TexturePacker.h"
+#include "TextureStreamer.h"
+
+// The --texture and --atlas modes: a grid of quads filling the window, one per image, either each streamed
+// into a texture of its own or all packed into atlases and arrays. Quads on the same texture are one
+// instanced draw, so packing cuts draws as well as binds.
+
+// A quad of the --texture/--atlas grid: its texture, and where in it the image is
+struct TexturedQuad {
+    TextureHandle streamed = 0; // --texture quads: texture is the streamer's for this, asked again each frame
+    GLuint texture = 0;
+    bool array = false;
+    int layer = 0;
+    glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+// Streams the images in (read and decoded on the scheduler's threads), then packs them once they're all
+// there and uploads the pages one per call. Images whose bytes the registry has seen already aren't decoded
+// again, and share a region in the pack. Prints what the packing saved.
+AssetHandle requestPackedTextures(AssetScheduler &assets, AssetRegistry &registry,
+                                  const std::vector<std::string> &paths, const TexturePackOptions &options,
+                                  PackedTextures &packed, std::vector<GLuint> &pageTextures);
+
+class TextureGrid {
+public:
+    // GL thread. Programs and VAOs for the quad in vertexBuffer and elementBuffer (see Playground.h). Has to
+    // outlive the scheduler pack() is given, and the registry has to outlive it.
+    TextureGrid(AssetRegistry &registry, GLuint vertexBuffer, GLuint elementBuffer);
+    ~TextureGrid();
+    TextureGrid(const TextureGrid &) = delete;
+    TextureGrid &operator=(const TextureGrid &) = delete;
+
+    // Each image on a quad of its own, streamed in through a TextureStreamer, block compressed (through a
+    // texture cache in the working directory) if compress is set
+    void stream(const std::vector<std::string> &paths, bool compress, const TextureCacheOptions &compression);
+    // The images packed into atlases and arrays, drawn once they all are
+    void pack(AssetScheduler &assets, const std::vector<std::string> &paths, const TexturePackOptions &options);
+
+    // GL thread, once a frame: takes in what's arrived. False once the packing has failed.
+    bool update(AssetScheduler &assets);
+    // GL thread. A draw per texture (page), not per quad.
+    void draw();
+    bool empty() const { return quads.empty(); }
+
+private:
+    AssetRegistry &registry;
+    std::unique_ptr<Shader> program, arrayProgram;
+    GLuint vertexArray = 0, arrayVertexArray = 0;
+    GLuint instanceBuffer = 0;
+    GLint placementLocation[2] = { -1, -1 }, uvTransformLocation[2] = { -1, -1 }; // program, arrayProgram
+    std::vector<glm::vec4> instances; // placement and uvTransform per quad, in draw order
+    std::vector<TexturedQuad> quads;
+    std::vector<size_t> order; // quads grouped by texture
+    std::unique_ptr<TextureStreamer> streamer;
+    std::chrono::steady_clock::time_point streamStart;
+    bool streamReported = false;
+    PackedTextures packed;
+    std::vector<GLuint> pageTextures; // packed pages
+    AssetHandle packAsset = 0;
+
+    void sortQuads();
+};
+
+#endif //OPENGLPLAYGROUND_TEXTUREGRID_H
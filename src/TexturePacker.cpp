@@ -0,0 +1,293 @@
+#include "TexturePacker.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <map>
+
+namespace {
+
+struct Rect {
+    int x = 0, y = 0, w = 0, h = 0;
+
+    bool contains(const Rect &other) const {
+        return other.x >= x && other.y >= y && other.x + other.w <= x + w && other.y + other.h <= y + h;
+    }
+    bool overlaps(const Rect &other) const {
+        return other.x < x + w && other.x + other.w > x && other.y < y + h && other.y + other.h > y;
+    }
+};
+
+// MaxRects: the free space is kept as every maximal free rectangle (they overlap), a placement goes into the
+// one it leaves the least of on its shorter side, and the free rectangles it hits are cut around it
+class MaxRectsBin {
+public:
+    int width, height;
+    int usedWidth = 0, usedHeight = 0;
+
+    MaxRectsBin(int width, int height) : width(width), height(height) {
+        Rect all;
+        all.w = width;
+        all.h = height;
+        free.push_back(all);
+    }
+
+    bool insert(int w, int h, Rect &placed) {
+        int bestShort = -1, bestLong = -1;
+        for (const Rect &space : free) {
+            if (space.w < w || space.h < h)
+                continue;
+            const int leftoverW = space.w - w, leftoverH = space.h - h;
+            const int shortSide = std::min(leftoverW, leftoverH), longSide = std::max(leftoverW, leftoverH);
+            if (bestShort < 0 || shortSide < bestShort || (shortSide == bestShort && longSide < bestLong)) {
+                bestShort = shortSide;
+                bestLong = longSide;
+                placed.x = space.x;
+                placed.y = space.y;
+            }
+        }
+        if (bestShort < 0)
+            return false;
+        placed.w = w;
+        placed.h = h;
+        split(placed);
+        usedWidth = std::max(usedWidth, placed.x + w);
+        usedHeight = std::max(usedHeight, placed.y + h);
+        return true;
+    }
+
+private:
+    std::vector<Rect> free;
+
+    void split(const Rect &placed) {
+        std::vector<Rect> next;
+        for (const Rect &space : free) {
+            if (!space.overlaps(placed)) {
+                next.push_back(space);
+                continue;
+            }
+            // What's left of the free rectangle on each side of the placement
+            if (placed.x > space.x)
+                next.push_back({ space.x, space.y, placed.x - space.x, space.h });
+            if (placed.x + placed.w < space.x + space.w)
+                next.push_back({ placed.x + placed.w, space.y, space.x + space.w - placed.x - placed.w, space.h });
+            if (placed.y > space.y)
+                next.push_back({ space.x, space.y, space.w, placed.y - space.y });
+            if (placed.y + placed.h < space.y + space.h)
+                next.push_back({ space.x, placed.y + placed.h, space.w, space.y + space.h - placed.y - placed.h });
+        }
+        // Drop rectangles inside others (keeping one of any duplicates)
+        free.clear();
+        for (size_t i = 0; i < next.size(); i++) {
+            bool redundant = false;
+            for (size_t j = 0; j < next.size() && !redundant; j++)
+                redundant = i != j && next[j].contains(next[i]) && (!next[i].contains(next[j]) || j < i);
+            if (!redundant)
+                free.push_back(next[i]);
+        }
+    }
+};
+
+int alignUp(int value, int alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int powerOfTwoAtLeast(int value) {
+    int result = 1;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+// A page holding one texture, or one layer of an array: its whole mip chain
+void addChain(const Image &image, const MipOptions &options, std::vector<Image> &mips) {
+    Image copy = image;
+    buildMipChain(std::move(copy), mips, options);
+}
+
+} // namespace
+
+void packTextures(const std::vector<const Image *> &images, const TexturePackOptions &options, PackedTextures &packed) {
+    packed.pages.clear();
+    packed.regions.assign(images.size(), TextureRegion());
+    const int padding = powerOfTwoAtLeast(std::max(options.padding, 1));
+    std::vector<bool> placed(images.size(), false);
+
+    // Arrays: textures grouped by size
+    if (options.arrays) {
+        std::map<std::pair<int, int>, std::vector<size_t>> sizes;
+        for (size_t i = 0; i < images.size(); i++)
+            sizes[std::make_pair(images[i]->width, images[i]->height)].push_back(i);
+        for (const auto &group : sizes) {
+            const std::vector<size_t> &members = group.second;
+            if ((int) members.size() < options.minArrayLayers)
+                continue;
+            for (size_t first = 0; first < members.size(); first += (size_t) options.maxArrayLayers) {
+                const size_t count = std::min(members.size() - first, (size_t) options.maxArrayLayers);
+                TexturePage page;
+                page.array = true;
+                page.width = group.first.first;
+                page.height = group.first.second;
+                page.layers.resize(count);
+                page.textureCount = (int) count;
+                page.usage = 1.0f;
+                for (size_t layer = 0; layer < count; layer++) {
+                    const size_t i = members[first + layer];
+                    addChain(*images[i], options.mipOptions, page.layers[layer]);
+                    packed.regions[i].page = (int) packed.pages.size();
+                    packed.regions[i].layer = (int) layer;
+                    placed[i] = true;
+                }
+                packed.pages.push_back(std::move(page));
+            }
+        }
+    }
+
+    // Atlases: biggest first, which is what makes greedy bin packing work
+    std::vector<size_t> order;
+    for (size_t i = 0; i < images.size(); i++) {
+        if (placed[i])
+            continue;
+        const int w = alignUp(images[i]->width + 2 * padding, padding), h = alignUp(images[i]->height + 2 * padding, padding);
+        if (images[i]->width > options.maxAtlasTexture || images[i]->height > options.maxAtlasTexture ||
+            w > options.atlasSize || h > options.atlasSize) {
+            // Too big to share: a page of its own
+            TexturePage page;
+            page.width = images[i]->width;
+            page.height = images[i]->height;
+            page.layers.resize(1);
+            page.textureCount = 1;
+            page.usage = 1.0f;
+            addChain(*images[i], options.mipOptions, page.layers[0]);
+            packed.regions[i].page = (int) packed.pages.size();
+            packed.pages.push_back(std::move(page));
+            continue;
+        }
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        const int sideA = std::max(images[a]->width, images[a]->height), sideB = std::max(images[b]->width, images[b]->height);
+        if (sideA != sideB)
+            return sideA > sideB;
+        return images[a]->width * images[a]->height > images[b]->width * images[b]->height;
+    });
+    // Each atlas starts at the smallest power of two size that could hold what's left and doubles (width then
+    // height) until it all fits, so a handful of textures doesn't end up spread over a mostly empty page. At
+    // full size whatever doesn't fit moves on to the next atlas.
+    std::vector<MaxRectsBin> bins;
+    std::vector<std::vector<std::pair<size_t, Rect>>> contents;
+    while (!order.empty()) {
+        size_t area = 0;
+        for (size_t i : order)
+            area += (size_t) alignUp(images[i]->width + 2 * padding, padding) *
+                    alignUp(images[i]->height + 2 * padding, padding);
+        int binW = padding, binH = padding;
+        while ((size_t) binW * binH < area && (binW < options.atlasSize || binH < options.atlasSize)) {
+            if (binW <= binH && binW < options.atlasSize)
+                binW *= 2;
+            else
+                binH *= 2;
+        }
+        for (;;) {
+            MaxRectsBin bin(binW, binH);
+            std::vector<std::pair<size_t, Rect>> fitted;
+            std::vector<size_t> left;
+            for (size_t i : order) {
+                const int w = alignUp(images[i]->width + 2 * padding, padding);
+                const int h = alignUp(images[i]->height + 2 * padding, padding);
+                Rect rect;
+                if (bin.insert(w, h, rect))
+                    fitted.push_back(std::make_pair(i, rect));
+                else
+                    left.push_back(i);
+            }
+            const bool full = binW >= options.atlasSize && binH >= options.atlasSize;
+            if (left.empty() || full) {
+                bins.push_back(bin);
+                contents.push_back(std::move(fitted));
+                order.swap(left);
+                break;
+            }
+            if (binW <= binH && binW < options.atlasSize)
+                binW *= 2;
+            else
+                binH *= 2;
+        }
+    }
+
+    MipOptions atlasMips = options.mipOptions;
+    atlasMips.filter = MipFilter::Box;
+    int atlasLevels = 1;
+    while ((1 << atlasLevels) <= padding)
+        atlasLevels++;
+    for (size_t b = 0; b < bins.size(); b++) {
+        TexturePage page;
+        page.width = powerOfTwoAtLeast(bins[b].usedWidth);
+        page.height = powerOfTwoAtLeast(bins[b].usedHeight);
+        page.textureCount = (int) contents[b].size();
+        Image atlas;
+        atlas.width = page.width;
+        atlas.height = page.height;
+        atlas.pixels.assign((size_t) page.width * page.height * 4, 0);
+        size_t texels = 0;
+        for (const std::pair<size_t, Rect> &entry : contents[b]) {
+            const Image &image = *images[entry.first];
+            const Rect &rect = entry.second;
+            // The texture plus its gutter, which repeats the edge texels outwards
+            for (int y = -padding; y < image.height + padding && rect.y + padding + y < rect.y + rect.h; y++) {
+                const int sy = std::min(std::max(y, 0), image.height - 1);
+                unsigned char *row = &atlas.pixels[((size_t) (rect.y + padding + y) * page.width) * 4];
+                for (int x = -padding; x < image.width + padding && rect.x + padding + x < rect.x + rect.w; x++) {
+                    const int sx = std::min(std::max(x, 0), image.width - 1);
+                    std::memcpy(row + (rect.x + padding + x) * 4, &image.pixels[((size_t) sy * image.width + sx) * 4], 4);
+                }
+            }
+            texels += (size_t) image.width * image.height;
+            TextureRegion &region = packed.regions[entry.first];
+            region.page = (int) packed.pages.size();
+            region.uvTransform = glm::vec4((float) image.width / page.width, (float) image.height / page.height,
+                                           (float) (rect.x + padding) / page.width, (float) (rect.y + padding) / page.height);
+        }
+        page.usage = (float) texels / ((float) page.width * page.height);
+        page.layers.resize(1);
+        buildMipChain(std::move(atlas), page.layers[0], atlasMips);
+        if ((int) page.layers[0].size() > atlasLevels)
+            page.layers[0].resize((size_t) atlasLevels);
+        packed.pages.push_back(std::move(page));
+    }
+}
+
+GLuint uploadTexturePage(const TexturePage &page) {
+    if (page.layers.empty() || page.layers[0].empty()) {
+        std::cerr << "ERROR::TEXTUREPACKER::EMPTY_PAGE" << std::endl;
+        return 0;
+    }
+    const GLenum target = texturePageTarget(page);
+    const int levels = (int) page.layers[0].size();
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(target, texture);
+    for (int l = 0; l < levels; l++) {
+        const Image &level = page.layers[0][l];
+        if (page.array) {
+            glTexImage3D(target, l, GL_RGBA8, level.width, level.height, (GLsizei) page.layers.size(), 0, GL_RGBA,
+                         GL_UNSIGNED_BYTE, nullptr);
+            for (size_t layer = 0; layer < page.layers.size(); layer++)
+                glTexSubImage3D(target, l, 0, 0, (GLint) layer, level.width, level.height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                                page.layers[layer][l].pixels.data());
+        } else {
+            glTexImage2D(target, l, GL_RGBA8, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         level.pixels.data());
+        }
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    // Atlased textures can't repeat: wrapping would sample the neighbours. Array layers and textures on a
+    // page of their own still can, so they keep the default.
+    if (!page.array && page.textureCount > 1) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(target, 0);
+    return texture;
+}
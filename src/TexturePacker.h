@@ -0,0 +1,59 @@
+#ifndef OPENGLPLAYGROUND_TEXTUREPACKER_H
+#define OPENGLPLAYGROUND_TEXTUREPACKER_H
+
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "ImageDecoder.h"
+#include "MipBuilder.h"
+
+// Packs many small textures into a few GL textures, so draws that only differ by texture stop needing a
+// glBindTexture between them (and can be merged, given a way to vary the UVs per draw):
+// - textures that share a size become layers of a GL_TEXTURE_2D_ARRAY, full mip chains, sampled with
+//   the layer index
+// - the rest go into atlases, MaxRects bin packed (best short side fit). Each one gets a gutter of repeated
+//   edge texels and sits on a multiple of the gutter width, so with 2x2 box filtered mips no level up to
+//   log2(gutter) mixes two textures; the atlas's chain stops there.
+// Textures too big for an atlas keep a page to themselves.
+
+struct TexturePackOptions {
+    int atlasSize = 2048;      // largest atlas side, atlases shrink to what they use (powers of two)
+    int padding = 8;           // power of two: gutter on each side and placement alignment
+    int maxAtlasTexture = 512; // bigger textures (either side) are never atlased
+    bool arrays = true;        // same size textures share an array, if there are at least minArrayLayers
+    int minArrayLayers = 2;
+    int maxArrayLayers = 256;  // GL 3.3's guaranteed GL_MAX_ARRAY_TEXTURE_LAYERS
+    MipOptions mipOptions;     // atlases always use the box filter, a wider one would reach over the gutter
+};
+
+// Where a texture ended up. Sample page `page` at uv * uvTransform.xy + uvTransform.zw (and at `layer`).
+struct TextureRegion {
+    int page = -1;
+    int layer = 0;
+    glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+};
+
+struct TexturePage {
+    bool array = false;
+    int width = 0, height = 0;
+    std::vector<std::vector<Image>> layers; // [layer][mip level], an atlas has one layer
+    int textureCount = 0;                   // how many inputs share it
+    float usage = 0.0f;                     // share of the page covered by texels (an atlas's gutters excluded)
+};
+
+struct PackedTextures {
+    std::vector<TexturePage> pages;
+    std::vector<TextureRegion> regions; // one per input, in input order
+};
+
+// Input order doesn't matter (they're sorted for packing). Images must be RGBA8 with non-zero sizes.
+void packTextures(const std::vector<const Image *> &images, const TexturePackOptions &options, PackedTextures &packed);
+
+// GL_TEXTURE_2D for an atlas, GL_TEXTURE_2D_ARRAY for an array, every level uploaded. Only atlases are
+// clamped to the edge. Returns 0 on failure.
+GLuint uploadTexturePage(const TexturePage &page);
+inline GLenum texturePageTarget(const TexturePage &page) {
+    return page.array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+}
+
+#endif //OPENGLPLAYGROUND_TEXTUREPACKER_H
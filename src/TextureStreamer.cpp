@@ -0,0 +1,330 @@
+#include "TextureStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include "MappedFile.h"
+
+void TextureStreamer::Stream::release(int l) {
+    if (compressed)
+        blocks[l].blocks = std::vector<unsigned char>();
+    else
+        mips[l].pixels = std::vector<unsigned char>();
+}
+
+TextureStreamer::TextureStreamer(int decodeThreads, AssetRegistry *registry)
+        : ownRegistry(registry ? nullptr : new AssetRegistry()), registry(registry ? registry : ownRegistry.get()),
+          workers(decodeThreads) {
+    mipOptions.threadCount = 1;
+    compression.threadCount = 1;
+    glGenTextures(1, &placeholder);
+    glBindTexture(GL_TEXTURE_2D, placeholder);
+    const unsigned char grey[4] = { 128, 128, 128, 255 };
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenBuffers(TEXTURE_PBO_COUNT, pbos);
+    for (GLuint pbo : pbos) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, TEXTURE_PBO_BYTES, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::~TextureStreamer() {
+    for (GLsync fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+    glDeleteBuffers(TEXTURE_PBO_COUNT, pbos);
+    // Workers that are still going won't acquire anything more, and the last reference to each texture
+    // deletes it
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    for (const std::unique_ptr<Stream> &stream : streams)
+        if (stream->content)
+            registry->release(stream->content);
+    glDeleteTextures(1, &placeholder);
+}
+
+TextureHandle TextureStreamer::load(const std::string &path) {
+    std::unique_ptr<Stream> stream(new Stream());
+    stream->path = path;
+    if (compress) {
+        if (formatSupported < 0 || checkedFormat != compression.format) {
+            checkedFormat = compression.format;
+            formatSupported = bcFormatSupported(checkedFormat) ? 1 : 0;
+            if (!formatSupported)
+                std::cerr << "ERROR::TEXTURESTREAMER::FORMAT_UNSUPPORTED " << bcFormatName(checkedFormat)
+                          << ", uploading RGBA8" << std::endl;
+        }
+        stream->compressed = formatSupported == 1;
+    }
+
+    Stream *raw = stream.get();
+    streams.push_back(std::move(stream));
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.requested++;
+    }
+    workers.push([this, raw]() { decode(raw); });
+    return (TextureHandle) streams.size();
+}
+
+void TextureStreamer::decode(Stream *stream) {
+    auto start = std::chrono::steady_clock::now();
+    size_t sourceBytes = 0, decodedBytes = 0;
+    bool fromCache = false;
+    {
+        MappedFile file;
+        Image image;
+        bool decoded = false;
+        if (file.open(stream->path.c_str())) {
+            // The cache key already covers the bytes and every setting that changes what comes out of them.
+            // Flipped for RGBA8 streams, so they don't share with compressed ones.
+            const uint64_t key = textureCacheKey(file.data(), file.size(), compression, mipOptions);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+                return;
+            stream->content = registry->acquire(AssetKind::Texture, stream->compressed ? key : ~key, file.size(),
+                                                &stream->owner);
+            if (stream->content && !stream->owner) {
+                // Someone else is loading this content: share theirs
+                stream->decoded = true;
+                finished.push_back(stream);
+                counters.deduplicated++;
+                return;
+            }
+        }
+        if (stream->owner) {
+            if (stream->compressed) {
+                decoded = loadCompressedTexture(file.data(), file.size(), compression, mipOptions, stream->blocks,
+                                                &fromCache);
+            } else if (decodeImage(file.data(), file.size(), image)) {
+                buildMipChain(std::move(image), stream->mips, mipOptions);
+                decoded = true;
+            }
+        }
+        if (decoded) {
+            sourceBytes = file.size();
+            for (int l = 0; l < stream->levelCount(); l++)
+                decodedBytes += stream->bytes(l);
+            stream->level = stream->levelCount() - 1;
+        } else {
+            std::cerr << "ERROR::TEXTURESTREAMER::DECODE_FAILED " << stream->path << std::endl;
+            stream->failed = true;
+        }
+    }
+    stream->decoded = true;
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // Under the lock, so no worker can start sharing the content between this and update() picking it up
+    if (stream->failed && stream->owner && !stopping)
+        registry->fail(stream->content);
+    finished.push_back(stream);
+    counters.decoded += stream->failed ? 0 : 1;
+    counters.compressed += stream->compressed && !stream->failed ? 1 : 0;
+    counters.cacheHits += fromCache ? 1 : 0;
+    counters.failed += stream->failed ? 1 : 0;
+    counters.sourceBytes += sourceBytes;
+    counters.decodedBytes += decodedBytes;
+    counters.decodeSeconds += seconds;
+}
+
+bool TextureStreamer::fillPBO(size_t &budget) {
+    GLsync &fence = fences[nextPBO];
+    if (fence) {
+        // Zero timeout: if the GPU is still reading this PBO we come back next frame rather than wait
+        const GLenum state = glClientWaitSync(fence, 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+            return false;
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPBO]);
+    // Unsynchronised is safe now that the fence says the GPU is done with it, and invalidating lets the
+    // driver skip keeping the old contents around
+    auto *mapped = (unsigned char *) glMapBufferRange(
+            GL_PIXEL_UNPACK_BUFFER, 0, TEXTURE_PBO_BYTES,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        std::cerr << "ERROR::TEXTURESTREAMER::MAP_FAILED" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        return false;
+    }
+    slices.clear();
+    size_t used = 0;
+    while (!uploading.empty() && budget > 0) {
+        // Smallest level waiting first, across all textures, so everything gets a blurry version quickly
+        auto next = std::min_element(uploading.begin(), uploading.end(), [](const Stream *a, const Stream *b) {
+            return a->bytes(a->level) < b->bytes(b->level);
+        });
+        Stream *stream = *next;
+        const int levelRows = stream->rows(stream->level);
+        const size_t rowBytes = stream->rowBytes(stream->level);
+        // At least a row per PBO, whatever the budget, or a wide texture would never get anywhere
+        const size_t space = std::min<size_t>(TEXTURE_PBO_BYTES - used, used == 0 ? std::max(budget, rowBytes) : budget);
+        const int rows = (int) std::min<size_t>(space / rowBytes, (size_t) (levelRows - stream->row));
+        if (rows == 0)
+            break;
+        std::memcpy(mapped + used, stream->data(stream->level) + stream->row * rowBytes, rows * rowBytes);
+        slices.push_back({ stream, stream->level, stream->row, rows, used });
+        used += (rows * rowBytes + 3) & ~(size_t) 3;
+        budget -= std::min(budget, rows * rowBytes);
+        stream->row += rows;
+        if (stream->row == levelRows) {
+            stream->row = 0;
+            if (stream->level-- == 0)
+                uploading.erase(next);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    for (const Slice &slice : slices) {
+        Stream *stream = slice.stream;
+        const int width = stream->width(slice.level), height = stream->height(slice.level);
+        const size_t rowBytes = stream->rowBytes(slice.level);
+        const GLenum format = stream->compressed ? bcGLFormat(stream->blocks[0].format) : GL_RGBA8;
+        glBindTexture(GL_TEXTURE_2D, stream->texture);
+        if (!stream->allocated) {
+            // Specify every level now that the size is known (replacing the placeholder) but only sample the
+            // coarsest until more arrive. With the PBO bound, a null pointer would mean "from offset 0 of it".
+            const int levels = stream->levelCount();
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            for (int l = 0; l < levels; l++) {
+                if (stream->compressed)
+                    glCompressedTexImage2D(GL_TEXTURE_2D, l, format, stream->width(l), stream->height(l), 0,
+                                           (GLsizei) stream->bytes(l), nullptr);
+                else
+                    glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, stream->width(l), stream->height(l), 0, GL_RGBA,
+                                 GL_UNSIGNED_BYTE, nullptr);
+            }
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPBO]);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, levels - 1);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+            stream->allocated = true;
+        }
+        if (stream->compressed) {
+            // Block rows: the region is whole blocks, except where it ends at the level's bottom edge
+            const int top = slice.row * 4, bottom = std::min((slice.row + slice.rows) * 4, height);
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, slice.level, 0, top, width, bottom - top, format,
+                                      (GLsizei) (slice.rows * rowBytes), (const void *) slice.offset);
+        } else {
+            glTexSubImage2D(GL_TEXTURE_2D, slice.level, 0, slice.row, width, slice.rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                            (const void *) slice.offset);
+        }
+        counters.uploads++;
+        counters.uploadedBytes += slice.rows * rowBytes;
+        if (slice.row + slice.rows == stream->rows(slice.level)) {
+            // Level complete: sample from it on, and the CPU copy can go
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, slice.level);
+            stream->residentLevel = slice.level;
+            stream->release(slice.level);
+            if (slice.level == 0)
+                counters.resident++;
+        }
+    }
+    if (!slices.empty())
+        fences[nextPBO] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    nextPBO = (nextPBO + 1) % TEXTURE_PBO_COUNT;
+    return true;
+}
+
+void TextureStreamer::update(size_t byteBudget) {
+    std::vector<Stream *> picked;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        picked.swap(finished);
+    }
+    for (Stream *stream : picked) {
+        if (stream->failed && stream->owner)
+            abandon(stream);
+        if (stream->failed || !stream->owner)
+            continue;
+        // The texture is made here rather than in load(), so content loaded twice only ever gets one.
+        // Handing it to the registry means the last stream sharing it deletes it.
+        glGenTextures(1, &stream->texture);
+        glBindTexture(GL_TEXTURE_2D, stream->texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        size_t bytes = 0;
+        for (int l = 0; l < stream->levelCount(); l++)
+            bytes += stream->bytes(l);
+        const GLuint texture = stream->texture;
+        registry->publish(stream->content, texture, bytes, [texture]() { glDeleteTextures(1, &texture); });
+        owners[stream->content] = stream;
+        uploading.push_back(stream);
+    }
+    if (uploading.empty())
+        return;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t budget = byteBudget;
+    while (!uploading.empty() && budget > 0) {
+        if (!fillPBO(budget)) {
+            counters.stalls++;
+            break;
+        }
+        if (slices.empty())
+            break;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    counters.uploadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TextureStreamer::abandon(Stream *owner) {
+    // The registry has forgotten the content, so nobody else can have started sharing it since
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const std::unique_ptr<Stream> &stream : streams) {
+        if (stream.get() == owner || !stream->content || stream->content != owner->content)
+            continue;
+        stream->failed = true;
+        counters.failed++;
+        registry->release(stream->content);
+        stream->content = 0;
+    }
+    if (owner->content)
+        registry->release(owner->content);
+    owner->content = 0;
+}
+
+bool TextureStreamer::busy() const {
+    if (!uploading.empty() || workers.pending() > 0)
+        return true;
+    std::lock_guard<std::mutex> lock(mutex);
+    return !finished.empty();
+}
+
+const TextureStreamer::Stream *TextureStreamer::source(TextureHandle handle) const {
+    if (handle == 0 || handle > streams.size())
+        return nullptr;
+    const Stream *stream = streams[handle - 1].get();
+    if (stream->texture)
+        return stream;
+    // Content is only set once the worker has seen the file, and the owner only listed once it's decoded
+    AssetId content;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        content = stream->content;
+    }
+    auto found = owners.find(content);
+    return found != owners.end() ? found->second : nullptr;
+}
+
+GLuint TextureStreamer::texture(TextureHandle handle) const {
+    const Stream *stream = source(handle);
+    return stream && stream->residentLevel >= 0 ? stream->texture : placeholder;
+}
+
+int TextureStreamer::residentLevel(TextureHandle handle) const {
+    const Stream *stream = source(handle);
+    return stream ? stream->residentLevel : -1;
+}
+
+TextureStreamStats TextureStreamer::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
@@ -0,0 +1,152 @@
+#ifndef OPENGLPLAYGROUND_TEXTURESTREAMER_H
+#define OPENGLPLAYGROUND_TEXTURESTREAMER_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include "AssetRegistry.h"
+#include "ImageDecoder.h"
+#include "MipBuilder.h"
+#include "TextureCache.h"
+#include "Parallel.h"
+
+// Texture loading that never blocks the render thread: files are decoded (and their mip chains built) on
+// worker threads, then uploaded a slice at a time through a ring of pixel buffer objects, so
+// glTexSubImage2D only ever reads from a buffer the GPU is done with and returns straight away.
+// Mips go up coarsest first and GL_TEXTURE_BASE_LEVEL follows them down, so a texture is usable (blurry)
+// as soon as its smallest levels are in and sharpens as the bigger ones arrive.
+// With compression on, the workers get block compressed levels from the texture cache (encoding them the
+// first time) and the slices are rows of blocks going to glCompressedTexSubImage2D instead.
+// Files are looked up in an AssetRegistry by content before they're decoded: loading the same image under
+// another path (or twice) shares the first load's texture rather than decoding and uploading it again. If
+// that first load fails, the loads sharing it fail with it, and loading the file again later tries afresh.
+
+#define TEXTURE_PBO_COUNT 4
+#define TEXTURE_PBO_BYTES (4u << 20)
+// Upload budget per update(), so a burst of big textures is spread over a few frames
+#define TEXTURE_UPLOAD_BUDGET (8u << 20)
+
+typedef uint32_t TextureHandle; // 0 is never a valid handle
+
+struct TextureStreamStats {
+    size_t requested = 0, decoded = 0, failed = 0, resident = 0; // resident: every level uploaded
+    size_t sourceBytes = 0;     // file bytes decoded
+    size_t decodedBytes = 0;    // RGBA or block bytes produced, mips included
+    size_t compressed = 0;      // textures uploaded block compressed
+    size_t cacheHits = 0;       // of those, how many the texture cache already had
+    size_t deduplicated = 0;    // loads whose content another load already had, so weren't decoded
+    double decodeSeconds = 0.0; // summed over the worker threads
+    size_t uploadedBytes = 0;
+    size_t uploads = 0;         // glTexSubImage2D calls
+    double uploadSeconds = 0.0; // render thread time spent mapping, copying and issuing uploads
+    size_t stalls = 0;          // updates that stopped early because every PBO was still in use by the GPU
+
+    // MB/s per decoding thread, of file and of decoded bytes
+    double decodeSourceMBps() const { return decodeSeconds > 0.0 ? sourceBytes / decodeSeconds / 1e6 : 0.0; }
+    double decodePixelMBps() const { return decodeSeconds > 0.0 ? decodedBytes / decodeSeconds / 1e6 : 0.0; }
+    // MB/s the render thread pushes into PBOs
+    double uploadMBps() const { return uploadSeconds > 0.0 ? uploadedBytes / uploadSeconds / 1e6 : 0.0; }
+};
+
+class TextureStreamer {
+public:
+    // 0 decode threads = one per core. Needs a current GL context (3.2+ for fences) from construction on,
+    // and every call has to come from that context's thread. Without a registry the streamer keeps its own;
+    // one that's passed in has to outlive the streamer, and is released into from the GL thread.
+    explicit TextureStreamer(int decodeThreads = 0, AssetRegistry *registry = nullptr);
+    ~TextureStreamer();
+    TextureStreamer(const TextureStreamer &) = delete;
+    TextureStreamer &operator=(const TextureStreamer &) = delete;
+
+    // Returns straight away. The handle's texture() is a grey 1x1 until the first levels of the image
+    // arrive; textures belong to the streamer (or rather its registry references).
+    TextureHandle load(const std::string &path);
+    // What to bind for handle this frame: it changes when the image arrives, so ask again each frame
+    GLuint texture(TextureHandle handle) const;
+    // Call once a frame: picks up what the workers have decoded and uploads up to byteBudget bytes of it.
+    // Leaves GL_TEXTURE_2D on the active unit and GL_PIXEL_UNPACK_BUFFER unbound.
+    void update(size_t byteBudget = TEXTURE_UPLOAD_BUDGET);
+    // Something is still decoding or waiting to be uploaded
+    bool busy() const;
+    // Finest level of handle's texture uploaded so far (0 = fully resident), -1 while it's the placeholder
+    int residentLevel(TextureHandle handle) const;
+    TextureStreamStats stats() const;
+
+    // How the workers build mip chains, read as each texture decodes, so set it before load(). Each texture
+    // gets one thread: the workers already run one texture each. Uncompressed levels are still uploaded as
+    // GL_RGBA8 (the builder has done the sRGB maths, sampling stays as it was).
+    MipOptions mipOptions;
+    // Block compress what load() sees from then on, through the cache described by `compression` (whose
+    // thread count is set to 1 for the same reason). Formats the context can't sample fall back to RGBA8.
+    bool compress = false;
+    TextureCacheOptions compression;
+
+private:
+    struct Stream {
+        GLuint texture = 0;      // made when the owner's decode is picked up
+        std::string path;
+        AssetId content = 0;     // registry reference, set by the worker
+        bool owner = false;      // first with this content: decodes and uploads it, the rest share that
+        std::vector<Image> mips; // filled by a worker, freed level by level as they're uploaded
+        std::vector<CompressedImage> blocks; // instead of mips when compressed
+        bool compressed = false;
+        bool decoded = false, failed = false;
+        bool allocated = false;  // levels specified with glTexImage2D
+        int level = -1;          // next level to upload, coarsest first
+        int row = 0;             // next row of that level
+        int residentLevel = -1;
+
+        // Levels either way. Rows are rows of blocks when compressed.
+        int levelCount() const { return (int) (compressed ? blocks.size() : mips.size()); }
+        int width(int l) const { return compressed ? blocks[l].width : mips[l].width; }
+        int height(int l) const { return compressed ? blocks[l].height : mips[l].height; }
+        int rows(int l) const { return compressed ? blocks[l].blocksHigh() : mips[l].height; }
+        size_t rowBytes(int l) const {
+            return compressed ? blocks[l].blocksWide() * bcBlockBytes(blocks[l].format) : (size_t) mips[l].width * 4;
+        }
+        size_t bytes(int l) const { return rowBytes(l) * rows(l); }
+        const unsigned char *data(int l) const { return compressed ? blocks[l].blocks.data() : mips[l].pixels.data(); }
+        void release(int l);
+    };
+    // An upload that's been copied into a PBO, waiting to be issued once the PBO is unmapped
+    struct Slice {
+        Stream *stream;
+        int level, row, rows;
+        size_t offset;
+    };
+
+    mutable std::mutex mutex; // guards `finished`, `stopping`, Stream::content and the decode half of counters
+    std::vector<std::unique_ptr<Stream>> streams; // handle - 1
+    std::unordered_map<AssetId, const Stream *> owners; // picked up by update(), by content
+    GLuint placeholder = 0;
+    bool stopping = false;    // being destroyed: workers stop acquiring
+    std::vector<Stream *> finished; // decoded by a worker, not picked up by update() yet
+    std::vector<Stream *> uploading;
+    GLuint pbos[TEXTURE_PBO_COUNT] = {};
+    GLsync fences[TEXTURE_PBO_COUNT] = {};
+    int nextPBO = 0;
+    TextureStreamStats counters;
+    std::vector<Slice> slices;
+    std::unique_ptr<AssetRegistry> ownRegistry;
+    AssetRegistry *registry;
+    // Last, so it's destroyed first: workers still decoding into `streams` are joined before those go
+    WorkerThreads workers;
+
+    // bcFormatSupported() for compression.format, asked once per format
+    BCFormat checkedFormat = BCFormat::BC1;
+    int formatSupported = -1;
+
+    void decode(Stream *stream);
+    // GL thread, for an owner whose decode failed: fails the streams sharing its content and lets go of it
+    void abandon(Stream *owner);
+    // The stream whose texture handle shows, null until there is one
+    const Stream *source(TextureHandle handle) const;
+    // Copies as much as fits of the next uploads into one PBO, then issues them. False if the PBO is busy.
+    bool fillPBO(size_t &budget);
+};
+
+#endif //OPENGLPLAYGROUND_TEXTURESTREAMER_H
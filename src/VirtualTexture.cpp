@@ -0,0 +1,379 @@
+#include "VirtualTexture.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iostream>
+
+namespace {
+
+int powerOfTwoAtLeast(int value) {
+    int result = 1;
+    while (result < value)
+        result *= 2;
+    return result;
+}
+
+// Feedback pages sorted by key come out finest level first, and by row within a level
+uint32_t pageKey(int level, int x, int y) {
+    return (uint32_t) level << 24 | (uint32_t) y << 12 | (uint32_t) x;
+}
+
+} // namespace
+
+VirtualTexture::VirtualTexture(const VirtualTextureOptions &options)
+        : options(options), loaders(options.loaderThreads) {
+    glGenBuffers(VIRTUAL_TEXTURE_FEEDBACK_BUFFERS, readbacks);
+}
+
+VirtualTexture::~VirtualTexture() {
+    for (GLsync fence : fences)
+        if (fence)
+            glDeleteSync(fence);
+    glDeleteBuffers(VIRTUAL_TEXTURE_FEEDBACK_BUFFERS, readbacks);
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &feedbackColour);
+    }
+    if (cache)
+        glDeleteTextures(1, &cache);
+    if (indirection)
+        glDeleteTextures(1, &indirection);
+}
+
+bool VirtualTexture::open(const char *path) {
+    if (cache) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::ALREADY_OPEN " << path << std::endl;
+        return false;
+    }
+    if (!file.open(path))
+        return false;
+    const VirtualTextureHeader &header = file.header();
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    const int cacheSize = options.cacheSlots * header.tileSize();
+    // The indirection stores slots in 8 bits each way
+    if (options.cacheSlots < 2 || options.cacheSlots > 256 || cacheSize > maxSize) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::CACHE_TOO_BIG " << options.cacheSlots << " slots of "
+                  << header.tileSize() << " texels, GL allows " << maxSize << std::endl;
+        return false;
+    }
+    const VirtualTextureLevel &finest = file.level(0);
+    if (finest.pagesWide > 4096 || finest.pagesHigh > 4096) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::TOO_MANY_PAGES " << path << std::endl;
+        return false;
+    }
+
+    glGenTextures(1, &cache);
+    glBindTexture(GL_TEXTURE_2D, cache);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    slots.assign((size_t) options.cacheSlots * options.cacheSlots, Slot());
+
+    // Power of two sizes: GL halves (rounding down) from level 0, and the page counts of the .vtex levels
+    // (which round up) then always fit
+    const int levelCount = file.levelCount();
+    indirectionWidth = powerOfTwoAtLeast((int) finest.pagesWide);
+    indirectionHeight = powerOfTwoAtLeast((int) finest.pagesHigh);
+    glGenTextures(1, &indirection);
+    glBindTexture(GL_TEXTURE_2D, indirection);
+    residency.resize(levelCount);
+    loading.resize(levelCount);
+    indirectionTexels.resize(levelCount);
+    for (int l = 0; l < levelCount; l++) {
+        const int width = std::max(indirectionWidth >> l, 1), height = std::max(indirectionHeight >> l, 1);
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        residency[l].assign((size_t) file.level(l).pagesWide * file.level(l).pagesHigh, -1);
+        loading[l].assign(residency[l].size(), 0);
+        indirectionTexels[l].assign((size_t) width * height, 0);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    // The last level's single page is the fallback for everything, so it goes in now and stays
+    LoadedTile root;
+    root.level = levelCount - 1;
+    root.x = root.y = 0;
+    const unsigned char *texels = file.tile(root.level, 0, 0);
+    root.texels.assign(texels, texels + header.tileBytes());
+    glBindTexture(GL_TEXTURE_2D, cache);
+    const int slot = uploadTile(root);
+    slots[slot].pinned = true;
+    glBindTexture(GL_TEXTURE_2D, indirection);
+    updateIndirection();
+    glBindTexture(GL_TEXTURE_2D, 0);
+    counters = VirtualTextureStats();
+    counters.cachePages = slots.size();
+    counters.residentPages = 1;
+    return true;
+}
+
+void VirtualTexture::createFeedbackTarget(int width, int height) {
+    if (!framebuffer) {
+        glGenFramebuffers(1, &framebuffer);
+        glGenRenderbuffers(1, &feedbackColour);
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, feedbackColour);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackColour);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "ERROR::VIRTUALTEXTURE::FEEDBACK_INCOMPLETE" << std::endl;
+    feedbackWidth = width;
+    feedbackHeight = height;
+}
+
+void VirtualTexture::beginFeedback(int viewportWidth, int viewportHeight) {
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, previousViewport);
+    const int width = std::max(viewportWidth / options.feedbackDivisor, 1);
+    const int height = std::max(viewportHeight / options.feedbackDivisor, 1);
+    if (width != feedbackWidth || height != feedbackHeight)
+        createFeedbackTarget(width, height);
+    else
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+    // Alpha 255 is "no page", for pixels nothing virtual covers
+    GLfloat clear[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clear);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(clear[0], clear[1], clear[2], clear[3]);
+}
+
+void VirtualTexture::endFeedback() {
+    // A buffer whose read back hasn't been gone through yet is skipped rather than waited on
+    const int index = nextReadback;
+    if (!fences[index]) {
+        const size_t bytes = (size_t) feedbackWidth * feedbackHeight * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[index]);
+        if ((size_t) readbackWidth[index] * readbackHeight[index] * 4 != bytes)
+            glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) bytes, nullptr, GL_STREAM_READ);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glReadPixels(0, 0, feedbackWidth, feedbackHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbackWidth[index] = feedbackWidth;
+        readbackHeight[index] = feedbackHeight;
+        fences[index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        nextReadback = (index + 1) % VIRTUAL_TEXTURE_FEEDBACK_BUFFERS;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint) previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void VirtualTexture::update() {
+    if (!cache)
+        return;
+    counters.uploads = counters.evictions = counters.dropped = 0;
+
+    // The oldest read backs first. Only the newest one the GPU has finished is worth going through.
+    int newest = -1;
+    for (int i = 0; i < VIRTUAL_TEXTURE_FEEDBACK_BUFFERS; i++) {
+        const int index = (nextReadback + i) % VIRTUAL_TEXTURE_FEEDBACK_BUFFERS;
+        if (!fences[index])
+            continue;
+        const GLenum state = glClientWaitSync(fences[index], 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+            break;
+        glDeleteSync(fences[index]);
+        fences[index] = nullptr;
+        newest = index;
+    }
+    if (newest >= 0) {
+        const size_t bytes = (size_t) readbackWidth[newest] * readbackHeight[newest] * 4;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbacks[newest]);
+        auto *pixels = (const unsigned char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) bytes,
+                                                                 GL_MAP_READ_BIT);
+        if (pixels) {
+            readFeedback(pixels, readbackWidth[newest], readbackHeight[newest]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // Loaded tiles, coarsest first: they stand in for the most pages
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (LoadedTile &tile : loaded)
+            waiting.push_back(std::move(tile));
+        loaded.clear();
+    }
+    if (!waiting.empty()) {
+        std::stable_sort(waiting.begin(), waiting.end(), [](const LoadedTile &a, const LoadedTile &b) {
+            return a.level > b.level;
+        });
+        const size_t count = std::min(waiting.size(), (size_t) std::max(options.uploadsPerFrame, 1));
+        glBindTexture(GL_TEXTURE_2D, cache);
+        for (size_t i = 0; i < count; i++) {
+            const LoadedTile &tile = waiting[i];
+            loading[tile.level][(size_t) tile.y * file.level(tile.level).pagesWide + tile.x] = 0;
+            inFlight--;
+            if (uploadTile(tile) < 0)
+                counters.dropped++;
+        }
+        waiting.erase(waiting.begin(), waiting.begin() + count);
+    }
+    if (indirectionDirty) {
+        glBindTexture(GL_TEXTURE_2D, indirection);
+        updateIndirection();
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    counters.pendingLoads = inFlight;
+    counters.totalUploads += counters.uploads;
+    counters.totalEvictions += counters.evictions;
+}
+
+void VirtualTexture::readFeedback(const unsigned char *pixels, int width, int height) {
+    auto start = std::chrono::steady_clock::now();
+    const int levelCount = file.levelCount();
+    std::vector<uint32_t> pages;
+    pages.reserve((size_t) width * height);
+    for (size_t i = 0; i < (size_t) width * height; i++) {
+        const unsigned char *pixel = pixels + i * 4;
+        const int level = pixel[3];
+        if (level >= levelCount)
+            continue;
+        const int x = pixel[0] | (pixel[2] & 15) << 8, y = pixel[1] | (pixel[2] >> 4) << 8;
+        if (x < (int) file.level(level).pagesWide && y < (int) file.level(level).pagesHigh)
+            pages.push_back(pageKey(level, x, y));
+    }
+    std::sort(pages.begin(), pages.end());
+    pages.erase(std::unique(pages.begin(), pages.end()), pages.end());
+
+    // Everything visible and every ancestor of it counts as used this generation. Anything missing is a
+    // candidate for loading, whether it's needed itself or only stands in for a missing descendant.
+    generation++;
+    counters.visiblePages = pages.size();
+    counters.missingPages = 0;
+    std::vector<uint32_t> missing;
+    for (uint32_t key : pages) {
+        int level = (int) (key >> 24), x = (int) (key & 4095), y = (int) (key >> 12 & 4095);
+        bool visible = true;
+        for (; level < levelCount; level++, x /= 2, y /= 2) {
+            const size_t page = (size_t) y * file.level(level).pagesWide + x;
+            const int slot = residency[level][page];
+            if (slot >= 0) {
+                slots[slot].lastUsed = generation;
+            } else {
+                if (visible)
+                    counters.missingPages++;
+                if (!loading[level][page])
+                    missing.push_back(pageKey(level, x, y));
+            }
+            visible = false;
+        }
+    }
+    std::sort(missing.begin(), missing.end(), std::greater<uint32_t>());
+    missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+    for (uint32_t key : missing) {
+        if (inFlight >= (size_t) options.loadsInFlight)
+            break;
+        const int level = (int) (key >> 24), x = (int) (key & 4095), y = (int) (key >> 12 & 4095);
+        loading[level][(size_t) y * file.level(level).pagesWide + x] = 1;
+        inFlight++;
+        loaders.push([this, level, x, y]() {
+            // Reading the mapping is what pulls the tile off disk
+            LoadedTile tile;
+            tile.level = level;
+            tile.x = x;
+            tile.y = y;
+            const unsigned char *texels = file.tile(level, x, y);
+            tile.texels.assign(texels, texels + file.header().tileBytes());
+            std::lock_guard<std::mutex> lock(mutex);
+            loaded.push_back(std::move(tile));
+        });
+    }
+    counters.feedbackMilliseconds =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int VirtualTexture::uploadTile(const LoadedTile &tile) {
+    // A free slot, or the least recently used page that wasn't in the last feedback
+    int chosen = -1;
+    for (size_t s = 0; s < slots.size(); s++) {
+        const Slot &slot = slots[s];
+        if (slot.level < 0) {
+            chosen = (int) s;
+            break;
+        }
+        if (!slot.pinned && slot.lastUsed < generation && (chosen < 0 || slot.lastUsed < slots[chosen].lastUsed))
+            chosen = (int) s;
+    }
+    if (chosen < 0)
+        return -1;
+    Slot &slot = slots[chosen];
+    if (slot.level >= 0) {
+        residency[slot.level][(size_t) slot.y * file.level(slot.level).pagesWide + slot.x] = -1;
+        counters.evictions++;
+        counters.residentPages--;
+    }
+    slot.level = tile.level;
+    slot.x = tile.x;
+    slot.y = tile.y;
+    slot.lastUsed = generation;
+    residency[tile.level][(size_t) tile.y * file.level(tile.level).pagesWide + tile.x] = chosen;
+    counters.uploads++;
+    counters.residentPages++;
+    indirectionDirty = true;
+
+    const int size = file.header().tileSize();
+    glTexSubImage2D(GL_TEXTURE_2D, 0, (chosen % options.cacheSlots) * size, (chosen / options.cacheSlots) * size,
+                    size, size, GL_RGBA, GL_UNSIGNED_BYTE, tile.texels.data());
+    return chosen;
+}
+
+void VirtualTexture::updateIndirection() {
+    // Coarsest first, so each texel can take its parent's entry when its own page isn't resident
+    const int levelCount = file.levelCount();
+    for (int l = levelCount - 1; l >= 0; l--) {
+        const int width = std::max(indirectionWidth >> l, 1), height = std::max(indirectionHeight >> l, 1);
+        const VirtualTextureLevel &level = file.level(l);
+        std::vector<uint32_t> &texels = indirectionTexels[l];
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int slot = -1;
+                if (x < (int) level.pagesWide && y < (int) level.pagesHigh)
+                    slot = residency[l][(size_t) y * level.pagesWide + x];
+                uint32_t entry;
+                if (slot >= 0) {
+                    entry = (uint32_t) (slot % options.cacheSlots) | (uint32_t) (slot / options.cacheSlots) << 8 |
+                            (uint32_t) l << 16 | 255u << 24;
+                } else if (l + 1 < levelCount) {
+                    const int parentWidth = std::max(indirectionWidth >> (l + 1), 1);
+                    const int parentHeight = std::max(indirectionHeight >> (l + 1), 1);
+                    entry = indirectionTexels[l + 1][(size_t) std::min(y / 2, parentHeight - 1) * parentWidth +
+                                                     std::min(x / 2, parentWidth - 1)];
+                } else {
+                    entry = texels[0]; // past the last level's only page
+                }
+                texels[(size_t) y * width + x] = entry;
+            }
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, l, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    }
+    indirectionDirty = false;
+}
+
+void VirtualTexture::bind(const Shader &program, int firstUnit, bool feedback) const {
+    const VirtualTextureHeader &header = file.header();
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    glBindTexture(GL_TEXTURE_2D, cache);
+    glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+    glBindTexture(GL_TEXTURE_2D, indirection);
+    glActiveTexture(GL_TEXTURE0 + firstUnit);
+    program.setInt("pageCache", firstUnit);
+    program.setInt("indirection", firstUnit + 1);
+    program.setVec2("virtualSize", glm::vec2((float) header.width, (float) header.height));
+    program.setFloat("pageSize", (float) header.pageSize);
+    program.setFloat("pageBorder", (float) header.border);
+    program.setFloat("cacheSize", (float) (options.cacheSlots * header.tileSize()));
+    program.setFloat("maxLevel", (float) (file.levelCount() - 1));
+    // A feedback pixel covers feedbackDivisor^2 screen pixels, so its derivatives are that much bigger
+    program.setFloat("lodBias", feedback ? -std::log2((float) options.feedbackDivisor) : 0.0f);
+}
@@ -0,0 +1,123 @@
+#ifndef OPENGLPLAYGROUND_VIRTUALTEXTURE_H
+#define OPENGLPLAYGROUND_VIRTUALTEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+#include "GLShader.h"
+#include "Parallel.h"
+#include "VirtualTextureFile.h"
+
+// Sparse virtual texturing: a .vtex of any size drawn through a fixed size page cache.
+// - Feedback: the scene is drawn a second time, small, with VirtualTextureFeedbackShader, which writes
+//   the page (level, x, y) each pixel wants. It's read back through a ring of pixel pack buffers a couple
+//   of frames late, so reading never waits on the GPU.
+// - Page manager: pages seen in the feedback (and their coarser ancestors) are marked used that frame.
+//   Missing ones are read from the mapped file by loader threads, coarsest first, and copied into a slot
+//   of the cache texture, evicting the least recently used page. The single page of the last level is
+//   loaded up front and never evicted, so there's always something to fall back to.
+// - Indirection: a mipmapped texture with a texel per page per level, holding the cache slot and level of
+//   the finest resident page covering it. VirtualTextureFragmentShader looks it up and samples the cache.
+// GPU memory is the cache (cacheSlots^2 tiles) plus the indirection (4 bytes a page), whatever the size
+// of the texture.
+
+#define VIRTUAL_TEXTURE_FEEDBACK_BUFFERS 3
+
+struct VirtualTextureOptions {
+    int cacheSlots = 16;       // per side: 16 is 256 pages, 19 MB with 128 texel pages
+    int feedbackDivisor = 8;   // feedback resolution is the viewport's divided by this
+    int loadsInFlight = 64;    // tiles queued on the loader threads at once
+    int uploadsPerFrame = 16;  // tiles copied into the cache per update()
+    int loaderThreads = 2;
+};
+
+// Counters for the last update() (pages) and since open() (totals)
+struct VirtualTextureStats {
+    size_t visiblePages = 0;  // distinct pages in the last feedback read back
+    size_t missingPages = 0;  // of those, how many weren't resident (drawn from a coarser page instead)
+    size_t residentPages = 0;
+    size_t cachePages = 0;    // capacity
+    size_t pendingLoads = 0;  // queued or loaded but not uploaded yet
+    size_t uploads = 0, evictions = 0;
+    size_t dropped = 0;       // loads thrown away because every page in the cache was in use that frame
+    double feedbackMilliseconds = 0.0; // CPU time spent going through the feedback
+    size_t totalUploads = 0, totalEvictions = 0;
+};
+
+class VirtualTexture {
+public:
+    // Needs a current GL context, and every call has to come from its thread
+    explicit VirtualTexture(const VirtualTextureOptions &options = VirtualTextureOptions());
+    ~VirtualTexture();
+    VirtualTexture(const VirtualTexture &) = delete;
+    VirtualTexture &operator=(const VirtualTexture &) = delete;
+
+    // Maps the file, creates the cache and indirection textures and loads the fallback page. False (after an
+    // error) if the file won't open or the cache would be too big for GL.
+    bool open(const char *path);
+
+    // Draw the feedback pass between these, with programs that bind() has set up for feedback. Begin binds
+    // the small framebuffer (and viewport), end starts its read back and restores the previous ones.
+    void beginFeedback(int viewportWidth, int viewportHeight);
+    void endFeedback();
+
+    // Once a frame: goes through any feedback that's been read back, queues loads, uploads loaded tiles
+    // and updates the indirection texture
+    void update();
+
+    // Sets program's uniforms (program has to be in use) and binds the cache and indirection to texture
+    // units firstUnit and firstUnit + 1. Feedback programs get the lod bias of the smaller target.
+    void bind(const Shader &program, int firstUnit = 0, bool feedback = false) const;
+
+    const VirtualTextureStats &stats() const { return counters; }
+    const VirtualTextureHeader &header() const { return file.header(); }
+
+private:
+    struct Slot {
+        int level = -1, x = 0, y = 0; // page held, level -1 when free
+        uint32_t lastUsed = 0;        // feedback generation
+        bool pinned = false;
+    };
+    struct LoadedTile {
+        int level, x, y;
+        std::vector<unsigned char> texels;
+    };
+
+    VirtualTextureOptions options;
+    VirtualTextureFile file;
+    GLuint cache = 0, indirection = 0;
+    int indirectionWidth = 0, indirectionHeight = 0; // level 0, powers of two so GL's halving covers every level
+    std::vector<Slot> slots;
+    // Per level, per page: cache slot or -1, and whether it's been queued for loading
+    std::vector<std::vector<int>> residency;
+    std::vector<std::vector<char>> loading;
+    std::vector<std::vector<uint32_t>> indirectionTexels; // per level, RGBA8 (slot x, slot y, level, 255)
+    bool indirectionDirty = true;
+    uint32_t generation = 1;
+
+    GLuint framebuffer = 0, feedbackColour = 0;
+    int feedbackWidth = 0, feedbackHeight = 0;
+    GLuint readbacks[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {};
+    GLsync fences[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {};
+    int readbackWidth[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {}, readbackHeight[VIRTUAL_TEXTURE_FEEDBACK_BUFFERS] = {};
+    int nextReadback = 0;
+    GLint previousFramebuffer = 0, previousViewport[4] = {};
+
+    std::mutex mutex; // guards `loaded`
+    std::vector<LoadedTile> loaded;
+    std::vector<LoadedTile> waiting; // loaded, over the upload budget, uploaded next update()
+    size_t inFlight = 0;             // pushed to the loaders, not uploaded or dropped yet
+    VirtualTextureStats counters;
+    // Last, so it's destroyed first: loaders still reading the file are joined before it's unmapped
+    WorkerThreads loaders;
+
+    void createFeedbackTarget(int width, int height);
+    void readFeedback(const unsigned char *pixels, int width, int height);
+    // Into a free or least recently used slot: the slot, or -1 if every one was used this generation
+    int uploadTile(const LoadedTile &tile);
+    void updateIndirection();
+};
+
+#endif //OPENGLPLAYGROUND_VIRTUALTEXTURE_H
@@ -0,0 +1,148 @@
+#include "VirtualTextureFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+namespace {
+
+size_t alignUp(size_t value) {
+    return (value + VIRTUAL_TEXTURE_ALIGNMENT - 1) & ~(size_t) (VIRTUAL_TEXTURE_ALIGNMENT - 1);
+}
+
+// The tile of page (x, y): the page plus its border, clamped to the level's edges
+void cutTile(const Image &level, int x, int y, int pageSize, int border, unsigned char *tile) {
+    const int size = pageSize + 2 * border;
+    const int left = x * pageSize - border, top = y * pageSize - border;
+    for (int row = 0; row < size; row++) {
+        const int sy = std::min(std::max(top + row, 0), level.height - 1);
+        const unsigned char *source = &level.pixels[(size_t) sy * level.width * 4];
+        unsigned char *out = tile + (size_t) row * size * 4;
+        for (int column = 0; column < size; column++) {
+            const int sx = std::min(std::max(left + column, 0), level.width - 1);
+            std::memcpy(out + column * 4, source + sx * 4, 4);
+        }
+    }
+}
+
+} // namespace
+
+bool writeVirtualTexture(Image &&image, const char *path, const VirtualTextureBuildOptions &options) {
+    if (options.pageSize < 8 || (options.pageSize & (options.pageSize - 1)) || options.border < 0 ||
+        options.border > options.pageSize / 2) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::BAD_PAGE_SIZE " << options.pageSize << " border " << options.border
+                  << std::endl;
+        return false;
+    }
+    std::vector<Image> mips;
+    buildMipChain(std::move(image), mips, options.mipOptions);
+    size_t levelCount = 1;
+    while (levelCount < mips.size() && (mips[levelCount - 1].width > options.pageSize ||
+                                        mips[levelCount - 1].height > options.pageSize))
+        levelCount++;
+    mips.resize(levelCount);
+
+    VirtualTextureHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = VIRTUAL_TEXTURE_MAGIC;
+    header.version = VIRTUAL_TEXTURE_VERSION;
+    header.width = (uint32_t) mips[0].width;
+    header.height = (uint32_t) mips[0].height;
+    header.pageSize = (uint32_t) options.pageSize;
+    header.border = (uint32_t) options.border;
+    header.levelCount = (uint32_t) levelCount;
+    std::vector<VirtualTextureLevel> levels(levelCount);
+    uint64_t tiles = 0;
+    for (size_t l = 0; l < levelCount; l++) {
+        levels[l].width = (uint32_t) mips[l].width;
+        levels[l].height = (uint32_t) mips[l].height;
+        levels[l].pagesWide = (uint32_t) ((mips[l].width + options.pageSize - 1) / options.pageSize);
+        levels[l].pagesHigh = (uint32_t) ((mips[l].height + options.pageSize - 1) / options.pageSize);
+        levels[l].firstTile = tiles;
+        tiles += (uint64_t) levels[l].pagesWide * levels[l].pagesHigh;
+    }
+
+    const std::string temporary = std::string(path) + ".tmp";
+    std::ofstream out(temporary, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    const size_t tableEnd = sizeof(header) + levels.size() * sizeof(VirtualTextureLevel);
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(levels.data()), (std::streamsize) (levels.size() * sizeof(VirtualTextureLevel)));
+    const std::vector<char> padding(alignUp(tableEnd) - tableEnd, 0);
+    out.write(padding.data(), (std::streamsize) padding.size());
+    std::vector<unsigned char> tile(header.tileBytes());
+    for (size_t l = 0; l < levelCount; l++) {
+        for (uint32_t y = 0; y < levels[l].pagesHigh; y++) {
+            for (uint32_t x = 0; x < levels[l].pagesWide; x++) {
+                cutTile(mips[l], (int) x, (int) y, options.pageSize, options.border, tile.data());
+                out.write(reinterpret_cast<const char *>(tile.data()), (std::streamsize) tile.size());
+            }
+        }
+        mips[l].pixels = std::vector<unsigned char>();
+    }
+    out.close();
+    if (!out || std::rename(temporary.c_str(), path) != 0) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool VirtualTextureFile::open(const char *path) {
+    levels.clear();
+    if (!file.open(path))
+        return false;
+    const unsigned char *data = file.data();
+    const size_t size = file.size();
+    if (size < sizeof(head)) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    std::memcpy(&head, data, sizeof(head));
+    if (head.magic != VIRTUAL_TEXTURE_MAGIC || head.version != VIRTUAL_TEXTURE_VERSION) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::WRONG_VERSION " << path << std::endl;
+        return false;
+    }
+    const size_t tableEnd = sizeof(head) + (size_t) head.levelCount * sizeof(VirtualTextureLevel);
+    if (head.width == 0 || head.height == 0 || head.pageSize < 8 || (head.pageSize & (head.pageSize - 1)) ||
+        head.border > head.pageSize / 2 || head.levelCount == 0 || head.levelCount > 32 || tableEnd > size) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::CORRUPT " << path << std::endl;
+        return false;
+    }
+    levels.resize(head.levelCount);
+    std::memcpy(levels.data(), data + sizeof(head), levels.size() * sizeof(VirtualTextureLevel));
+    dataOffset = alignUp(tableEnd);
+    // Every level has to be the halving of the one above it, as the shaders work the sizes out themselves
+    uint64_t tiles = 0;
+    for (size_t l = 0; l < levels.size(); l++) {
+        const VirtualTextureLevel &level = levels[l];
+        const uint32_t width = std::max(head.width >> l, 1u), height = std::max(head.height >> l, 1u);
+        if (level.width != width || level.height != height || level.firstTile != tiles ||
+            level.pagesWide != (width + head.pageSize - 1) / head.pageSize ||
+            level.pagesHigh != (height + head.pageSize - 1) / head.pageSize) {
+            std::cerr << "ERROR::VIRTUALTEXTURE::CORRUPT " << path << std::endl;
+            levels.clear();
+            return false;
+        }
+        tiles += (uint64_t) level.pagesWide * level.pagesHigh;
+    }
+    if (levels.back().pagesWide != 1 || levels.back().pagesHigh != 1 ||
+        dataOffset + tiles * head.tileBytes() > size) {
+        std::cerr << "ERROR::VIRTUALTEXTURE::CORRUPT " << path << std::endl;
+        levels.clear();
+        return false;
+    }
+    return true;
+}
+
+const unsigned char *VirtualTextureFile::tile(int level, int x, int y) const {
+    const VirtualTextureLevel &record = levels[level];
+    const uint64_t index = record.firstTile + (uint64_t) y * record.pagesWide + x;
+    return file.data() + dataOffset + index * head.tileBytes();
+}
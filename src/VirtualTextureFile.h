@@ -0,0 +1,68 @@
+#ifndef OPENGLPLAYGROUND_VIRTUALTEXTUREFILE_H
+#define OPENGLPLAYGROUND_VIRTUALTEXTUREFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "ImageDecoder.h"
+#include "MappedFile.h"
+#include "MipBuilder.h"
+
+// Pre-tiled mip chains for virtual texturing (.vtex). Every level is cut into pages of pageSize texels,
+// and each page is stored with `border` texels of its neighbours (edge texels repeated past the image)
+// around it, so a page sitting anywhere in the page cache filters bilinearly as if the whole level were
+// there. Levels stop at the first one that fits in a single page.
+// Layout: a header, a record per level, then the tiles level by level, rows top to bottom, each one
+// tileSize() square RGBA8 texels, at a 4096 byte aligned start: a tile is one read from the mapped file.
+
+#define VIRTUAL_TEXTURE_MAGIC 0x5650474Fu // "OGPV"
+#define VIRTUAL_TEXTURE_VERSION 1
+#define VIRTUAL_TEXTURE_ALIGNMENT 4096
+
+struct VirtualTextureHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width, height; // level 0
+    uint32_t pageSize, border;
+    uint32_t levelCount;
+    uint32_t reserved;
+
+    int tileSize() const { return (int) (pageSize + 2 * border); }
+    size_t tileBytes() const { return (size_t) tileSize() * tileSize() * 4; }
+};
+
+struct VirtualTextureLevel {
+    uint32_t width, height;
+    uint32_t pagesWide, pagesHigh;
+    uint64_t firstTile; // index of its top left tile
+};
+
+struct VirtualTextureBuildOptions {
+    int pageSize = 128; // power of two
+    int border = 4;     // enough for bilinear (1) with room for anisotropic filtering
+    MipOptions mipOptions;
+};
+
+// Builds the mip chain of image and writes it tiled to path (through a temporary file, like the caches)
+bool writeVirtualTexture(Image &&image, const char *path, const VirtualTextureBuildOptions &options);
+
+// A .vtex mapped for reading. Tiles are only paged in from disk when something reads them.
+class VirtualTextureFile {
+public:
+    // Prints an error and returns false if the file is missing or isn't a valid .vtex
+    bool open(const char *path);
+
+    const VirtualTextureHeader &header() const { return head; }
+    const VirtualTextureLevel &level(int l) const { return levels[l]; }
+    int levelCount() const { return (int) levels.size(); }
+    // Straight into the mapping, header().tileBytes() long. Safe from any thread.
+    const unsigned char *tile(int level, int x, int y) const;
+
+private:
+    MappedFile file;
+    VirtualTextureHeader head = {};
+    std::vector<VirtualTextureLevel> levels;
+    size_t dataOffset = 0;
+};
+
+#endif //OPENGLPLAYGROUND_VIRTUALTEXTUREFILE_H
@@ -0,0 +1,93 @@
+#include "VirtualTextureView.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/gtc/matrix_transform.hpp>
+#include "GLMesh.h"
+#include "Playground.h"
+
+VirtualTextureView::VirtualTextureView(const VirtualTextureOptions &options, GLuint vertexBuffer, GLuint elementBuffer)
+        : texture(options), lastMoved(glfwGetTime()) {
+    program.reset(new Shader(texturedVertexShaderPath, virtualTextureFragmentShaderPath));
+    feedbackProgram.reset(new Shader(texturedVertexShaderPath, virtualTextureFeedbackShaderPath));
+    GLuint *vaos[2] = { &vertexArray, &feedbackVertexArray };
+    const Shader *programs[2] = { program.get(), feedbackProgram.get() };
+    for (int i = 0; i < 2; i++) {
+        glGenVertexArrays(1, vaos[i]);
+        glBindVertexArray(*vaos[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffer);
+        applyVertexLayout(quadLayout(), programs[i]->ID);
+    }
+    glBindVertexArray(0);
+}
+
+VirtualTextureView::~VirtualTextureView() {
+    glDeleteVertexArrays(1, &vertexArray);
+    glDeleteVertexArrays(1, &feedbackVertexArray);
+}
+
+bool VirtualTextureView::open(const char *path) {
+    if (!texture.open(path))
+        return false;
+    const VirtualTextureHeader &header = texture.header();
+    std::cout << path << ": " << header.width << "x" << header.height << " through a cache of "
+              << texture.stats().cachePages << " pages (" << header.pageSize << " texels)" << std::endl;
+    return true;
+}
+
+glm::mat4 VirtualTextureView::move(GLFWwindow *window) {
+    const double now = glfwGetTime();
+    const float seconds = (float) (now - lastMoved);
+    lastMoved = now;
+    const float step = seconds / zoom;
+    if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS)
+        pan.x += step;
+    if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS)
+        pan.x -= step;
+    if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS)
+        pan.y -= step;
+    if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS)
+        pan.y += step;
+    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        zoom *= std::exp2(seconds * 2.0f);
+    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        zoom = std::max(zoom * std::exp2(-seconds * 2.0f), 0.5f);
+    pan = glm::clamp(pan, glm::vec2(-0.5f), glm::vec2(0.5f));
+    return glm::translate(glm::scale(glm::mat4(1.0f), glm::vec3(zoom)), glm::vec3(pan, 0.0f));
+}
+
+void VirtualTextureView::draw(const glm::mat4 &transform, int width, int height) {
+    texture.update();
+    texture.beginFeedback(width, height);
+    feedbackProgram->use();
+    texture.bind(*feedbackProgram, 0, true);
+    feedbackProgram->setMat4("transform", transform);
+    feedbackProgram->setVec4("uvTransform", glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+    glBindVertexArray(feedbackVertexArray);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+    texture.endFeedback();
+
+    program->use();
+    texture.bind(*program);
+    program->setMat4("transform", transform);
+    program->setVec4("uvTransform", glm::vec4(1.0f, 1.0f, 0.0f, 0.0f));
+    glBindVertexArray(vertexArray);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+}
+
+std::string VirtualTextureView::title() const {
+    const VirtualTextureStats &vt = texture.stats();
+    return "OpenGL - pages " + std::to_string(vt.residentPages) + "/" + std::to_string(vt.cachePages) +
+           " resident, " + std::to_string(vt.visiblePages) + " visible, " + std::to_string(vt.missingPages) +
+           " missing, " + std::to_string(vt.pendingLoads) + " loading, " + std::to_string(vt.uploads) + " up " +
+           std::to_string(vt.evictions) + " evicted";
+}
+
+void VirtualTextureView::report() const {
+    const VirtualTextureStats &vt = texture.stats();
+    std::cout << ", virtual texture: " << vt.residentPages << "/" << vt.cachePages << " pages resident, "
+              << vt.visiblePages << " visible (" << vt.missingPages << " missing), " << vt.totalUploads
+              << " uploads and " << vt.totalEvictions << " evictions so far, feedback took "
+              << vt.feedbackMilliseconds << " ms";
+}
@@ -0,0 +1,44 @@
+#ifndef OPENGLPLAYGROUND_VIRTUALTEXTUREVIEW_H
+#define OPENGLPLAYGROUND_VIRTUALTEXTUREVIEW_H
+
+#include <memory>
+#include <string>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include "GLShader.h"
+#include "VirtualTexture.h"
+
+// The --virtual mode: a virtual texture on the quad, which the arrow keys pan and W/S zoom into, far enough
+// to need its finest pages. It's drawn twice a frame, by the feedback program into its small target and then
+// for real, so each program gets a VAO.
+class VirtualTextureView {
+public:
+    // GL thread. VAOs of the quad in vertexBuffer and elementBuffer (see Playground.h).
+    VirtualTextureView(const VirtualTextureOptions &options, GLuint vertexBuffer, GLuint elementBuffer);
+    ~VirtualTextureView();
+    VirtualTextureView(const VirtualTextureView &) = delete;
+    VirtualTextureView &operator=(const VirtualTextureView &) = delete;
+
+    // GL thread
+    bool open(const char *path);
+
+    // Main thread: pans and zooms by the keys held since the last call. Returns the quad's transform.
+    glm::mat4 move(GLFWwindow *window);
+    // GL thread
+    void draw(const glm::mat4 &transform, int width, int height);
+    // Residency, for the title bar
+    std::string title() const;
+    // Appends the cache's state to the frame report's line
+    void report() const;
+
+private:
+    VirtualTexture texture;
+    std::unique_ptr<Shader> program, feedbackProgram;
+    GLuint vertexArray = 0, feedbackVertexArray = 0;
+    glm::vec2 pan = glm::vec2(0.0f);
+    float zoom = 2.0f;
+    double lastMoved;
+};
+
+#endif //OPENGLPLAYGROUND_VIRTUALTEXTUREVIEW_H
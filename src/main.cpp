@@ -1,10 +1,28 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
+#include "AssetRegistry.h"
+#include "AssetScheduler.h"
+#include "CommandLine.h"
+#include "FramePacer.h"
+#include "GLMesh.h"
 #include "GLShader.h"
+#include "JobSystem.h"
+#include "ModelView.h"
+#include "Playground.h"
+#include "RenderThread.h"
+#include "Reports.h"
+#include "SceneRenderer.h"
+#include "SceneSimulation.h"
+#include "TextureGrid.h"
+#include "VirtualTextureView.h"
 
 void processInput(GLFWwindow *window)
 {
@@ -12,7 +30,45 @@ void processInput(GLFWwindow *window)
         glfwSetWindowShouldClose(window, true);
 }
 
-int main() {
+// Everything the drawing of a frame needs from the main thread, which is on to the next one by then
+struct FramePacket {
+    uint64_t frame = 0;                           // the pacer's
+    int width = 0, height = 0;                    // framebuffer
+    glm::mat4 virtualTransform = glm::mat4(1.0f); // where the --virtual quad is
+    SceneFrame scene;
+    ModelFrame model;
+    SceneSimulationStats simulation;              // totals so far, as of this frame
+};
+
+struct SceneCamera {
+    glm::mat4 viewProjection;
+    glm::vec3 eye;
+    float projectionScale; // pixels per world unit at distance 1, for LODSelector
+};
+
+// Circles the scene's bounds, looking at their centre from a little above
+SceneCamera sceneCamera(const SceneBounds &bounds, float seconds, int width, int height) {
+    const glm::vec3 centre = (bounds.min + bounds.max) * 0.5f;
+    const float radius = std::max(glm::length(bounds.max - bounds.min) * 0.5f, 1e-3f);
+    const float angle = seconds * 0.2f;
+    SceneCamera camera;
+    camera.eye = centre + glm::vec3(std::sin(angle), 0.5f, std::cos(angle)) * radius * 1.2f;
+    camera.viewProjection = glm::perspective(glm::radians(60.0f), (float) width / (float) std::max(height, 1),
+                                             radius * 0.01f, radius * 4.0f) *
+                            glm::lookAt(camera.eye, centre, glm::vec3(0.0f, 1.0f, 0.0f));
+    camera.projectionScale = (float) height / (2.0f * std::tan(glm::radians(30.0f)));
+    return camera;
+}
+
+int main(int argc, char **argv) {
+    // Every parallelBlocks/parallelFor from this thread on (culling, transforms, the CPU backend, loaders)
+    // runs as jobs on these workers instead of starting threads each time
+    JobSystem jobs;
+    ViewerOptions options;
+    int result = 0;
+    if (runCommandLine(argc, argv, jobs, options, result))
+        return result;
+
     // Some setup
     glfwInit(); // Remember to terminate
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -32,20 +88,6 @@ int main() {
         return -1;
     }
 
-    // Vertices
-    float vertices[] = {
-            -0.5f,  0.5f, 1.0f, 0.0f, 0.0f, // Top-left
-            0.5f,  0.5f, 0.0f, 1.0f, 0.0f, // Top-right
-            0.5f, -0.5f, 0.0f, 0.0f, 1.0f, // Bottom-right
-            -0.5f, -0.5f, 1.0f, 1.0f, 1.0f  // Bottom-left
-
-    };
-
-    GLuint elements[] = {
-            0, 1, 2,
-            2, 3, 0
-    };
-
     { // Set up Vertex Array Object -> stores attribute links + VBO
         GLuint VAO;
         glGenVertexArrays(1, &VAO);
@@ -54,47 +96,209 @@ int main() {
         GLuint VBO;
         glGenBuffers(1, &VBO);
         glBindBuffer(GL_ARRAY_BUFFER, VBO); // This binds to the VAO
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
 
         GLuint EBO;
         glGenBuffers(1, &EBO);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(elements), elements, GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadElements), quadElements, GL_STATIC_DRAW);
 
         // Load some shaders:
-        Shader shaderProgram("../Assets/Shaders/VertexShader.glsl", "../Assets/Shaders/FragmentShader.glsl");
+        Shader shaderProgram(vertexShaderPath, fragmentShaderPath);
         shaderProgram.use();
 
         // Bind stuff to the VAO
-        // We already bound the VBO to GL_ARRAY_BUFFER
-        GLint posAttrib = glGetAttribLocation(shaderProgram.ID, "position"); // search by string
-        // This function will bind this information, and the VBO that is currently bound to GL_ARRAY_BUFFER
-        glVertexAttribPointer(posAttrib, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*) 0);
-        glEnableVertexAttribArray(posAttrib);
+        // We already bound the VBO to GL_ARRAY_BUFFER, the layout says where each shader input is in it
+        applyVertexLayout(quadLayout(), shaderProgram.ID);
+        shaderProgram.setMat4("transform", glm::mat4(1.0f));
+
+        // Models and packed textures stream in through the scheduler while the loop runs; it's declared after
+        // what its callbacks fill in, so it goes first. Content loaded twice (the same image or mesh under two
+        // paths, say) is shared through the registry.
+        AssetRegistry registry;
+        std::unique_ptr<ModelView> model;
+        std::unique_ptr<TextureGrid> textureGrid; // --texture and --atlas
+        AssetScheduler assets;
+        const double assetUploadBudget = 2.0; // ms of each frame
+        auto assetStart = std::chrono::steady_clock::now();
+        bool assetsReported = false;
+        if (options.modelPath) {
+            model.reset(new ModelView(options.modelPath, shaderProgram, registry));
+            model->request(assets);
+        }
+        if (!options.texturePaths.empty() || !options.atlasPaths.empty()) {
+            textureGrid.reset(new TextureGrid(registry, VBO, EBO));
+            if (!options.texturePaths.empty())
+                textureGrid->stream(options.texturePaths, options.compressTextures, options.textureCompression);
+            else
+                textureGrid->pack(assets, options.atlasPaths, options.packOptions);
+        }
+        std::unique_ptr<VirtualTextureView> virtualTexture;
+        if (options.virtualTexturePath) {
+            virtualTexture.reset(new VirtualTextureView(options.virtualTextureOptions, VBO, EBO));
+            if (!virtualTexture->open(options.virtualTexturePath))
+                return -1;
+        }
 
-        GLint colAttrib = glGetAttribLocation(shaderProgram.ID, "colour");
-        glVertexAttribPointer(colAttrib, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(2*sizeof(float)));
-        glEnableVertexAttribArray(colAttrib);
+        std::unique_ptr<Shader> sceneProgram;
+        std::unique_ptr<SceneRenderer> sceneRenderer;
+        std::unique_ptr<SceneSimulation> simulation;
+        if (options.scenePath) {
+            sceneProgram.reset(new Shader(sceneVertexShaderPath, sceneFragmentShaderPath));
+            sceneRenderer.reset(new SceneRenderer(jobs, registry));
+            if (!sceneRenderer->open(options.scenePath, *sceneProgram))
+                return -1;
+            simulation.reset(new SceneSimulation(options.simulationRate));
+            simulation->interpolate = options.interpolateSimulation;
+            simulation->attach(sceneRenderer->scene().transforms());
+            sceneRenderer->attachTransforms(simulation->transforms());
+        }
+        SceneSimulationStats reportedSimulation; // render thread, the totals at the last report
+        double simulationTime = glfwGetTime();
+
+        // GPU time of the draws, read back once the GPU says a result is ready so we never wait on it.
+        // Four queries in flight; a frame whose query is still busy when its slot comes round again
+        // just goes untimed
+        GLuint timers[4];
+        bool timerPending[4] = {};
+        glGenQueries(4, timers);
+        double gpuMilliseconds = 0.0;
+        int frame = 0, timedFrames = 0;
 
         // Render Loop
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE); // Wireframe
         // glPolygonMode(GL_FRONT_AND_BACK, GL_FILL); // Filled
-        while (!glfwWindowShouldClose(window)) {
-            processInput(window);
-
-            glClear(GL_COLOR_BUFFER_BIT);
+        // The main thread polls events, reads input and prepares each frame into a packet: the scene's
+        // transforms, LOD selection, culling and recording, and the model's LOD selection and meshlet
+        // culling, all run there, on its jobs. The render thread only does the GL calls for it, so the two
+        // work on consecutive frames at once. Window titles can only be set from the main
+        // thread, so the render thread leaves them in `title`.
+        const GLFWvidmode *videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        FramePacer pacer(options.pacing, videoMode ? videoMode->refreshRate : 0.0);
+        pacer.applySwapMode();
+        std::unique_ptr<RenderThread<FramePacket>> renderThread;
+        std::mutex titleMutex;
+        std::string title;
+        auto renderFrame = [&](FramePacket &packet) {
+            pacer.pollGPU();
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            assets.update(assetUploadBudget);
+            if (model && !model->update(assets))
+                glfwSetWindowShouldClose(window, true);
+            if (textureGrid && !textureGrid->update(assets))
+                glfwSetWindowShouldClose(window, true);
+            if (!assetsReported && (model || !options.atlasPaths.empty()) && !assets.busy()) {
+                reportAssetStreaming(assets.stats(), std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - assetStart).count());
+                reportAssetRegistry(registry.stats());
+                assetsReported = true;
+            }
             //glDrawArrays(GL_TRIANGLES, 0, 3);
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            timerPending[frame & 3] = false;
+            glBeginQuery(GL_TIME_ELAPSED, timers[frame & 3]);
+            if (virtualTexture) {
+                virtualTexture->draw(packet.virtualTransform, packet.width, packet.height);
+                // Residency every frame, in the title bar
+                std::lock_guard<std::mutex> lock(titleMutex);
+                title = virtualTexture->title();
+            } else if (textureGrid && !textureGrid->empty()) {
+                // A grid of quads, one per texture, filling the window
+                textureGrid->draw();
+            } else if (sceneRenderer) {
+                sceneRenderer->submit(packet.scene);
+            } else if (model && model->ready()) {
+                model->draw(packet.model);
+            } else {
+                glBindVertexArray(VAO);
+                glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            pacer.submitted(packet.frame);
+            timerPending[frame & 3] = true;
+            // Oldest first, results become available in submission order
+            for (int i = 1; i <= 4; i++) {
+                const int slot = (frame + i) & 3;
+                if (!timerPending[slot])
+                    continue;
+                GLuint available = GL_FALSE;
+                glGetQueryObjectuiv(timers[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+                if (!available)
+                    break;
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(timers[slot], GL_QUERY_RESULT, &nanoseconds);
+                gpuMilliseconds += (double) nanoseconds / 1e6;
+                timedFrames++;
+                timerPending[slot] = false;
+            }
+            if (++frame % 300 == 0) {
+                std::cout << "GPU: " << (timedFrames ? gpuMilliseconds / timedFrames : 0.0) << " ms/frame";
+                if (model)
+                    model->report();
+                if (virtualTexture)
+                    virtualTexture->report();
+                std::cout << std::endl;
+                if (sceneRenderer) {
+                    reportSceneDrawing(sceneRenderer->stats());
+                    sceneRenderer->resetStats();
+                    reportSimulation(reportedSimulation, packet.simulation, options.simulationRate,
+                                     options.interpolateSimulation);
+                    reportedSimulation = packet.simulation;
+                    // Drawing without the recording has the GL thread reading the transforms, which only
+                    // holds still for it without a render thread
+                    if (!renderThread->threaded())
+                        sceneRenderer->recordCommands = !sceneRenderer->recordCommands;
+                }
+                reportRenderThread(renderThread->stats(), renderThread->threaded());
+                renderThread->resetStats();
+                reportFramePacing(pacer.stats(), pacer.swapMode(), options.pacing);
+                pacer.resetStats();
+                reportJobs(jobs);
+                jobs.resetStats();
+                gpuMilliseconds = 0.0;
+                timedFrames = 0;
+            }
+        };
+        renderThread.reset(new RenderThread<FramePacket>(window, options.renderThreadDepth, renderFrame,
+                                                         [&](FramePacket &packet) { pacer.swapped(packet.frame); }));
 
-            glfwSwapBuffers(window);
+        while (!glfwWindowShouldClose(window)) {
+            // A packet to fill first: waiting for one is waiting for the render thread, and input read before
+            // that would be stale by the time it's used. Then the pacer's sleep, for the same reason.
+            FramePacket &packet = renderThread->begin();
+            packet.frame = pacer.beginFrame();
             glfwPollEvents();
+            processInput(window);
+            glfwGetFramebufferSize(window, &packet.width, &packet.height);
+            if (virtualTexture)
+                packet.virtualTransform = virtualTexture->move(window);
+            if (model)
+                model->prepare(packet.model, packet.height);
+            if (sceneRenderer) {
+                // As many fixed steps as the time since the last frame holds, then the nodes drawn where
+                // they'd be in between the last two
+                const double now = glfwGetTime();
+                simulation->advance(now - simulationTime);
+                simulationTime = now;
+                packet.simulation = simulation->stats();
+                const SceneCamera camera = sceneCamera(sceneRenderer->scene().header().bounds, (float) now,
+                                                       packet.width, packet.height);
+                sceneRenderer->prepare(packet.scene, camera.viewProjection, camera.eye, camera.projectionScale);
+            }
+            renderThread->submit();
+            std::lock_guard<std::mutex> lock(titleMutex);
+            if (!title.empty()) {
+                glfwSetWindowTitle(window, title.c_str());
+                title.clear();
+            }
         }
+        // The GL objects below go with the context back on this thread
+        renderThread->stop();
 
+        glDeleteQueries(4, timers);
         glDeleteBuffers(1, &VBO);
         glDeleteVertexArrays(1, &VAO);
     } // VAO
 
     glfwTerminate();
 }
-
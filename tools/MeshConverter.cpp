@@ -0,0 +1,73 @@
+// Offline mesh preprocessor: OBJ/GLB -> .mesh (see src/MeshCache.h).
+//
+// Usage: MeshConverter [--compress] [--no-optimize] [--no-lods] [--strips] <source.obj|source.glb> [<output.mesh>]
+//
+// The output defaults to the source path + ".mesh", which is where CachedMesh::load looks, so running this
+// over the asset folder at build time means the game never parses a text mesh.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "../src/MeshCache.h"
+
+int main(int argc, char **argv) {
+    MeshImportOptions options;
+    const char *source = nullptr, *output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--compress")
+            options.compress = true;
+        else if (std::string(argv[i]) == "--no-optimize")
+            options.optimize = false;
+        else if (std::string(argv[i]) == "--no-lods")
+            options.lods = false;
+        else if (std::string(argv[i]) == "--strips")
+            options.strips = true;
+        else if (!source)
+            source = argv[i];
+        else if (!output)
+            output = argv[i];
+    }
+    if (!source) {
+        std::cerr << "Usage: " << argv[0] << " [--compress] [--no-optimize] [--no-lods] [--strips] <source.obj|source.glb> [<output.mesh>]" << std::endl;
+        return 1;
+    }
+    const std::string defaultOutput = std::string(source) + ".mesh";
+    if (!output)
+        output = defaultOutput.c_str();
+
+    auto start = std::chrono::steady_clock::now();
+    MeshSourceStamp stamp;
+    MeshData mesh;
+    MeshImportReport report;
+    if (!meshSourceStamp(source, stamp) || !importMesh(source, mesh, options, &report)) {
+        std::cerr << "Could not read file " << source << std::endl;
+        return 1;
+    }
+    auto loaded = std::chrono::steady_clock::now();
+    if (!writeMeshCache(output, mesh, stamp, options))
+        return 1;
+    auto written = std::chrono::steady_clock::now();
+
+    MeshSourceStamp result;
+    meshSourceStamp(output, result);
+    std::cout << source << " -> " << output << ": " << mesh.vertexCount << " vertices, "
+              << report.indices.listBytes / (3 * sizeof(uint32_t)) << " triangles (all LODs), " << mesh.submeshes.size() << " submeshes, " << stamp.size / 1024 << " KiB -> "
+              << result.size / 1024 << " KiB (import " << std::chrono::duration<double, std::milli>(loaded - start).count()
+              << " ms, write " << std::chrono::duration<double, std::milli>(written - loaded).count() << " ms)" << std::endl;
+    if (options.optimize)
+        std::cout << "  ACMR " << report.optimize.acmrBefore << " -> " << report.optimize.acmrAfter << ", ATVR "
+                  << report.optimize.atvrBefore << " -> " << report.optimize.atvrAfter << ", "
+                  << report.optimize.clusters << " overdraw clusters" << std::endl;
+    const IndexPackStats &packed = report.indices;
+    std::cout << "  indices: " << (packed.type == ComponentType::UnsignedShort ? "16" : "32") << " bit "
+              << (packed.strips ? "strips" : "list") << " in " << packed.batches << " batches, " << packed.packedBytes / 1024
+              << " KiB vs " << packed.listBytes / 1024 << " KiB as a 32 bit list (" << packed.savedBytes() / 1024
+              << " KiB saved)" << std::endl;
+    if (options.lods) {
+        std::cout << "  " << mesh.lods.size() << " LODs in " << report.lodSeconds * 1000.0 << " ms:";
+        for (const MeshLOD &lod : mesh.lods)
+            std::cout << " " << lod.indexCount << " indices (error " << lod.error << ")";
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+// Writes a .scene (see src/SceneFile.h) with a generated hierarchy, for trying out scene loading and the
+// transform pass at sizes no hand made scene gets to.
+//
+// Usage: SceneBuilder [--nodes <count>] [--fanout <children>] [--materials <count>] <output.scene> [<mesh.obj|mesh.glb> ...]
+//
+// Nodes are laid out breadth first, each with up to `fanout` children scattered around it. The leaves get
+// the meshes in turn (their bounds come from loading them, through the .mesh cache) and the materials
+// likewise; without meshes every leaf is a unit cube called "cube".
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include "../src/MeshCache.h"
+#include "../src/SceneFile.h"
+
+int main(int argc, char **argv) {
+    size_t nodeCount = 1000000, fanout = 8, materialCount = 4;
+    const char *output = nullptr;
+    std::vector<std::string> meshPaths;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--nodes" && i + 1 < argc)
+            nodeCount = (size_t) std::atol(argv[++i]);
+        else if (std::string(argv[i]) == "--fanout" && i + 1 < argc)
+            fanout = (size_t) std::max(std::atol(argv[++i]), 1l);
+        else if (std::string(argv[i]) == "--materials" && i + 1 < argc)
+            materialCount = (size_t) std::max(std::atol(argv[++i]), 1l);
+        else if (!output)
+            output = argv[i];
+        else
+            meshPaths.push_back(argv[i]);
+    }
+    if (!output || nodeCount == 0) {
+        std::cerr << "Usage: " << argv[0] << " [--nodes <count>] [--fanout <children>] [--materials <count>] <output.scene> [<mesh.obj|mesh.glb> ...]" << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    SceneData scene;
+    std::vector<SceneBounds> meshBounds;
+    for (const std::string &path : meshPaths) {
+        CachedMesh mesh;
+        if (!mesh.load(path.c_str()))
+            return 1;
+        scene.meshPaths.push_back(path);
+        meshBounds.push_back({ mesh.boundsMin, mesh.boundsMax });
+    }
+    if (meshPaths.empty()) {
+        scene.meshPaths.push_back("cube");
+        meshBounds.push_back({ glm::vec3(-0.5f), glm::vec3(0.5f) });
+    }
+    for (size_t m = 0; m < materialCount; m++)
+        scene.materialNames.push_back("material" + std::to_string(m));
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f), angles(0.0f, 6.2831853f), scales(0.8f, 1.2f);
+    size_t leaves = 0;
+    for (size_t i = 0; i < nodeCount; i++) {
+        const uint32_t parent = i == 0 ? TRANSFORM_NO_PARENT : (uint32_t) ((i - 1) / fanout);
+        const float angle = angles(random) * 0.5f;
+        const glm::vec4 rotation(0.0f, std::sin(angle), 0.0f, std::cos(angle)); // about y
+        const glm::vec3 translation = i == 0 ? glm::vec3(0.0f) : glm::vec3(unit(random), unit(random), unit(random)) * 4.0f;
+        uint32_t mesh = SCENE_NONE, material = SCENE_NONE;
+        SceneBounds bounds = {};
+        if (i * fanout + 1 >= nodeCount) {
+            mesh = (uint32_t) (leaves % scene.meshPaths.size());
+            material = (uint32_t) (leaves % materialCount);
+            bounds = meshBounds[mesh];
+            leaves++;
+        }
+        scene.addNode(parent, translation, rotation, glm::vec3(scales(random)), mesh, material, bounds);
+    }
+    auto built = std::chrono::steady_clock::now();
+    if (!writeScene(scene, output))
+        return 1;
+    auto written = std::chrono::steady_clock::now();
+
+    SceneFile result;
+    if (!result.open(output))
+        return 1;
+    const SceneBounds &bounds = result.header().bounds;
+    std::cout << output << ": " << nodeCount << " nodes (" << leaves << " with meshes), " << result.meshCount()
+              << " meshes, " << result.materialCount() << " materials, " << result.header().fileSize / 1024
+              << " KiB, bounds (" << bounds.min.x << ", " << bounds.min.y << ", " << bounds.min.z << ") - ("
+              << bounds.max.x << ", " << bounds.max.y << ", " << bounds.max.z << ") (generate "
+              << std::chrono::duration<double, std::milli>(built - start).count() << " ms, write "
+              << std::chrono::duration<double, std::milli>(written - built).count() << " ms)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,483 @@
+// Build-time GLSL -> C++ translator for the CPU backend.
+//
+// Usage: ShaderTranslator <output.cpp> <vertex.glsl> <fragment.glsl> [<vertex.glsl> <fragment.glsl> ...]
+//
+// Handles the GLSL 330 subset our shaders use: in/out/uniform globals, float/vecN/matN maths, swizzle reads,
+// helper functions and constants. Each shader becomes a C++ struct whose members are the GLSL globals and whose
+// main() is the GLSL main() copied token for token. GLSL maths is valid C++ once the types come from
+// SWShaderLanguage.h, where every float/vec is 8 lanes wide, so only a handful of tokens need rewriting:
+//   float -> Float, 1.0 -> 1.0f, v.zyx -> v.swz<2,1,0>(), v.r -> v.x
+// Each pair is registered under shaderProgramName(vertex, fragment), the same name the GL Shader gets.
+
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../src/ShaderProgramName.h"
+
+struct Token {
+    enum Kind { Identifier, Number, Punctuation } kind;
+    std::string text;
+    int line;
+    bool newlineBefore; // used to keep the generated code roughly as laid out as the source
+    bool spaceBefore;
+};
+
+struct Variable {
+    std::string type;
+    std::string name;
+};
+
+struct ShaderSource {
+    std::string path;
+    std::vector<Variable> inputs, outputs, uniforms;
+    std::vector<Token> members;  // global constants / variables, already translated
+    std::vector<Token> functions; // helper functions + main, already translated
+};
+
+static std::string currentFile;
+
+static void fail(int line, const std::string &message) {
+    std::cerr << "ERROR::SHADERTRANSLATOR::" << currentFile << ":" << line << ": " << message << std::endl;
+    std::exit(1);
+}
+
+static bool readWholeFile(const std::string &path, std::string &out) {
+    std::ifstream file(path, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+        return false;
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+static std::vector<Token> tokenize(const std::string &src) {
+    std::vector<Token> tokens;
+    int line = 1;
+    bool newline = true, space = false;
+    size_t i = 0;
+    while (i < src.size()) {
+        char c = src[i];
+        if (c == '\n') { line++; newline = true; i++; continue; }
+        if (std::isspace((unsigned char) c)) { space = true; i++; continue; }
+        if (c == '/' && i + 1 < src.size() && src[i + 1] == '/') {
+            while (i < src.size() && src[i] != '\n') i++;
+            continue;
+        }
+        if (c == '/' && i + 1 < src.size() && src[i + 1] == '*') {
+            i += 2;
+            while (i + 1 < src.size() && !(src[i] == '*' && src[i + 1] == '/')) {
+                if (src[i] == '\n') { line++; newline = true; }
+                i++;
+            }
+            i += 2;
+            continue;
+        }
+        if (c == '#') { // Preprocessor: #version is meaningless here, everything else we don't support
+            size_t end = src.find('\n', i);
+            std::string directive = src.substr(i, end == std::string::npos ? std::string::npos : end - i);
+            if (directive.compare(0, 8, "#version") != 0)
+                fail(line, "preprocessor directives are not supported: " + directive);
+            i = end == std::string::npos ? src.size() : end;
+            continue;
+        }
+
+        Token t;
+        t.line = line;
+        t.newlineBefore = newline;
+        t.spaceBefore = space;
+        newline = space = false;
+        size_t start = i;
+        if (std::isalpha((unsigned char) c) || c == '_') {
+            while (i < src.size() && (std::isalnum((unsigned char) src[i]) || src[i] == '_')) i++;
+            t.kind = Token::Identifier;
+        } else if (std::isdigit((unsigned char) c) || (c == '.' && i + 1 < src.size() && std::isdigit((unsigned char) src[i + 1]))) {
+            while (i < src.size() && (std::isalnum((unsigned char) src[i]) || src[i] == '.' ||
+                                      ((src[i] == '+' || src[i] == '-') && (src[i - 1] == 'e' || src[i - 1] == 'E'))))
+                i++;
+            t.kind = Token::Number;
+        } else {
+            static const char *twoChar[] = { "+=", "-=", "*=", "/=", "==", "!=", "<=", ">=", "&&", "||", "++", "--" };
+            i++;
+            for (const char *op : twoChar)
+                if (src.compare(start, 2, op) == 0) { i = start + 2; break; }
+            t.kind = Token::Punctuation;
+        }
+        t.text = src.substr(start, i - start);
+        tokens.push_back(t);
+    }
+    return tokens;
+}
+
+static int componentCount(const std::string &type, int line) {
+    if (type == "float") return 1;
+    if (type == "vec2") return 2;
+    if (type == "vec3") return 3;
+    if (type == "vec4") return 4;
+    fail(line, "only float and vec2/3/4 can be shader inputs and outputs, not " + type);
+    return 0;
+}
+
+static std::string uniformCppType(const std::string &type, int line) {
+    if (type == "float") return "float";
+    if (type == "int" || type == "bool") return "int";
+    if (type == "vec2" || type == "vec3" || type == "vec4" || type == "mat3" || type == "mat4") return "glm::" + type;
+    if (type.compare(0, 7, "sampler") == 0) fail(line, "sampler uniforms are not supported by the CPU backend yet");
+    fail(line, "unsupported uniform type " + type);
+    return "";
+}
+
+// .zyx -> .swz<2,1,0>(), .r -> .x, or "" if the field isn't a swizzle
+static std::string translateSwizzle(const std::string &field) {
+    static const char *sets[] = { "xyzw", "rgba", "stpq" };
+    if (field.size() > 4)
+        return "";
+    for (const char *set : sets) {
+        std::string letters(set);
+        if (field.find_first_not_of(letters) != std::string::npos)
+            continue;
+        if (field.size() == 1)
+            return std::string(1, "xyzw"[letters.find(field[0])]);
+        std::string out = "swz<";
+        for (size_t k = 0; k < field.size(); k++)
+            out += (k ? "," : "") + std::to_string(letters.find(field[k]));
+        return out + ">()";
+    }
+    return "";
+}
+
+// Rewrites the few GLSL tokens that don't mean the same thing in C++ (see the comment at the top)
+static std::vector<Token> translateTokens(const std::vector<Token> &in) {
+    static const std::set<std::string> unsupported = {
+            "discard", "gl_FragCoord", "gl_FragColor", "gl_VertexID", "gl_InstanceID", "struct", "texture" };
+    std::vector<Token> out;
+    for (size_t i = 0; i < in.size(); i++) {
+        Token t = in[i];
+        if (t.kind == Token::Identifier) {
+            if (unsupported.count(t.text))
+                fail(t.line, "'" + t.text + "' is not supported by the CPU backend yet");
+            if (t.text == "float")
+                t.text = "Float";
+        } else if (t.kind == Token::Number) {
+            bool isFloat = t.text.find('.') != std::string::npos ||
+                           (t.text.compare(0, 2, "0x") != 0 && t.text.find_first_of("eE") != std::string::npos);
+            char last = t.text.back();
+            if (last == 'u' || last == 'U')
+                t.text.pop_back();
+            else if (isFloat && last != 'f' && last != 'F')
+                t.text += "f";
+        } else if (t.text == "." && i + 1 < in.size() && in[i + 1].kind == Token::Identifier) {
+            Token field = in[++i];
+            std::string swizzle = translateSwizzle(field.text);
+            if (!swizzle.empty()) {
+                // Only assignments write: `a.xy != b.xy` and `a.xy <= b.xy` are fine
+                static const std::set<std::string> assignments = { "=", "+=", "-=", "*=", "/=" };
+                if (field.text.size() > 1 && i + 1 < in.size() && assignments.count(in[i + 1].text))
+                    fail(field.line, "swizzle writes are not supported by the CPU backend");
+                field.text = swizzle;
+            }
+            out.push_back(t);
+            out.push_back(field);
+            continue;
+        }
+        out.push_back(t);
+    }
+    return out;
+}
+
+static ShaderSource parseShader(const std::string &path) {
+    ShaderSource shader;
+    shader.path = path;
+    currentFile = path;
+    std::string src;
+    if (!readWholeFile(path, src))
+        fail(0, "could not read file");
+    std::vector<Token> tokens = tokenize(src);
+
+    size_t i = 0;
+    auto expect = [&](const char *text) {
+        if (i >= tokens.size() || tokens[i].text != text)
+            fail(i < tokens.size() ? tokens[i].line : 0, std::string("expected '") + text + "'");
+        i++;
+    };
+    // Copies tokens up to and including the matching closing brace / the terminating semicolon
+    auto copyUntil = [&](std::vector<Token> &dest, bool braces) {
+        int depth = 0;
+        while (i < tokens.size()) {
+            const Token &t = tokens[i++];
+            dest.push_back(t);
+            if (t.text == "{") depth++;
+            if (t.text == "}" && --depth == 0 && braces) return;
+            if (t.text == ";" && depth == 0 && !braces) return;
+        }
+        fail(tokens.back().line, "unexpected end of file");
+    };
+
+    while (i < tokens.size()) {
+        const Token &t = tokens[i];
+        if (t.text == "layout") { // layout(location = 0) etc. mean nothing here
+            while (i < tokens.size() && tokens[i].text != ")") i++;
+            i++;
+            continue;
+        }
+        if (t.text == "precision") {
+            while (i < tokens.size() && tokens[i].text != ";") i++;
+            i++;
+            continue;
+        }
+        if (t.text == "flat" || t.text == "smooth" || t.text == "noperspective") {
+            if (t.text == "flat")
+                std::cerr << path << ":" << t.line << ": warning: flat varyings are interpolated on the CPU" << std::endl;
+            i++;
+            continue;
+        }
+        if (t.text == "in" || t.text == "out" || t.text == "uniform") {
+            std::vector<Variable> &list = t.text == "in" ? shader.inputs : (t.text == "out" ? shader.outputs : shader.uniforms);
+            i++;
+            std::string type = tokens[i++].text;
+            do {
+                if (tokens[i].kind != Token::Identifier)
+                    fail(tokens[i].line, "expected a variable name");
+                list.push_back({ type, tokens[i++].text });
+                if (tokens[i].text == "[")
+                    fail(tokens[i].line, "arrays are not supported by the CPU backend yet");
+            } while (tokens[i].text == "," && ++i);
+            expect(";");
+            continue;
+        }
+        // Anything else is a global variable/constant or a function: look ahead for '(' before ';' or '='
+        size_t j = i;
+        while (j < tokens.size() && tokens[j].text != "(" && tokens[j].text != ";" && tokens[j].text != "=") j++;
+        if (j < tokens.size() && tokens[j].text == "(") {
+            std::vector<Token> function;
+            copyUntil(function, true);
+            shader.functions.insert(shader.functions.end(), function.begin(), function.end());
+        } else {
+            std::vector<Token> member;
+            copyUntil(member, false);
+            shader.members.insert(shader.members.end(), member.begin(), member.end());
+        }
+    }
+
+    // GLSL parameter qualifiers: `in` is the default, out/inout become references
+    std::vector<Token> functions;
+    for (size_t k = 0; k < shader.functions.size(); k++) {
+        const Token &t = shader.functions[k];
+        if ((t.text == "in" || t.text == "out" || t.text == "inout" || t.text == "const") && k + 2 < shader.functions.size() &&
+            shader.functions[k + 1].kind == Token::Identifier && shader.functions[k + 2].kind == Token::Identifier) {
+            if (t.text == "out" || t.text == "inout") {
+                Token type = shader.functions[k + 1], ref = t;
+                ref.text = "&";
+                type.newlineBefore = t.newlineBefore;
+                functions.push_back(type);
+                functions.push_back(ref);
+                k++;
+            }
+            continue;
+        }
+        functions.push_back(t);
+    }
+    shader.functions = translateTokens(functions);
+    shader.members = translateTokens(shader.members);
+    return shader;
+}
+
+static void emitTokens(std::ostream &out, const std::vector<Token> &tokens, int baseIndent) {
+    int depth = 0;
+    bool first = true;
+    for (const Token &t : tokens) {
+        if (t.text == "}") depth--;
+        if (t.newlineBefore || first) {
+            out << "\n" << std::string((size_t) (baseIndent + depth) * 4, ' ');
+        } else if (t.spaceBefore) {
+            out << " ";
+        }
+        out << t.text;
+        if (t.text == "{") depth++;
+        first = false;
+    }
+    out << "\n";
+}
+
+static void emitStage(std::ostream &out, const char *structName, const ShaderSource &shader,
+                      const std::vector<Variable> &uniforms, const std::vector<Variable> &extraOutputs) {
+    out << "struct " << structName << " {\n";
+    for (const Variable &u : uniforms)
+        out << "    const " << uniformCppType(u.type, 0) << " &" << u.name << ";\n";
+    for (const Variable &v : shader.inputs)
+        out << "    " << (v.type == "float" ? "Float" : v.type) << " " << v.name << ";\n";
+    for (const Variable &v : shader.outputs)
+        out << "    " << (v.type == "float" ? "Float" : v.type) << " " << v.name << ";\n";
+    for (const Variable &v : extraOutputs)
+        out << "    " << v.type << " " << v.name << ";\n";
+    if (!shader.members.empty())
+        emitTokens(out, shader.members, 1);
+    out << "\n    explicit " << structName << "(const Uniforms &u_)";
+    for (size_t k = 0; k < uniforms.size(); k++)
+        out << (k ? ", " : " : ") << uniforms[k].name << "(u_." << uniforms[k].name << ")";
+    out << " {}\n";
+    emitTokens(out, shader.functions, 1);
+    out << "};\n\n";
+}
+
+static void emitLoad(std::ostream &out, const Variable &v, const char *array, int first) {
+    int n = componentCount(v.type, 0);
+    out << "    s." << v.name << " = " << (n == 1 ? "Float" : v.type) << "(";
+    for (int c = 0; c < n; c++)
+        out << (c ? ", " : "") << array << "[" << first + c << "]";
+    out << ");\n";
+}
+
+static void emitStore(std::ostream &out, const std::string &name, int components, const char *array, int first) {
+    static const char *fields[] = { ".x", ".y", ".z", ".w" };
+    for (int c = 0; c < components; c++)
+        out << "    " << array << "[" << first + c << "] = s." << name << (components == 1 ? "" : fields[c]) << ".v;\n";
+}
+
+static void emitProgram(std::ostream &out, const std::string &vertexPath, const std::string &fragmentPath, int index) {
+    ShaderSource vs = parseShader(vertexPath);
+    ShaderSource fs = parseShader(fragmentPath);
+    std::string programName = shaderProgramName(vertexPath.c_str(), fragmentPath.c_str());
+
+    // Uniforms are shared between the two stages, like in a linked GL program
+    std::vector<Variable> uniforms = vs.uniforms;
+    for (const Variable &u : fs.uniforms) {
+        bool found = false;
+        for (const Variable &existing : uniforms) {
+            if (existing.name != u.name) continue;
+            if (existing.type != u.type) {
+                currentFile = fragmentPath;
+                fail(0, "uniform " + u.name + " has a different type in the vertex shader");
+            }
+            found = true;
+        }
+        if (!found) uniforms.push_back(u);
+    }
+
+    // Only the vertex outputs the fragment shader reads become varyings, everything else is dead
+    // (each varying costs a plane evaluation per pixel)
+    struct Varying { Variable variable; int first; };
+    std::vector<Varying> varyings;
+    int varyingComponents = 0;
+    currentFile = fragmentPath;
+    for (const Variable &in : fs.inputs) {
+        bool found = false;
+        for (const Variable &v : vs.outputs) {
+            if (v.name != in.name) continue;
+            if (v.type != in.type) fail(0, "varying " + in.name + " has a different type in the vertex shader");
+            found = true;
+        }
+        if (!found) fail(0, "fragment input " + in.name + " is not written by the vertex shader");
+        varyings.push_back({ in, varyingComponents });
+        varyingComponents += componentCount(in.type, 0);
+    }
+    if (fs.outputs.size() != 1)
+        fail(0, "the fragment shader must have exactly one output");
+    int colourComponents = componentCount(fs.outputs[0].type, 0);
+    if (colourComponents < 3)
+        fail(0, "the fragment output must be a vec3 or vec4");
+    if (varyingComponents > 16)
+        fail(0, "too many varying components for the CPU backend (max 16)");
+
+    int attributeComponents = 0;
+    for (const Variable &v : vs.inputs)
+        attributeComponents += componentCount(v.type, 0);
+    if (attributeComponents > 16) {
+        currentFile = vertexPath;
+        fail(0, "too many vertex input components for the CPU backend (max 16)");
+    }
+
+    out << "// " << programName << "\n";
+    out << "namespace program" << index << " {\n\n";
+    out << "struct Uniforms {\n";
+    for (const Variable &u : uniforms)
+        out << "    " << uniformCppType(u.type, 0) << " " << u.name << ";\n";
+    if (uniforms.empty())
+        out << "    int unused;\n";
+    out << "};\n\n";
+
+    emitStage(out, "VertexStage", vs, uniforms, { { "vec4", "gl_Position" } });
+    emitStage(out, "FragmentStage", fs, uniforms, {});
+
+    out << "void vertexKernel(const Float8 *in_, Float8 *position_, Float8 *varyings_, const void *uniforms_) {\n";
+    out << "    VertexStage s(*static_cast<const Uniforms *>(uniforms_));\n";
+    int first = 0;
+    for (const Variable &v : vs.inputs) {
+        emitLoad(out, v, "in_", first);
+        first += componentCount(v.type, 0);
+    }
+    out << "    s.main();\n";
+    emitStore(out, "gl_Position", 4, "position_", 0);
+    for (const Varying &v : varyings)
+        emitStore(out, v.variable.name, componentCount(v.variable.type, 0), "varyings_", v.first);
+    out << "}\n\n";
+
+    out << "void fragmentKernel(const Float8 *varyings_, Float8 *colour_, const void *uniforms_) {\n";
+    out << "    FragmentStage s(*static_cast<const Uniforms *>(uniforms_));\n";
+    for (const Varying &v : varyings)
+        emitLoad(out, v.variable, "varyings_", v.first);
+    out << "    s.main();\n";
+    emitStore(out, fs.outputs[0].name, colourComponents, "colour_", 0);
+    if (colourComponents == 3)
+        out << "    colour_[3] = f8Set1(1.0f);\n";
+    out << "}\n\n";
+
+    out << "const SWAttributeInfo attributes[] = {\n";
+    first = 0;
+    for (const Variable &v : vs.inputs) {
+        out << "    { \"" << v.name << "\", " << first << ", " << componentCount(v.type, 0) << " },\n";
+        first += componentCount(v.type, 0);
+    }
+    if (vs.inputs.empty())
+        out << "    { \"\", 0, 0 },\n";
+    out << "};\n\n";
+    out << "const SWUniformInfo uniforms[] = {\n";
+    for (const Variable &u : uniforms)
+        out << "    { \"" << u.name << "\", offsetof(Uniforms, " << u.name << "), sizeof(Uniforms::" << u.name << ") },\n";
+    if (uniforms.empty())
+        out << "    { \"\", 0, 0 },\n";
+    out << "};\n\n";
+    out << "const SWProgram program = {\n"
+        << "    \"" << programName << "\", " << attributeComponents << ", " << varyingComponents << ",\n"
+        << "    vertexKernel, fragmentKernel,\n"
+        << "    attributes, " << vs.inputs.size() << ", uniforms, " << uniforms.size() << ", sizeof(Uniforms)\n"
+        << "};\n"
+        << "const SWProgramRegistration registration(&program);\n\n";
+    out << "} // namespace program" << index << "\n\n";
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4 || (argc - 2) % 2 != 0) {
+        std::cerr << "Usage: " << argv[0] << " <output.cpp> <vertex.glsl> <fragment.glsl> [<vertex.glsl> <fragment.glsl> ...]"
+                  << std::endl;
+        return 1;
+    }
+
+    std::stringstream out;
+    out << "// Generated by ShaderTranslator from the GLSL sources below. Do not edit, edit the .glsl files instead.\n";
+    for (int i = 2; i < argc; i++)
+        out << "//   " << shaderFileStem(argv[i]) << ".glsl\n";
+    out << "\n#include <cstddef>\n#include \"SWShaderLanguage.h\"\n#include \"SWProgramRegistry.h\"\n\n";
+    out << "namespace {\n\nusing namespace swsl;\n\n";
+    for (int i = 2; i < argc; i += 2)
+        emitProgram(out, argv[i], argv[i + 1], (i - 2) / 2);
+    out << "} // namespace\n";
+
+    // Only touch the output when it changed, so an edit that translates the same doesn't recompile it. The
+    // build goes by a stamp written after this instead, or it would run the translator every time.
+    std::string existing;
+    if (readWholeFile(argv[1], existing) && existing == out.str())
+        return 0;
+    std::ofstream file(argv[1], std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Could not write file " << argv[1] << std::endl;
+        return 1;
+    }
+    file << out.str();
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Offline image -> .vtex tiler for virtual texturing (see src/VirtualTextureFile.h).
+//
+// Usage: VirtualTextureBuilder [--page <texels>] [--border <texels>] [--kaiser] <source.png|source.jpg> [<output.vtex>]
+//
+// The output defaults to the source path + ".vtex". The source still has to decode into memory here, it's
+// the GPU that only ever holds the pages in view.
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "../src/VirtualTextureFile.h"
+
+int main(int argc, char **argv) {
+    VirtualTextureBuildOptions options;
+    const char *source = nullptr, *output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--page" && i + 1 < argc)
+            options.pageSize = std::atoi(argv[++i]);
+        else if (std::string(argv[i]) == "--border" && i + 1 < argc)
+            options.border = std::atoi(argv[++i]);
+        else if (std::string(argv[i]) == "--kaiser")
+            options.mipOptions.filter = MipFilter::Kaiser;
+        else if (!source)
+            source = argv[i];
+        else if (!output)
+            output = argv[i];
+    }
+    if (!source) {
+        std::cerr << "Usage: " << argv[0] << " [--page <texels>] [--border <texels>] [--kaiser] <source.png|source.jpg> [<output.vtex>]" << std::endl;
+        return 1;
+    }
+    const std::string defaultOutput = std::string(source) + ".vtex";
+    if (!output)
+        output = defaultOutput.c_str();
+
+    auto start = std::chrono::steady_clock::now();
+    Image image;
+    if (!loadImage(source, image)) {
+        std::cerr << "Could not read file " << source << std::endl;
+        return 1;
+    }
+    const int width = image.width, height = image.height;
+    auto loaded = std::chrono::steady_clock::now();
+    if (!writeVirtualTexture(std::move(image), output, options))
+        return 1;
+    auto written = std::chrono::steady_clock::now();
+
+    VirtualTextureFile result;
+    if (!result.open(output))
+        return 1;
+    size_t pages = 0;
+    for (int l = 0; l < result.levelCount(); l++)
+        pages += (size_t) result.level(l).pagesWide * result.level(l).pagesHigh;
+    std::cout << source << " -> " << output << ": " << width << "x" << height << ", " << result.levelCount()
+              << " levels, " << pages << " pages of " << options.pageSize << " (+" << options.border << " border), "
+              << pages * result.header().tileBytes() / (1024 * 1024) << " MiB (decode "
+              << std::chrono::duration<double, std::milli>(loaded - start).count() << " ms, mips and tiles "
+              << std::chrono::duration<double, std::milli>(written - loaded).count() << " ms)" << std::endl;
+    return 0;
+}